@@ -379,6 +379,7 @@ let package = Package(
         "internal/platform/implementation/g3",
         "internal/platform/implementation/apple/Tests",
         "internal/platform/implementation/apple/Mediums/Ble/Sockets/Tests",
+        "internal/platform/implementation/linux",
         "internal/platform/implementation/windows",
         "third_party",
         "CONTRIBUTING.md",
@@ -418,6 +419,8 @@ let package = Package(
         "connections/listeners_test.cc",
         "connections/strategy_test.cc",
         "connections/implementation/offline_frames_test.cc",
+        "connections/implementation/endpoint_manager_benchmark.cc",
+        "connections/implementation/offline_frames_benchmark.cc",
         "connections/implementation/offline_service_controller_test.cc",
         "connections/implementation/encryption_runner_test.cc",
         "connections/implementation/p2p_cluster_pcp_handler_test.cc",
@@ -427,6 +430,8 @@ let package = Package(
         "connections/implementation/internal_payload_factory_test.cc",
         "connections/implementation/client_proxy_test.cc",
         "connections/implementation/payload_manager_test.cc",
+        "connections/implementation/payload_scheduler_test.cc",
+        "connections/implementation/chunk_size_controller_test.cc",
         "connections/implementation/offline_frames_validator_test.cc",
         "connections/implementation/service_controller_router_test.cc",
         "connections/implementation/bluetooth_bwu_test.cc",
@@ -525,6 +530,8 @@ let package = Package(
         "internal/platform/implementation/apple/atomic_boolean_test.cc",
         "internal/platform/implementation/apple/atomic_uint32_test.cc",
         "internal/platform/implementation/shared/file_test.cc",
+        "internal/platform/implementation/shared/deferred_writer_test.cc",
+        "internal/platform/implementation/shared/timer_wheel_test.cc",
         "internal/platform/atomic_boolean_test.cc",
         "internal/platform/exception_test.cc",
         "internal/platform/error_code_recorder_test.cc",
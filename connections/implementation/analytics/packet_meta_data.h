@@ -25,7 +25,7 @@ namespace nearby {
 namespace analytics {
 
 struct PacketMetaData {
-  int packet_size;
+  int packet_size = 0;
   absl::Time file_io_start_time;
   absl::Time file_io_end_time;
   absl::Time encryption_start_time;
@@ -16,6 +16,7 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <new>
 #include <ostream>
 #include <string>
@@ -134,6 +135,24 @@ bool ThroughputRecorder::Stop() {
         NEARBY_LOGS(INFO) << dump_content;
       }
     }
+
+    if (disk_stall_ > absl::ZeroDuration() ||
+        channel_stall_ > absl::ZeroDuration()) {
+      NEARBY_LOGS(INFO) << "Payload_id:" << payload_id_
+                        << ((payload_direction_ ==
+                             PayloadDirection::INCOMING_PAYLOAD)
+                                ? " receiver"
+                                : " sender")
+                        << " stalled on disk for "
+                        << absl::ToInt64Milliseconds(disk_stall_)
+                        << " ms, on channel for "
+                        << absl::ToInt64Milliseconds(channel_stall_) << " ms";
+    }
+    if (max_write_queue_bytes_ > 0) {
+      NEARBY_LOGS(INFO) << "Payload_id:" << payload_id_
+                        << " write queue peaked at " << max_write_queue_bytes_
+                        << " bytes";
+    }
   }
   return true;
 }
@@ -254,6 +273,33 @@ void ThroughputRecorder::OnFrameReceived(Medium medium,
   CalculateDurationTimes(packetMetaData);
 }
 
+void ThroughputRecorder::OnChunkStalls(absl::Duration disk_stall,
+                                       absl::Duration channel_stall) {
+  MutexLock lock(&mutex_);
+  disk_stall_ += disk_stall;
+  channel_stall_ += channel_stall;
+}
+
+void ThroughputRecorder::OnWriteQueueDepth(int64_t queued_bytes) {
+  MutexLock lock(&mutex_);
+  max_write_queue_bytes_ = std::max(max_write_queue_bytes_, queued_bytes);
+}
+
+int64_t ThroughputRecorder::GetMaxWriteQueueBytes() {
+  MutexLock lock(&mutex_);
+  return max_write_queue_bytes_;
+}
+
+int64_t ThroughputRecorder::GetDiskStallMillis() {
+  MutexLock lock(&mutex_);
+  return absl::ToInt64Milliseconds(disk_stall_);
+}
+
+int64_t ThroughputRecorder::GetChannelStallMillis() {
+  MutexLock lock(&mutex_);
+  return absl::ToInt64Milliseconds(channel_stall_);
+}
+
 void ThroughputRecorder::CalculateDurationTimes(PacketMetaData packetMetaData) {
   encryption_time_ += packetMetaData.GetEncryptionTimeInMillis();
   socket_io_time_ += packetMetaData.GetSocketIoTimeInMillis();
@@ -87,6 +87,18 @@ class ThroughputRecorder {
   int64_t GetDurationMillis();
   void OnFrameSent(Medium medium, PacketMetaData& packetMetaData);
   void OnFrameReceived(Medium medium, PacketMetaData& packetMetaData);
+  // Records how long the sender of an outgoing payload was blocked on a
+  // chunk: waiting for it to be read from disk, and waiting for the channel
+  // to take it (including the receiver's ack, if any). For an incoming
+  // payload, the disk stall is how long the reader waited for the chunk to be
+  // written or queued for writing.
+  void OnChunkStalls(absl::Duration disk_stall, absl::Duration channel_stall);
+  int64_t GetDiskStallMillis();
+  int64_t GetChannelStallMillis();
+  // Records the bytes of an incoming payload waiting to be written to disk
+  // after a chunk was attached. Only the maximum is kept.
+  void OnWriteQueueDepth(int64_t queued_bytes);
+  int64_t GetMaxWriteQueueBytes();
   void MarkAsSuccess();
 
  private:
@@ -104,6 +116,9 @@ class ThroughputRecorder {
   int64_t file_io_time_ = 0;
   int64_t encryption_time_ = 0;
   int64_t socket_io_time_ = 0;
+  absl::Duration disk_stall_ = absl::ZeroDuration();
+  absl::Duration channel_stall_ = absl::ZeroDuration();
+  int64_t max_write_queue_bytes_ = 0;
   int64_t duration_millis_ = 0;
   int throughput_kbps_ = 0;
 };
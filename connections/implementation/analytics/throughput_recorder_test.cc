@@ -228,6 +228,32 @@ TEST_F(ThroughputRecorderTest, OnTPRecorderNotStarted) {
   EXPECT_FALSE(throughput.dump());
 }
 
+TEST_F(ThroughputRecorderTest, OnChunkStallsAccumulatesPerPayload) {
+  auto TPRecorder = tp_recorder_container_.GetTPRecorder(
+      kPayloadIdA, PayloadDirection::OUTGOING_PAYLOAD);
+  TPRecorder->Start(PayloadType::kFile, PayloadDirection::OUTGOING_PAYLOAD);
+  TPRecorder->OnChunkStalls(absl::Milliseconds(3), absl::Milliseconds(10));
+  TPRecorder->OnChunkStalls(absl::Milliseconds(4), absl::Milliseconds(20));
+
+  EXPECT_EQ(TPRecorder->GetDiskStallMillis(), 7);
+  EXPECT_EQ(TPRecorder->GetChannelStallMillis(), 30);
+  auto other_recorder = tp_recorder_container_.GetTPRecorder(
+      kPayloadIdB, PayloadDirection::OUTGOING_PAYLOAD);
+  EXPECT_EQ(other_recorder->GetDiskStallMillis(), 0);
+  EXPECT_EQ(other_recorder->GetChannelStallMillis(), 0);
+}
+
+TEST_F(ThroughputRecorderTest, OnWriteQueueDepthKeepsMaximum) {
+  auto TPRecorder = tp_recorder_container_.GetTPRecorder(
+      kPayloadIdA, PayloadDirection::INCOMING_PAYLOAD);
+  TPRecorder->Start(PayloadType::kFile, PayloadDirection::INCOMING_PAYLOAD);
+  TPRecorder->OnWriteQueueDepth(4096);
+  TPRecorder->OnWriteQueueDepth(65536);
+  TPRecorder->OnWriteQueueDepth(0);
+
+  EXPECT_EQ(TPRecorder->GetMaxWriteQueueBytes(), 65536);
+}
+
 }  // namespace
 }  // namespace analytics
 }  // namespace nearby
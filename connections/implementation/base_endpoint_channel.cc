@@ -14,13 +14,18 @@
 
 #include "connections/implementation/base_endpoint_channel.h"
 
+#include <array>
 #include <cassert>
 #include <memory>
 #include <string>
 #include <utility>
 
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "connections/implementation/flags/nearby_connections_feature_flags.h"
 #include "connections/implementation/offline_frames.h"
+#include "internal/flags/nearby_flags.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/logging.h"
@@ -44,14 +49,14 @@ std::int32_t BytesToInt(const ByteArray& bytes) {
   return result;
 }
 
-ByteArray IntToBytes(std::int32_t value) {
-  char int_bytes[sizeof(std::int32_t)];
+std::array<char, sizeof(std::int32_t)> IntToBytes(std::int32_t value) {
+  std::array<char, sizeof(std::int32_t)> int_bytes;
   int_bytes[0] = static_cast<char>((value >> 24) & 0x0FF);
   int_bytes[1] = static_cast<char>((value >> 16) & 0x0FF);
   int_bytes[2] = static_cast<char>((value >> 8) & 0x0FF);
   int_bytes[3] = static_cast<char>((value) & 0x0FF);
 
-  return ByteArray(int_bytes, sizeof(int_bytes));
+  return int_bytes;
 }
 
 ExceptionOr<std::int32_t> ReadInt(InputStream* reader) {
@@ -62,10 +67,6 @@ ExceptionOr<std::int32_t> ReadInt(InputStream* reader) {
   return ExceptionOr<std::int32_t>(BytesToInt(std::move(read_bytes.result())));
 }
 
-Exception WriteInt(OutputStream* writer, std::int32_t value) {
-  return writer->Write(IntToBytes(value));
-}
-
 }  // namespace
 
 BaseEndpointChannel::BaseEndpointChannel(const std::string& service_id,
@@ -99,7 +100,16 @@ BaseEndpointChannel::BaseEndpointChannel(
       technology_(technology),
       band_(band),
       frequency_(frequency),
-      try_count_(try_count) {}
+      try_count_(try_count),
+      pipelined_(NearbyFlags::GetInstance().GetBoolFlag(
+          config_package_nearby::nearby_connections_feature::
+              kEnableEndpointChannelPipelining)) {}
+
+BaseEndpointChannel::~BaseEndpointChannel() {
+  if (pipelined_) {
+    ShutdownPipeline();
+  }
+}
 
 ExceptionOr<ByteArray> BaseEndpointChannel::Read() {
   PacketMetaData packet_meta_data;
@@ -108,80 +118,102 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read() {
 
 ExceptionOr<ByteArray> BaseEndpointChannel::Read(
     PacketMetaData& packet_meta_data) {
-  ByteArray result;
-  {
-    MutexLock lock(&reader_mutex_);
-
-    packet_meta_data.StartSocketIo();
-    ExceptionOr<std::int32_t> read_int = ReadInt(reader_);
-    if (!read_int.ok()) {
-      return ExceptionOr<ByteArray>(read_int.exception());
-    }
-
-    if (read_int.result() < 0 || read_int.result() > kMaxAllowedReadBytes) {
-      NEARBY_LOGS(WARNING) << __func__ << ": Read an invalid number of bytes: "
-                           << read_int.result();
-      return ExceptionOr<ByteArray>(Exception::kIo);
-    }
+  if (pipelined_) {
+    return ReadPipelined(packet_meta_data);
+  }
 
-    ExceptionOr<ByteArray> read_bytes = reader_->ReadExactly(read_int.result());
-    if (!read_bytes.ok()) {
-      return read_bytes;
-    }
-    packet_meta_data.StopSocketIo();
-    packet_meta_data.SetPacketSize(read_int.result() + sizeof(std::int32_t));
-    result = std::move(read_bytes.result());
+  ExceptionOr<ByteArray> frame = ReadFrame(packet_meta_data);
+  if (!frame.ok()) {
+    return frame;
   }
 
+  ExceptionOr<ByteArray> result;
   {
     MutexLock crypto_lock(&crypto_mutex_);
-    if (IsEncryptionEnabledLocked()) {
-      // If encryption is enabled, decode the message.
-      std::string input(std::move(result));
-      packet_meta_data.StartEncryption();
-      std::unique_ptr<std::string> decrypted_data =
-          crypto_context_->DecodeMessageFromPeer(input);
-      if (decrypted_data) {
-        result = ByteArray(std::move(*decrypted_data));
-      } else {
-        // It could be a protocol race, where remote party sends a KEEP_ALIVE
-        // before encryption is setup on their side, and we receive it after
-        // we switched to encryption mode.
-        // In this case, we verify that message is indeed a valid KEEP_ALIVE,
-        // and let it through if it is, otherwise message is erased.
-        // TODO(apolyudov): verify this happens at most once per session.
-        result = {};
-        auto parsed = parser::FromBytes(ByteArray(input));
-        if (parsed.ok()) {
-          if (parser::GetFrameType(parsed.result()) ==
-              location::nearby::connections::V1Frame::KEEP_ALIVE) {
-            NEARBY_LOGS(INFO)
-                << __func__
-                << ": Read unencrypted KEEP_ALIVE on encrypted channel.";
-            result = ByteArray(input);
-          } else {
-            NEARBY_LOGS(WARNING)
-                << __func__ << ": Read unexpected unencrypted frame of type "
-                << parser::GetFrameType(parsed.result());
-          }
-        } else {
-          NEARBY_LOGS(WARNING)
-              << __func__ << ": Unable to parse data as unencrypted message.";
-        }
-      }
-      packet_meta_data.StopEncryption();
-      if (result.Empty()) {
-        NEARBY_LOGS(WARNING) << __func__ << ": Unable to parse read result.";
-        return ExceptionOr<ByteArray>(Exception::kInvalidProtocolBuffer);
-      }
-    }
+    result = DecryptFrame(std::move(frame.result()), crypto_context_.get(),
+                          packet_meta_data);
+  }
+  if (!result.ok()) {
+    return result;
   }
 
   {
     MutexLock lock(&last_read_mutex_);
     last_read_timestamp_ = SystemClock::ElapsedRealtime();
   }
-  return ExceptionOr<ByteArray>(result);
+  return result;
+}
+
+ExceptionOr<ByteArray> BaseEndpointChannel::ReadFrame(
+    PacketMetaData& packet_meta_data) {
+  MutexLock lock(&reader_mutex_);
+
+  packet_meta_data.StartSocketIo();
+  ExceptionOr<std::int32_t> read_int = ReadInt(reader_);
+  if (!read_int.ok()) {
+    return ExceptionOr<ByteArray>(read_int.exception());
+  }
+
+  if (read_int.result() < 0 || read_int.result() > kMaxAllowedReadBytes) {
+    NEARBY_LOGS(WARNING) << __func__ << ": Read an invalid number of bytes: "
+                         << read_int.result();
+    return ExceptionOr<ByteArray>(Exception::kIo);
+  }
+
+  ExceptionOr<ByteArray> read_bytes = reader_->ReadExactly(read_int.result());
+  if (!read_bytes.ok()) {
+    return read_bytes;
+  }
+  packet_meta_data.StopSocketIo();
+  packet_meta_data.SetPacketSize(read_int.result() + sizeof(std::int32_t));
+  return read_bytes;
+}
+
+ExceptionOr<ByteArray> BaseEndpointChannel::DecryptFrame(
+    ByteArray frame, EncryptionContext* context,
+    PacketMetaData& packet_meta_data) {
+  if (context == nullptr) {
+    return ExceptionOr<ByteArray>(std::move(frame));
+  }
+
+  // If encryption is enabled, decode the message.
+  ByteArray result;
+  std::string input(std::move(frame));
+  packet_meta_data.StartEncryption();
+  std::unique_ptr<std::string> decrypted_data =
+      context->DecodeMessageFromPeer(input);
+  if (decrypted_data) {
+    result = ByteArray(std::move(*decrypted_data));
+  } else {
+    // It could be a protocol race, where remote party sends a KEEP_ALIVE
+    // before encryption is setup on their side, and we receive it after
+    // we switched to encryption mode.
+    // In this case, we verify that message is indeed a valid KEEP_ALIVE,
+    // and let it through if it is, otherwise message is erased.
+    // TODO(apolyudov): verify this happens at most once per session.
+    auto parsed = parser::FromBytes(ByteArray(input));
+    if (parsed.ok()) {
+      if (parser::GetFrameType(parsed.result()) ==
+          location::nearby::connections::V1Frame::KEEP_ALIVE) {
+        NEARBY_LOGS(INFO)
+            << __func__ << ": Read unencrypted KEEP_ALIVE on encrypted channel.";
+        result = ByteArray(std::move(input));
+      } else {
+        NEARBY_LOGS(WARNING)
+            << __func__ << ": Read unexpected unencrypted frame of type "
+            << parser::GetFrameType(parsed.result());
+      }
+    } else {
+      NEARBY_LOGS(WARNING) << __func__
+                           << ": Unable to parse data as unencrypted message.";
+    }
+  }
+  packet_meta_data.StopEncryption();
+  if (result.Empty()) {
+    NEARBY_LOGS(WARNING) << __func__ << ": Unable to parse read result.";
+    return ExceptionOr<ByteArray>(Exception::kInvalidProtocolBuffer);
+  }
+  return ExceptionOr<ByteArray>(std::move(result));
 }
 
 Exception BaseEndpointChannel::Write(const ByteArray& data) {
@@ -198,8 +230,15 @@ Exception BaseEndpointChannel::Write(const ByteArray& data,
     }
   }
 
-  ByteArray encrypted_data;
-  const ByteArray* data_to_write = &data;
+  if (pipelined_) {
+    return WritePipelined(data, packet_meta_data);
+  }
+
+  // Holds the ciphertext when encryption is enabled; `body` points either at
+  // it or directly at the caller's `data`, so neither is copied before the
+  // write.
+  std::unique_ptr<std::string> encrypted;
+  absl::string_view body = data.AsStringView();
   {
     // Holding both mutexes is necessary to prevent the keep alive and payload
     // threads from writing encrypted messages out of order which causes a
@@ -211,19 +250,17 @@ Exception BaseEndpointChannel::Write(const ByteArray& data,
       if (IsEncryptionEnabledLocked()) {
         // If encryption is enabled, encode the message.
         packet_meta_data.StartEncryption();
-        std::unique_ptr<std::string> encrypted =
-            crypto_context_->EncodeMessageToPeer(std::string(data));
+        encrypted = crypto_context_->EncodeMessageToPeer(data.AsStringRef());
         packet_meta_data.StopEncryption();
         if (!encrypted) {
           NEARBY_LOGS(WARNING) << __func__ << ": Failed to encrypt data.";
           return {Exception::kIo};
         }
-        encrypted_data = ByteArray(std::move(*encrypted));
-        data_to_write = &encrypted_data;
+        body = *encrypted;
       }
     }
 
-    size_t data_size = data_to_write->size();
+    size_t data_size = body.size();
     if (data_size < 0 || data_size > kMaxAllowedReadBytes) {
       NEARBY_LOGS(WARNING) << __func__ << ": Write an invalid number of bytes: "
                            << data_size;
@@ -231,16 +268,14 @@ Exception BaseEndpointChannel::Write(const ByteArray& data,
     }
 
     packet_meta_data.StartSocketIo();
-    Exception write_exception =
-        WriteInt(writer_, static_cast<std::int32_t>(data_size));
+    // Send the length header and the body as one vectored write, so the frame
+    // goes out in one piece instead of two separate writes.
+    std::array<char, sizeof(std::int32_t)> header =
+        IntToBytes(static_cast<std::int32_t>(data_size));
+    Exception write_exception = writer_->WriteV(
+        {absl::string_view(header.data(), header.size()), body});
     if (write_exception.Raised()) {
-      NEARBY_LOGS(WARNING) << __func__ << ": Failed to write header: "
-                           << write_exception.value;
-      return write_exception;
-    }
-    write_exception = writer_->Write(*data_to_write);
-    if (write_exception.Raised()) {
-      NEARBY_LOGS(WARNING) << __func__ << ": Failed to write data: "
+      NEARBY_LOGS(WARNING) << __func__ << ": Failed to write frame: "
                            << write_exception.value;
       return write_exception;
     }
@@ -254,13 +289,208 @@ Exception BaseEndpointChannel::Write(const ByteArray& data,
     packet_meta_data.SetPacketSize(data_size + sizeof(std::uint32_t));
   }
 
+  UpdateLastWriteTimestamp();
+  return {Exception::kSuccess};
+}
+
+ExceptionOr<ByteArray> BaseEndpointChannel::ReadPipelined(
+    PacketMetaData& packet_meta_data) {
+  PipelinedReadFrame frame;
+  {
+    MutexLock lock(&pipeline_mutex_);
+    if (read_stage_ == nullptr && !pipeline_closed_) {
+      read_stage_ = std::make_unique<SingleThreadExecutor>();
+      read_stage_->Execute([this]() { RunReadStage(); });
+    }
+    while (read_queue_.empty() && read_exception_.Ok() && !pipeline_closed_) {
+      pipeline_cond_.Wait();
+    }
+    if (read_queue_.empty()) {
+      return ExceptionOr<ByteArray>(
+          read_exception_.Raised() ? read_exception_ : Exception{Exception::kIo});
+    }
+    frame = std::move(read_queue_.front());
+    read_queue_.pop_front();
+    // Make room for the read-ahead stage.
+    pipeline_cond_.Notify();
+  }
+  packet_meta_data.socket_io_start_time = frame.socket_io_start_time;
+  packet_meta_data.socket_io_end_time = frame.socket_io_end_time;
+  packet_meta_data.SetPacketSize(frame.data.size() + sizeof(std::int32_t));
+
+  // Only the context pointer is read under crypto_mutex_, so decryption here
+  // does not block encryption on the writer's thread. The D2D context keeps
+  // separate state for encoding and decoding.
+  std::shared_ptr<EncryptionContext> context = GetEncryptionContext();
+  ExceptionOr<ByteArray> result;
+  {
+    MutexLock lock(&decode_mutex_);
+    result = DecryptFrame(std::move(frame.data), context.get(),
+                          packet_meta_data);
+  }
+  if (!result.ok()) {
+    return result;
+  }
+
   {
-    MutexLock lock(&last_write_mutex_);
-    last_write_timestamp_ = SystemClock::ElapsedRealtime();
+    MutexLock lock(&last_read_mutex_);
+    last_read_timestamp_ = SystemClock::ElapsedRealtime();
+  }
+  return result;
+}
+
+Exception BaseEndpointChannel::WritePipelined(
+    const ByteArray& data, PacketMetaData& packet_meta_data) {
+  // Held until the frame is queued, so that frames are queued in the order
+  // they were encrypted in.
+  MutexLock encode_lock(&encode_mutex_);
+
+  std::string frame;
+  std::shared_ptr<EncryptionContext> context = GetEncryptionContext();
+  if (context != nullptr) {
+    packet_meta_data.StartEncryption();
+    std::unique_ptr<std::string> encrypted =
+        context->EncodeMessageToPeer(data.AsStringRef());
+    packet_meta_data.StopEncryption();
+    if (!encrypted) {
+      NEARBY_LOGS(WARNING) << __func__ << ": Failed to encrypt data.";
+      return {Exception::kIo};
+    }
+    frame = std::move(*encrypted);
+  } else {
+    frame = data.AsStringRef();
+  }
+
+  size_t data_size = frame.size();
+  if (data_size > kMaxAllowedReadBytes) {
+    NEARBY_LOGS(WARNING) << __func__ << ": Write an invalid number of bytes: "
+                         << data_size;
+    return {Exception::kIo};
   }
+
+  // Socket I/O time, in pipelined mode, is the time spent waiting for room
+  // in the write stage.
+  packet_meta_data.StartSocketIo();
+  {
+    MutexLock lock(&pipeline_mutex_);
+    while (write_queue_.size() >= kMaxPipelinedFrames && !pipeline_closed_ &&
+           write_exception_.Ok()) {
+      pipeline_cond_.Wait();
+    }
+    if (write_exception_.Raised()) {
+      return write_exception_;
+    }
+    if (pipeline_closed_) {
+      return {Exception::kIo};
+    }
+    if (write_stage_ == nullptr) {
+      write_stage_ = std::make_unique<SingleThreadExecutor>();
+      write_stage_->Execute([this]() { RunWriteStage(); });
+    }
+    write_queue_.push_back(std::move(frame));
+    pipeline_cond_.Notify();
+  }
+  packet_meta_data.StopSocketIo();
+  packet_meta_data.SetPacketSize(data_size + sizeof(std::uint32_t));
   return {Exception::kSuccess};
 }
 
+void BaseEndpointChannel::RunReadStage() {
+  while (true) {
+    {
+      MutexLock lock(&pipeline_mutex_);
+      while (read_queue_.size() >= kMaxPipelinedFrames && !pipeline_closed_) {
+        pipeline_cond_.Wait();
+      }
+      if (pipeline_closed_) {
+        return;
+      }
+    }
+
+    PacketMetaData packet_meta_data;
+    ExceptionOr<ByteArray> frame = ReadFrame(packet_meta_data);
+
+    MutexLock lock(&pipeline_mutex_);
+    if (!frame.ok()) {
+      read_exception_ = frame.GetException();
+      pipeline_cond_.Notify();
+      return;
+    }
+    read_queue_.push_back({
+        .data = std::move(frame.result()),
+        .socket_io_start_time = packet_meta_data.socket_io_start_time,
+        .socket_io_end_time = packet_meta_data.socket_io_end_time,
+    });
+    pipeline_cond_.Notify();
+  }
+}
+
+void BaseEndpointChannel::RunWriteStage() {
+  while (true) {
+    std::string frame;
+    {
+      MutexLock lock(&pipeline_mutex_);
+      while (write_queue_.empty() && !pipeline_closed_) {
+        pipeline_cond_.Wait();
+      }
+      if (write_queue_.empty()) {
+        return;
+      }
+      frame = std::move(write_queue_.front());
+      write_queue_.pop_front();
+      write_in_flight_ = true;
+    }
+
+    Exception write_exception{Exception::kSuccess};
+    {
+      MutexLock lock(&writer_mutex_);
+      std::array<char, sizeof(std::int32_t)> header =
+          IntToBytes(static_cast<std::int32_t>(frame.size()));
+      write_exception = writer_->WriteV(
+          {absl::string_view(header.data(), header.size()), frame});
+      if (write_exception.Ok()) {
+        write_exception = writer_->Flush();
+      }
+    }
+    if (write_exception.Ok()) {
+      UpdateLastWriteTimestamp();
+    }
+
+    MutexLock lock(&pipeline_mutex_);
+    write_in_flight_ = false;
+    if (write_exception.Raised()) {
+      NEARBY_LOGS(WARNING) << __func__ << ": Failed to write frame: "
+                           << write_exception.value;
+      write_exception_ = write_exception;
+      write_queue_.clear();
+      pipeline_cond_.Notify();
+      return;
+    }
+    pipeline_cond_.Notify();
+  }
+}
+
+void BaseEndpointChannel::ShutdownPipeline() {
+  std::unique_ptr<SingleThreadExecutor> read_stage;
+  std::unique_ptr<SingleThreadExecutor> write_stage;
+  {
+    MutexLock lock(&pipeline_mutex_);
+    pipeline_closed_ = true;
+    pipeline_cond_.Notify();
+    read_stage = std::move(read_stage_);
+    write_stage = std::move(write_stage_);
+  }
+  // Destroying the executors joins the stages; both return once they see
+  // `pipeline_closed_` or their stream fails.
+  read_stage.reset();
+  write_stage.reset();
+}
+
+void BaseEndpointChannel::UpdateLastWriteTimestamp() {
+  MutexLock lock(&last_write_mutex_);
+  last_write_timestamp_ = SystemClock::ElapsedRealtime();
+}
+
 void BaseEndpointChannel::Close() {
   {
     // In case channel is paused, resume it first thing.
@@ -272,7 +502,26 @@ void BaseEndpointChannel::Close() {
     is_closed_ = true;
     UnblockPausedWriter();
   }
+  if (pipelined_) {
+    // Give frames that were already accepted by Write() a chance to reach the
+    // socket, e.g. a DISCONNECTION frame written just before closing.
+    MutexLock lock(&pipeline_mutex_);
+    absl::Time deadline = SystemClock::ElapsedRealtime() + kPipelineDrainTimeout;
+    while ((!write_queue_.empty() || write_in_flight_) &&
+           write_exception_.Ok()) {
+      absl::Duration remaining = deadline - SystemClock::ElapsedRealtime();
+      if (remaining <= absl::ZeroDuration()) {
+        NEARBY_LOGS(WARNING) << __func__ << ": Dropping "
+                             << write_queue_.size() << " pipelined frames.";
+        break;
+      }
+      pipeline_cond_.Wait(remaining);
+    }
+  }
   CloseIo();
+  if (pipelined_) {
+    ShutdownPipeline();
+  }
   CloseImpl();
 }
 
@@ -342,6 +591,12 @@ int BaseEndpointChannel::GetMaxTransmitPacketSize() const {
   return kDefaultMaxTransmitPacketSize;
 }
 
+std::shared_ptr<BaseEndpointChannel::EncryptionContext>
+BaseEndpointChannel::GetEncryptionContext() const {
+  MutexLock crypto_lock(&crypto_mutex_);
+  return crypto_context_;
+}
+
 void BaseEndpointChannel::EnableEncryption(
     std::shared_ptr<EncryptionContext> context) {
   MutexLock crypto_lock(&crypto_mutex_);
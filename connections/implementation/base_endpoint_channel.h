@@ -16,24 +16,39 @@
 #define CORE_INTERNAL_BASE_ENDPOINT_CHANNEL_H_
 
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/time/time.h"
 #include "connections/implementation/analytics/analytics_recorder.h"
 #include "connections/implementation/analytics/packet_meta_data.h"
 #include "connections/implementation/endpoint_channel.h"
 #include "internal/platform/byte_array.h"
+#include "internal/platform/condition_variable.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/mutex.h"
 #include "internal/platform/output_stream.h"
+#include "internal/platform/single_thread_executor.h"
 
 namespace nearby {
 namespace connections {
 
 using analytics::PacketMetaData;
 
+// Frames a byte stream into length-prefixed messages, and optionally encrypts
+// them with a D2D context.
+//
+// When `kEnableEndpointChannelPipelining` is set at construction time, the
+// channel runs in pipelined mode: Write() encrypts on the caller's thread and
+// queues the frame for a dedicated write stage, and a read-ahead stage pulls
+// frames off the socket while Read() decrypts the previous one. Encryption
+// and decryption no longer share a lock, and frames keep their D2D sequence
+// order. A write error is reported by the next Write() rather than the one
+// that queued the frame. A pipelined channel must be closed before it is
+// destroyed, so that its stages stop touching the streams.
 class BaseEndpointChannel : public EndpointChannel {
  public:
   BaseEndpointChannel(const std::string& service_id,
@@ -45,7 +60,7 @@ class BaseEndpointChannel : public EndpointChannel {
       location::nearby::proto::connections::ConnectionTechnology,
       location::nearby::proto::connections::ConnectionBand band, int frequency,
       int try_count);
-  ~BaseEndpointChannel() override = default;
+  ~BaseEndpointChannel() override;
 
   // EndpointChannel:
   ExceptionOr<ByteArray> Read() override;
@@ -83,6 +98,9 @@ class BaseEndpointChannel : public EndpointChannel {
 
  protected:
   virtual void CloseImpl() = 0;
+  // True if Read() returns frames buffered by the read-ahead stage, in which
+  // case readiness of the underlying socket says nothing about Read().
+  bool IsPipelined() const { return pipelined_; }
   // For tests only.
   std::unique_ptr<std::string> EncodeMessageForTests(absl::string_view data);
 
@@ -93,8 +111,40 @@ class BaseEndpointChannel : public EndpointChannel {
   // The default maximum transmit unit/packet size.
   static constexpr int kDefaultMaxTransmitPacketSize = 65536;  // 64 KB
 
+  // The maximum number of frames each pipeline stage may hold before the
+  // producing side blocks.
+  static constexpr int kMaxPipelinedFrames = 8;
+
+  // How long Close() waits for queued pipelined writes to reach the socket.
+  static constexpr absl::Duration kPipelineDrainTimeout = absl::Seconds(1);
+
+  // A frame read off the socket by the read-ahead stage, still encrypted.
+  struct PipelinedReadFrame {
+    ByteArray data;
+    absl::Time socket_io_start_time;
+    absl::Time socket_io_end_time;
+  };
+
   bool IsEncryptionEnabledLocked() const
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(crypto_mutex_);
+  std::shared_ptr<EncryptionContext> GetEncryptionContext() const
+      ABSL_LOCKS_EXCLUDED(crypto_mutex_);
+  // Reads one length-prefixed frame off the socket, without decrypting it.
+  ExceptionOr<ByteArray> ReadFrame(PacketMetaData& packet_meta_data)
+      ABSL_LOCKS_EXCLUDED(reader_mutex_);
+  // Decrypts `frame` with `context`, if it is not null.
+  ExceptionOr<ByteArray> DecryptFrame(ByteArray frame,
+                                      EncryptionContext* context,
+                                      PacketMetaData& packet_meta_data);
+  ExceptionOr<ByteArray> ReadPipelined(PacketMetaData& packet_meta_data)
+      ABSL_LOCKS_EXCLUDED(pipeline_mutex_, decode_mutex_);
+  Exception WritePipelined(const ByteArray& data,
+                           PacketMetaData& packet_meta_data)
+      ABSL_LOCKS_EXCLUDED(pipeline_mutex_, encode_mutex_);
+  void RunReadStage() ABSL_LOCKS_EXCLUDED(pipeline_mutex_);
+  void RunWriteStage() ABSL_LOCKS_EXCLUDED(pipeline_mutex_);
+  void ShutdownPipeline() ABSL_LOCKS_EXCLUDED(pipeline_mutex_);
+  void UpdateLastWriteTimestamp() ABSL_LOCKS_EXCLUDED(last_write_mutex_);
   void UnblockPausedWriter() ABSL_EXCLUSIVE_LOCKS_REQUIRED(is_paused_mutex_);
   void BlockUntilUnpaused() ABSL_EXCLUSIVE_LOCKS_REQUIRED(is_paused_mutex_);
   void CloseIo() ABSL_NO_THREAD_SAFETY_ANALYSIS;
@@ -141,6 +191,33 @@ class BaseEndpointChannel : public EndpointChannel {
 
   analytics::AnalyticsRecorder* analytics_recorder_ = nullptr;
   std::string endpoint_id_ = "";
+
+  // Pipelined mode state; unused unless `pipelined_` is true.
+  const bool pipelined_;
+  // Orders encryption with enqueueing, so frames reach the write stage in the
+  // same order as their D2D sequence numbers.
+  Mutex encode_mutex_;
+  // Serializes decryption, which advances the D2D decode sequence number.
+  Mutex decode_mutex_;
+  mutable Mutex pipeline_mutex_;
+  ConditionVariable pipeline_cond_{&pipeline_mutex_};
+  std::deque<std::string> write_queue_ ABSL_GUARDED_BY(pipeline_mutex_);
+  // The frame currently being written by the write stage, if any.
+  bool write_in_flight_ ABSL_GUARDED_BY(pipeline_mutex_) = false;
+  // The first socket write failure; reported by every later Write().
+  Exception write_exception_ ABSL_GUARDED_BY(pipeline_mutex_) = {
+      Exception::kSuccess};
+  std::deque<PipelinedReadFrame> read_queue_ ABSL_GUARDED_BY(pipeline_mutex_);
+  // The socket read failure that stopped the read-ahead stage, if any.
+  Exception read_exception_ ABSL_GUARDED_BY(pipeline_mutex_) = {
+      Exception::kSuccess};
+  bool pipeline_closed_ ABSL_GUARDED_BY(pipeline_mutex_) = false;
+  // Created on first use. Declared last, so that the stages are joined before
+  // the state above goes away.
+  std::unique_ptr<SingleThreadExecutor> read_stage_
+      ABSL_GUARDED_BY(pipeline_mutex_);
+  std::unique_ptr<SingleThreadExecutor> write_stage_
+      ABSL_GUARDED_BY(pipeline_mutex_);
 };
 
 }  // namespace connections
@@ -24,6 +24,7 @@
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
@@ -31,7 +32,9 @@
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/encryption_runner.h"
 #include "connections/implementation/endpoint_channel.h"
+#include "connections/implementation/flags/nearby_connections_feature_flags.h"
 #include "connections/implementation/offline_frames.h"
+#include "internal/flags/nearby_flags.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
@@ -62,6 +65,26 @@ class TestEndpointChannel : public BaseEndpointChannel {
   MOCK_METHOD(void, CloseImpl, (), (override));
 };
 
+// Forwards to another OutputStream, counting the Write() calls it receives.
+// Does not override WriteV(), so it also exercises the default gather path.
+class CountingOutputStream : public OutputStream {
+ public:
+  explicit CountingOutputStream(OutputStream* output) : output_(output) {}
+
+  Exception Write(const ByteArray& data) override {
+    write_count_++;
+    return output_->Write(data);
+  }
+  Exception Flush() override { return output_->Flush(); }
+  Exception Close() override { return output_->Close(); }
+
+  int write_count() const { return write_count_; }
+
+ private:
+  OutputStream* output_;
+  int write_count_ = 0;
+};
+
 std::function<void()> MakeDataPump(
     std::string label, InputStream* input, OutputStream* output,
     std::function<void(const ByteArray&)> monitor = nullptr) {
@@ -181,6 +204,21 @@ TEST(BaseEndpointChannelTest, ReadWrite) {
   EXPECT_EQ(rx_message, tx_message);
 }
 
+TEST(BaseEndpointChannelTest, WriteSendsHeaderAndBodyInOneWrite) {
+  auto pipe_a = CreatePipe();  // channel_a writes to pipe_a, reads from pipe_b.
+  auto pipe_b = CreatePipe();  // channel_b writes to pipe_b, reads from pipe_a.
+  CountingOutputStream counting_output(pipe_a.second.get());
+  TestEndpointChannel channel_a(pipe_b.first.get(), &counting_output);
+  TestEndpointChannel channel_b(pipe_a.first.get(), pipe_b.second.get());
+  ByteArray tx_message{"data message"};
+
+  EXPECT_TRUE(channel_a.Write(tx_message).Ok());
+  ByteArray rx_message = std::move(channel_b.Read().result());
+
+  EXPECT_EQ(counting_output.write_count(), 1);
+  EXPECT_EQ(rx_message, tx_message);
+}
+
 TEST(BaseEndpointChannelTest, ChannelUnencryptedByDefault) {
   auto pipe = CreatePipe();
   TestEndpointChannel channel(pipe.first.get(), pipe.second.get());
@@ -456,6 +494,63 @@ TEST(BaseEndpointChannelTest, ReadUnencryptedFrameOnEncryptedChannel) {
   channel_b.Close(DisconnectionReason::REMOTE_DISCONNECTION);
 }
 
+TEST(BaseEndpointChannelTest, PipelinedReadWriteKeepsFrameOrder) {
+  NearbyFlags::GetInstance().OverrideBoolFlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kEnableEndpointChannelPipelining,
+      true);
+  auto pipe_a = CreatePipe();  // channel_a writes to pipe_a, reads from pipe_b.
+  auto pipe_b = CreatePipe();  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(pipe_b.first.get(), pipe_a.second.get());
+  TestEndpointChannel channel_b(pipe_a.first.get(), pipe_b.second.get());
+  auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
+  ASSERT_NE(context_a, nullptr);
+  ASSERT_NE(context_b, nullptr);
+  channel_a.EnableEncryption(context_a);
+  channel_b.EnableEncryption(context_b);
+
+  // Write more frames than either pipeline stage holds, so that the writer
+  // and the read-ahead stage both have to block and resume.
+  constexpr int kFrameCount = 64;
+  MultiThreadExecutor writer(1);
+  writer.Execute([&channel_a]() {
+    for (int i = 0; i < kFrameCount; ++i) {
+      EXPECT_TRUE(channel_a.Write(ByteArray(absl::StrCat("frame ", i))).Ok());
+    }
+  });
+  for (int i = 0; i < kFrameCount; ++i) {
+    ExceptionOr<ByteArray> result = channel_b.Read();
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(std::string(result.result()), absl::StrCat("frame ", i));
+  }
+
+  channel_a.Close(DisconnectionReason::LOCAL_DISCONNECTION);
+  channel_b.Close(DisconnectionReason::REMOTE_DISCONNECTION);
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
+TEST(BaseEndpointChannelTest, PipelinedCloseFlushesQueuedWrites) {
+  NearbyFlags::GetInstance().OverrideBoolFlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kEnableEndpointChannelPipelining,
+      true);
+  auto pipe_a = CreatePipe();  // channel_a writes to pipe_a, reads from pipe_b.
+  auto pipe_b = CreatePipe();  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(pipe_b.first.get(), pipe_a.second.get());
+  TestEndpointChannel channel_b(pipe_a.first.get(), pipe_b.second.get());
+  ByteArray tx_message{"last message"};
+
+  EXPECT_TRUE(channel_a.Write(tx_message).Ok());
+  channel_a.Close(DisconnectionReason::LOCAL_DISCONNECTION);
+  ExceptionOr<ByteArray> result = channel_b.Read();
+
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result.result(), tx_message);
+  EXPECT_TRUE(channel_a.Write(tx_message).Raised());
+  channel_b.Close(DisconnectionReason::REMOTE_DISCONNECTION);
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
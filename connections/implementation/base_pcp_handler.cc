@@ -1341,6 +1341,10 @@ void BasePcpHandler::OnIncomingFrame(
           client->SetRemoteSafeToDisconnectVersion(
               endpoint_id, connection_response.safe_to_disconnect_version());
         }
+        if (connection_response.has_payload_receive_window_bytes()) {
+          client->SetRemotePayloadReceiveWindow(
+              endpoint_id, connection_response.payload_receive_window_bytes());
+        }
         channel_manager_->UpdateSafeToDisconnectForEndpoint(
             endpoint_id, client->IsSafeToDisconnectEnabled(endpoint_id));
         EvaluateConnectionResult(client, endpoint_id,
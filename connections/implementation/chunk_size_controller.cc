@@ -0,0 +1,75 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/chunk_size_controller.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace connections {
+
+ChunkSizeController::ChunkSizeController(absl::Duration target_frame_duration,
+                                         int max_chunk_size)
+    : target_frame_duration_(target_frame_duration),
+      max_chunk_size_(max_chunk_size),
+      chunk_size_(max_chunk_size) {}
+
+void ChunkSizeController::SetMaxChunkSize(int max_chunk_size) {
+  max_chunk_size_ = max_chunk_size;
+  chunk_size_ = std::clamp(chunk_size_, GetMinChunkSize(), max_chunk_size_);
+}
+
+int ChunkSizeController::GetMinChunkSize() const {
+  return std::min(kMinChunkSize, max_chunk_size_);
+}
+
+void ChunkSizeController::OnFrameSent(std::int64_t frame_size,
+                                      absl::Duration duration) {
+  if (frame_size <= 0 || duration <= absl::ZeroDuration()) return;
+
+  double size = frame_size;
+  double time = absl::ToDoubleSeconds(duration);
+  double decay = 1 - kSampleWeight;
+  weight_ = weight_ * decay + 1;
+  sum_size_ = sum_size_ * decay + size;
+  sum_time_ = sum_time_ * decay + time;
+  sum_size_squared_ = sum_size_squared_ * decay + size * size;
+  sum_size_time_ = sum_size_time_ * decay + size * time;
+  if (++samples_ < kMinSamples) return;
+
+  double mean_size = sum_size_ / weight_;
+  double mean_time = sum_time_ / weight_;
+  double size_variance = sum_size_squared_ / weight_ - mean_size * mean_size;
+  double covariance = sum_size_time_ / weight_ - mean_size * mean_time;
+  double seconds_per_byte = mean_time / mean_size;
+  double overhead = 0;
+  // The overhead can only be told apart from the per-byte cost once frames of
+  // different sizes were sent; until then, all of the time is per byte.
+  if (size_variance > 0.01 * mean_size * mean_size && covariance > 0) {
+    seconds_per_byte = covariance / size_variance;
+    overhead = std::max(0.0, mean_time - seconds_per_byte * mean_size);
+  }
+
+  double target = absl::ToDoubleSeconds(target_frame_duration_);
+  double desired = std::max(target - overhead, overhead) / seconds_per_byte;
+  desired = std::clamp(desired, chunk_size_ / 2.0, chunk_size_ * 2.0);
+  chunk_size_ = std::clamp(static_cast<int>(desired), GetMinChunkSize(),
+                           max_chunk_size_);
+}
+
+}  // namespace connections
+}  // namespace nearby
@@ -0,0 +1,79 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_CHUNK_SIZE_CONTROLLER_H_
+#define CORE_INTERNAL_CHUNK_SIZE_CONTROLLER_H_
+
+#include <cstdint>
+
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace connections {
+
+// Picks the size of the payload chunks sent to one endpoint from how long its
+// recent frames took to send.
+//
+// The time to send a frame is modelled as a fixed per-frame overhead (round
+// trip, encryption setup, framing) plus a per-byte cost, both fitted over the
+// recent frames with exponentially decaying weights. The chunk size is the
+// largest one expected to be sent within `target_frame_duration`, so a slow
+// link doesn't hold a frame for long, but never so small that the overhead
+// takes more than half of the frame time. It moves by at most a factor of 2 per
+// frame, and stays within [kMinChunkSize, max_chunk_size], where
+// max_chunk_size is the largest frame the medium takes.
+//
+// Not thread safe.
+class ChunkSizeController {
+ public:
+  // Smallest chunk size picked, unless the medium takes less.
+  static constexpr int kMinChunkSize = 4 * 1024;
+
+  ChunkSizeController(absl::Duration target_frame_duration,
+                      int max_chunk_size);
+
+  // Updates the largest chunk size, e.g. after a bandwidth upgrade.
+  void SetMaxChunkSize(int max_chunk_size);
+
+  int GetChunkSize() const { return chunk_size_; }
+
+  // Reports that a frame of `frame_size` bytes took `duration` to send.
+  void OnFrameSent(std::int64_t frame_size, absl::Duration duration);
+
+ private:
+  // Weight of the latest frame in the fit.
+  static constexpr double kSampleWeight = 0.125;
+  // Frames needed before the chunk size starts to move.
+  static constexpr int kMinSamples = 4;
+
+  int GetMinChunkSize() const;
+
+  const absl::Duration target_frame_duration_;
+  int max_chunk_size_;
+  int chunk_size_;
+
+  // Decayed sums over the recent frames, of sizes in bytes and durations in
+  // seconds.
+  int samples_ = 0;
+  double weight_ = 0;
+  double sum_size_ = 0;
+  double sum_time_ = 0;
+  double sum_size_squared_ = 0;
+  double sum_size_time_ = 0;
+};
+
+}  // namespace connections
+}  // namespace nearby
+
+#endif  // CORE_INTERNAL_CHUNK_SIZE_CONTROLLER_H_
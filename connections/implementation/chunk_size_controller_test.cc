@@ -0,0 +1,155 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/chunk_size_controller.h"
+
+#include <cstdint>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::testing::AllOf;
+using ::testing::Ge;
+using ::testing::Le;
+
+constexpr absl::Duration kTargetFrameDuration = absl::Milliseconds(100);
+constexpr int kWifiMaxChunkSize = 64 * 1024;
+constexpr int kFrames = 50;
+
+// A link sending `bytes_per_second`, with `latency` added to every frame.
+struct SimulatedLink {
+  std::int64_t bytes_per_second;
+  absl::Duration latency;
+
+  absl::Duration Send(int frame_size) const {
+    return latency + absl::Seconds(static_cast<double>(frame_size) /
+                                   bytes_per_second);
+  }
+};
+
+void SendFrames(ChunkSizeController& controller, const SimulatedLink& link,
+                int frames) {
+  for (int i = 0; i < frames; ++i) {
+    int chunk_size = controller.GetChunkSize();
+    controller.OnFrameSent(chunk_size, link.Send(chunk_size));
+  }
+}
+
+auto IsAbout(int chunk_size) {
+  return AllOf(Ge(chunk_size * 9 / 10), Le(chunk_size * 11 / 10));
+}
+
+TEST(ChunkSizeControllerTest, StartsAtMaxChunkSize) {
+  ChunkSizeController controller(kTargetFrameDuration, kWifiMaxChunkSize);
+
+  EXPECT_EQ(controller.GetChunkSize(), kWifiMaxChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, FastLinkKeepsMaxChunkSize) {
+  ChunkSizeController controller(kTargetFrameDuration, kWifiMaxChunkSize);
+
+  SendFrames(controller, {.bytes_per_second = 10'000'000,
+                          .latency = absl::Milliseconds(2)},
+             kFrames);
+
+  EXPECT_EQ(controller.GetChunkSize(), kWifiMaxChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, SlowLinkSendsFramesWithinTarget) {
+  ChunkSizeController controller(kTargetFrameDuration, kWifiMaxChunkSize);
+
+  SendFrames(controller,
+             {.bytes_per_second = 125'000, .latency = absl::ZeroDuration()},
+             kFrames);
+
+  // 100ms at 1Mbps.
+  EXPECT_THAT(controller.GetChunkSize(), IsAbout(12'500));
+}
+
+TEST(ChunkSizeControllerTest, LatencyIsTakenOutOfTarget) {
+  ChunkSizeController controller(kTargetFrameDuration, kWifiMaxChunkSize);
+
+  SendFrames(controller,
+             {.bytes_per_second = 250'000, .latency = absl::Milliseconds(20)},
+             kFrames);
+
+  // 80ms left for the bytes, at 2Mbps.
+  EXPECT_THAT(controller.GetChunkSize(), IsAbout(20'000));
+}
+
+TEST(ChunkSizeControllerTest, HighLatencyKeepsOverheadWithinHalfOfFrame) {
+  ChunkSizeController controller(kTargetFrameDuration, kWifiMaxChunkSize);
+
+  SendFrames(controller,
+             {.bytes_per_second = 125'000, .latency = absl::Milliseconds(80)},
+             kFrames);
+
+  // As long to send the bytes as the 80ms of latency, at 1Mbps.
+  EXPECT_THAT(controller.GetChunkSize(), IsAbout(10'000));
+}
+
+TEST(ChunkSizeControllerTest, RecoversWhenLinkSpeedsUp) {
+  ChunkSizeController controller(kTargetFrameDuration, kWifiMaxChunkSize);
+  SendFrames(controller,
+             {.bytes_per_second = 125'000, .latency = absl::ZeroDuration()},
+             kFrames);
+
+  SendFrames(controller, {.bytes_per_second = 10'000'000,
+                          .latency = absl::Milliseconds(2)},
+             kFrames);
+
+  EXPECT_EQ(controller.GetChunkSize(), kWifiMaxChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, StaysAboveMinChunkSize) {
+  ChunkSizeController controller(kTargetFrameDuration, kWifiMaxChunkSize);
+
+  SendFrames(controller,
+             {.bytes_per_second = 10'000, .latency = absl::ZeroDuration()},
+             kFrames);
+
+  EXPECT_EQ(controller.GetChunkSize(), ChunkSizeController::kMinChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, StaysWithinSmallerMediumMax) {
+  ChunkSizeController controller(kTargetFrameDuration, kWifiMaxChunkSize);
+
+  controller.SetMaxChunkSize(512);
+  EXPECT_EQ(controller.GetChunkSize(), 512);
+  SendFrames(controller,
+             {.bytes_per_second = 1'000, .latency = absl::ZeroDuration()},
+             kFrames);
+
+  EXPECT_EQ(controller.GetChunkSize(), 512);
+}
+
+TEST(ChunkSizeControllerTest, IgnoresFramesWithoutTimings) {
+  ChunkSizeController controller(kTargetFrameDuration, kWifiMaxChunkSize);
+
+  for (int i = 0; i < kFrames; ++i) {
+    controller.OnFrameSent(kWifiMaxChunkSize, absl::ZeroDuration());
+    controller.OnFrameSent(0, absl::Seconds(1));
+  }
+
+  EXPECT_EQ(controller.GetChunkSize(), kWifiMaxChunkSize);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
@@ -876,6 +876,23 @@ void ClientProxy::SetRemoteSafeToDisconnectVersion(
   }
 }
 
+std::int32_t ClientProxy::GetRemotePayloadReceiveWindow(
+    absl::string_view endpoint_id) const {
+  const ConnectionPair* item = LookupConnection(endpoint_id);
+  if (item != nullptr) {
+    return item->first.payload_receive_window_bytes;
+  }
+  return 0;
+}
+
+void ClientProxy::SetRemotePayloadReceiveWindow(
+    absl::string_view endpoint_id, std::int32_t payload_receive_window_bytes) {
+  ConnectionPair* item = LookupConnection(endpoint_id);
+  if (item != nullptr) {
+    item->first.payload_receive_window_bytes = payload_receive_window_bytes;
+  }
+}
+
 bool ClientProxy::IsSafeToDisconnectEnabled(absl::string_view endpoint_id) {
   return IsSupportSafeToDisconnect() &&
          GetRemoteSafeToDisconnectVersion(endpoint_id).has_value() &&
@@ -292,6 +292,12 @@ class ClientProxy final {
   void SetRemoteSafeToDisconnectVersion(
       absl::string_view endpoint_id,
       const std::int32_t& safe_to_disconnect_version);
+  // Returns the payload receive window the remote endpoint advertised, or 0
+  // if it didn't.
+  std::int32_t GetRemotePayloadReceiveWindow(
+      absl::string_view endpoint_id) const;
+  void SetRemotePayloadReceiveWindow(absl::string_view endpoint_id,
+                                     std::int32_t payload_receive_window_bytes);
   bool IsSafeToDisconnectEnabled(absl::string_view endpoint_id);
   bool IsAutoReconnectEnabled(absl::string_view endpoint_id);
   bool IsPayloadReceivedAckEnabled(absl::string_view endpoint_id);
@@ -326,6 +332,7 @@ class ClientProxy final {
     std::string connection_token;
     std::optional<location::nearby::connections::OsInfo> os_info;
     std::int32_t safe_to_disconnect_version;
+    std::int32_t payload_receive_window_bytes = 0;
   };
   using ConnectionPair = std::pair<Connection, PayloadListener>;
 
@@ -1052,6 +1052,19 @@ TEST_F(ClientProxyTest, SetRemoteInfoCorrect) {
             nearby_connections_version);
 }
 
+TEST_F(ClientProxyTest, SetRemotePayloadReceiveWindowCorrect) {
+  Endpoint advertising_endpoint =
+      StartAdvertising(&client1_, advertising_connection_listener_);
+  OnAdvertisingConnectionInitiated(&client1_, advertising_endpoint);
+  // Peers that don't advertise a window don't do flow control.
+  EXPECT_EQ(client1_.GetRemotePayloadReceiveWindow(advertising_endpoint.id), 0);
+
+  client1_.SetRemotePayloadReceiveWindow(advertising_endpoint.id, 65536);
+
+  EXPECT_EQ(client1_.GetRemotePayloadReceiveWindow(advertising_endpoint.id),
+            65536);
+}
+
 // Test ClientProxy::AddCancellationFlag, where if a flag is already in the map,
 // uncancel it. This addresses the case when users use NS to share/receive a
 // file, then cancel in the middle because the wrong file was selected, and then
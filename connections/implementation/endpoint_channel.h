@@ -19,6 +19,7 @@
 #include <string>
 
 #include "securegcm/d2d_connection_context_v1.h"
+#include "absl/functional/any_invocable.h"
 #include "connections/implementation/analytics/analytics_recorder.h"
 #include "connections/implementation/analytics/packet_meta_data.h"
 #include "internal/platform/byte_array.h"
@@ -121,6 +122,14 @@ class EndpointChannel {
   virtual void SetAnalyticsRecorder(
       analytics::AnalyticsRecorder* analytics_recorder,
       const std::string& endpoint_id) = 0;
+
+  // Asks for `callback` to be called once, from any thread but never from
+  // within this call, as soon as Read() has data to return or the channel is
+  // closed. Returns false if the medium can't tell, in which case the caller
+  // has to dedicate a thread to a blocking Read().
+  virtual bool NotifyWhenReadable(absl::AnyInvocable<void()> callback) {
+    return false;
+  }
 };
 
 inline bool operator==(const EndpointChannel& lhs, const EndpointChannel& rhs) {
@@ -23,14 +23,18 @@
 #include <vector>
 
 #include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "connections/implementation/analytics/throughput_recorder.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_channel.h"
 #include "connections/implementation/endpoint_channel_manager.h"
+#include "connections/implementation/flags/nearby_connections_feature_flags.h"
 #include "connections/implementation/offline_frames.h"
 #include "connections/implementation/payload_manager.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/implementation/service_id_constants.h"
+#include "google/protobuf/arena.h"
+#include "internal/flags/nearby_flags.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
@@ -38,6 +42,7 @@
 #include "internal/platform/logging.h"
 #include "internal/platform/mutex.h"
 #include "internal/platform/mutex_lock.h"
+#include "internal/platform/system_clock.h"
 #include "internal/proto/analytics/connections_log.pb.h"
 #include "proto/connections_enums.pb.h"
 
@@ -61,6 +66,8 @@ constexpr absl::Time kInvalidTimestamp = absl::InfinitePast();
 // The maximum time we will wait for the encryption setup during negotiating a
 // connection.
 constexpr absl::Duration kDecryptRetryTimeout = absl::Seconds(3);
+// Large enough to hold a parsed DATA frame, without its chunk body.
+constexpr int kFrameArenaBlockSize = 2048;
 }  // namespace
 
 class EndpointManager::LockedFrameProcessor {
@@ -110,13 +117,6 @@ void EndpointManager::EndpointChannelLoopRunnable(
     const std::string& runnable_name, ClientProxy* client,
     const std::string& endpoint_id,
     absl::AnyInvocable<ExceptionOr<bool>(EndpointChannel*)> handler) {
-  // EndpointChannelManager will not let multiple channels exist simultaneously
-  // for the same endpoint_id; it will be closing "old" channels as new ones
-  // come.
-  // Closed channel will return Exception::kIo for any Read, and loop (below)
-  // will retry and attempt to pick another channel.
-  // If channel is deleted (no mapping), or it is still the same channel
-  // (same Medium) on which we got the Exception::kIo, we terminate the loop.
   NEARBY_LOG(INFO, "Started worker loop name=%s, endpoint=%s",
              runnable_name.c_str(), endpoint_id.c_str());
   Medium last_failed_medium = Medium::UNKNOWN_MEDIUM;
@@ -125,83 +125,237 @@ void EndpointManager::EndpointChannelLoopRunnable(
     // because it can be changed out from under us (for example, when we
     // upgrade from Bluetooth to Wifi).
     std::shared_ptr<EndpointChannel> channel =
-        channel_manager_->GetChannelForEndpoint(endpoint_id);
-    if (channel == nullptr) {
-      NEARBY_LOG(INFO, "Endpoint channel is nullptr, bail out.");
-      break;
-    }
+        GetChannelForWorker(endpoint_id, last_failed_medium);
+    if (channel == nullptr) break;
 
-    // If we're looping back around after a failure, and there's not a new
-    // EndpointChannel for this endpoint, there's nothing more to do here.
-    if ((last_failed_medium != Medium::UNKNOWN_MEDIUM) &&
-        (channel->GetMedium() == last_failed_medium)) {
-      NEARBY_LOG(
-          INFO, "No new endpoint channel is found after a failure, exit loop.");
+    ExceptionOr<bool> keep_using_channel = handler(channel.get());
+    if (GetWorkerAction(client, endpoint_id, channel.get(), keep_using_channel,
+                        last_failed_medium) == WorkerAction::kStop) {
       break;
     }
+  }
+  StopWorker(runnable_name, client, endpoint_id);
+}
 
-    ExceptionOr<bool> keep_using_channel = handler(channel.get());
+std::shared_ptr<EndpointChannel> EndpointManager::GetChannelForWorker(
+    const std::string& endpoint_id, Medium last_failed_medium) {
+  // EndpointChannelManager will not let multiple channels exist simultaneously
+  // for the same endpoint_id; it will be closing "old" channels as new ones
+  // come.
+  // Closed channel will return Exception::kIo for any Read, and the worker
+  // will retry and attempt to pick another channel.
+  // If channel is deleted (no mapping), or it is still the same channel
+  // (same Medium) on which we got the Exception::kIo, the worker terminates.
+  std::shared_ptr<EndpointChannel> channel =
+      channel_manager_->GetChannelForEndpoint(endpoint_id);
+  if (channel == nullptr) {
+    NEARBY_LOG(INFO, "Endpoint channel is nullptr, bail out.");
+    return nullptr;
+  }
 
-    if (!keep_using_channel.ok()) {
-      Exception exception = keep_using_channel.GetException();
-      // An "invalid proto" may be a final payload on a channel we're about to
-      // close, so we'll loop back around once. We set |last_failed_medium| to
-      // ensure we don't loop indefinitely. See crbug.com/1182031 for more
-      // detail.
-      if (exception.Raised(Exception::kInvalidProtocolBuffer)) {
-        last_failed_medium = channel->GetMedium();
-        NEARBY_LOGS(INFO)
-            << "Received invalid protobuf message, re-fetching endpoint "
-               "channel; last_failed_medium="
-            << location::nearby::proto::connections::Medium_Name(
-                   last_failed_medium);
-        continue;
-      }
-      if (exception.Raised(Exception::kIo)) {
-        last_failed_medium = channel->GetMedium();
-        NEARBY_LOGS(INFO)
-            << "Endpoint channel IO exception; last_failed_medium="
-            << location::nearby::proto::connections::Medium_Name(
-                   last_failed_medium);
-        continue;
-      }
-      if (exception.Raised(Exception::kInterrupted)) {
-        break;
-      }
+  // If we're looping back around after a failure, and there's not a new
+  // EndpointChannel for this endpoint, there's nothing more to do here.
+  if ((last_failed_medium != Medium::UNKNOWN_MEDIUM) &&
+      (channel->GetMedium() == last_failed_medium)) {
+    NEARBY_LOG(INFO,
+               "No new endpoint channel is found after a failure, exit loop.");
+    return nullptr;
+  }
+  return channel;
+}
+
+EndpointManager::WorkerAction EndpointManager::GetWorkerAction(
+    ClientProxy* client, const std::string& endpoint_id,
+    EndpointChannel* channel, const ExceptionOr<bool>& keep_using_channel,
+    Medium& last_failed_medium) {
+  if (!keep_using_channel.ok()) {
+    Exception exception = keep_using_channel.GetException();
+    // An "invalid proto" may be a final payload on a channel we're about to
+    // close, so we'll loop back around once. We set |last_failed_medium| to
+    // ensure we don't loop indefinitely. See crbug.com/1182031 for more
+    // detail.
+    if (exception.Raised(Exception::kInvalidProtocolBuffer)) {
+      last_failed_medium = channel->GetMedium();
+      NEARBY_LOGS(INFO)
+          << "Received invalid protobuf message, re-fetching endpoint "
+             "channel; last_failed_medium="
+          << location::nearby::proto::connections::Medium_Name(
+                 last_failed_medium);
+      return WorkerAction::kReplaceChannel;
+    }
+    if (exception.Raised(Exception::kIo)) {
+      last_failed_medium = channel->GetMedium();
+      NEARBY_LOGS(INFO)
+          << "Endpoint channel IO exception; last_failed_medium="
+          << location::nearby::proto::connections::Medium_Name(
+                 last_failed_medium);
+      return WorkerAction::kReplaceChannel;
     }
+    if (exception.Raised(Exception::kInterrupted)) {
+      return WorkerAction::kStop;
+    }
+  }
 
-    if (!keep_using_channel.result()) {
-      NEARBY_LOGS(INFO) << "Dropping current channel: last medium="
-                        << location::nearby::proto::connections::Medium_Name(
-                               last_failed_medium);
-      if (client->IsSafeToDisconnectEnabled(endpoint_id)) {
-        channel_manager_->MarkEndpointStopWaitToDisconnect(
-            endpoint_id, /* is_safe_to_disconnect */ false,
-            /* notify_stop_waiting */ true);
-      }
-      break;
+  if (!keep_using_channel.result()) {
+    NEARBY_LOGS(INFO) << "Dropping current channel: last medium="
+                      << location::nearby::proto::connections::Medium_Name(
+                             last_failed_medium);
+    if (client->IsSafeToDisconnectEnabled(endpoint_id)) {
+      channel_manager_->MarkEndpointStopWaitToDisconnect(
+          endpoint_id, /* is_safe_to_disconnect */ false,
+          /* notify_stop_waiting */ true);
     }
+    return WorkerAction::kStop;
   }
+  return WorkerAction::kKeepChannel;
+}
+
+void EndpointManager::StopWorker(const std::string& runnable_name,
+                                 ClientProxy* client,
+                                 const std::string& endpoint_id) {
   // Indicate we're out of the loop and it is ok to schedule another instance
   // if needed.
   NEARBY_LOGS(INFO) << "Worker going down; worker name=" << runnable_name
                     << "; endpoint_id=" << endpoint_id;
   // Always clear out all state related to this endpoint before terminating
-  // this thread.
+  // this worker.
   DiscardEndpoint(client, endpoint_id, DisconnectionReason::IO_ERROR);
   NEARBY_LOGS(INFO) << "Worker done; worker name=" << runnable_name
                     << "; endpoint_id=" << endpoint_id;
 }
 
-ExceptionOr<OfflineFrame> EndpointManager::TryDecryptFrame(
-    const ByteArray& data, EndpointChannel* endpoint_channel) {
+void EndpointManager::StartReader(std::shared_ptr<EndpointWorker> reader) {
+  std::shared_ptr<EndpointChannel> channel =
+      GetChannelForWorker(reader->endpoint_id, reader->last_failed_medium);
+  if (channel == nullptr) {
+    StopWorker("Read", reader->client, reader->endpoint_id);
+    return;
+  }
+  if (channel.get() != reader->channel) {
+    reader->channel = channel.get();
+    reader->try_decrypting = !channel->IsEncrypted();
+  }
+  if (channel->NotifyWhenReadable([this, reader]() {
+        RunOnPool(worker_pool_, reader, "read",
+                  [this, reader]() { ReadNextFrame(reader); });
+      })) {
+    return;
+  }
+
+  // The medium can't tell when there is something to read, so block on it
+  // from a thread of its own until the endpoint goes away.
+  NEARBY_LOGS(INFO) << "Starting a dedicated reader thread for endpoint "
+                    << reader->endpoint_id << " on channel "
+                    << channel->GetType();
+  reader->thread = std::make_unique<SingleThreadExecutor>();
+  reader->thread->Execute("reader", [this, client = reader->client,
+                                     endpoint_id = reader->endpoint_id]() {
+    EndpointChannelLoopRunnable(
+        "Read", client, endpoint_id,
+        [this, client, endpoint_id](EndpointChannel* channel) {
+          return HandleData(endpoint_id, client, channel);
+        });
+  });
+}
+
+void EndpointManager::ReadNextFrame(std::shared_ptr<EndpointWorker> reader) {
+  MutexLock lock(&reader->mutex);
+  if (reader->stopped) return;
+  std::shared_ptr<EndpointChannel> channel = GetChannelForWorker(
+      reader->endpoint_id, reader->last_failed_medium);
+  if (channel == nullptr) {
+    StopWorker("Read", reader->client, reader->endpoint_id);
+    return;
+  }
+  if (channel.get() != reader->channel) {
+    // Replaced since it was armed; wait until the new one is readable.
+    StartReader(reader);
+    return;
+  }
+
+  Exception exception = HandleFrame(reader->endpoint_id, reader->client,
+                                    channel.get(), reader->try_decrypting);
+  ExceptionOr<bool> keep_using_channel =
+      exception.Ok() ? ExceptionOr<bool>(true) : ExceptionOr<bool>(exception);
+  if (GetWorkerAction(reader->client, reader->endpoint_id, channel.get(),
+                      keep_using_channel,
+                      reader->last_failed_medium) == WorkerAction::kStop) {
+    StopWorker("Read", reader->client, reader->endpoint_id);
+    return;
+  }
+  StartReader(reader);
+}
+
+void EndpointManager::RunKeepAlive(std::shared_ptr<EndpointWorker> keep_alive,
+                                   absl::Duration keep_alive_interval,
+                                   absl::Duration keep_alive_timeout) {
+  MutexLock lock(&keep_alive->mutex);
+  if (keep_alive->stopped) return;
+  while (true) {
+    std::shared_ptr<EndpointChannel> channel = GetChannelForWorker(
+        keep_alive->endpoint_id, keep_alive->last_failed_medium);
+    if (channel == nullptr) break;
+
+    absl::Duration wait_for;
+    ExceptionOr<bool> keep_using_channel = HandleKeepAlive(
+        channel.get(), keep_alive_interval, keep_alive_timeout, wait_for);
+    WorkerAction action =
+        GetWorkerAction(keep_alive->client, keep_alive->endpoint_id,
+                        channel.get(), keep_using_channel,
+                        keep_alive->last_failed_medium);
+    if (action == WorkerAction::kStop) break;
+    if (action == WorkerAction::kReplaceChannel) continue;
+
+    keep_alive->next_keep_alive = keep_alive_timer_.Schedule(
+        [this, keep_alive, keep_alive_interval, keep_alive_timeout]() {
+          RunOnPool(keep_alive_pool_, keep_alive, "keep-alive",
+                    [this, keep_alive, keep_alive_interval,
+                     keep_alive_timeout]() {
+                      RunKeepAlive(keep_alive, keep_alive_interval,
+                                   keep_alive_timeout);
+                    });
+        },
+        wait_for);
+    return;
+  }
+  StopWorker("KeepAliveManager", keep_alive->client, keep_alive->endpoint_id);
+}
+
+void EndpointManager::RunOnPool(MultiThreadExecutor& pool,
+                                const std::shared_ptr<EndpointWorker>& worker,
+                                const std::string& name, Runnable runnable) {
+  MutexLock lock(&worker->post_mutex);
+  if (worker->posting_stopped) return;
+  pool.Execute(name, std::move(runnable));
+}
+
+void EndpointManager::StopEndpointWorker(EndpointWorker* worker) {
+  {
+    MutexLock lock(&worker->post_mutex);
+    worker->posting_stopped = true;
+  }
+  std::unique_ptr<SingleThreadExecutor> thread;
+  {
+    MutexLock lock(&worker->mutex);
+    worker->stopped = true;
+    worker->next_keep_alive.Cancel();
+    thread = std::move(worker->thread);
+  }
+  // Waits for a dedicated reader to leave its loop, outside of the lock as it
+  // doesn't take it.
+  thread.reset();
+}
+
+ExceptionOr<OfflineFrame*> EndpointManager::TryDecryptFrame(
+    const ByteArray& data, EndpointChannel* endpoint_channel,
+    google::protobuf::Arena* arena) {
   auto start_time = SystemClock::ElapsedRealtime();
   while (true) {
     ExceptionOr<ByteArray> decrypted = endpoint_channel->TryDecrypt(data);
     if (decrypted.ok()) {
       NEARBY_LOGS(VERBOSE) << "Message decrypted after "
                            << SystemClock::ElapsedRealtime() - start_time;
-      return parser::FromBytes(decrypted.result());
+      return parser::FromBytes(decrypted.result(), arena);
     }
     if (decrypted.exception() == Exception::kExecution) {
       return decrypted.exception();
@@ -226,70 +380,99 @@ ExceptionOr<bool> EndpointManager::HandleData(
   // a replacement for this endpoint since we last checked with the
   // EndpointChannelManager.
   while (true) {
-    PacketMetaData packet_meta_data;
-    ExceptionOr<ByteArray> bytes = endpoint_channel->Read(packet_meta_data);
-    if (!bytes.ok()) {
-      NEARBY_LOG(INFO, "Stop reading on read-time exception: %d",
-                 bytes.exception());
-      return ExceptionOr<bool>(bytes.exception());
+    Exception exception =
+        HandleFrame(endpoint_id, client, endpoint_channel, try_decrypting);
+    if (!exception.Ok()) {
+      return ExceptionOr<bool>(exception);
     }
-    ExceptionOr<OfflineFrame> wrapped_frame = parser::FromBytes(bytes.result());
-    if (!wrapped_frame.ok() && try_decrypting) {
-      // Workaround for a race condition where the remote party has sent an
-      // encrypted message but our end was still configured as unencrypted when
-      // the message was received. The workaround is to wait until the
-      // encryption set-up has completed on another thread. We run this
-      // workaround if:
-      // - the connection was unencrypted when we started reading from the
-      // channel
-      // - the received frame looks wrong (corrupted)
-      // - it's the first invalid frame.
-      try_decrypting = false;
-      ExceptionOr<OfflineFrame> decrypted =
-          TryDecryptFrame(bytes.result(), endpoint_channel);
-      if (decrypted.ok()) {
-        wrapped_frame = std::move(decrypted);
-      }
+  }
+}
+
+Exception EndpointManager::HandleFrame(const std::string& endpoint_id,
+                                       ClientProxy* client,
+                                       EndpointChannel* endpoint_channel,
+                                       bool& try_decrypting) {
+  PacketMetaData packet_meta_data;
+  ExceptionOr<ByteArray> bytes = endpoint_channel->Read(packet_meta_data);
+  if (!bytes.ok()) {
+    NEARBY_LOG(INFO, "Stop reading on read-time exception: %d",
+               bytes.exception());
+    return bytes.GetException();
+  }
+  // KEEP_ALIVE frames have no processor and nothing to validate, so there is
+  // no need to parse them.
+  if (parser::PeekFrameType(bytes.result()) == V1Frame::KEEP_ALIVE) {
+    NEARBY_LOG(INFO, "KeepAlive message for endpoint %s", endpoint_id.c_str());
+    return {Exception::kSuccess};
+  }
+  // The frame only lives until it has been dispatched; parsing it on an arena
+  // backed by the stack saves an allocation per message and field, which adds
+  // up over the DATA frames of a transfer. Chunk bodies are still allocated on
+  // the heap, so processors can move them out of the frame. The arena expects
+  // its initial block to be 8-byte aligned.
+  alignas(8) char arena_block[kFrameArenaBlockSize];
+  google::protobuf::ArenaOptions arena_options;
+  arena_options.initial_block = arena_block;
+  arena_options.initial_block_size = sizeof(arena_block);
+  google::protobuf::Arena arena(arena_options);
+  ExceptionOr<OfflineFrame*> wrapped_frame =
+      parser::FromBytes(bytes.result(), &arena);
+  if (!wrapped_frame.ok() && try_decrypting) {
+    // Workaround for a race condition where the remote party has sent an
+    // encrypted message but our end was still configured as unencrypted when
+    // the message was received. The workaround is to wait until the
+    // encryption set-up has completed on another thread. We run this
+    // workaround if:
+    // - the connection was unencrypted when we started reading from the
+    // channel
+    // - the received frame looks wrong (corrupted)
+    // - it's the first invalid frame.
+    try_decrypting = false;
+    ExceptionOr<OfflineFrame*> decrypted =
+        TryDecryptFrame(bytes.result(), endpoint_channel, &arena);
+    if (decrypted.ok()) {
+      wrapped_frame = std::move(decrypted);
     }
-    if (!wrapped_frame.ok()) {
-      if (wrapped_frame.GetException().Raised(
-              Exception::kInvalidProtocolBuffer)) {
-        NEARBY_LOG(INFO, "Failed to decode; endpoint=%s; channel=%s; skip",
-                   endpoint_id.c_str(), endpoint_channel->GetType().c_str());
-        continue;
-      } else {
-        NEARBY_LOG(INFO, "Stop reading on parse-time exception: %d",
-                   wrapped_frame.exception());
-        return ExceptionOr<bool>(wrapped_frame.exception());
-      }
+  }
+  if (!wrapped_frame.ok()) {
+    if (wrapped_frame.GetException().Raised(
+            Exception::kInvalidProtocolBuffer)) {
+      NEARBY_LOG(INFO, "Failed to decode; endpoint=%s; channel=%s; skip",
+                 endpoint_id.c_str(), endpoint_channel->GetType().c_str());
+      return {Exception::kSuccess};
+    } else {
+      NEARBY_LOG(INFO, "Stop reading on parse-time exception: %d",
+                 wrapped_frame.exception());
+      return wrapped_frame.GetException();
     }
-    OfflineFrame& frame = wrapped_frame.result();
-
-    // Route the incoming offlineFrame to its registered processor.
-    V1Frame::FrameType frame_type = parser::GetFrameType(frame);
-    LockedFrameProcessor frame_processor = GetFrameProcessor(frame_type);
-    if (!frame_processor) {
-      // report messages without handlers, except KEEP_ALIVE, which has
-      // no explicit handler.
-      if (frame_type == V1Frame::KEEP_ALIVE) {
-        NEARBY_LOG(INFO, "KeepAlive message for endpoint %s",
-                   endpoint_id.c_str());
-      } else if (frame_type == V1Frame::DISCONNECTION) {
-        NEARBY_LOG(INFO, "Disconnect message for endpoint %s",
-                   endpoint_id.c_str());
-        ProcessDisconnectionFrame(client, endpoint_id, endpoint_channel, frame);
-      } else {
-        NEARBY_LOGS(ERROR) << "Unhandled message: endpoint_id=" << endpoint_id
-                           << ", frame type="
-                           << V1Frame::FrameType_Name(frame_type);
-      }
-      continue;
+  }
+  OfflineFrame& frame = *wrapped_frame.result();
+
+  // Route the incoming offlineFrame to its registered processor.
+  V1Frame::FrameType frame_type = parser::GetFrameType(frame);
+  LockedFrameProcessor frame_processor = GetFrameProcessor(frame_type);
+  if (!frame_processor) {
+    // report messages without handlers, except KEEP_ALIVE, which has
+    // no explicit handler.
+    if (frame_type == V1Frame::KEEP_ALIVE) {
+      NEARBY_LOG(INFO, "KeepAlive message for endpoint %s",
+                 endpoint_id.c_str());
+    } else if (frame_type == V1Frame::DISCONNECTION) {
+      NEARBY_LOG(INFO, "Disconnect message for endpoint %s",
+                 endpoint_id.c_str());
+      ProcessDisconnectionFrame(client, endpoint_id, endpoint_channel, frame);
+    } else {
+      NEARBY_LOGS(ERROR) << "Unhandled message: endpoint_id=" << endpoint_id
+                         << ", frame type="
+                         << V1Frame::FrameType_Name(frame_type);
     }
-
-    frame_processor->OnIncomingFrame(frame, endpoint_id, client,
-                                     endpoint_channel->GetMedium(),
-                                     packet_meta_data);
+    return {Exception::kSuccess};
   }
+
+  frame_processor->OnIncomingFrame(frame, endpoint_id, client,
+                                   endpoint_channel->GetMedium(),
+                                   packet_meta_data);
+  return {Exception::kSuccess};
 }
 
 void EndpointManager::ProcessDisconnectionFrame(
@@ -350,8 +533,7 @@ void EndpointManager::ProcessDisconnectionFrame(
 
 ExceptionOr<bool> EndpointManager::HandleKeepAlive(
     EndpointChannel* endpoint_channel, absl::Duration keep_alive_interval,
-    absl::Duration keep_alive_timeout, Mutex* keep_alive_waiter_mutex,
-    ConditionVariable* keep_alive_waiter) {
+    absl::Duration keep_alive_timeout, absl::Duration& wait_for) {
   // Check if it has been too long since we received a frame from our endpoint.
   absl::Time last_read_time = endpoint_channel->GetLastReadTimestamp();
   absl::Duration duration_until_timeout =
@@ -373,24 +555,20 @@ ExceptionOr<bool> EndpointManager::HandleKeepAlive(
           ? keep_alive_interval
           : last_write_time + keep_alive_interval -
                 SystemClock::ElapsedRealtime();
+  // A paused channel would block the write, and with it a thread shared by all
+  // endpoints, until it is resumed; try again on the next run instead.
   if (duration_until_write_keep_alive <= absl::ZeroDuration()) {
-    Exception write_exception = endpoint_channel->Write(parser::ForKeepAlive());
-    if (!write_exception.Ok()) {
-      return ExceptionOr<bool>(write_exception);
+    if (!endpoint_channel->IsPaused()) {
+      Exception write_exception =
+          endpoint_channel->Write(parser::ForKeepAlive());
+      if (!write_exception.Ok()) {
+        return ExceptionOr<bool>(write_exception);
+      }
     }
     duration_until_write_keep_alive = keep_alive_interval;
   }
 
-  absl::Duration wait_for =
-      std::min(duration_until_timeout, duration_until_write_keep_alive);
-  {
-    MutexLock lock(keep_alive_waiter_mutex);
-    Exception wait_exception = keep_alive_waiter->Wait(wait_for);
-    if (!wait_exception.Ok()) {
-      return ExceptionOr<bool>(wait_exception);
-    }
-  }
-
+  wait_for = std::min(duration_until_timeout, duration_until_write_keep_alive);
   return ExceptionOr<bool>(true);
 }
 
@@ -495,6 +673,22 @@ EndpointManager::LockedFrameProcessor EndpointManager::GetFrameProcessor(
 void EndpointManager::RemoveEndpointState(const std::string& endpoint_id) {
   NEARBY_LOGS(VERBOSE) << "EnsureWorkersTerminated for endpoint "
                        << endpoint_id;
+  {
+    // Frames still queued for the endpoint are dropped, and their senders
+    // told it failed.
+    MutexLock lock(&fan_out_mutex_);
+    auto queue = fan_out_queues_.find(endpoint_id);
+    if (queue != fan_out_queues_.end()) {
+      queue->second->failed = true;
+      FailFanOutFramesLocked(*queue->second);
+      fan_out_queues_.erase(queue);
+      fan_out_cond_.Notify();
+    }
+  }
+  {
+    MutexLock lock(&chunk_size_mutex_);
+    chunk_size_controllers_.erase(endpoint_id);
+  }
   auto item = endpoints_.find(endpoint_id);
   if (item != endpoints_.end()) {
     NEARBY_LOGS(INFO) << "EndpointState found for endpoint " << endpoint_id;
@@ -558,26 +752,26 @@ void EndpointManager::RegisterEndpoint(
             .first->second;
 
     NEARBY_LOGS(INFO) << "Starting workers: endpoint " << endpoint_id;
-    // For every endpoint, there's normally only one Read handler instance
-    // running on a dedicated thread. This instance reads data from the
-    // endpoint and delegates incoming frames to various FrameProcessors.
+    auto reader = std::make_shared<EndpointWorker>(client, endpoint_id);
+    auto keep_alive = std::make_shared<EndpointWorker>(client, endpoint_id);
+    endpoint_state.SetWorkers(reader, keep_alive);
+
+    // For every endpoint, there's normally only one reader. It reads data from
+    // the endpoint and delegates incoming frames to various FrameProcessors.
     // Once the frame has been properly handled, it starts reading again
-    // for the next frame. If the handler fails its read and no other
+    // for the next frame. If the reader fails its read and no other
     // EndpointChannels are available for this endpoint, a disconnection
     // will be initiated.
-    endpoint_state.StartEndpointReader([this, client, endpoint_id]() {
-      EndpointChannelLoopRunnable(
-          "Read", client, endpoint_id,
-          [this, client, endpoint_id](EndpointChannel* channel) {
-            return HandleData(endpoint_id, client, channel);
-          });
-    });
-
-    // For every endpoint, there's only one KeepAliveManager instance
-    // running on a dedicated thread. This instance will periodically send
-    // out a ping* to the endpoint while listening for an incoming pong**.
-    // If it fails to send the ping, or if no pong is heard within
-    // keep_alive_timeout, it initiates a disconnection.
+    {
+      MutexLock lock(&reader->mutex);
+      StartReader(reader);
+    }
+
+    // For every endpoint, there's only one KeepAlive worker, run by the timer
+    // shared by all endpoints. It periodically sends out a ping* to the
+    // endpoint while listening for an incoming pong**. If it fails to send the
+    // ping, or if no pong is heard within keep_alive_timeout, it initiates a
+    // disconnection.
     //
     // (*) Bluetooth requires a constant outgoing stream of messages. If
     // there's silence, Android will break the socket. This is why we
@@ -587,20 +781,11 @@ void EndpointManager::RegisterEndpoint(
     // listen for the pong.
     NEARBY_LOGS(VERBOSE) << "EndpointManager enabling KeepAlive for endpoint "
                          << endpoint_id;
-    endpoint_state.StartEndpointKeepAliveManager(
-        [this, client, endpoint_id, keep_alive_interval, keep_alive_timeout](
-            Mutex* keep_alive_waiter_mutex,
-            ConditionVariable* keep_alive_waiter) {
-          EndpointChannelLoopRunnable(
-              "KeepAliveManager", client, endpoint_id,
-              [this, keep_alive_interval, keep_alive_timeout,
-               keep_alive_waiter_mutex,
-               keep_alive_waiter](EndpointChannel* channel) {
-                return HandleKeepAlive(
-                    channel, keep_alive_interval, keep_alive_timeout,
-                    keep_alive_waiter_mutex, keep_alive_waiter);
+    RunOnPool(keep_alive_pool_, keep_alive, "keep-alive",
+              [this, keep_alive, keep_alive_interval, keep_alive_timeout]() {
+                RunKeepAlive(keep_alive, keep_alive_interval,
+                             keep_alive_timeout);
               });
-        });
     NEARBY_LOGS(INFO) << "Registering endpoint " << endpoint_id
                       << ", workers started and notifying client.";
 
@@ -637,20 +822,58 @@ int EndpointManager::GetMaxTransmitPacketSize(const std::string& endpoint_id) {
   return channel->GetMaxTransmitPacketSize();
 }
 
+int EndpointManager::GetAdaptiveChunkSize(
+    const std::string& endpoint_id, absl::Duration target_frame_duration) {
+  int max_chunk_size = GetMaxTransmitPacketSize(endpoint_id);
+  if (max_chunk_size <= 0) {
+    return max_chunk_size;
+  }
+
+  MutexLock lock(&chunk_size_mutex_);
+  auto [controller, created] = chunk_size_controllers_.try_emplace(
+      endpoint_id, target_frame_duration, max_chunk_size);
+  // The medium may have changed since, after a bandwidth upgrade.
+  if (!created) controller->second.SetMaxChunkSize(max_chunk_size);
+  return controller->second.GetChunkSize();
+}
+
+void EndpointManager::OnFrameWritten(const std::string& endpoint_id,
+                                     const PacketMetaData& packet_meta_data) {
+  // Pipelined channels only count the wait for room in their write stage as
+  // socket I/O, which is the time to send a frame once they are busy.
+  absl::Duration duration =
+      std::max(packet_meta_data.encryption_end_time -
+                   packet_meta_data.encryption_start_time,
+               absl::ZeroDuration()) +
+      std::max(packet_meta_data.socket_io_end_time -
+                   packet_meta_data.socket_io_start_time,
+               absl::ZeroDuration());
+
+  MutexLock lock(&chunk_size_mutex_);
+  auto controller = chunk_size_controllers_.find(endpoint_id);
+  if (controller == chunk_size_controllers_.end()) return;
+  controller->second.OnFrameSent(packet_meta_data.packet_size, duration);
+}
+
 std::vector<std::string> EndpointManager::SendPayloadChunk(
     const PayloadTransferFrame::PayloadHeader& payload_header,
-    const PayloadTransferFrame::PayloadChunk& payload_chunk,
+    PayloadTransferFrame::PayloadChunk payload_chunk,
     const std::vector<std::string>& endpoint_ids,
     PacketMetaData& packet_meta_data) {
+  std::int64_t offset = payload_chunk.offset();
+  bool last_chunk =
+      payload_chunk.flags() & PayloadTransferFrame::PayloadChunk::LAST_CHUNK;
   ByteArray bytes =
-      parser::ForDataPayloadTransfer(payload_header, payload_chunk);
+      parser::ForDataPayloadTransfer(payload_header, std::move(payload_chunk));
 
+  // The last chunk is flushed, so that the payload is fully written once it
+  // is reported as sent.
   return SendTransferFrameBytes(
-      endpoint_ids, bytes, payload_header.id(),
-      /*offset=*/payload_chunk.offset(),
+      endpoint_ids, std::move(bytes), payload_header.id(),
+      /*offset=*/offset,
       /*packet_type=*/
       PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::DATA),
-      packet_meta_data);
+      packet_meta_data, /*flush=*/last_chunk);
 }
 
 // Designed to run asynchronously. It is called from IO thread pools, and
@@ -721,11 +944,11 @@ std::vector<std::string> EndpointManager::SendControlMessage(
   PacketMetaData packet_meta_data;
 
   return SendTransferFrameBytes(
-      endpoint_ids, bytes, header.id(),
+      endpoint_ids, std::move(bytes), header.id(),
       /*offset=*/control.offset(),
       /*packet_type=*/
       PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::CONTROL),
-      packet_meta_data);
+      packet_meta_data, /*flush=*/false);
 }
 
 // @EndpointManagerThread
@@ -762,8 +985,8 @@ void EndpointManager::RemoveEndpoint(ClientProxy* client,
   }
 
   // Unregistering from channel_manager_ will also serve to terminate
-  // the dedicated handler and KeepAlive threads we started when we registered
-  // this endpoint.
+  // the reader and KeepAlive workers we started when we registered this
+  // endpoint.
   if (channel_manager_->UnregisterChannelForEndpoint(endpoint_id, reason,
                                                      safe_disconnect_result)) {
     // Notify all frame processors of the disconnection immediately and wait
@@ -912,18 +1135,30 @@ std::int64_t payload_id,
   PacketMetaData packet_meta_data;
 
   return SendTransferFrameBytes(
-      endpoint_ids, bytes, payload_id,
+      endpoint_ids, std::move(bytes), payload_id,
       /* offset= */ -1,
       /*packet_type=*/
       PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::PAYLOAD_ACK),
-      packet_meta_data);
+      packet_meta_data, /*flush=*/false);
 }
 
 
 std::vector<std::string> EndpointManager::SendTransferFrameBytes(
-    const std::vector<std::string>& endpoint_ids, const ByteArray& bytes,
+    const std::vector<std::string>& endpoint_ids, ByteArray bytes,
     std::int64_t payload_id, std::int64_t offset,
-    const std::string& packet_type, PacketMetaData& packet_meta_data) {
+    const std::string& packet_type, PacketMetaData& packet_meta_data,
+    bool flush) {
+  std::int64_t max_lag_frames = NearbyFlags::GetInstance().GetInt64Flag(
+      config_package_nearby::nearby_connections_feature::
+          kEndpointFanOutMaxLagFrames);
+  if (max_lag_frames > 0) {
+    // Even a single endpoint goes through its send queue, so that its frames
+    // stay in order with those sent to it along with other endpoints.
+    return FanOutTransferFrameBytes(endpoint_ids, std::move(bytes), payload_id,
+                                    packet_type, packet_meta_data,
+                                    flush ? 0 : max_lag_frames);
+  }
+
   std::vector<std::string> failed_endpoint_ids;
   for (const std::string& endpoint_id : endpoint_ids) {
     std::shared_ptr<EndpointChannel> channel =
@@ -949,6 +1184,7 @@ std::vector<std::string> EndpointManager::SendTransferFrameBytes(
       NEARBY_LOGS(INFO) << "Failed to send packet; endpoint_id=" << endpoint_id;
       continue;
     }
+    OnFrameWritten(endpoint_id, packet_meta_data);
     analytics::ThroughputRecorderContainer::GetInstance()
         .GetTPRecorder(payload_id, PayloadDirection::OUTGOING_PAYLOAD)
         ->OnFrameSent(channel->GetMedium(), packet_meta_data);
@@ -957,12 +1193,186 @@ std::vector<std::string> EndpointManager::SendTransferFrameBytes(
   return failed_endpoint_ids;
 }
 
+std::vector<std::string> EndpointManager::FanOutTransferFrameBytes(
+    const std::vector<std::string>& endpoint_ids, ByteArray bytes,
+    std::int64_t payload_id, const std::string& packet_type,
+    const PacketMetaData& packet_meta_data, std::int64_t max_lag_frames) {
+  absl::Duration drop_timeout =
+      absl::Milliseconds(NearbyFlags::GetInstance().GetInt64Flag(
+          config_package_nearby::nearby_connections_feature::
+              kEndpointFanOutDropTimeoutMillis));
+  auto shared_bytes = std::make_shared<const ByteArray>(std::move(bytes));
+  std::vector<std::string> failed_endpoint_ids;
+  // Queues the frame was added to, with its number and state in each.
+  std::vector<std::shared_ptr<FanOutQueue>> queues;
+  std::vector<std::pair<std::uint64_t, std::shared_ptr<FanOutFrameState>>>
+      queued;
+
+  MutexLock lock(&fan_out_mutex_);
+  for (const std::string& endpoint_id : endpoint_ids) {
+    std::shared_ptr<FanOutQueue>& queue = fan_out_queues_[endpoint_id];
+    if (queue == nullptr) queue = std::make_shared<FanOutQueue>(endpoint_id);
+    if (queue->failed || queue->dropped) {
+      NEARBY_LOGS(INFO) << "Failed to send packet; endpoint_id=" << endpoint_id;
+      failed_endpoint_ids.push_back(endpoint_id);
+      continue;
+    }
+    auto state = std::make_shared<FanOutFrameState>();
+    std::uint64_t sequence = queue->next_sequence++;
+    queue->frames.push_back({.bytes = shared_bytes,
+                             .payload_id = payload_id,
+                             .packet_meta_data = packet_meta_data,
+                             .sequence = sequence,
+                             .state = state});
+    queues.push_back(queue);
+    queued.emplace_back(sequence, std::move(state));
+    if (!queue->scheduled) {
+      queue->scheduled = true;
+      fan_out_ready_.push_back(queue);
+    }
+  }
+  DispatchFanOutWritesLocked();
+
+  absl::Time deadline = SystemClock::ElapsedRealtime() + drop_timeout;
+  for (size_t i = 0; i < queues.size(); ++i) {
+    FanOutQueue& queue = *queues[i];
+    const std::string& endpoint_id = queue.endpoint_id;
+    std::uint64_t sequence = queued[i].first;
+    const FanOutFrameState& state = *queued[i].second;
+    while (true) {
+      if (state.failed) {
+        failed_endpoint_ids.push_back(endpoint_id);
+        break;
+      }
+      if (state.written) break;
+      // Number of the first frame the endpoint has left to write.
+      std::uint64_t unwritten = queue.frames.empty()
+                                    ? queue.next_sequence
+                                    : queue.frames.front().sequence;
+      if (unwritten + max_lag_frames > sequence) break;
+      if (drop_timeout == absl::ZeroDuration()) {
+        fan_out_cond_.Wait();
+        continue;
+      }
+      absl::Duration remaining = deadline - SystemClock::ElapsedRealtime();
+      if (remaining <= absl::ZeroDuration()) {
+        NEARBY_LOGS(WARNING)
+            << "Endpoint " << endpoint_id << " is more than " << max_lag_frames
+            << " frames behind; failed to send " << packet_type
+            << " of Payload " << payload_id;
+        DropFanOutQueueLocked(queue);
+        failed_endpoint_ids.push_back(endpoint_id);
+        break;
+      }
+      fan_out_cond_.Wait(remaining);
+    }
+  }
+  return failed_endpoint_ids;
+}
+
+void EndpointManager::DispatchFanOutWritesLocked() {
+  while (fan_out_running_writes_ < kFanOutPoolSize && !fan_out_ready_.empty()) {
+    std::shared_ptr<FanOutQueue> queue = std::move(fan_out_ready_.front());
+    fan_out_ready_.pop_front();
+    // The frames of the queue may have failed since it got in line.
+    if (queue->failed || queue->frames.empty()) {
+      queue->scheduled = false;
+      continue;
+    }
+    queue->writing = true;
+    ++fan_out_running_writes_;
+    fan_out_pool_.Execute("fan-out-write",
+                          [this, queue]() { WriteFanOutFrame(queue); });
+  }
+}
+
+void EndpointManager::WriteFanOutFrame(std::shared_ptr<FanOutQueue> queue) {
+  absl::optional<FanOutFrame> frame;
+  {
+    MutexLock lock(&fan_out_mutex_);
+    if (!queue->failed) frame = queue->frames.front();
+  }
+  bool ok = frame.has_value() && WriteFrameToEndpoint(queue->endpoint_id, *frame);
+
+  MutexLock lock(&fan_out_mutex_);
+  // The frame already failed, with the rest of the queue, if the endpoint was
+  // dropped or removed while it was being written.
+  if (queue->dropped) {
+    queue->dropped = false;
+  } else if (!queue->failed) {
+    if (ok) {
+      queue->frames.front().state->written = true;
+      queue->frames.pop_front();
+    } else {
+      queue->failed = true;
+      FailFanOutFramesLocked(*queue);
+    }
+  }
+  queue->writing = false;
+  if (queue->stalled) {
+    queue->stalled = false;
+    --fan_out_stalled_writes_;
+  } else {
+    --fan_out_running_writes_;
+  }
+  // Back to the end of the line, so that every queue gets a turn.
+  if (!queue->failed && !queue->frames.empty()) {
+    fan_out_ready_.push_back(std::move(queue));
+  } else {
+    queue->scheduled = false;
+  }
+  DispatchFanOutWritesLocked();
+  fan_out_cond_.Notify();
+}
+
+bool EndpointManager::WriteFrameToEndpoint(const std::string& endpoint_id,
+                                           const FanOutFrame& frame) {
+  std::shared_ptr<EndpointChannel> channel =
+      channel_manager_->GetChannelForEndpoint(endpoint_id);
+  if (channel == nullptr) {
+    NEARBY_LOGS(ERROR) << "EndpointManager failed to find EndpointChannel "
+                          "over which to write Payload "
+                       << frame.payload_id << " to endpoint " << endpoint_id;
+    return false;
+  }
+  analytics::PacketMetaData packet_meta_data = frame.packet_meta_data;
+  if (!channel->Write(*frame.bytes, packet_meta_data).Ok()) {
+    NEARBY_LOGS(INFO) << "Failed to send packet; endpoint_id=" << endpoint_id;
+    return false;
+  }
+  OnFrameWritten(endpoint_id, packet_meta_data);
+  analytics::ThroughputRecorderContainer::GetInstance()
+      .GetTPRecorder(frame.payload_id, PayloadDirection::OUTGOING_PAYLOAD)
+      ->OnFrameSent(channel->GetMedium(), packet_meta_data);
+  return true;
+}
+
+void EndpointManager::DropFanOutQueueLocked(FanOutQueue& queue) {
+  FailFanOutFramesLocked(queue);
+  // Frames sent before the write in progress returns would wait behind it.
+  if (queue.writing) queue.dropped = true;
+  // The write is likely stuck in the channel. Let another endpoint have its
+  // slot, as long as the pool has a thread left for it.
+  if (queue.writing && !queue.stalled &&
+      fan_out_stalled_writes_ < kMaxStalledFanOutWrites) {
+    queue.stalled = true;
+    --fan_out_running_writes_;
+    ++fan_out_stalled_writes_;
+    DispatchFanOutWritesLocked();
+  }
+  fan_out_cond_.Notify();
+}
+
+void EndpointManager::FailFanOutFramesLocked(FanOutQueue& queue) {
+  for (FanOutFrame& frame : queue.frames) frame.state->failed = true;
+  queue.frames.clear();
+}
+
 EndpointManager::EndpointState::~EndpointState() {
-  // We must unregister the endpoint first to signal the runnables that they
-  // should exit their loops. SingleThreadExecutor destructors will wait for
-  // the workers to finish. |channel_manager_| is null after moved from this
-  // object (in move constructor) which prevents unregistering the channel
-  // prematurely.
+  // We must unregister the endpoint first to signal the workers that they
+  // should exit their loops, then wait for those in progress to finish.
+  // |channel_manager_| is null after moved from this object (in move
+  // constructor) which prevents unregistering the channel prematurely.
   if (channel_manager_) {
     NEARBY_LOG(VERBOSE, "EndpointState destructor %s", endpoint_id_.c_str());
     channel_manager_->UnregisterChannelForEndpoint(
@@ -970,25 +1380,8 @@ EndpointManager::EndpointState::~EndpointState() {
         ConnectionsLog::EstablishedConnection::SAFE_DISCONNECTION);
   }
 
-  // Make sure the KeepAlive thread isn't blocking shutdown.
-  if (keep_alive_waiter_mutex_ && keep_alive_waiter_) {
-    MutexLock lock(keep_alive_waiter_mutex_.get());
-    keep_alive_waiter_->Notify();
-  }
-}
-
-void EndpointManager::EndpointState::StartEndpointReader(Runnable&& runnable) {
-  reader_thread_.Execute("reader", std::move(runnable));
-}
-
-void EndpointManager::EndpointState::StartEndpointKeepAliveManager(
-    absl::AnyInvocable<void(Mutex*, ConditionVariable*)> runnable) {
-  keep_alive_thread_.Execute(
-      "keep-alive", [runnable = std::move(runnable),
-                     keep_alive_waiter_mutex = keep_alive_waiter_mutex_.get(),
-                     keep_alive_waiter = keep_alive_waiter_.get()]() mutable {
-        runnable(keep_alive_waiter_mutex, keep_alive_waiter);
-      });
+  if (reader_) StopEndpointWorker(reader_.get());
+  if (keep_alive_) StopEndpointWorker(keep_alive_.get());
 }
 
 void EndpointManager::RunOnEndpointManagerThread(const std::string& name,
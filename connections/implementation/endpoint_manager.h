@@ -16,6 +16,7 @@
 #define CORE_INTERNAL_ENDPOINT_MANAGER_H_
 
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <string>
@@ -28,15 +29,21 @@
 #include "absl/functional/any_invocable.h"
 #include "absl/time/time.h"
 #include "connections/implementation/analytics/packet_meta_data.h"
+#include "connections/implementation/chunk_size_controller.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_channel.h"
 #include "connections/implementation/endpoint_channel_manager.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/listeners.h"
+#include "google/protobuf/arena.h"
 #include "internal/platform/byte_array.h"
+#include "internal/platform/cancelable.h"
 #include "internal/platform/condition_variable.h"
 #include "internal/platform/count_down_latch.h"
+#include "internal/platform/multi_thread_executor.h"
+#include "internal/platform/mutex.h"
 #include "internal/platform/runnable.h"
+#include "internal/platform/scheduled_executor.h"
 #include "internal/platform/single_thread_executor.h"
 
 namespace nearby {
@@ -54,16 +61,38 @@ namespace connections {
 // dedicated writer threads belonging to the PayloadManager. The writer thread
 // that is used depends on the PayloadType.
 //
-// The EndpointManager has one dedicated reader thread for each registered
-// endpoint, and the receiving of every incoming payload (and its subsequent
-// chunks) originates on one of those threads before control is transferred over
-// to PayloadManager::ProcessFrame() (still running on that
-// same dedicated reader thread).
+// The receiving of every incoming payload (and its subsequent chunks)
+// originates on the reader of its endpoint before control is transferred over
+// to PayloadManager::ProcessFrame() (still running on that same reader). For
+// channels that report readiness (see EndpointChannel::NotifyWhenReadable()),
+// each frame is read by a task on a small pool shared by all endpoints; other
+// channels get one dedicated, blocking reader thread per endpoint.
+//
+// KeepAlive frames for all endpoints are driven by one shared timer, and sent
+// from a separate small pool, so that they don't queue up behind frame reads
+// and processing.
+//
+// When kEndpointFanOutMaxLagFrames is set, payload frames are written through
+// per-endpoint send queues drained in parallel, one frame per turn, so a slow
+// endpoint doesn't hold up the others until it falls that many frames behind.
 
 class EndpointManager {
  public:
   using OfflineFrame = ::location::nearby::connections::OfflineFrame;
 
+  // Number of threads reading from channels that report readiness, for all
+  // endpoints.
+  static constexpr int kWorkerPoolSize = 4;
+  // Number of threads sending KeepAlive frames, for all endpoints.
+  static constexpr int kKeepAlivePoolSize = 2;
+  // Number of payload frames written at once from the per-endpoint send
+  // queues, for all endpoints.
+  static constexpr int kFanOutPoolSize = 8;
+  // Number of writes to endpoints dropped by kEndpointFanOutDropTimeoutMillis
+  // that may still be stuck in their channel without counting against
+  // kFanOutPoolSize.
+  static constexpr int kMaxStalledFanOutWrites = 8;
+
   class FrameProcessor {
    public:
     virtual ~FrameProcessor() = default;
@@ -125,13 +154,21 @@ class EndpointManager {
   // transport.
   int GetMaxTransmitPacketSize(const std::string& endpoint_id);
 
+  // Returns the size of the payload chunks to send to `endpoint_id`, so that
+  // a frame takes about `target_frame_duration` to send given how its recent
+  // frames went, within GetMaxTransmitPacketSize(). Returns 0 if the endpoint
+  // is unknown.
+  int GetAdaptiveChunkSize(const std::string& endpoint_id,
+                           absl::Duration target_frame_duration);
+
   // Returns the list of endpoints to which sending this chunk failed.
+  // The chunk is moved into the outgoing frame, so its body is not copied.
   //
   // Invoked from the PayloadManager's sendPayload() method.
   std::vector<std::string> SendPayloadChunk(
       const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
           payload_header,
-      const location::nearby::connections::PayloadTransferFrame::PayloadChunk&
+      location::nearby::connections::PayloadTransferFrame::PayloadChunk
           payload_chunk,
       const std::vector<std::string>& endpoint_ids,
       analytics::PacketMetaData& packet_meta_data);
@@ -150,7 +187,7 @@ class EndpointManager {
   //    a) We failed to read from the endpoint in its dedicated reader thread.
   //    b) We failed to write to the endpoint in PayloadManager.
   //    c) The connection was rejected in PCPHandler.
-  //    d) The dedicated KeepAlive thread exceeded its period of inactivity.
+  //    d) The KeepAlive timer exceeded its period of inactivity.
   // Or in the numerous other cases where a failure occurred and we no longer
   // believe the endpoint is in a healthy state.
   //
@@ -167,15 +204,51 @@ class EndpointManager {
                   std::unique_ptr<SingleThreadExecutor> serial_executor);
 
  private:
+  // State of a reader or KeepAlive worker of an endpoint. Tasks run on
+  // behalf of the worker share it, and check `stopped` under `mutex` before
+  // touching anything else: the EndpointManager and `client` may be gone once
+  // it is set.
+  struct EndpointWorker {
+    EndpointWorker(ClientProxy* client, const std::string& endpoint_id)
+        : client(client), endpoint_id(endpoint_id) {}
+
+    ClientProxy* const client;
+    const std::string endpoint_id;
+    // Held while a task runs. The task may take the locks of the channel
+    // manager, so readiness callbacks and timers, which may run under those,
+    // only take `post_mutex` to post a task.
+    Mutex mutex;
+    bool stopped ABSL_GUARDED_BY(mutex) = false;
+    Mutex post_mutex;
+    bool posting_stopped ABSL_GUARDED_BY(post_mutex) = false;
+    // See EndpointChannelLoopRunnable().
+    Medium last_failed_medium ABSL_GUARDED_BY(mutex) = Medium::UNKNOWN_MEDIUM;
+    // Pooled reader only: the channel read last, and whether an invalid frame
+    // read from it may be one encrypted before our end was (see HandleData()).
+    EndpointChannel* channel ABSL_GUARDED_BY(mutex) = nullptr;
+    bool try_decrypting ABSL_GUARDED_BY(mutex) = false;
+    // Reader only: the dedicated thread of channels that can't report
+    // readiness.
+    std::unique_ptr<SingleThreadExecutor> thread ABSL_GUARDED_BY(mutex);
+    // KeepAlive only: the next run of the worker.
+    Cancelable next_keep_alive ABSL_GUARDED_BY(mutex);
+  };
+
+  // What a worker does once its handler returned for a channel.
+  enum class WorkerAction {
+    // Go on with the same channel.
+    kKeepChannel,
+    // Look for a replacement of the channel, which has failed.
+    kReplaceChannel,
+    // Give up on the endpoint.
+    kStop,
+  };
+
   class EndpointState {
    public:
     EndpointState(const std::string& endpoint_id,
                   EndpointChannelManager* channel_manager)
-        : endpoint_id_{endpoint_id},
-          channel_manager_{channel_manager},
-          keep_alive_waiter_mutex_{std::make_unique<Mutex>()},
-          keep_alive_waiter_{std::make_unique<ConditionVariable>(
-              keep_alive_waiter_mutex_.get())} {}
+        : endpoint_id_{endpoint_id}, channel_manager_{channel_manager} {}
 
     EndpointState(const EndpointState&) = delete;
     // The default move constructor would not reset |channel_manager_|, for
@@ -184,32 +257,23 @@ class EndpointManager {
     EndpointState(EndpointState&& other)
         : endpoint_id_{std::move(other.endpoint_id_)},
           channel_manager_{std::exchange(other.channel_manager_, nullptr)},
-          reader_thread_{std::move(other.reader_thread_)},
-          keep_alive_waiter_mutex_{
-              std::exchange(other.keep_alive_waiter_mutex_, nullptr)},
-          keep_alive_waiter_{std::exchange(other.keep_alive_waiter_, nullptr)},
-          keep_alive_thread_{std::move(other.keep_alive_thread_)} {}
+          reader_{std::move(other.reader_)},
+          keep_alive_{std::move(other.keep_alive_)} {}
     EndpointState& operator=(const EndpointState&) = delete;
     EndpointState&& operator=(EndpointState&&) = delete;
     ~EndpointState();
 
-    void StartEndpointReader(Runnable&& runnable);
-    void StartEndpointKeepAliveManager(
-        absl::AnyInvocable<void(Mutex*, ConditionVariable*)> runnable);
+    void SetWorkers(std::shared_ptr<EndpointWorker> reader,
+                    std::shared_ptr<EndpointWorker> keep_alive) {
+      reader_ = std::move(reader);
+      keep_alive_ = std::move(keep_alive);
+    }
 
    private:
     const std::string endpoint_id_;
     EndpointChannelManager* channel_manager_;
-    SingleThreadExecutor reader_thread_;
-
-    // Use a condition variable so we can wait on the thread but still be able
-    // to wake it up before shutting down. We don't want to just sleep and risk
-    // blocking shutdown. Note: Create the mutex/condition variable on the heap
-    // so raw pointers sent to HandleKeepAlive() aren't invalidated during
-    // std::move operations.
-    mutable std::unique_ptr<Mutex> keep_alive_waiter_mutex_;
-    std::unique_ptr<ConditionVariable> keep_alive_waiter_;
-    SingleThreadExecutor keep_alive_thread_;
+    std::shared_ptr<EndpointWorker> reader_;
+    std::shared_ptr<EndpointWorker> keep_alive_;
   };
 
   // RAII accessor for FrameProcessor
@@ -234,12 +298,19 @@ class EndpointManager {
   ExceptionOr<bool> HandleData(const std::string& endpoint_id,
                                ClientProxy* client_proxy,
                                EndpointChannel* endpoint_channel);
-
+  // Reads and dispatches one frame. `try_decrypting` is cleared once the
+  // workaround described in HandleData() has been tried.
+  Exception HandleFrame(const std::string& endpoint_id,
+                        ClientProxy* client_proxy,
+                        EndpointChannel* endpoint_channel,
+                        bool& try_decrypting);
+
+  // Sends a KeepAlive frame if it is due, and sets `wait_for` to the time
+  // until it has to be called again.
   ExceptionOr<bool> HandleKeepAlive(EndpointChannel* endpoint_channel,
                                     absl::Duration keep_alive_interval,
                                     absl::Duration keep_alive_timeout,
-                                    Mutex* keep_alive_waiter_mutex,
-                                    ConditionVariable* keep_alive_waiter);
+                                    absl::Duration& wait_for);
 
   // Waits for a given endpoint EndpointChannelLoopRunnable() workers to
   // terminate.
@@ -252,6 +323,34 @@ class EndpointManager {
       const std::string& runnable_name, ClientProxy* client_proxy,
       const std::string& endpoint_id,
       absl::AnyInvocable<ExceptionOr<bool>(EndpointChannel*)> handler);
+  // Returns the channel a worker has to use next, or nullptr if there is none
+  // left to try after a failure on `last_failed_medium`.
+  std::shared_ptr<EndpointChannel> GetChannelForWorker(
+      const std::string& endpoint_id, Medium last_failed_medium);
+  WorkerAction GetWorkerAction(ClientProxy* client_proxy,
+                               const std::string& endpoint_id,
+                               EndpointChannel* channel,
+                               const ExceptionOr<bool>& result,
+                               Medium& last_failed_medium);
+  void StopWorker(const std::string& runnable_name, ClientProxy* client_proxy,
+                  const std::string& endpoint_id);
+
+  // Reads from the channel of `reader` on worker_pool_ whenever it is
+  // readable, or on a dedicated thread if it can't tell.
+  void StartReader(std::shared_ptr<EndpointWorker> reader)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(reader->mutex);
+  void ReadNextFrame(std::shared_ptr<EndpointWorker> reader);
+  // Checks the KeepAlive state of the endpoint and arms keep_alive_timer_ for
+  // the next check, which runs on keep_alive_pool_.
+  void RunKeepAlive(std::shared_ptr<EndpointWorker> keep_alive,
+                    absl::Duration keep_alive_interval,
+                    absl::Duration keep_alive_timeout);
+  // Runs `runnable` on `pool`, unless `worker` has been stopped. Called from
+  // threads that don't belong to the EndpointManager.
+  void RunOnPool(MultiThreadExecutor& pool,
+                 const std::shared_ptr<EndpointWorker>& worker,
+                 const std::string& name, Runnable runnable);
+  static void StopEndpointWorker(EndpointWorker* worker);
 
   static void WaitForLatch(const std::string& method_name,
                            CountDownLatch* latch);
@@ -260,7 +359,7 @@ class EndpointManager {
 
   // It should be noted that this method may be called multiple times (because
   // invoking this method closes the endpoint channel, which causes the
-  // dedicated reader and KeepAlive threads to terminate, which in turn leads to
+  // reader and KeepAlive workers to terminate, which in turn leads to
   // this method being called), but that's alright because the implementation of
   // this method is idempotent.
   // @EndpointManagerThread
@@ -281,17 +380,96 @@ class EndpointManager {
       ClientProxy* client, const std::string& service_id,
       const std::string& endpoint_id, DisconnectionReason reason);
 
+  // Whether a frame queued for one endpoint was written, or given up on.
+  // Shared with the sender waiting for it, and guarded by fan_out_mutex_.
+  struct FanOutFrameState {
+    bool written = false;
+    bool failed = false;
+  };
+
+  // Frame waiting in the send queue of an endpoint.
+  struct FanOutFrame {
+    // Shared by the send queues of all the endpoints the frame is sent to.
+    std::shared_ptr<const ByteArray> bytes;
+    std::int64_t payload_id;
+    analytics::PacketMetaData packet_meta_data;
+    // Number of the frame in its queue; frames are numbered from 0 in the
+    // order they are queued.
+    std::uint64_t sequence;
+    std::shared_ptr<FanOutFrameState> state;
+  };
+
+  // Frames to write to one endpoint, in order. While `scheduled` is set, the
+  // queue waits in fan_out_ready_ or its front frame is being written, which
+  // `writing` tells.
+  //
+  // When the endpoint falls behind for longer than the drop timeout, the
+  // frames queued for it fail. If a write is stuck in its channel, `dropped`
+  // is set until that write returns, and frames sent meanwhile fail right
+  // away; after that, frames are written again. After a failed write, or once
+  // the endpoint is removed, `failed` is set and nothing more is written.
+  struct FanOutQueue {
+    explicit FanOutQueue(std::string endpoint_id)
+        : endpoint_id(std::move(endpoint_id)) {}
+
+    const std::string endpoint_id;
+    std::deque<FanOutFrame> frames;
+    std::uint64_t next_sequence = 0;
+    bool scheduled = false;
+    bool writing = false;
+    // The write in progress belongs to a dropped endpoint, and no longer
+    // counts against kFanOutPoolSize.
+    bool stalled = false;
+    bool dropped = false;
+    bool failed = false;
+  };
+
+  // Writes `payload_transfer_frame_bytes` to every endpoint of
+  // `endpoint_ids`, and returns the ones that failed. If `flush` is set, the
+  // frame has been written to every endpoint that didn't fail on return, even
+  // when the send queues are used.
   std::vector<std::string> SendTransferFrameBytes(
       const std::vector<std::string>& endpoint_ids,
-      const ByteArray& payload_transfer_frame_bytes, std::int64_t payload_id,
+      ByteArray payload_transfer_frame_bytes, std::int64_t payload_id,
       std::int64_t offset, const std::string& packet_type,
-      analytics::PacketMetaData& packet_meta_data);
+      analytics::PacketMetaData& packet_meta_data, bool flush);
+  // SendTransferFrameBytes() through the send queues. Waits until every
+  // endpoint has at most `max_lag_frames` frames left to write, this one
+  // included, or until it failed.
+  std::vector<std::string> FanOutTransferFrameBytes(
+      const std::vector<std::string>& endpoint_ids, ByteArray bytes,
+      std::int64_t payload_id, const std::string& packet_type,
+      const analytics::PacketMetaData& packet_meta_data,
+      std::int64_t max_lag_frames);
+  // Feeds the timings of a frame written to `endpoint_id` to its chunk size
+  // controller, if it has one.
+  void OnFrameWritten(const std::string& endpoint_id,
+                      const analytics::PacketMetaData& packet_meta_data);
+  // Starts writes for the queues waiting in fan_out_ready_, in turn, while
+  // fewer than kFanOutPoolSize are running.
+  void DispatchFanOutWritesLocked()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(fan_out_mutex_);
+  // Writes the front frame of `queue` on fan_out_pool_, then puts the queue
+  // back in line if it has more.
+  void WriteFanOutFrame(std::shared_ptr<FanOutQueue> queue);
+  // Writes `frame` to `endpoint_id` and records it. Returns false on failure.
+  bool WriteFrameToEndpoint(const std::string& endpoint_id,
+                            const FanOutFrame& frame);
+  // Fails the frames of `queue` for an endpoint that fell too far behind, and
+  // stops counting its write in progress, if any, against kFanOutPoolSize.
+  void DropFanOutQueueLocked(FanOutQueue& queue)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(fan_out_mutex_);
+  // Fails every frame still in `queue` and empties it.
+  void FailFanOutFramesLocked(FanOutQueue& queue)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(fan_out_mutex_);
 
   // Executes all jobs sequentially, on a serial_executor_.
   void RunOnEndpointManagerThread(const std::string& name, Runnable runnable);
 
-  ExceptionOr<OfflineFrame> TryDecryptFrame(const ByteArray& data,
-                                            EndpointChannel* endpoint_channel);
+  // Parses the decrypted frame on `arena`.
+  ExceptionOr<OfflineFrame*> TryDecryptFrame(const ByteArray& data,
+                                             EndpointChannel* endpoint_channel,
+                                             google::protobuf::Arena* arena);
   EndpointChannelManager* channel_manager_;
 
   RecursiveMutex frame_processors_lock_;
@@ -299,6 +477,29 @@ class EndpointManager {
                       FrameProcessorWithMutex>
       frame_processors_ ABSL_GUARDED_BY(frame_processors_lock_);
 
+  // Shared by the workers of all endpoints. Declared before `endpoints_`, so
+  // they outlive it.
+  MultiThreadExecutor worker_pool_{kWorkerPoolSize};
+  MultiThreadExecutor keep_alive_pool_{kKeepAlivePoolSize};
+  ScheduledExecutor keep_alive_timer_;
+
+  Mutex fan_out_mutex_;
+  ConditionVariable fan_out_cond_{&fan_out_mutex_};
+  absl::flat_hash_map<std::string, std::shared_ptr<FanOutQueue>>
+      fan_out_queues_ ABSL_GUARDED_BY(fan_out_mutex_);
+  // Queues waiting for their turn to write one frame.
+  std::deque<std::shared_ptr<FanOutQueue>> fan_out_ready_
+      ABSL_GUARDED_BY(fan_out_mutex_);
+  int fan_out_running_writes_ ABSL_GUARDED_BY(fan_out_mutex_) = 0;
+  int fan_out_stalled_writes_ ABSL_GUARDED_BY(fan_out_mutex_) = 0;
+  Mutex chunk_size_mutex_;
+  // Created by GetAdaptiveChunkSize().
+  absl::flat_hash_map<std::string, ChunkSizeController> chunk_size_controllers_
+      ABSL_GUARDED_BY(chunk_size_mutex_);
+
+  // Declared after the send queues, so that it is shut down first.
+  MultiThreadExecutor fan_out_pool_{kFanOutPoolSize + kMaxStalledFanOutWrites};
+
   // We keep track of all registered channel endpoints here.
   absl::flat_hash_map<std::string, EndpointState> endpoints_;
 
@@ -0,0 +1,150 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Threads and memory used by EndpointManager against the number of connected
+// endpoints, for channels that do and don't report readiness.
+//
+// Thread count and resident memory are read from /proc/self/status, so both
+// are only reported on Linux.
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
+#include "connections/connection_options.h"
+#include "connections/implementation/client_proxy.h"
+#include "connections/implementation/endpoint_channel_manager.h"
+#include "connections/implementation/endpoint_manager.h"
+#include "connections/implementation/fake_endpoint_channel.h"
+#include "connections/listeners.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::location::nearby::proto::connections::DisconnectionReason;
+
+// A connected endpoint that never sends anything, which is what most
+// endpoints of a hub look like most of the time.
+class IdleEndpointChannel : public FakeEndpointChannel {
+ public:
+  explicit IdleEndpointChannel(bool reports_readiness)
+      : FakeEndpointChannel(Medium::WIFI_LAN, "service"),
+        reports_readiness_(reports_readiness) {}
+
+  ExceptionOr<ByteArray> Read(PacketMetaData& packet_meta_data) override {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(&closed_));
+    return {Exception::kIo};
+  }
+  void Close(DisconnectionReason reason) override {
+    absl::AnyInvocable<void()> callback;
+    {
+      absl::MutexLock lock(&mutex_);
+      closed_ = true;
+      callback = std::move(on_readable_);
+    }
+    FakeEndpointChannel::Close(reason);
+    if (callback) callback();
+  }
+  bool NotifyWhenReadable(absl::AnyInvocable<void()> callback) override {
+    if (!reports_readiness_) return false;
+    absl::MutexLock lock(&mutex_);
+    on_readable_ = std::move(callback);
+    return true;
+  }
+
+ private:
+  const bool reports_readiness_;
+  absl::Mutex mutex_;
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+  absl::AnyInvocable<void()> on_readable_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Returns the value of `field` in /proc/self/status, or 0 if unknown.
+std::int64_t GetProcStatus(absl::string_view field) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    absl::string_view value = line;
+    if (!absl::ConsumePrefix(&value, absl::StrCat(field, ":"))) continue;
+    absl::ConsumeSuffix(&value, " kB");
+    std::int64_t result = 0;
+    if (absl::SimpleAtoi(value, &result)) return result;
+  }
+  return 0;
+}
+
+// Connects state.range(0) endpoints, whose channels report readiness if
+// state.range(1) is set, and reports the threads and memory they cost.
+void BM_ConnectedEndpoints(benchmark::State& state) {
+  const int endpoint_count = state.range(0);
+  const bool reports_readiness = state.range(1) != 0;
+  ConnectionOptions connection_options{
+      .keep_alive_interval_millis = 5000,
+      .keep_alive_timeout_millis = 30000,
+  };
+  ConnectionListener listener;
+  ConnectionResponseInfo info;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    ClientProxy client;
+    EndpointChannelManager channel_manager;
+    auto endpoint_manager = std::make_unique<EndpointManager>(&channel_manager);
+    std::int64_t threads_before = GetProcStatus("Threads");
+    std::int64_t rss_before = GetProcStatus("VmRSS");
+    state.ResumeTiming();
+
+    for (int i = 0; i < endpoint_count; ++i) {
+      endpoint_manager->RegisterEndpoint(
+          &client, absl::StrCat("endpoint-", i), info, connection_options,
+          std::make_unique<IdleEndpointChannel>(reports_readiness), listener,
+          "token");
+    }
+
+    state.PauseTiming();
+    state.counters["threads"] = GetProcStatus("Threads") - threads_before;
+    state.counters["rss_kib"] = GetProcStatus("VmRSS") - rss_before;
+    for (int i = 0; i < endpoint_count; ++i) {
+      endpoint_manager->UnregisterEndpoint(&client,
+                                           absl::StrCat("endpoint-", i));
+    }
+    endpoint_manager.reset();
+    state.ResumeTiming();
+  }
+  state.counters["endpoints"] = endpoint_count;
+}
+BENCHMARK(BM_ConnectedEndpoints)
+    ->ArgNames({"endpoints", "readiness"})
+    ->ArgsProduct({{1, 10, 50, 100}, {0, 1}})
+    ->Iterations(3)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
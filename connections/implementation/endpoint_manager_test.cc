@@ -24,10 +24,13 @@
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "connections/connection_options.h"
+#include "connections/implementation/chunk_size_controller.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_channel_manager.h"
 #include "connections/implementation/flags/nearby_connections_feature_flags.h"
@@ -94,6 +97,8 @@ class MockEndpointChannel : public EndpointChannel {
   MOCK_METHOD(absl::Time, GetLastWriteTimestamp, (), (const override));
   MOCK_METHOD(void, SetAnalyticsRecorder,
               (analytics::AnalyticsRecorder*, const std::string&), (override));
+  MOCK_METHOD(bool, NotifyWhenReadable, (absl::AnyInvocable<void()> callback),
+              (override));
 
   bool IsClosed() const {
     absl::MutexLock lock(&mutex_);
@@ -350,6 +355,258 @@ TEST_F(EndpointManagerTest, SendControlMessageAndPayloadAckWorks) {
   NEARBY_LOG(INFO, "Will call destructors now");
 }
 
+TEST_F(EndpointManagerTest, FanOutDoesNotWaitForSlowEndpoint) {
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kEndpointFanOutMaxLagFrames,
+      4);
+  PayloadTransferFrame::PayloadHeader header;
+  PayloadTransferFrame::ControlMessage control;
+  header.set_id(12345);
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+  CountDownLatch release_slow_endpoint(1);
+  CountDownLatch fast_endpoint_written(3);
+  auto slow_channel = std::make_unique<MockEndpointChannel>();
+  auto fast_channel = std::make_unique<MockEndpointChannel>();
+  EXPECT_CALL(*slow_channel, NotifyWhenReadable).WillOnce(Return(true));
+  EXPECT_CALL(*fast_channel, NotifyWhenReadable).WillOnce(Return(true));
+  EXPECT_CALL(*slow_channel, Write(_, _))
+      .WillRepeatedly([&release_slow_endpoint](const ByteArray& data,
+                                               PacketMetaData& meta_data) {
+        release_slow_endpoint.Await();
+        return Exception{Exception::kSuccess};
+      });
+  EXPECT_CALL(*fast_channel, Write(_, _))
+      .WillRepeatedly([&fast_endpoint_written](const ByteArray& data,
+                                               PacketMetaData& meta_data) {
+        fast_endpoint_written.CountDown();
+        return Exception{Exception::kSuccess};
+      });
+  endpoint_id_ = "slow";
+  RegisterEndpoint(std::move(slow_channel), false);
+  endpoint_id_ = "fast";
+  RegisterEndpoint(std::move(fast_channel), false);
+
+  // The slow endpoint stays within the allowed lag, so none of the frames
+  // waits for it.
+  for (int i = 0; i < 3; ++i) {
+    control.set_offset(i);
+    EXPECT_EQ(em_.SendControlMessage(header, control,
+                                     std::vector<std::string>{"slow", "fast"}),
+              std::vector<std::string>{});
+  }
+  EXPECT_TRUE(fast_endpoint_written.Await(absl::Seconds(1)).result());
+
+  release_slow_endpoint.CountDown();
+  em_.UnregisterEndpoint(client_.get(), "slow");
+  em_.UnregisterEndpoint(client_.get(), "fast");
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
+TEST_F(EndpointManagerTest, FanOutDropsEndpointThatFallsBehind) {
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kEndpointFanOutMaxLagFrames,
+      1);
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kEndpointFanOutDropTimeoutMillis,
+      100);
+  PayloadTransferFrame::PayloadHeader header;
+  PayloadTransferFrame::ControlMessage control;
+  header.set_id(12345);
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+  CountDownLatch release_slow_endpoint(1);
+  std::atomic<int> slow_endpoint_writes = 0;
+  CountDownLatch fast_endpoint_written(3);
+  auto slow_channel = std::make_unique<MockEndpointChannel>();
+  auto fast_channel = std::make_unique<MockEndpointChannel>();
+  EXPECT_CALL(*slow_channel, NotifyWhenReadable).WillOnce(Return(true));
+  EXPECT_CALL(*fast_channel, NotifyWhenReadable).WillOnce(Return(true));
+  EXPECT_CALL(*slow_channel, Write(_, _))
+      .WillRepeatedly([&](const ByteArray& data, PacketMetaData& meta_data) {
+        ++slow_endpoint_writes;
+        release_slow_endpoint.Await();
+        return Exception{Exception::kSuccess};
+      });
+  EXPECT_CALL(*fast_channel, Write(_, _))
+      .WillRepeatedly([&fast_endpoint_written](const ByteArray& data,
+                                               PacketMetaData& meta_data) {
+        fast_endpoint_written.CountDown();
+        return Exception{Exception::kSuccess};
+      });
+  endpoint_id_ = "slow";
+  RegisterEndpoint(std::move(slow_channel), false);
+  endpoint_id_ = "fast";
+  RegisterEndpoint(std::move(fast_channel), false);
+  std::vector<std::string> endpoint_ids{"slow", "fast"};
+
+  control.set_offset(0);
+  EXPECT_EQ(em_.SendControlMessage(header, control, endpoint_ids),
+            std::vector<std::string>{});
+  // The slow endpoint is still writing the first frame when the drop timeout
+  // expires.
+  control.set_offset(1);
+  EXPECT_EQ(em_.SendControlMessage(header, control, endpoint_ids),
+            std::vector<std::string>{"slow"});
+  // Until that write returns, frames fail for it without waiting.
+  control.set_offset(2);
+  absl::Time start = absl::Now();
+  EXPECT_EQ(em_.SendControlMessage(header, control, endpoint_ids),
+            std::vector<std::string>{"slow"});
+  EXPECT_LT(absl::Now() - start, absl::Milliseconds(100));
+  EXPECT_TRUE(fast_endpoint_written.Await(absl::Seconds(1)).result());
+
+  release_slow_endpoint.CountDown();
+  em_.UnregisterEndpoint(client_.get(), "slow");
+  em_.UnregisterEndpoint(client_.get(), "fast");
+  // The frame queued behind the stuck one was dropped.
+  EXPECT_EQ(slow_endpoint_writes, 1);
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
+TEST_F(EndpointManagerTest, FanOutWritesToDroppedEndpointOnceWriteReturns) {
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kEndpointFanOutMaxLagFrames,
+      1);
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kEndpointFanOutDropTimeoutMillis,
+      100);
+  PayloadTransferFrame::PayloadHeader header;
+  PayloadTransferFrame::ControlMessage control;
+  header.set_id(12345);
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+  CountDownLatch release_slow_endpoint(1);
+  CountDownLatch slow_endpoint_written_again(1);
+  std::atomic<int> slow_endpoint_writes = 0;
+  auto slow_channel = std::make_unique<MockEndpointChannel>();
+  auto fast_channel = std::make_unique<MockEndpointChannel>();
+  EXPECT_CALL(*slow_channel, NotifyWhenReadable).WillOnce(Return(true));
+  EXPECT_CALL(*fast_channel, NotifyWhenReadable).WillOnce(Return(true));
+  EXPECT_CALL(*slow_channel, Write(_, _))
+      .WillRepeatedly([&](const ByteArray& data, PacketMetaData& meta_data) {
+        if (++slow_endpoint_writes == 2) {
+          slow_endpoint_written_again.CountDown();
+        }
+        release_slow_endpoint.Await();
+        return Exception{Exception::kSuccess};
+      });
+  EXPECT_CALL(*fast_channel, Write(_, _))
+      .WillRepeatedly(Return(Exception{Exception::kSuccess}));
+  endpoint_id_ = "slow";
+  RegisterEndpoint(std::move(slow_channel), false);
+  endpoint_id_ = "fast";
+  RegisterEndpoint(std::move(fast_channel), false);
+  std::vector<std::string> endpoint_ids{"slow", "fast"};
+
+  control.set_offset(0);
+  EXPECT_EQ(em_.SendControlMessage(header, control, endpoint_ids),
+            std::vector<std::string>{});
+  control.set_offset(1);
+  EXPECT_EQ(em_.SendControlMessage(header, control, endpoint_ids),
+            std::vector<std::string>{"slow"});
+
+  // Only the frame that timed out failed. Once the stuck write returns, the
+  // next frame reaches the endpoint.
+  release_slow_endpoint.CountDown();
+  control.set_offset(2);
+  std::vector<std::string> failed_endpoint_ids;
+  for (int attempt = 0; attempt < 100; ++attempt) {
+    failed_endpoint_ids = em_.SendControlMessage(header, control, endpoint_ids);
+    if (failed_endpoint_ids.empty()) break;
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_EQ(failed_endpoint_ids, std::vector<std::string>{});
+  EXPECT_TRUE(slow_endpoint_written_again.Await(absl::Seconds(1)).result());
+
+  em_.UnregisterEndpoint(client_.get(), "slow");
+  em_.UnregisterEndpoint(client_.get(), "fast");
+  EXPECT_EQ(slow_endpoint_writes, 2);
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
+TEST_F(EndpointManagerTest, FanOutFailsEndpointAfterWriteError) {
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kEndpointFanOutMaxLagFrames,
+      1);
+  PayloadTransferFrame::PayloadHeader header;
+  PayloadTransferFrame::ControlMessage control;
+  header.set_id(12345);
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+  std::atomic<int> broken_endpoint_writes = 0;
+  auto broken_channel = std::make_unique<MockEndpointChannel>();
+  auto healthy_channel = std::make_unique<MockEndpointChannel>();
+  EXPECT_CALL(*broken_channel, NotifyWhenReadable).WillOnce(Return(true));
+  EXPECT_CALL(*healthy_channel, NotifyWhenReadable).WillOnce(Return(true));
+  EXPECT_CALL(*broken_channel, Write(_, _))
+      .WillRepeatedly([&broken_endpoint_writes](const ByteArray& data,
+                                                PacketMetaData& meta_data) {
+        ++broken_endpoint_writes;
+        return Exception{Exception::kIo};
+      });
+  EXPECT_CALL(*healthy_channel, Write(_, _))
+      .WillRepeatedly(Return(Exception{Exception::kSuccess}));
+  endpoint_id_ = "broken";
+  RegisterEndpoint(std::move(broken_channel), false);
+  endpoint_id_ = "healthy";
+  RegisterEndpoint(std::move(healthy_channel), false);
+  std::vector<std::string> endpoint_ids{"broken", "healthy"};
+
+  control.set_offset(0);
+  EXPECT_EQ(em_.SendControlMessage(header, control, endpoint_ids),
+            std::vector<std::string>{});
+  for (int i = 1; i < 4; ++i) {
+    control.set_offset(i);
+    EXPECT_EQ(em_.SendControlMessage(header, control, endpoint_ids),
+              std::vector<std::string>{"broken"});
+  }
+
+  em_.UnregisterEndpoint(client_.get(), "broken");
+  em_.UnregisterEndpoint(client_.get(), "healthy");
+  // Nothing was written after the first failure.
+  EXPECT_EQ(broken_endpoint_writes, 1);
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
+TEST_F(EndpointManagerTest, AdaptiveChunkSizeFollowsFrameTimings) {
+  constexpr int kMaxTransmitPacketSize = 64 * 1024;
+  PayloadTransferFrame::PayloadHeader header;
+  PayloadTransferFrame::ControlMessage control;
+  header.set_id(12345);
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+  auto endpoint_channel = std::make_unique<MockEndpointChannel>();
+  EXPECT_CALL(*endpoint_channel, NotifyWhenReadable).WillOnce(Return(true));
+  EXPECT_CALL(*endpoint_channel, GetMaxTransmitPacketSize())
+      .WillRepeatedly(Return(kMaxTransmitPacketSize));
+  // Every frame is reported as a full packet taking half a second to send.
+  EXPECT_CALL(*endpoint_channel, Write(_, _))
+      .WillRepeatedly(
+          [](const ByteArray& data, PacketMetaData& packet_meta_data) {
+            packet_meta_data.socket_io_start_time = absl::Now();
+            packet_meta_data.socket_io_end_time =
+                packet_meta_data.socket_io_start_time + absl::Seconds(0.5);
+            packet_meta_data.SetPacketSize(kMaxTransmitPacketSize);
+            return Exception{Exception::kSuccess};
+          });
+  RegisterEndpoint(std::move(endpoint_channel), false);
+
+  EXPECT_EQ(em_.GetAdaptiveChunkSize(endpoint_id_, absl::Milliseconds(100)),
+            kMaxTransmitPacketSize);
+  for (int i = 0; i < 10; ++i) {
+    em_.SendControlMessage(header, control, std::vector{endpoint_id_});
+  }
+  int chunk_size =
+      em_.GetAdaptiveChunkSize(endpoint_id_, absl::Milliseconds(100));
+  EXPECT_LT(chunk_size, kMaxTransmitPacketSize);
+  EXPECT_GE(chunk_size, ChunkSizeController::kMinChunkSize);
+  EXPECT_EQ(em_.GetAdaptiveChunkSize("unknown", absl::Milliseconds(100)), 0);
+
+  em_.UnregisterEndpoint(client_.get(), endpoint_id_);
+}
+
 TEST_F(EndpointManagerTest, SingleReadOnReadError) {
   auto endpoint_channel = std::make_unique<MockEndpointChannel>();
   EXPECT_CALL(*endpoint_channel, Read(_))
@@ -458,6 +715,110 @@ TEST_F(EndpointManagerTest, TryDecrypt) {
   RegisterEndpoint(std::move(endpoint_channel));
 }
 
+TEST_F(EndpointManagerTest, ReadsOnWorkerPoolWhenChannelReportsReadiness) {
+  SingleThreadExecutor notifier;
+  auto endpoint_channel = std::make_unique<MockEndpointChannel>();
+  auto connect_request = std::make_unique<MockFrameProcessor>();
+  ByteArray endpoint_info{"endpoint_name"};
+  ConnectionInfo connection_info{
+      "endpoint_id",
+      endpoint_info,
+      1234 /*nonce*/,
+      false /*supports_5_ghz*/,
+      "" /*bssid*/,
+      2412 /*ap_frequency*/,
+      "8xqT" /*ip_address in 4 bytes format*/,
+      std::vector<Medium>{Medium::BLE} /*supported_mediums*/,
+      0 /*keep_alive_interval_millis*/,
+      0 /*keep_alive_timeout_millis*/};
+  auto read_data = parser::ForConnectionRequestConnections({}, connection_info);
+  EXPECT_CALL(*connect_request, OnIncomingFrame);
+  EXPECT_CALL(*connect_request, OnEndpointDisconnect);
+  // Armed for the first frame, then again after it. The read failure that
+  // follows ends the reader.
+  EXPECT_CALL(*endpoint_channel, NotifyWhenReadable)
+      .Times(2)
+      .WillRepeatedly([&notifier](absl::AnyInvocable<void()> callback) {
+        notifier.Execute(std::move(callback));
+        return true;
+      });
+  EXPECT_CALL(*endpoint_channel, Read(_))
+      .WillOnce(Return(ExceptionOr<ByteArray>(read_data)))
+      .WillRepeatedly(Return(ExceptionOr<ByteArray>(Exception::kIo)));
+  EXPECT_CALL(*endpoint_channel, Write(_))
+      .WillRepeatedly(Return(Exception{Exception::kSuccess}));
+  em_.RegisterFrameProcessor(V1Frame::CONNECTION_REQUEST,
+                             connect_request.get());
+  processors_.emplace_back(std::move(connect_request));
+  RegisterEndpoint(std::move(endpoint_channel));
+}
+
+TEST_F(EndpointManagerTest, SendsKeepAliveFromSharedTimer) {
+  connection_options_.keep_alive_interval_millis = 20;
+  CountDownLatch keep_alive_sent(2);
+  auto endpoint_channel = std::make_unique<MockEndpointChannel>();
+  // Nothing to read: the reader stays idle without holding a thread.
+  EXPECT_CALL(*endpoint_channel, NotifyWhenReadable).WillOnce(Return(true));
+  EXPECT_CALL(*endpoint_channel, Write(_))
+      .WillRepeatedly(Return(Exception{Exception::kSuccess}));
+  EXPECT_CALL(*endpoint_channel, Write(Eq(parser::ForKeepAlive())))
+      .WillRepeatedly([&keep_alive_sent](const ByteArray& data) {
+        keep_alive_sent.CountDown();
+        return Exception{Exception::kSuccess};
+      });
+  RegisterEndpoint(std::move(endpoint_channel), false);
+
+  EXPECT_TRUE(keep_alive_sent.Await(absl::Seconds(1)).result());
+  em_.UnregisterEndpoint(client_.get(), endpoint_id_);
+}
+
+TEST_F(EndpointManagerTest, SendsKeepAliveWhileReadsOccupyWorkerPool) {
+  connection_options_.keep_alive_interval_millis = 20;
+  SingleThreadExecutor notifier;
+  CountDownLatch release_reads(1);
+  EXPECT_CALL(mock_listener_.initiated_cb, Call)
+      .Times(EndpointManager::kWorkerPoolSize);
+  // Each of these endpoints keeps a thread of the worker pool busy in Read().
+  for (int i = 0; i < EndpointManager::kWorkerPoolSize; ++i) {
+    auto channel = std::make_unique<MockEndpointChannel>();
+    EXPECT_CALL(*channel, NotifyWhenReadable)
+        .WillRepeatedly([&notifier](absl::AnyInvocable<void()> callback) {
+          notifier.Execute(std::move(callback));
+          return true;
+        });
+    EXPECT_CALL(*channel, Read(_))
+        .WillRepeatedly([&release_reads](PacketMetaData& packet_meta_data) {
+          release_reads.Await();
+          return ExceptionOr<ByteArray>(Exception::kIo);
+        });
+    EXPECT_CALL(*channel, Write(_))
+        .WillRepeatedly(Return(Exception{Exception::kSuccess}));
+    EXPECT_CALL(*channel, GetMedium()).WillRepeatedly(Return(Medium::BLE));
+    EXPECT_CALL(*channel, GetLastReadTimestamp())
+        .WillRepeatedly(Return(start_time_));
+    EXPECT_CALL(*channel, GetLastWriteTimestamp())
+        .WillRepeatedly(Return(start_time_));
+    em_.RegisterEndpoint(client_.get(), absl::StrCat("blocked_", i), info_,
+                         connection_options_, std::move(channel), listener_,
+                         connection_token_);
+  }
+  CountDownLatch keep_alive_sent(2);
+  auto endpoint_channel = std::make_unique<MockEndpointChannel>();
+  EXPECT_CALL(*endpoint_channel, NotifyWhenReadable).WillOnce(Return(true));
+  EXPECT_CALL(*endpoint_channel, Write(_))
+      .WillRepeatedly(Return(Exception{Exception::kSuccess}));
+  EXPECT_CALL(*endpoint_channel, Write(Eq(parser::ForKeepAlive())))
+      .WillRepeatedly([&keep_alive_sent](const ByteArray& data) {
+        keep_alive_sent.CountDown();
+        return Exception{Exception::kSuccess};
+      });
+  RegisterEndpoint(std::move(endpoint_channel), false);
+
+  EXPECT_TRUE(keep_alive_sent.Await(absl::Seconds(1)).result());
+  release_reads.CountDown();
+  em_.UnregisterEndpoint(client_.get(), endpoint_id_);
+}
+
 // Regression test for b/278729669.
 //
 // During the destruction of NearbyConnections, Core (which owns ClientProxy)
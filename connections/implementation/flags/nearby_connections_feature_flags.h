@@ -62,6 +62,76 @@ constexpr auto kEnablePayloadReceivedAck =
 constexpr auto kSafeToDisconnectVersion =
     flags::Flag<int64_t>(kConfigPackage, "45425841", 0);
 
+// Enable/Disable pipelined endpoint channels. When enabled, a channel encrypts
+// on the writer's thread and hands the frame to a dedicated socket write stage,
+// and reads frames ahead of the reader so decryption overlaps socket reads.
+constexpr auto kEnableEndpointChannelPipelining =
+    flags::Flag<bool>(kConfigPackage, "45632411", false);
+
+// Enable/Disable read-ahead for outgoing file payloads. When enabled, the next
+// few chunks of a file are read on a separate thread while the current chunk
+// is being sent.
+constexpr auto kEnableFilePayloadReadAhead =
+    flags::Flag<bool>(kConfigPackage, "45632412", false);
+
+// Enable/Disable the concurrent payload scheduler. When enabled, outgoing
+// bytes and file payloads to different endpoints are sent in parallel on a
+// bounded worker pool, interleaved chunk by chunk, with bytes payloads
+// preferred over file payloads.
+constexpr auto kEnableConcurrentPayloadScheduler =
+    flags::Flag<bool>(kConfigPackage, "45632413", false);
+
+// Maximum number of bytes of an incoming stream payload buffered until the
+// client reads them. Once reached, reading further frames from the endpoint
+// waits for the client. 0 means unbounded.
+constexpr auto kIncomingStreamPayloadBufferSizeBytes =
+    flags::Flag<int64_t>(kConfigPackage, "45632414", 0);
+
+// Maximum number of bytes of an incoming file payload queued for the disk
+// writer threads. When set, chunks are written to disk off the endpoint's
+// reader thread, which only waits once this many bytes are queued. 0 means
+// chunks are written on the reader thread.
+constexpr auto kIncomingFilePayloadWriteBehindBytes =
+    flags::Flag<int64_t>(kConfigPackage, "45632415", 0);
+
+// Maximum number of frames an endpoint may fall behind when payload frames are
+// sent to several endpoints. When set, every endpoint has its own send queue,
+// written in parallel with the others, and the sender only waits for an
+// endpoint once it is this many frames behind. 0 means frames are written to
+// one endpoint after the other.
+constexpr auto kEndpointFanOutMaxLagFrames =
+    flags::Flag<int64_t>(kConfigPackage, "45632416", 0);
+
+// How long the sender waits for an endpoint that fell too far behind before
+// failing the frames queued for it, when kEndpointFanOutMaxLagFrames is set.
+// The frames sent after that fail right away until the write stuck in the
+// channel of the endpoint returns. 0 means the sender waits as long as it
+// takes.
+constexpr auto kEndpointFanOutDropTimeoutMillis =
+    flags::Flag<int64_t>(kConfigPackage, "45632417", 0);
+
+// Time to send one payload frame that chunk sizes are tuned for, per endpoint,
+// from the timings of the frames sent to it. Chunks stay within the largest
+// frame the medium takes. 0 means chunks are always that largest size.
+constexpr auto kAdaptiveChunkTargetMillis =
+    flags::Flag<int64_t>(kConfigPackage, "45632418", 0);
+
+// Bytes of each incoming payload a sender may have in flight ahead of the
+// receiver, advertised in the connection response. Payload flow control is
+// used with an endpoint when both devices advertise a window; receivers then
+// report their progress every half window, and senders wait for room in the
+// window before sending a chunk. 0 means no flow control.
+constexpr auto kPayloadReceiveWindowBytes =
+    flags::Flag<int64_t>(kConfigPackage, "45632419", 0);
+
+// How long an incoming stream payload waits for the client to read from a
+// full buffer when kIncomingStreamPayloadBufferSizeBytes is set. Once it
+// expires the payload fails, so that a client that stopped reading doesn't
+// hold up the other frames of the endpoint. 0 fails the payload as soon as the
+// buffer is full.
+constexpr auto kIncomingStreamPayloadWriteTimeoutMillis =
+    flags::Flag<int64_t>(kConfigPackage, "45632420", 5000);
+
 }  // namespace nearby_connections_feature
 }  // namespace config_package_nearby
 }  // namespace connections
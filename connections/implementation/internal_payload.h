@@ -96,6 +96,10 @@ class InternalPayload {
   // early, e.g. after being cancelled or having no more recipients left.
   virtual void Close() {}
 
+  // Returns the number of bytes attached but not yet written out, for
+  // payloads that write behind AttachNextChunk().
+  virtual std::int64_t GetQueuedWriteBytes() const { return 0; }
+
  protected:
   Payload payload_;
   // We're caching the payload ID here because the backing payload will be
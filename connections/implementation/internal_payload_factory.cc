@@ -16,24 +16,34 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
 #include <utility>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "connections/implementation/flags/nearby_connections_feature_flags.h"
 #include "connections/implementation/internal_payload.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/payload.h"
 #include "connections/payload_type.h"
+#include "internal/flags/nearby_flags.h"
 #include "internal/platform/byte_array.h"
+#include "internal/platform/condition_variable.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/file.h"
 #include "internal/platform/implementation/platform.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/logging.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/multi_thread_executor.h"
+#include "internal/platform/mutex_lock.h"
 #include "internal/platform/os_name.h"
 #include "internal/platform/output_stream.h"
 #include "internal/platform/pipe.h"
+#include "internal/platform/single_thread_executor.h"
 
 namespace nearby {
 namespace connections {
@@ -176,7 +186,13 @@ class IncomingStreamInternalPayload : public InternalPayload {
       return {Exception::kSuccess};
     }
 
-    return output_->Write(chunk);
+    Exception exception = output_->Write(chunk);
+    if (exception.Raised(Exception::kTimeout)) {
+      NEARBY_LOGS(WARNING) << "Client stopped reading incoming Payload " << this
+                           << ", failing it.";
+      return {Exception::kIo};
+    }
+    return exception;
   }
 
   ExceptionOr<size_t> SkipToOffset(size_t offset) override {
@@ -191,11 +207,26 @@ class IncomingStreamInternalPayload : public InternalPayload {
   std::unique_ptr<OutputStream> output_;
 };
 
+// Number of chunks an outgoing file payload keeps read ahead of the sender
+// when file payload read-ahead is enabled. Bounds the memory held per payload
+// to kMaxReadAheadChunks * chunk_size.
+constexpr size_t kMaxReadAheadChunks = 4;
+
+// Outgoing file payload. When kEnableFilePayloadReadAhead is on, a dedicated
+// read-ahead thread keeps up to kMaxReadAheadChunks chunks of the file in
+// memory, so reading the next chunk from disk overlaps with sending the
+// current one on the channel. The thread is started by the first
+// DetachNextChunk() call and stopped by Close().
 class OutgoingFileInternalPayload : public InternalPayload {
  public:
   explicit OutgoingFileInternalPayload(Payload payload)
       : InternalPayload(std::move(payload)),
-        total_size_{payload_.AsFile()->GetTotalSize()} {}
+        total_size_{payload_.AsFile()->GetTotalSize()},
+        read_ahead_(NearbyFlags::GetInstance().GetBoolFlag(
+            config_package_nearby::nearby_connections_feature::
+                kEnableFilePayloadReadAhead)) {}
+
+  ~OutgoingFileInternalPayload() override { StopReadAhead(); }
 
   location::nearby::connections::PayloadTransferFrame::PayloadHeader::
       PayloadType
@@ -207,6 +238,10 @@ class OutgoingFileInternalPayload : public InternalPayload {
   std::int64_t GetTotalSize() const override { return total_size_; }
 
   ByteArray DetachNextChunk(int chunk_size) override {
+    if (read_ahead_) {
+      return DetachReadAheadChunk(chunk_size);
+    }
+
     InputFile* file = payload_.AsFile();
     if (!file) return {};
 
@@ -237,6 +272,18 @@ class OutgoingFileInternalPayload : public InternalPayload {
     if (!file) {
       return {Exception::kIo};
     }
+    {
+      MutexLock lock(&mutex_);
+      if (read_ahead_started_) {
+        // Chunks past the current offset may already be buffered; skipping
+        // the file underneath them would desync the payload.
+        NEARBY_LOGS(WARNING) << "Skip offset: " << offset
+                             << " requested after read-ahead started for "
+                                "file payload "
+                             << this;
+        return {Exception::kIo};
+      }
+    }
 
     ExceptionOr<size_t> real_offset = file->Skip(offset);
     if (real_offset.ok() && real_offset.GetResult() == offset) {
@@ -254,21 +301,133 @@ class OutgoingFileInternalPayload : public InternalPayload {
   }
 
   void Close() override {
+    StopReadAhead();
     InputFile* file = payload_.AsFile();
     if (file) file->Close();
   }
 
  private:
+  ByteArray DetachReadAheadChunk(int chunk_size) {
+    MutexLock lock(&mutex_);
+    // Later reads use the most recently requested size, so a change in the
+    // optimal chunk size (e.g. after a bandwidth upgrade) takes effect after
+    // the already buffered chunks.
+    read_ahead_chunk_size_ = chunk_size;
+    if (!read_ahead_started_ && !closed_) {
+      read_ahead_started_ = true;
+      reader_ = std::make_unique<SingleThreadExecutor>();
+      reader_->Execute("file-read-ahead", [this]() { RunReadAhead(); });
+    }
+    while (chunks_.empty() && !end_of_file_ && !closed_) {
+      cond_.Wait();
+    }
+    if (closed_ || chunks_.empty()) {
+      return {};
+    }
+
+    ByteArray chunk = std::move(chunks_.front());
+    chunks_.pop_front();
+    if (chunk.size() > static_cast<size_t>(chunk_size)) {
+      // The chunk was read for a larger size than the caller can send now;
+      // hand out the head and keep the tail for the next call.
+      chunks_.push_front(
+          ByteArray(chunk.data() + chunk_size, chunk.size() - chunk_size));
+      chunk = ByteArray(chunk.data(), chunk_size);
+    }
+    cond_.Notify();
+    return chunk;
+  }
+
+  void RunReadAhead() {
+    InputFile* file = payload_.AsFile();
+    while (true) {
+      int chunk_size;
+      {
+        MutexLock lock(&mutex_);
+        while (chunks_.size() >= kMaxReadAheadChunks && !closed_) {
+          cond_.Wait();
+        }
+        if (closed_) {
+          return;
+        }
+        chunk_size = read_ahead_chunk_size_;
+      }
+
+      ExceptionOr<ByteArray> bytes_read =
+          file ? file->Read(chunk_size) : ExceptionOr<ByteArray>{ByteArray()};
+
+      MutexLock lock(&mutex_);
+      if (!bytes_read.ok() || bytes_read.result().Empty()) {
+        if (bytes_read.ok() && file) {
+          // No more data for outgoing payload.
+          file->Close();
+        }
+        end_of_file_ = true;
+        cond_.Notify();
+        return;
+      }
+      chunks_.push_back(std::move(bytes_read.result()));
+      cond_.Notify();
+    }
+  }
+
+  void StopReadAhead() {
+    std::unique_ptr<SingleThreadExecutor> reader;
+    {
+      MutexLock lock(&mutex_);
+      closed_ = true;
+      cond_.Notify();
+      reader = std::move(reader_);
+    }
+    // Destroying the executor joins the read-ahead thread, which returns once
+    // it sees `closed_` or reaches the end of the file.
+    reader.reset();
+  }
+
   std::int64_t total_size_;
+  const bool read_ahead_;
+
+  Mutex mutex_;
+  ConditionVariable cond_{&mutex_};
+  std::deque<ByteArray> chunks_ ABSL_GUARDED_BY(mutex_);
+  int read_ahead_chunk_size_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool read_ahead_started_ ABSL_GUARDED_BY(mutex_) = false;
+  bool end_of_file_ ABSL_GUARDED_BY(mutex_) = false;
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+  std::unique_ptr<SingleThreadExecutor> reader_ ABSL_GUARDED_BY(mutex_);
 };
 
+// Incoming file chunks are coalesced into writes of this size, so that every
+// write but the last one starts and ends on a multiple of it in the file.
+constexpr size_t kWriteBlockSize = 64 * 1024;
+// Number of threads writing incoming file payloads to disk, shared by all of
+// them.
+constexpr int kDiskWriterThreads = 2;
+
+MultiThreadExecutor& GetDiskWriterPool() {
+  static MultiThreadExecutor* pool =
+      new MultiThreadExecutor(kDiskWriterThreads);
+  return *pool;
+}
+
+// Incoming file payload. When kIncomingFilePayloadWriteBehindBytes is set,
+// chunks are coalesced into kWriteBlockSize blocks and written by the disk
+// writer pool, one block at a time per payload, so a slow disk doesn't hold
+// up the endpoint's reader thread. AttachNextChunk() only waits while that
+// many bytes are queued. A failed write is returned by the next call, and the
+// last (empty) chunk waits for all queued blocks to be written.
 class IncomingFileInternalPayload : public InternalPayload {
  public:
   IncomingFileInternalPayload(Payload payload, OutputFile output_file,
                               std::int64_t total_size)
       : InternalPayload(std::move(payload)),
         output_file_(std::move(output_file)),
-        total_size_(total_size) {}
+        total_size_(total_size),
+        max_queued_bytes_(NearbyFlags::GetInstance().GetInt64Flag(
+            config_package_nearby::nearby_connections_feature::
+                kIncomingFilePayloadWriteBehindBytes)) {}
+
+  ~IncomingFileInternalPayload() override { StopWrites(); }
 
   location::nearby::connections::PayloadTransferFrame::PayloadHeader::
       PayloadType
@@ -282,6 +441,10 @@ class IncomingFileInternalPayload : public InternalPayload {
   ByteArray DetachNextChunk(int chunk_size) override { return {}; }
 
   Exception AttachNextChunk(const ByteArray& chunk) override {
+    if (max_queued_bytes_ > 0) {
+      return chunk.Empty() ? FinishWrites() : QueueChunk(chunk);
+    }
+
     if (chunk.Empty()) {
       // Received null last chunk for incoming payload.
       output_file_.Close();
@@ -297,11 +460,135 @@ class IncomingFileInternalPayload : public InternalPayload {
     return {Exception::kIo};
   }
 
-  void Close() override { output_file_.Close(); }
+  void Close() override {
+    StopWrites();
+    output_file_.Close();
+  }
+
+  std::int64_t GetQueuedWriteBytes() const override {
+    MutexLock lock(&mutex_);
+    return queued_bytes_ + block_.size();
+  }
 
  private:
+  Exception QueueChunk(const ByteArray& chunk) {
+    MutexLock lock(&mutex_);
+    while (queued_bytes_ >= max_queued_bytes_ && write_error_.Ok() &&
+           !closed_) {
+      cond_.Wait();
+    }
+    if (!write_error_.Ok()) {
+      return write_error_;
+    }
+    if (closed_) {
+      return {Exception::kIo};
+    }
+    if (block_.capacity() < kWriteBlockSize) {
+      block_.reserve(kWriteBlockSize);
+    }
+    block_.append(chunk.data(), chunk.size());
+    size_t full_blocks_size = block_.size() / kWriteBlockSize * kWriteBlockSize;
+    if (full_blocks_size == 0) {
+      return {Exception::kSuccess};
+    }
+    if (full_blocks_size == block_.size()) {
+      blocks_.push_back(ByteArray(std::move(block_)));
+      block_.clear();
+    } else {
+      blocks_.push_back(ByteArray(block_.data(), full_blocks_size));
+      block_.erase(0, full_blocks_size);
+    }
+    queued_bytes_ += full_blocks_size;
+    ScheduleWrites();
+    return {Exception::kSuccess};
+  }
+
+  Exception FinishWrites() {
+    Exception result;
+    {
+      MutexLock lock(&mutex_);
+      if (!block_.empty() && write_error_.Ok() && !closed_) {
+        queued_bytes_ += block_.size();
+        blocks_.push_back(ByteArray(std::move(block_)));
+        block_.clear();
+        ScheduleWrites();
+      }
+      while (writing_) {
+        cond_.Wait();
+      }
+      result = closed_ ? Exception{Exception::kIo} : write_error_;
+    }
+    // Received null last chunk for incoming payload.
+    Exception close_result = output_file_.Close();
+    return result.Ok() ? close_result : result;
+  }
+
+  void ScheduleWrites() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    if (writing_ || blocks_.empty()) {
+      return;
+    }
+    writing_ = true;
+    GetDiskWriterPool().Execute("incoming-file-write",
+                                [this]() { RunWrites(); });
+  }
+
+  // Writes the queued blocks in order on a disk writer thread, until none are
+  // left, a write fails or the payload is closed.
+  void RunWrites() {
+    while (true) {
+      ByteArray block;
+      {
+        MutexLock lock(&mutex_);
+        if (blocks_.empty() || closed_) {
+          writing_ = false;
+          cond_.Notify();
+          return;
+        }
+        block = std::move(blocks_.front());
+        blocks_.pop_front();
+      }
+
+      Exception result = output_file_.Write(block);
+
+      MutexLock lock(&mutex_);
+      queued_bytes_ -= block.size();
+      if (!result.Ok()) {
+        NEARBY_LOGS(ERROR) << "Failed to write incoming file payload " << this;
+        write_error_ = result;
+        writing_ = false;
+        cond_.Notify();
+        return;
+      }
+      cond_.Notify();
+    }
+  }
+
+  void StopWrites() {
+    MutexLock lock(&mutex_);
+    closed_ = true;
+    cond_.Notify();
+    // A write in progress holds `this`; the queued blocks are dropped.
+    while (writing_) {
+      cond_.Wait();
+    }
+    blocks_.clear();
+    block_.clear();
+    queued_bytes_ = 0;
+  }
+
   OutputFile output_file_;
   const std::int64_t total_size_;
+  const std::int64_t max_queued_bytes_;
+
+  mutable Mutex mutex_;
+  ConditionVariable cond_{&mutex_};
+  // Bytes not yet making up a whole block.
+  std::string block_ ABSL_GUARDED_BY(mutex_);
+  std::deque<ByteArray> blocks_ ABSL_GUARDED_BY(mutex_);
+  std::int64_t queued_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool writing_ ABSL_GUARDED_BY(mutex_) = false;
+  Exception write_error_ ABSL_GUARDED_BY(mutex_) = {Exception::kSuccess};
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
 };
 
 }  // namespace
@@ -366,7 +653,24 @@ std::unique_ptr<InternalPayload> CreateIncomingInternalPayload(
     }
 
     case PayloadTransferFrame::PayloadHeader::STREAM: {
-      auto [input, output] = CreatePipe();
+      // With a bounded pipe, a client that reads the stream slowly makes the
+      // endpoint's reader wait instead of buffering the whole stream. A client
+      // that stops reading altogether fails the payload once the write times
+      // out.
+      size_t buffer_size = NearbyFlags::GetInstance().GetInt64Flag(
+          config_package_nearby::nearby_connections_feature::
+              kIncomingStreamPayloadBufferSizeBytes);
+      PipeOptions options = {
+          .high_watermark = buffer_size,
+          .low_watermark = buffer_size / 2,
+      };
+      if (buffer_size > 0) {
+        options.write_timeout =
+            absl::Milliseconds(NearbyFlags::GetInstance().GetInt64Flag(
+                config_package_nearby::nearby_connections_feature::
+                    kIncomingStreamPayloadWriteTimeoutMillis));
+      }
+      auto [input, output] = CreatePipe(options);
 
       return std::make_unique<IncomingStreamInternalPayload>(
           Payload(payload_id, std::move(input)), std::move(output));
@@ -20,10 +20,14 @@
 #include <utility>
 
 #include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "connections/implementation/flags/nearby_connections_feature_flags.h"
 #include "connections/implementation/internal_payload.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/payload.h"
 #include "connections/payload_type.h"
+#include "internal/flags/nearby_flags.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/file.h"
@@ -229,6 +233,174 @@ TEST(InternalPayloadFactoryTest,
   EXPECT_EQ(contents_after_skip, ByteArray("6789"));
 }
 
+TEST(InternalPayloadFactoryTest,
+     ReadAhead_FilePayload_DetachesChunksInOrder) {
+  NearbyFlags::GetInstance().OverrideBoolFlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kEnableFilePayloadReadAhead,
+      true);
+  ByteArray contents("0123456789");
+  Payload::Id payload_id = Payload::GenerateId();
+  CreateFileWithContents(payload_id, contents);
+  InputFile inputFile(payload_id, contents.size());
+  std::unique_ptr<InternalPayload> internal_payload =
+      CreateOutgoingInternalPayload(Payload{payload_id, std::move(inputFile)});
+  EXPECT_NE(internal_payload, nullptr);
+
+  EXPECT_EQ(internal_payload->DetachNextChunk(3), ByteArray("012"));
+  EXPECT_EQ(internal_payload->DetachNextChunk(3), ByteArray("345"));
+  // Chunks already read ahead at the old size are split to fit a smaller one.
+  std::string rest;
+  while (rest.size() < 4) {
+    ByteArray chunk = internal_payload->DetachNextChunk(2);
+    ASSERT_FALSE(chunk.Empty());
+    EXPECT_LE(chunk.size(), 2u);
+    rest += std::string(chunk);
+  }
+  EXPECT_EQ(rest, "6789");
+  EXPECT_TRUE(internal_payload->DetachNextChunk(2).Empty());
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
+TEST(InternalPayloadFactoryTest,
+     ReadAhead_FilePayloadSkipToOffset_ReadsFromOffset) {
+  NearbyFlags::GetInstance().OverrideBoolFlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kEnableFilePayloadReadAhead,
+      true);
+  ByteArray contents("0123456789");
+  Payload::Id payload_id = Payload::GenerateId();
+  CreateFileWithContents(payload_id, contents);
+  InputFile inputFile(payload_id, contents.size());
+  std::unique_ptr<InternalPayload> internal_payload =
+      CreateOutgoingInternalPayload(Payload{payload_id, std::move(inputFile)});
+  EXPECT_NE(internal_payload, nullptr);
+
+  ExceptionOr<size_t> result = internal_payload->SkipToOffset(4);
+
+  EXPECT_TRUE(result.ok());
+  EXPECT_EQ(internal_payload->DetachNextChunk(512), ByteArray("456789"));
+  EXPECT_TRUE(internal_payload->DetachNextChunk(512).Empty());
+  // Once read-ahead has started, the file position is no longer the payload
+  // offset, so skipping is refused.
+  EXPECT_FALSE(internal_payload->SkipToOffset(2).ok());
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
+TEST(InternalPayloadFactoryTest, ReadAhead_CloseUnblocksAndStopsReading) {
+  NearbyFlags::GetInstance().OverrideBoolFlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kEnableFilePayloadReadAhead,
+      true);
+  ByteArray contents("0123456789");
+  Payload::Id payload_id = Payload::GenerateId();
+  CreateFileWithContents(payload_id, contents);
+  InputFile inputFile(payload_id, contents.size());
+  std::unique_ptr<InternalPayload> internal_payload =
+      CreateOutgoingInternalPayload(Payload{payload_id, std::move(inputFile)});
+  EXPECT_NE(internal_payload, nullptr);
+
+  EXPECT_EQ(internal_payload->DetachNextChunk(1), ByteArray("0"));
+  internal_payload->Close();
+
+  EXPECT_TRUE(internal_payload->DetachNextChunk(1).Empty());
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
+TEST(InternalPayloadFactoryTest,
+     StreamPayload_StalledReaderDoesNotBlockNextFrame) {
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kIncomingStreamPayloadBufferSizeBytes,
+      4);
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kIncomingStreamPayloadWriteTimeoutMillis,
+      100);
+  PayloadTransferFrame frame;
+  frame.set_packet_type(PayloadTransferFrame::DATA);
+  auto& header = *frame.mutable_payload_header();
+  header.set_type(PayloadTransferFrame::PayloadHeader::STREAM);
+  header.set_id(12345);
+  std::unique_ptr<InternalPayload> internal_payload =
+      CreateIncomingInternalPayload(frame, "");
+  ASSERT_NE(internal_payload, nullptr);
+  // Held by the client, which never reads from it.
+  Payload payload = internal_payload->ReleasePayload();
+
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray("abcd")).Ok());
+  absl::Time start = absl::Now();
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray("efgh"))
+                  .Raised(Exception::kIo));
+  EXPECT_LT(absl::Now() - start, absl::Seconds(1));
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
+std::unique_ptr<InternalPayload> CreateIncomingFilePayload(
+    Payload::Id payload_id, std::int64_t total_size) {
+  PayloadTransferFrame frame;
+  frame.set_packet_type(PayloadTransferFrame::DATA);
+  auto& header = *frame.mutable_payload_header();
+  header.set_type(PayloadTransferFrame::PayloadHeader::FILE);
+  header.set_id(payload_id);
+  header.set_total_size(total_size);
+  return CreateIncomingInternalPayload(frame, ::testing::TempDir());
+}
+
+TEST(InternalPayloadFactoryTest, WriteBehind_FilePayload_WritesChunksInOrder) {
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kIncomingFilePayloadWriteBehindBytes,
+      128 * 1024);
+  // Chunks that don't line up with the write blocks.
+  std::string contents;
+  for (int i = 0; contents.size() < 300 * 1024; i++) {
+    contents += std::string(50000, 'a' + i % 26);
+  }
+  Payload::Id payload_id = Payload::GenerateId();
+  std::unique_ptr<InternalPayload> internal_payload =
+      CreateIncomingFilePayload(payload_id, contents.size());
+  ASSERT_NE(internal_payload, nullptr);
+
+  for (size_t offset = 0; offset < contents.size(); offset += 50000) {
+    EXPECT_TRUE(internal_payload
+                    ->AttachNextChunk(ByteArray(contents.substr(offset, 50000)))
+                    .Ok());
+    EXPECT_LE(internal_payload->GetQueuedWriteBytes(), 256 * 1024);
+  }
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray()).Ok());
+  EXPECT_EQ(internal_payload->GetQueuedWriteBytes(), 0);
+
+  Payload payload = internal_payload->ReleasePayload();
+  ASSERT_NE(payload.AsFile(), nullptr);
+  ExceptionOr<ByteArray> read = payload.AsFile()->Read(contents.size());
+  ASSERT_TRUE(read.ok());
+  EXPECT_EQ(std::string(read.result()), contents);
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
+TEST(InternalPayloadFactoryTest, WriteBehind_CloseDropsQueuedChunks) {
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kIncomingFilePayloadWriteBehindBytes,
+      128 * 1024);
+  Payload::Id payload_id = Payload::GenerateId();
+  std::unique_ptr<InternalPayload> internal_payload =
+      CreateIncomingFilePayload(payload_id, 200 * 1024);
+  ASSERT_NE(internal_payload, nullptr);
+
+  EXPECT_TRUE(
+      internal_payload->AttachNextChunk(ByteArray(std::string(100 * 1024, 'x')))
+          .Ok());
+  internal_payload->Close();
+
+  EXPECT_EQ(internal_payload->GetQueuedWriteBytes(), 0);
+  EXPECT_FALSE(
+      internal_payload->AttachNextChunk(ByteArray(std::string(1024, 'x')))
+          .Ok());
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
@@ -14,7 +14,9 @@
 
 #include "connections/implementation/offline_frames.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
@@ -26,6 +28,9 @@
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/medium_selector.h"
 #include "connections/status.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
 #include "internal/flags/nearby_flags.h"
 #include "internal/platform/byte_array.h"
 
@@ -37,6 +42,9 @@ namespace {
 using ExceptionOrOfflineFrame =
     ExceptionOr<::location::nearby::connections::OfflineFrame>;
 using MessageLite = ::google::protobuf::MessageLite;
+using ::google::protobuf::Arena;
+using ::google::protobuf::io::CodedInputStream;
+using ::google::protobuf::internal::WireFormatLite;
 using ::location::nearby::connections::BandwidthUpgradeNegotiationFrame;
 using ::location::nearby::connections::ConnectionRequestFrame;
 using ::location::nearby::connections::ConnectionResponseFrame;
@@ -59,7 +67,8 @@ ByteArray ToBytes(OfflineFrame&& frame) {
 ExceptionOrOfflineFrame FromBytes(const ByteArray& bytes) {
   OfflineFrame frame;
 
-  if (frame.ParseFromString(std::string(bytes))) {
+  // Parse straight from the ByteArray; the frame copies out what it keeps.
+  if (frame.ParseFromArray(bytes.data(), bytes.size())) {
     Exception validation_exception = EnsureValidOfflineFrame(frame);
     if (validation_exception.Raised()) {
       return ExceptionOrOfflineFrame(validation_exception);
@@ -70,6 +79,59 @@ ExceptionOrOfflineFrame FromBytes(const ByteArray& bytes) {
   }
 }
 
+ExceptionOr<OfflineFrame*> FromBytes(const ByteArray& bytes, Arena* arena) {
+  OfflineFrame* frame = Arena::CreateMessage<OfflineFrame>(arena);
+  if (!frame->ParseFromArray(bytes.data(), bytes.size())) {
+    return Exception::kInvalidProtocolBuffer;
+  }
+  Exception validation_exception = EnsureValidOfflineFrame(*frame);
+  if (validation_exception.Raised()) {
+    return validation_exception;
+  }
+  return ExceptionOr<OfflineFrame*>(frame);
+}
+
+V1Frame::FrameType PeekFrameType(const ByteArray& bytes) {
+  CodedInputStream input(reinterpret_cast<const std::uint8_t*>(bytes.data()),
+                         bytes.size());
+  std::uint32_t version = OfflineFrame::UNKNOWN_VERSION;
+  std::uint32_t type = V1Frame::UNKNOWN_FRAME_TYPE;
+  while (std::uint32_t tag = input.ReadTag()) {
+    int field_number = WireFormatLite::GetTagFieldNumber(tag);
+    WireFormatLite::WireType wire_type = WireFormatLite::GetTagWireType(tag);
+    if (field_number == OfflineFrame::kVersionFieldNumber &&
+        wire_type == WireFormatLite::WIRETYPE_VARINT) {
+      if (!input.ReadVarint32(&version)) return V1Frame::UNKNOWN_FRAME_TYPE;
+    } else if (field_number == OfflineFrame::kV1FieldNumber &&
+               wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      // Only the type is read out of the V1Frame; the rest of it, such as a
+      // payload chunk body, is skipped over.
+      std::uint32_t length;
+      if (!input.ReadVarint32(&length)) return V1Frame::UNKNOWN_FRAME_TYPE;
+      CodedInputStream::Limit limit = input.PushLimit(length);
+      while (std::uint32_t v1_tag = input.ReadTag()) {
+        if (WireFormatLite::GetTagFieldNumber(v1_tag) ==
+                V1Frame::kTypeFieldNumber &&
+            WireFormatLite::GetTagWireType(v1_tag) ==
+                WireFormatLite::WIRETYPE_VARINT) {
+          if (!input.ReadVarint32(&type)) return V1Frame::UNKNOWN_FRAME_TYPE;
+        } else if (!WireFormatLite::SkipField(&input, v1_tag)) {
+          return V1Frame::UNKNOWN_FRAME_TYPE;
+        }
+      }
+      if (!input.ConsumedEntireMessage()) return V1Frame::UNKNOWN_FRAME_TYPE;
+      input.PopLimit(limit);
+    } else if (!WireFormatLite::SkipField(&input, tag)) {
+      return V1Frame::UNKNOWN_FRAME_TYPE;
+    }
+  }
+  if (!input.ConsumedEntireMessage() || version != OfflineFrame::V1 ||
+      !V1Frame::FrameType_IsValid(static_cast<int>(type))) {
+    return V1Frame::UNKNOWN_FRAME_TYPE;
+  }
+  return static_cast<V1Frame::FrameType>(type);
+}
+
 V1Frame::FrameType GetFrameType(const OfflineFrame& frame) {
   if ((frame.version() == OfflineFrame::V1) && frame.has_v1()) {
     return frame.v1().type();
@@ -192,6 +254,18 @@ ByteArray ForConnectionResponse(
       NearbyFlags::GetInstance().GetInt64Flag(
           config_package_nearby::nearby_connections_feature::
               kSafeToDisconnectVersion));
+  std::int64_t payload_receive_window_bytes =
+      NearbyFlags::GetInstance().GetInt64Flag(
+          config_package_nearby::nearby_connections_feature::
+              kPayloadReceiveWindowBytes);
+  if (payload_receive_window_bytes > 0) {
+    // The field is an int32; a larger flag advertises the largest window it
+    // holds.
+    sub_frame->set_payload_receive_window_bytes(
+        static_cast<std::int32_t>(std::min<std::int64_t>(
+            payload_receive_window_bytes,
+            std::numeric_limits<std::int32_t>::max())));
+  }
 
   return ToBytes(std::move(frame));
 }
@@ -212,6 +286,22 @@ ByteArray ForDataPayloadTransfer(
   return ToBytes(std::move(frame));
 }
 
+ByteArray ForDataPayloadTransfer(
+    const PayloadTransferFrame::PayloadHeader& header,
+    PayloadTransferFrame::PayloadChunk&& chunk) {
+  OfflineFrame frame;
+
+  frame.set_version(OfflineFrame::V1);
+  auto* v1_frame = frame.mutable_v1();
+  v1_frame->set_type(V1Frame::PAYLOAD_TRANSFER);
+  auto* sub_frame = v1_frame->mutable_payload_transfer();
+  sub_frame->set_packet_type(PayloadTransferFrame::DATA);
+  *sub_frame->mutable_payload_header() = header;
+  *sub_frame->mutable_payload_chunk() = std::move(chunk);
+
+  return ToBytes(std::move(frame));
+}
+
 ByteArray ForControlPayloadTransfer(
     const PayloadTransferFrame::PayloadHeader& header,
     const PayloadTransferFrame::ControlMessage& control) {
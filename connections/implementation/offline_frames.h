@@ -21,6 +21,7 @@
 
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/connection_options.h"
+#include "google/protobuf/arena.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 
@@ -39,6 +40,19 @@ using UpgradePathInfo = ::location::nearby::connections::
 ExceptionOr<location::nearby::connections::OfflineFrame> FromBytes(
     const ByteArray& offline_frame_bytes);
 
+// Same as above, but creates the frame on `arena`, so that the frame and its
+// fields take a few arena blocks instead of an allocation each. The frame is
+// owned by, and only valid as long as, the arena.
+ExceptionOr<location::nearby::connections::OfflineFrame*> FromBytes(
+    const ByteArray& offline_frame_bytes, google::protobuf::Arena* arena);
+
+// Reads the FrameType of a serialized message without parsing, copying or
+// validating the rest of it, e.g. to skip a KEEP_ALIVE frame. Returns
+// V1Frame::UNKNOWN_FRAME_TYPE if the message is malformed, or if its contents
+// are not recognized.
+location::nearby::connections::V1Frame::FrameType PeekFrameType(
+    const ByteArray& offline_frame_bytes);
+
 // Returns FrameType of a parsed message, or
 // V1Frame::UNKNOWN_FRAME_TYPE, if frame contents is not recognized.
 location::nearby::connections::V1Frame::FrameType GetFrameType(
@@ -61,6 +75,12 @@ ByteArray ForDataPayloadTransfer(
         header,
     const location::nearby::connections::PayloadTransferFrame::PayloadChunk&
         chunk);
+// Same as above, but moves the chunk into the frame instead of copying its
+// body.
+ByteArray ForDataPayloadTransfer(
+    const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
+        header,
+    location::nearby::connections::PayloadTransferFrame::PayloadChunk&& chunk);
 ByteArray ForControlPayloadTransfer(
     const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
         header,
@@ -0,0 +1,192 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "connections/implementation/offline_frames.h"
+#include "connections/implementation/proto/offline_wire_formats.pb.h"
+#include "google/protobuf/arena.h"
+#include "internal/platform/byte_array.h"
+
+// Counts the heap allocations made by the benchmarks, to report how many
+// allocations, and how many bytes copied into them, it takes to parse a frame.
+namespace {
+std::atomic<std::int64_t> allocations{0};
+std::atomic<std::int64_t> allocated_bytes{0};
+}  // namespace
+
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size)) return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace nearby {
+namespace connections {
+namespace parser {
+namespace {
+
+using ::location::nearby::connections::OfflineFrame;
+using ::location::nearby::connections::PayloadTransferFrame;
+using ::location::nearby::connections::V1Frame;
+
+// Reports the frames parsed per second, and the heap allocations and bytes
+// allocated per frame since `allocations_before` and `bytes_before`.
+void ReportFrameCounters(benchmark::State& state,
+                         std::int64_t allocations_before,
+                         std::int64_t bytes_before) {
+  state.SetItemsProcessed(state.iterations());
+  state.counters["allocs_per_frame"] = benchmark::Counter(
+      allocations.load() - allocations_before,
+      benchmark::Counter::kAvgIterations);
+  state.counters["bytes_allocated_per_frame"] =
+      benchmark::Counter(allocated_bytes.load() - bytes_before,
+                         benchmark::Counter::kAvgIterations);
+}
+
+PayloadTransferFrame::PayloadHeader MakeHeader() {
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::FILE);
+  header.set_total_size(1024 * 1024 * 1024);
+  header.set_file_name("benchmark.bin");
+  return header;
+}
+
+// Stands in for the chunk PayloadManager builds from a file read.
+PayloadTransferFrame::PayloadChunk MakeChunk(std::int64_t size) {
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_offset(0);
+  chunk.set_flags(0);
+  chunk.set_body(std::string(size, 'x'));
+  return chunk;
+}
+
+// Builds a data frame from a chunk that is copied into the frame.
+void BM_ForDataPayloadTransferCopiedChunk(benchmark::State& state) {
+  PayloadTransferFrame::PayloadHeader header = MakeHeader();
+  for (auto _ : state) {
+    PayloadTransferFrame::PayloadChunk chunk = MakeChunk(state.range(0));
+    ByteArray bytes = ForDataPayloadTransfer(header, chunk);
+    benchmark::DoNotOptimize(bytes);
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ForDataPayloadTransferCopiedChunk)
+    ->Arg(4 * 1024)
+    ->Arg(64 * 1024)
+    ->Arg(1024 * 1024);
+
+// Builds a data frame from a chunk that is moved into the frame, as
+// EndpointManager::SendPayloadChunk does.
+void BM_ForDataPayloadTransferMovedChunk(benchmark::State& state) {
+  PayloadTransferFrame::PayloadHeader header = MakeHeader();
+  for (auto _ : state) {
+    PayloadTransferFrame::PayloadChunk chunk = MakeChunk(state.range(0));
+    ByteArray bytes = ForDataPayloadTransfer(header, std::move(chunk));
+    benchmark::DoNotOptimize(bytes);
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ForDataPayloadTransferMovedChunk)
+    ->Arg(4 * 1024)
+    ->Arg(64 * 1024)
+    ->Arg(1024 * 1024);
+
+// Parses a received data frame on the heap, as the receive path used to.
+void BM_FromBytesDataFrame(benchmark::State& state) {
+  ByteArray bytes =
+      ForDataPayloadTransfer(MakeHeader(), MakeChunk(state.range(0)));
+  std::int64_t allocations_before = allocations.load();
+  std::int64_t bytes_before = allocated_bytes.load();
+  for (auto _ : state) {
+    ExceptionOr<OfflineFrame> frame = FromBytes(bytes);
+    benchmark::DoNotOptimize(frame);
+  }
+  ReportFrameCounters(state, allocations_before, bytes_before);
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FromBytesDataFrame)
+    ->Arg(4 * 1024)
+    ->Arg(64 * 1024)
+    ->Arg(1024 * 1024);
+
+// Parses a received data frame on an arena backed by the stack, as
+// EndpointManager::HandleFrame does.
+void BM_FromBytesDataFrameOnArena(benchmark::State& state) {
+  ByteArray bytes =
+      ForDataPayloadTransfer(MakeHeader(), MakeChunk(state.range(0)));
+  std::int64_t allocations_before = allocations.load();
+  std::int64_t bytes_before = allocated_bytes.load();
+  for (auto _ : state) {
+    alignas(8) char arena_block[2048];
+    google::protobuf::ArenaOptions arena_options;
+    arena_options.initial_block = arena_block;
+    arena_options.initial_block_size = sizeof(arena_block);
+    google::protobuf::Arena arena(arena_options);
+    ExceptionOr<OfflineFrame*> frame = FromBytes(bytes, &arena);
+    benchmark::DoNotOptimize(frame);
+  }
+  ReportFrameCounters(state, allocations_before, bytes_before);
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FromBytesDataFrameOnArena)
+    ->Arg(4 * 1024)
+    ->Arg(64 * 1024)
+    ->Arg(1024 * 1024);
+
+// Parses a received KEEP_ALIVE frame to find its type.
+void BM_FromBytesKeepAlive(benchmark::State& state) {
+  ByteArray bytes = ForKeepAlive();
+  std::int64_t allocations_before = allocations.load();
+  std::int64_t bytes_before = allocated_bytes.load();
+  for (auto _ : state) {
+    ExceptionOr<OfflineFrame> frame = FromBytes(bytes);
+    benchmark::DoNotOptimize(GetFrameType(frame.result()));
+  }
+  ReportFrameCounters(state, allocations_before, bytes_before);
+}
+BENCHMARK(BM_FromBytesKeepAlive);
+
+// Peeks at the type of a received frame, as EndpointManager::HandleFrame does
+// before it parses one.
+void BM_PeekFrameType(benchmark::State& state) {
+  ByteArray bytes =
+      state.range(0) == 0
+          ? ForKeepAlive()
+          : ForDataPayloadTransfer(MakeHeader(), MakeChunk(state.range(0)));
+  std::int64_t allocations_before = allocations.load();
+  std::int64_t bytes_before = allocated_bytes.load();
+  for (auto _ : state) {
+    V1Frame::FrameType frame_type = PeekFrameType(bytes);
+    benchmark::DoNotOptimize(frame_type);
+  }
+  ReportFrameCounters(state, allocations_before, bytes_before);
+}
+BENCHMARK(BM_PeekFrameType)->Arg(0)->Arg(64 * 1024);
+
+}  // namespace
+}  // namespace parser
+}  // namespace connections
+}  // namespace nearby
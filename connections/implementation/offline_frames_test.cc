@@ -15,6 +15,8 @@
 #include "connections/implementation/offline_frames.h"
 
 #include <array>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -23,7 +25,10 @@
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
+#include "connections/implementation/flags/nearby_connections_feature_flags.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
+#include "google/protobuf/arena.h"
+#include "internal/flags/nearby_flags.h"
 #include "internal/platform/byte_array.h"
 
 namespace nearby {
@@ -89,6 +94,65 @@ TEST(OfflineFramesTest, CanParseMessageFromBytes) {
       std::vector(kMediums.begin(), kMediums.end()));
 }
 
+TEST(OfflineFramesTest, CanParseMessageFromBytesOnArena) {
+  PayloadTransferFrame::PayloadHeader header;
+  PayloadTransferFrame::PayloadChunk chunk;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(1024);
+  chunk.set_body("payload data");
+  chunk.set_offset(0);
+  chunk.set_flags(0);
+  ByteArray bytes = ForDataPayloadTransfer(header, chunk);
+  OfflineFrame expected;
+  ASSERT_TRUE(expected.ParseFromArray(bytes.data(), bytes.size()));
+
+  google::protobuf::Arena arena;
+  auto ret_value = FromBytes(bytes, &arena);
+
+  ASSERT_TRUE(ret_value.ok());
+  EXPECT_EQ(ret_value.result()->GetArena(), &arena);
+  EXPECT_THAT(*ret_value.result(), EqualsProto(expected));
+}
+
+TEST(OfflineFramesTest, CannotParseMalformedMessageOnArena) {
+  ByteArray bytes = ForKeepAlive();
+  google::protobuf::Arena arena;
+
+  auto ret_value =
+      FromBytes(ByteArray(bytes.data(), bytes.size() - 1), &arena);
+
+  EXPECT_FALSE(ret_value.ok());
+}
+
+TEST(OfflineFramesTest, CanPeekFrameType) {
+  PayloadTransferFrame::PayloadHeader header;
+  PayloadTransferFrame::PayloadChunk chunk;
+  header.set_id(12345);
+  chunk.set_body(std::string(1024, 'x'));
+
+  EXPECT_EQ(PeekFrameType(ForKeepAlive()), V1Frame::KEEP_ALIVE);
+  EXPECT_EQ(PeekFrameType(ForDataPayloadTransfer(header, chunk)),
+            V1Frame::PAYLOAD_TRANSFER);
+  EXPECT_EQ(PeekFrameType(ForDisconnection(
+                /*request_safe_to_disconnect=*/false,
+                /*ack_safe_to_disconnect=*/false)),
+            V1Frame::DISCONNECTION);
+}
+
+TEST(OfflineFramesTest, PeekFrameTypeOfMalformedMessageIsUnknown) {
+  ByteArray bytes = ForKeepAlive();
+  OfflineFrame no_version;
+  no_version.mutable_v1()->set_type(V1Frame::KEEP_ALIVE);
+
+  EXPECT_EQ(PeekFrameType(ByteArray(bytes.data(), bytes.size() - 1)),
+            V1Frame::UNKNOWN_FRAME_TYPE);
+  EXPECT_EQ(PeekFrameType(ByteArray(std::string("not a frame"))),
+            V1Frame::UNKNOWN_FRAME_TYPE);
+  EXPECT_EQ(PeekFrameType(ByteArray(no_version.SerializeAsString())),
+            V1Frame::UNKNOWN_FRAME_TYPE);
+}
+
 TEST(OfflineFramesTest, CanGenerateLegacyConnectionRequest) {
   constexpr absl::string_view kExpected =
       R"pb(
@@ -281,6 +345,40 @@ TEST(OfflineFramesTest, CanGenerateConnectionResponse) {
   EXPECT_THAT(message, EqualsProto(kExpected));
 }
 
+TEST(OfflineFramesTest, ConnectionResponseAdvertisesPayloadReceiveWindow) {
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kPayloadReceiveWindowBytes,
+      1024 * 1024);
+
+  ByteArray bytes = ForConnectionResponse(0, OsInfo());
+  auto response = FromBytes(bytes);
+  ASSERT_TRUE(response.ok());
+  EXPECT_EQ(response.result()
+                .v1()
+                .connection_response()
+                .payload_receive_window_bytes(),
+            1024 * 1024);
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
+TEST(OfflineFramesTest, ConnectionResponseClampsPayloadReceiveWindow) {
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kPayloadReceiveWindowBytes,
+      std::int64_t{1} << 32);
+
+  ByteArray bytes = ForConnectionResponse(0, OsInfo());
+  auto response = FromBytes(bytes);
+  ASSERT_TRUE(response.ok());
+  EXPECT_EQ(response.result()
+                .v1()
+                .connection_response()
+                .payload_receive_window_bytes(),
+            std::numeric_limits<std::int32_t>::max());
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
 TEST(OfflineFramesTest, CanGenerateControlPayloadTransfer) {
   PayloadTransferFrame::PayloadHeader header;
   PayloadTransferFrame::ControlMessage control;
@@ -18,6 +18,8 @@
 #include <regex>  //NOLINT
 #include <string>
 
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
 #include "connections/implementation/internal_payload.h"
 #include "connections/implementation/offline_frames.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
@@ -347,7 +349,7 @@ Exception EnsureValidBandwidthUpgradeNegotiationFrame(
   return {Exception::kSuccess};
 }
 
-bool CheckForIllegalCharacters(std::string toBeValidated,
+bool CheckForIllegalCharacters(absl::string_view toBeValidated,
                                const absl::string_view illegalPatterns[],
                                size_t illegalPatternsSize) {
   if (toBeValidated.empty()) {
@@ -356,11 +358,8 @@ bool CheckForIllegalCharacters(std::string toBeValidated,
 
   CHECK_GT(illegalPatternsSize, 0);
 
-  size_t found = 0;
   for (int index = 0; index < illegalPatternsSize; index++) {
-    found = toBeValidated.find(std::string(illegalPatterns[index]));
-
-    if (found != std::string::npos) {
+    if (absl::StrContains(toBeValidated, illegalPatterns[index])) {
       // TODO(jfcarroll): Find a way to issue a log statement here.
       // Currently, this breaks the fuzzer, as a logging dep is not
       // included for it in the BUILD file.
@@ -44,6 +44,7 @@
 #include "internal/platform/logging.h"
 #include "internal/platform/mutex_lock.h"
 #include "internal/platform/single_thread_executor.h"
+#include "internal/platform/system_clock.h"
 #include "proto/connections_enums.pb.h"
 
 namespace nearby {
@@ -53,9 +54,20 @@ using ::location::nearby::connections::OfflineFrame;
 using ::location::nearby::connections::V1Frame;
 using ::location::nearby::proto::connections::PayloadStatus;
 using ::nearby::analytics::PacketMetaData;
+using ::nearby::analytics::ThroughputRecorder;
 using ::nearby::analytics::ThroughputRecorderContainer;
 using ::nearby::connections::PayloadDirection;
 
+namespace {
+// Number of outgoing bytes and file payloads that progress in parallel when
+// the concurrent payload scheduler is enabled. Sized for a hub sending to 6-8
+// peers at once.
+constexpr int kMaxConcurrentPayloadSends = 8;
+// How often a sender waiting for room in a flow control window checks that
+// the payload and the endpoint are still there.
+constexpr absl::Duration kSendWindowPollInterval = absl::Milliseconds(500);
+}  // namespace
+
 // C++14 requires to declare this.
 // TODO(apolyudov): remove when migration to c++17 is possible.
 constexpr absl::Duration PayloadManager::kWaitCloseTimeout;
@@ -131,6 +143,11 @@ bool PayloadManager::SendPayloadLoop(
   // This will block if there is no data to transfer.
   // It will resume when new data arrives, or if Close() is called.
   int chunk_size = GetOptimalChunkSize(available_endpoint_ids);
+  // Chunk offsets are relative to the resume offset on both ends.
+  WaitForSendWindow(client, pending_payload, available_endpoint_ids,
+                    next_chunk_offset - resume_offset,
+                    next_chunk_offset - resume_offset + chunk_size);
+  if (shutdown_.Get()) return false;
   packet_meta_data.StartFileIo();
   ByteArray next_chunk =
       pending_payload.GetInternalPayload()->DetachNextChunk(chunk_size);
@@ -156,8 +173,15 @@ bool PayloadManager::SendPayloadLoop(
   // happened.
   PayloadTransferFrame::PayloadChunk payload_chunk(CreatePayloadChunk(
       next_chunk_offset - resume_offset, std::move(next_chunk), index));
+  // The chunk body is moved into the outgoing frame, so keep what is needed
+  // after the send.
+  bool is_last_chunk = IsLastChunk(payload_chunk);
+  std::int32_t payload_chunk_flags = payload_chunk.flags();
+  std::int64_t payload_chunk_offset = payload_chunk.offset();
+  absl::Time channel_start_time = SystemClock::ElapsedRealtime();
   const EndpointIds& failed_endpoint_ids = endpoint_manager_->SendPayloadChunk(
-      payload_header, payload_chunk, available_endpoint_ids, packet_meta_data);
+      payload_header, std::move(payload_chunk), available_endpoint_ids,
+      packet_meta_data);
   // Check whether at least one endpoint failed.
   if (!failed_endpoint_ids.empty()) {
     NEARBY_LOGS(INFO) << "Payload xfer: endpoints failed: payload_id="
@@ -168,7 +192,6 @@ bool PayloadManager::SendPayloadLoop(
                                       location::nearby::proto::connections::
                                           PayloadStatus::ENDPOINT_IO_ERROR);
   }
-  bool is_last_chunk = IsLastChunk(payload_chunk);
   // Check whether at least one endpoint succeeded -- if they all failed,
   // we'll just go right back to the top of the loop and break out when
   // availableEndpointIds is re-synced and found to be empty at that point.
@@ -182,11 +205,18 @@ bool PayloadManager::SendPayloadLoop(
           continue;
         }
 
-        HandleSuccessfulOutgoingChunk(
-            client, endpoint_id, payload_header, payload_chunk.flags(),
-            payload_chunk.offset(), payload_chunk.body().size());
+        HandleSuccessfulOutgoingChunk(client, endpoint_id, payload_header,
+                                      payload_chunk_flags, payload_chunk_offset,
+                                      next_chunk_size);
       }
     }
+    ThroughputRecorderContainer::GetInstance()
+        .GetTPRecorder(pending_payload.GetInternalPayload()->GetId(),
+                       PayloadDirection::OUTGOING_PAYLOAD)
+        ->OnChunkStalls(
+            packet_meta_data.file_io_end_time -
+                packet_meta_data.file_io_start_time,
+            SystemClock::ElapsedRealtime() - channel_start_time);
     NEARBY_LOGS(VERBOSE) << "PayloadManager done sending chunk at offset "
                          << next_chunk_offset << " of payload_id="
                          << pending_payload.GetInternalPayload()->GetId();
@@ -208,6 +238,59 @@ bool PayloadManager::SendPayloadLoop(
   return true;
 }
 
+bool PayloadManager::SendPayloadStep(ClientProxy* client,
+                                     const EndpointIds& endpoint_ids,
+                                     Payload::Id payload_id,
+                                     PayloadType payload_type,
+                                     size_t resume_offset,
+                                     std::int64_t payload_total_size,
+                                     OutgoingPayloadSend& send) {
+  if (!send.pending_payload) {
+    if (shutdown_.Get()) return false;
+    send.pending_payload = GetPayload(payload_id);
+    if (!send.pending_payload) {
+      RecordInvalidPayloadAnalytics(client, endpoint_ids, payload_id,
+                                    payload_type, resume_offset,
+                                    payload_total_size);
+      NEARBY_LOGS(INFO)
+          << "PayloadManager failed to create InternalPayload for outgoing "
+             "payload_id="
+          << payload_id << ", payload_type=" << ToString(payload_type)
+          << ", aborting sendPayload().";
+      return false;
+    }
+    auto* internal_payload = send.pending_payload->GetInternalPayload();
+    if (!internal_payload) return false;
+
+    RecordPayloadStartedAnalytics(client, endpoint_ids, payload_id,
+                                  payload_type, resume_offset,
+                                  internal_payload->GetTotalSize());
+
+    send.payload_header =
+        CreatePayloadHeader(*internal_payload, resume_offset,
+                            internal_payload->GetParentFolder(),
+                            internal_payload->GetFileName());
+
+    ThroughputRecorderContainer::GetInstance()
+        .GetTPRecorder(payload_id, PayloadDirection::OUTGOING_PAYLOAD)
+        ->Start(payload_type, PayloadDirection::OUTGOING_PAYLOAD);
+  }
+
+  bool should_continue =
+      !shutdown_.Get() &&
+      SendPayloadLoop(client, *send.pending_payload, send.payload_header,
+                      send.next_chunk_offset, resume_offset, send.index);
+  send.index++;
+  if (should_continue && !shutdown_.Get()) return true;
+
+  RunOnStatusUpdateThread("destroy-payload",
+                          [this, payload_id]()
+                              RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
+                                DestroyPendingPayload(payload_id);
+                              });
+  return false;
+}
+
 std::pair<PayloadManager::Endpoints, PayloadManager::Endpoints>
 PayloadManager::GetAvailableAndUnavailableEndpoints(
     const PendingPayload& pending_payload) {
@@ -311,6 +394,12 @@ PayloadManager::PayloadManager(EndpointManager& endpoint_manager)
     : endpoint_manager_(&endpoint_manager) {
   endpoint_manager_->RegisterFrameProcessor(V1Frame::PAYLOAD_TRANSFER, this);
   custom_save_path_ = "";
+  if (NearbyFlags::GetInstance().GetBoolFlag(
+          config_package_nearby::nearby_connections_feature::
+              kEnableConcurrentPayloadScheduler)) {
+    payload_scheduler_ =
+        std::make_unique<PayloadScheduler>(kMaxConcurrentPayloadSends);
+  }
 }
 
 void PayloadManager::CancelAllPayloads() {
@@ -354,6 +443,9 @@ PayloadManager::~PayloadManager() {
   stream_payload_executor_.Shutdown();
   file_payload_executor_.Shutdown();
   send_payload_ack_executor_.Shutdown();
+  if (payload_scheduler_) {
+    payload_scheduler_->Shutdown();
+  }
 
   CountDownLatch stop_latch(1);
   // Clear our tracked pending payloads.
@@ -426,6 +518,8 @@ void PayloadManager::SendPayload(ClientProxy* client,
   // other payload of the same type from even starting until this one is
   // completely done with. If we ever want to provide isolation across
   // ClientProxy objects this will need to be significantly re-architected.
+  // With the concurrent payload scheduler, the FCFS order is kept per payload
+  // type and set of endpoints, and different sets progress in parallel.
   PayloadType payload_type = payload.GetType();
   size_t resume_offset =
       FeatureFlags::GetInstance().GetFlags().enable_send_payload_offset
@@ -434,54 +528,34 @@ void PayloadManager::SendPayload(ClientProxy* client,
 
   Payload::Id payload_id =
       CreateOutgoingPayload(std::move(payload), endpoint_ids);
-  executor->Execute(
-      "send-payload", [this, client, endpoint_ids, payload_id, payload_type,
-                       resume_offset, payload_total_size]() {
-        if (shutdown_.Get()) return;
-        PendingPayloadHandle pending_payload = GetPayload(payload_id);
-        if (!pending_payload) {
-          RecordInvalidPayloadAnalytics(client, endpoint_ids, payload_id,
-                                        payload_type, resume_offset,
-                                        payload_total_size);
-          NEARBY_LOGS(INFO)
-              << "PayloadManager failed to create InternalPayload for outgoing "
-                 "payload_id="
-              << payload_id << ", payload_type=" << ToString(payload_type)
-              << ", aborting sendPayload().";
-          return;
-        }
-        auto* internal_payload = pending_payload->GetInternalPayload();
-        if (!internal_payload) return;
-
-        RecordPayloadStartedAnalytics(client, endpoint_ids, payload_id,
-                                      payload_type, resume_offset,
-                                      internal_payload->GetTotalSize());
-
-        PayloadTransferFrame::PayloadHeader payload_header{
-            CreatePayloadHeader(*internal_payload, resume_offset,
-                                internal_payload->GetParentFolder(),
-                                internal_payload->GetFileName())};
-
-        bool should_continue = true;
-        std::int64_t next_chunk_offset = 0;
-        int index = 0;
-
-        ThroughputRecorderContainer::GetInstance()
-            .GetTPRecorder(payload_id, PayloadDirection::OUTGOING_PAYLOAD)
-            ->Start(payload_type, PayloadDirection::OUTGOING_PAYLOAD);
-        while (should_continue && !shutdown_.Get()) {
-          should_continue =
-              SendPayloadLoop(client, *pending_payload, payload_header,
-                              next_chunk_offset, resume_offset, index);
-          index++;
-        }
-
-        RunOnStatusUpdateThread("destroy-payload",
-                                [this, payload_id]()
-                                    RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
-                                      DestroyPendingPayload(payload_id);
-                                    });
-      });
+  if (payload_scheduler_ && payload_type != PayloadType::kStream) {
+    // Stream payloads stay on their own executor: reading a stream blocks
+    // until the client writes to it, which would hold a scheduler worker.
+    EndpointIds sorted_endpoint_ids = endpoint_ids;
+    std::sort(sorted_endpoint_ids.begin(), sorted_endpoint_ids.end());
+    payload_scheduler_->Schedule(
+        absl::StrCat(ToString(payload_type), ":",
+                     ToString(sorted_endpoint_ids)),
+        payload_type == PayloadType::kBytes
+            ? PayloadScheduler::Priority::kHigh
+            : PayloadScheduler::Priority::kNormal,
+        [this, client, endpoint_ids, payload_id, payload_type, resume_offset,
+         payload_total_size, send = OutgoingPayloadSend()]() mutable {
+          return SendPayloadStep(client, endpoint_ids, payload_id,
+                                 payload_type, resume_offset,
+                                 payload_total_size, send);
+        });
+  } else {
+    executor->Execute(
+        "send-payload", [this, client, endpoint_ids, payload_id, payload_type,
+                         resume_offset, payload_total_size]() {
+          OutgoingPayloadSend send;
+          while (SendPayloadStep(client, endpoint_ids, payload_id,
+                                 payload_type, resume_offset,
+                                 payload_total_size, send)) {
+          }
+        });
+  }
   NEARBY_LOGS(INFO) << "PayloadManager: xfer scheduled: self=" << this
                     << "; payload_id=" << payload_id
                     << ", payload_type=" << ToString(payload_type);
@@ -675,10 +749,20 @@ SingleThreadExecutor* PayloadManager::GetOutgoingPayloadExecutor(
 }
 
 int PayloadManager::GetOptimalChunkSize(EndpointIds endpoint_ids) {
+  absl::Duration target_frame_duration =
+      absl::Milliseconds(NearbyFlags::GetInstance().GetInt64Flag(
+          config_package_nearby::nearby_connections_feature::
+              kAdaptiveChunkTargetMillis));
+  // Chunks are shared by all the endpoints of a payload, so the endpoint
+  // taking the smallest ones sets the size for all of them.
   int minChunkSize = std::numeric_limits<int>::max();
   for (const auto& endpoint_id : endpoint_ids) {
     minChunkSize = std::min(
-        minChunkSize, endpoint_manager_->GetMaxTransmitPacketSize(endpoint_id));
+        minChunkSize,
+        target_frame_duration > absl::ZeroDuration()
+            ? endpoint_manager_->GetAdaptiveChunkSize(endpoint_id,
+                                                      target_frame_duration)
+            : endpoint_manager_->GetMaxTransmitPacketSize(endpoint_id));
   }
   return minChunkSize;
 }
@@ -946,6 +1030,72 @@ bool PayloadManager::WaitForReceivedAck(
   return true;
 }
 
+std::int64_t PayloadManager::GetSendWindow(ClientProxy* client,
+                                           const std::string& endpoint_id) {
+  if (NearbyFlags::GetInstance().GetInt64Flag(
+          config_package_nearby::nearby_connections_feature::
+              kPayloadReceiveWindowBytes) <= 0) {
+    return 0;
+  }
+  return client->GetRemotePayloadReceiveWindow(endpoint_id);
+}
+
+void PayloadManager::WaitForSendWindow(ClientProxy* client,
+                                       PendingPayload& pending_payload,
+                                       const EndpointIds& endpoint_ids,
+                                       std::int64_t chunk_offset,
+                                       std::int64_t chunk_end) {
+  for (const auto& endpoint_id : endpoint_ids) {
+    std::int64_t window = GetSendWindow(client, endpoint_id);
+    if (window <= 0) continue;
+    // The receiver reports its progress every half window, so a window of
+    // two chunks always lets the next chunk through once it caught up.
+    window = std::max(window, 2 * (chunk_end - chunk_offset));
+    std::int64_t offset = std::min(chunk_offset, chunk_end - window);
+    while (!pending_payload.WaitForWindowOffset(endpoint_id, offset,
+                                                kSendWindowPollInterval)) {
+      EndpointInfo* endpoint_info = pending_payload.GetEndpoint(endpoint_id);
+      if (shutdown_.Get() || pending_payload.IsLocallyCanceled() ||
+          endpoint_info == nullptr ||
+          !endpoint_info->IsEndpointAvailable(client,
+                                              endpoint_info->status.Get())) {
+        // Left to the send loop to handle.
+        return;
+      }
+      NEARBY_LOGS(VERBOSE) << "Payload xfer: payload_id="
+                           << pending_payload.GetId()
+                           << " waiting for window of endpoint_id="
+                           << endpoint_id << " to reach offset " << offset;
+    }
+  }
+}
+
+void PayloadManager::SendPayloadWindowUpdate(
+    ClientProxy* client, PendingPayload& pending_payload,
+    const std::string& endpoint_id,
+    const PayloadTransferFrame::PayloadHeader& payload_header,
+    std::int64_t offset, bool is_last_chunk) {
+  // Nothing more will be sent after the last chunk.
+  if (is_last_chunk || GetSendWindow(client, endpoint_id) <= 0) return;
+  // The window advertised in the connection response, which is an int32.
+  std::int64_t window = std::min<std::int64_t>(
+      NearbyFlags::GetInstance().GetInt64Flag(
+          config_package_nearby::nearby_connections_feature::
+              kPayloadReceiveWindowBytes),
+      std::numeric_limits<std::int32_t>::max());
+  if (offset - pending_payload.GetWindowOffset(endpoint_id) < window / 2) {
+    return;
+  }
+  pending_payload.SetWindowOffset(endpoint_id, offset);
+  send_payload_ack_executor_.Execute(
+      "send_payload_window_update",
+      [this, endpoint_id, payload_header, offset]() {
+        SendControlMessage(
+            {endpoint_id}, payload_header, offset,
+            PayloadTransferFrame::ControlMessage::PAYLOAD_WINDOW_UPDATE);
+      });
+}
+
 bool PayloadManager::IsPayloadReceivedAckEnabled(
     ClientProxy* client, const std::string& endpoint_id,
     PendingPayload& pending_payload) {
@@ -1294,22 +1444,32 @@ void PayloadManager::ProcessDataPacket(
     return;
   }
   packet_meta_data.StopFileIo();
+  ThroughputRecorder* tp_recorder =
+      ThroughputRecorderContainer::GetInstance().GetTPRecorder(
+          payload_header.id(), PayloadDirection::INCOMING_PAYLOAD);
+  // With write-behind, the file I/O time is only how long the reader waited
+  // for the disk writer to catch up.
+  tp_recorder->OnChunkStalls(
+      packet_meta_data.file_io_end_time - packet_meta_data.file_io_start_time,
+      absl::ZeroDuration());
+  tp_recorder->OnWriteQueueDepth(
+      pending_payload->GetInternalPayload()->GetQueuedWriteBytes());
   bool is_last_chunk = (payload_chunk.flags() &
                         PayloadTransferFrame::PayloadChunk::LAST_CHUNK) != 0;
   SendPayloadReceivedAck(
       to_client, *pending_payload, from_endpoint_id, is_last_chunk);
+  SendPayloadWindowUpdate(to_client, *pending_payload, from_endpoint_id,
+                          payload_header,
+                          payload_chunk.offset() + payload_body_size,
+                          is_last_chunk);
 
   HandleSuccessfulIncomingChunk(to_client, from_endpoint_id, payload_header,
                                 payload_chunk.flags(), payload_chunk.offset(),
                                 payload_body_size);
 
-  ThroughputRecorderContainer::GetInstance()
-      .GetTPRecorder(payload_header.id(), PayloadDirection::INCOMING_PAYLOAD)
-      ->OnFrameReceived(medium, packet_meta_data);
+  tp_recorder->OnFrameReceived(medium, packet_meta_data);
   if (is_last_chunk) {
-    ThroughputRecorderContainer::GetInstance()
-        .GetTPRecorder(payload_header.id(), PayloadDirection::INCOMING_PAYLOAD)
-        ->MarkAsSuccess();
+    tp_recorder->MarkAsSuccess();
   }
 }
 
@@ -1365,6 +1525,12 @@ void PayloadManager::ProcessControlPacket(
                                                              control_message);
       }
       break;
+    case PayloadTransferFrame::ControlMessage::PAYLOAD_WINDOW_UPDATE:
+      if (!pending_payload->IsIncoming()) {
+        pending_payload->SetWindowOffset(from_endpoint_id,
+                                         control_message.offset());
+      }
+      break;
     default:
       NEARBY_LOGS(INFO) << "Unhandled control message "
                         << control_message.event() << " for payload_id="
@@ -1539,6 +1705,35 @@ void PayloadManager::PendingPayload::MarkReceivedAckFromEndpoint(
 
 bool PayloadManager::PendingPayload::IsIncoming() const { return is_incoming_; }
 
+std::int64_t PayloadManager::PendingPayload::GetWindowOffset(
+    const std::string& endpoint_id) const {
+  MutexLock lock(&window_mutex_);
+  auto item = window_offsets_.find(endpoint_id);
+  return item != window_offsets_.end() ? item->second : 0;
+}
+
+void PayloadManager::PendingPayload::SetWindowOffset(
+    const std::string& endpoint_id, std::int64_t offset) {
+  MutexLock lock(&window_mutex_);
+  std::int64_t& window_offset = window_offsets_[endpoint_id];
+  if (offset <= window_offset) return;
+  window_offset = offset;
+  window_cond_.Notify();
+}
+
+bool PayloadManager::PendingPayload::WaitForWindowOffset(
+    const std::string& endpoint_id, std::int64_t offset,
+    absl::Duration timeout) {
+  absl::Time deadline = SystemClock::ElapsedRealtime() + timeout;
+  MutexLock lock(&window_mutex_);
+  while (window_offsets_[endpoint_id] < offset) {
+    absl::Duration remaining = deadline - SystemClock::ElapsedRealtime();
+    if (remaining <= absl::ZeroDuration()) return false;
+    window_cond_.Wait(remaining);
+  }
+  return true;
+}
+
 std::vector<const PayloadManager::EndpointInfo*>
 PayloadManager::PendingPayload::GetEndpoints() const {
   MutexLock lock(&mutex_);
@@ -25,10 +25,12 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/functional/any_invocable.h"
+#include "absl/time/time.h"
 #include "connections/implementation/analytics/packet_meta_data.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_manager.h"
 #include "connections/implementation/internal_payload.h"
+#include "connections/implementation/payload_scheduler.h"
 #include "connections/listeners.h"
 #include "connections/payload.h"
 #include "connections/payload_type.h"
@@ -135,6 +137,20 @@ class PayloadManager : public EndpointManager::FrameProcessor {
     void MarkReceivedAckFromEndpoint(const std::string& from_endpoint_id);
     bool IsIncoming() const;
 
+    // Payload flow control. The window offset of an endpoint is, for an
+    // outgoing payload, how much of it the endpoint reported as consumed, and
+    // for an incoming one, how much was last reported to it.
+    std::int64_t GetWindowOffset(const std::string& endpoint_id) const
+        ABSL_LOCKS_EXCLUDED(window_mutex_);
+    // Raises the window offset of `endpoint_id` to `offset`.
+    void SetWindowOffset(const std::string& endpoint_id, std::int64_t offset)
+        ABSL_LOCKS_EXCLUDED(window_mutex_);
+    // Waits up to `timeout` for the window offset of `endpoint_id` to reach
+    // `offset`. Returns true if it did.
+    bool WaitForWindowOffset(const std::string& endpoint_id,
+                             std::int64_t offset, absl::Duration timeout)
+        ABSL_LOCKS_EXCLUDED(window_mutex_);
+
     // Gets the EndpointInfo objects for the endpoints (still) associated with
     // this payload.
     std::vector<const EndpointInfo*> GetEndpoints() const
@@ -179,6 +195,10 @@ class PayloadManager : public EndpointManager::FrameProcessor {
     DestroyCallback destroy_callback_;
     absl::flat_hash_map<std::string, EndpointInfo> endpoints_
         ABSL_GUARDED_BY(mutex_);
+    mutable Mutex window_mutex_;
+    ConditionVariable window_cond_{&window_mutex_};
+    absl::flat_hash_map<std::string, std::int64_t> window_offsets_
+        ABSL_GUARDED_BY(window_mutex_);
     int refcount_ = 0;
   };
 
@@ -274,6 +294,23 @@ class PayloadManager : public EndpointManager::FrameProcessor {
                        PayloadTransferFrame::PayloadHeader& payload_header,
                        std::int64_t& next_chunk_offset, size_t resume_offset,
                        int index);
+
+  // Progress of one outgoing payload between calls to SendPayloadStep().
+  struct OutgoingPayloadSend {
+    PendingPayloadHandle pending_payload;
+    PayloadTransferFrame::PayloadHeader payload_header;
+    std::int64_t next_chunk_offset = 0;
+    int index = 0;
+  };
+
+  // Sends the next chunk of an outgoing payload, starting the transfer on the
+  // first call. Returns true while there are more chunks to send; once it
+  // returns false the payload is finished and has been scheduled for
+  // destruction.
+  bool SendPayloadStep(ClientProxy* client, const EndpointIds& endpoint_ids,
+                       Payload::Id payload_id, PayloadType payload_type,
+                       size_t resume_offset, std::int64_t payload_total_size,
+                       OutgoingPayloadSend& send);
   void SendClientCallbacksForFinishedIncomingPayloadRunnable(
       ClientProxy* client, const std::string& endpoint_id,
       const PayloadTransferFrame::PayloadHeader& payload_header,
@@ -346,6 +383,25 @@ class PayloadManager : public EndpointManager::FrameProcessor {
                                    const std::string& endpoint_id,
                                    PendingPayload& pending_payload);
 
+  // Returns the window `endpoint_id` lets this device have in flight for one
+  // payload, or 0 if payload flow control isn't used with it.
+  std::int64_t GetSendWindow(ClientProxy* client,
+                             const std::string& endpoint_id);
+  // Waits until the chunk of `pending_payload` spanning [chunk_offset,
+  // chunk_end) fits in the window of every endpoint of `endpoint_ids` using
+  // flow control, or until the payload or the endpoint goes away. A chunk is
+  // always let through when everything before it was consumed.
+  void WaitForSendWindow(ClientProxy* client, PendingPayload& pending_payload,
+                         const EndpointIds& endpoint_ids,
+                         std::int64_t chunk_offset, std::int64_t chunk_end);
+  // Tells `endpoint_id` that this device consumed `pending_payload` up to
+  // `offset`, once it moved by half a window since the last time.
+  void SendPayloadWindowUpdate(
+      ClientProxy* client, PendingPayload& pending_payload,
+      const std::string& endpoint_id,
+      const PayloadTransferFrame::PayloadHeader& payload_header,
+      std::int64_t offset, bool is_last_chunk);
+
   // Handles a finished outgoing payload for the given endpointIds. All
   // statuses except for SUCCESS are handled here.
   void HandleFinishedOutgoingPayload(
@@ -425,6 +481,9 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   SingleThreadExecutor stream_payload_executor_;
   SingleThreadExecutor payload_status_update_executor_;
   SingleThreadExecutor send_payload_ack_executor_;
+  // Set when kEnableConcurrentPayloadScheduler is on; bytes and file payloads
+  // are then sent through it instead of their per-type executors.
+  std::unique_ptr<PayloadScheduler> payload_scheduler_;
   PendingPayloads pending_payloads_;
   EndpointManager* endpoint_manager_;
 
@@ -21,11 +21,13 @@
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "connections/implementation/flags/nearby_connections_feature_flags.h"
 #include "connections/implementation/simulation_user.h"
 #include "connections/listeners.h"
 #include "connections/medium_selector.h"
 #include "connections/payload.h"
 #include "connections/status.h"
+#include "internal/flags/nearby_flags.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/logging.h"
@@ -169,6 +171,75 @@ TEST_P(PayloadManagerTest, CanSendBytePayload) {
   env_.Stop();
 }
 
+TEST_P(PayloadManagerTest, CanSendStreamPayloadWithFlowControl) {
+  // Chunks are at most kChunkSize, so a window of two of them isn't widened,
+  // and the sender has to wait for window updates to send more than that.
+  constexpr size_t kWindowSize = 2 * kChunkSize;
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kPayloadReceiveWindowBytes,
+      kWindowSize);
+  // Until the stream is read, the receiver stops taking chunks once one chunk
+  // is buffered, and sends no more window updates.
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kIncomingStreamPayloadBufferSizeBytes,
+      kChunkSize);
+  NearbyFlags::GetInstance().OverrideInt64FlagValue(
+      config_package_nearby::nearby_connections_feature::
+          kIncomingStreamPayloadWriteTimeoutMillis,
+      absl::ToInt64Milliseconds(10 * kProgressTimeout));
+  env_.Start();
+  PayloadSimulationUser user_a(kDeviceA, GetParam());
+  PayloadSimulationUser user_b(kDeviceB, GetParam());
+  ASSERT_TRUE(SetupConnection(user_a, user_b));
+
+  auto [input, tx] = CreatePipe();
+  user_a.ExpectPayload(payload_latch_);
+  // Several windows worth of data, in several chunks.
+  const ByteArray message{std::string(4 * kWindowSize, 'm')};
+  tx->Write(message);
+
+  user_b.SendPayload(Payload(std::move(input)));
+  ASSERT_TRUE(payload_latch_.Await(kDefaultTimeout).result());
+  ASSERT_NE(user_a.GetPayload().AsStream(), nullptr);
+  InputStream& rx = *user_a.GetPayload().AsStream();
+  // Going past the first window takes a PAYLOAD_WINDOW_UPDATE from the
+  // receiver.
+  EXPECT_TRUE(user_b.WaitForProgress(
+      [](const PayloadProgressInfo& info) {
+        return info.bytes_transferred > kWindowSize;
+      },
+      5 * kProgressTimeout));
+  // With the receiver stalled, the sender waits for the window instead of
+  // sending the rest.
+  EXPECT_FALSE(user_b.WaitForProgress(
+      [&message](const PayloadProgressInfo& info) {
+        return info.bytes_transferred >= message.size();
+      },
+      kProgressTimeout));
+
+  std::string result;
+  while (result.size() < message.size()) {
+    ByteArray chunk = rx.Read(kChunkSize).result();
+    if (chunk.Empty()) break;
+    result.append(chunk.data(), chunk.size());
+  }
+  EXPECT_EQ(ByteArray(result), message);
+  EXPECT_TRUE(user_b.WaitForProgress(
+      [&message](const PayloadProgressInfo& info) {
+        return info.bytes_transferred >= message.size();
+      },
+      5 * kProgressTimeout));
+
+  rx.Close();
+  tx->Close();
+  user_a.Stop();
+  user_b.Stop();
+  env_.Stop();
+  NearbyFlags::GetInstance().ResetOverridedValues();
+}
+
 TEST_P(PayloadManagerTest, CanSendStreamPayload) {
   env_.Start();
   PayloadSimulationUser user_a(kDeviceA, GetParam());
@@ -0,0 +1,116 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/payload_scheduler.h"
+
+#include <deque>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace nearby {
+namespace connections {
+
+PayloadScheduler::PayloadScheduler(int max_parallelism)
+    : workers_(max_parallelism) {}
+
+PayloadScheduler::~PayloadScheduler() { Shutdown(); }
+
+void PayloadScheduler::Schedule(const std::string& lane_name,
+                                Priority priority, Step step) {
+  MutexLock lock(&mutex_);
+  if (shutdown_) return;
+  auto [it, inserted] = lanes_.try_emplace(lane_name);
+  Lane& lane = it->second;
+  if (inserted) lane.priority = priority;
+  lane.steps.push_back(std::move(step));
+  // A lane is in a ready queue whenever it is idle and has steps, so only the
+  // first step of an idle lane needs to make it ready.
+  if (!lane.running && lane.steps.size() == 1) {
+    MakeReady(lane_name, lane);
+  }
+}
+
+void PayloadScheduler::Shutdown() {
+  absl::flat_hash_map<std::string, Lane> dropped_lanes;
+  {
+    MutexLock lock(&mutex_);
+    if (shutdown_) return;
+    shutdown_ = true;
+    dropped_lanes = std::move(lanes_);
+    lanes_.clear();
+    ready_high_.clear();
+    ready_normal_.clear();
+  }
+  // Pending steps are destroyed here, outside of the lock, and the running
+  // ones are waited for by the executor.
+  dropped_lanes.clear();
+  workers_.Shutdown();
+}
+
+void PayloadScheduler::MakeReady(const std::string& lane_name,
+                                 const Lane& lane) {
+  if (lane.priority == Priority::kHigh) {
+    ready_high_.push_back(lane_name);
+  } else {
+    ready_normal_.push_back(lane_name);
+  }
+  workers_.Execute("payload-scheduler", [this]() { RunNextStep(); });
+}
+
+std::string PayloadScheduler::PopReadyLane() {
+  bool take_high =
+      !ready_high_.empty() &&
+      (ready_normal_.empty() || high_priority_turns_ < kHighPriorityWeight);
+  std::deque<std::string>& ready = take_high ? ready_high_ : ready_normal_;
+  high_priority_turns_ = take_high ? high_priority_turns_ + 1 : 0;
+  std::string lane_name = std::move(ready.front());
+  ready.pop_front();
+  return lane_name;
+}
+
+void PayloadScheduler::RunNextStep() {
+  std::string lane_name;
+  Step step;
+  {
+    MutexLock lock(&mutex_);
+    if (shutdown_ || (ready_high_.empty() && ready_normal_.empty())) return;
+    lane_name = PopReadyLane();
+    Lane& lane = lanes_[lane_name];
+    lane.running = true;
+    step = std::move(lane.steps.front());
+    lane.steps.pop_front();
+  }
+
+  bool has_more = step();
+
+  MutexLock lock(&mutex_);
+  auto it = lanes_.find(lane_name);
+  if (it == lanes_.end()) return;  // Dropped by Shutdown().
+  Lane& lane = it->second;
+  lane.running = false;
+  if (has_more) {
+    lane.steps.push_front(std::move(step));
+  }
+  if (lane.steps.empty()) {
+    lanes_.erase(it);
+  } else {
+    MakeReady(lane_name, lane);
+  }
+}
+
+}  // namespace connections
+}  // namespace nearby
@@ -0,0 +1,91 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_PAYLOAD_SCHEDULER_H_
+#define CORE_INTERNAL_PAYLOAD_SCHEDULER_H_
+
+#include <deque>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
+#include "internal/platform/multi_thread_executor.h"
+#include "internal/platform/mutex.h"
+
+namespace nearby {
+namespace connections {
+
+// Runs outgoing payload transfers on a bounded pool of worker threads.
+//
+// Work is submitted as steps on named lanes. Steps of one lane run one at a
+// time and in submission order, while different lanes run in parallel on up to
+// `max_parallelism` workers. A step returns true while it has more work (e.g.
+// more chunks of a payload to send); the lane then goes to the back of the
+// ready queue, so concurrent transfers are interleaved chunk by chunk instead
+// of one transfer holding a worker until it is complete.
+//
+// Lanes with kHigh priority are preferred, but after kHighPriorityWeight
+// consecutive high priority turns a ready kNormal lane is given one turn, so
+// bulk transfers are never starved.
+class PayloadScheduler {
+ public:
+  enum class Priority { kHigh = 0, kNormal = 1 };
+
+  // Number of kHigh turns given for each kNormal turn while both are ready.
+  static constexpr int kHighPriorityWeight = 4;
+
+  // Returns true to be called again on a later turn of the same lane.
+  using Step = absl::AnyInvocable<bool()>;
+
+  explicit PayloadScheduler(int max_parallelism);
+  ~PayloadScheduler();
+
+  // Appends `step` to `lane`. The priority of a lane is set by the step that
+  // creates it.
+  void Schedule(const std::string& lane, Priority priority, Step step)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Drops steps that have not started yet and waits for running ones.
+  void Shutdown() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Lane {
+    Priority priority = Priority::kNormal;
+    std::deque<Step> steps;
+    bool running = false;
+  };
+
+  // Moves `lane` to the ready queue of its priority and hands a turn to the
+  // worker pool.
+  void MakeReady(const std::string& lane_name, const Lane& lane)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Body of a worker turn: runs the front step of the next ready lane.
+  void RunNextStep() ABSL_LOCKS_EXCLUDED(mutex_);
+  // Pops the name of the lane to serve next, following the priority weights.
+  std::string PopReadyLane() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  Mutex mutex_;
+  bool shutdown_ ABSL_GUARDED_BY(mutex_) = false;
+  absl::flat_hash_map<std::string, Lane> lanes_ ABSL_GUARDED_BY(mutex_);
+  std::deque<std::string> ready_high_ ABSL_GUARDED_BY(mutex_);
+  std::deque<std::string> ready_normal_ ABSL_GUARDED_BY(mutex_);
+  int high_priority_turns_ ABSL_GUARDED_BY(mutex_) = 0;
+  MultiThreadExecutor workers_;
+};
+
+}  // namespace connections
+}  // namespace nearby
+
+#endif  // CORE_INTERNAL_PAYLOAD_SCHEDULER_H_
@@ -0,0 +1,168 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/payload_scheduler.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr absl::Duration kTimeout = absl::Seconds(5);
+
+class StepLog {
+ public:
+  void Add(const std::string& entry) {
+    MutexLock lock(&mutex_);
+    entries_.push_back(entry);
+  }
+
+  std::vector<std::string> Get() {
+    MutexLock lock(&mutex_);
+    return entries_;
+  }
+
+ private:
+  Mutex mutex_;
+  std::vector<std::string> entries_;
+};
+
+TEST(PayloadSchedulerTest, StepsOfOneLaneRunInOrder) {
+  StepLog log;
+  CountDownLatch done(3);
+  PayloadScheduler scheduler(4);
+
+  for (const char* name : {"1", "2", "3"}) {
+    scheduler.Schedule("lane", PayloadScheduler::Priority::kNormal,
+                       [&log, &done, name]() {
+                         log.Add(name);
+                         done.CountDown();
+                         return false;
+                       });
+  }
+
+  EXPECT_TRUE(done.Await(kTimeout).result());
+  EXPECT_THAT(log.Get(), ElementsAre("1", "2", "3"));
+}
+
+TEST(PayloadSchedulerTest, LanesRunInParallel) {
+  CountDownLatch both_started(2);
+  CountDownLatch done(2);
+  PayloadScheduler scheduler(2);
+
+  for (const char* lane : {"a", "b"}) {
+    scheduler.Schedule(lane, PayloadScheduler::Priority::kNormal,
+                       [&both_started, &done]() {
+                         both_started.CountDown();
+                         // Only returns if the other lane runs concurrently.
+                         both_started.Await(kTimeout);
+                         done.CountDown();
+                         return false;
+                       });
+  }
+
+  EXPECT_TRUE(done.Await(kTimeout).result());
+  EXPECT_TRUE(both_started.Await(absl::ZeroDuration()).result());
+}
+
+TEST(PayloadSchedulerTest, UnfinishedStepYieldsToOtherLanes) {
+  StepLog log;
+  CountDownLatch b_scheduled(1);
+  CountDownLatch done(1);
+  PayloadScheduler scheduler(1);
+
+  int a_turns = 0;
+  scheduler.Schedule("a", PayloadScheduler::Priority::kNormal,
+                     [&log, &b_scheduled, &done, &a_turns]() {
+                       b_scheduled.Await(kTimeout);
+                       log.Add("a");
+                       if (++a_turns < 3) return true;
+                       done.CountDown();
+                       return false;
+                     });
+  scheduler.Schedule("b", PayloadScheduler::Priority::kNormal, [&log]() {
+    log.Add("b");
+    return false;
+  });
+  b_scheduled.CountDown();
+
+  EXPECT_TRUE(done.Await(kTimeout).result());
+  EXPECT_THAT(log.Get(), ElementsAre("a", "b", "a", "a"));
+}
+
+TEST(PayloadSchedulerTest, HighPriorityPreferredWithoutStarvingNormal) {
+  StepLog log;
+  CountDownLatch gate_started(1);
+  CountDownLatch gate(1);
+  CountDownLatch done(7);
+  PayloadScheduler scheduler(1);
+
+  // Occupy the only worker until everything else is queued.
+  scheduler.Schedule("gate", PayloadScheduler::Priority::kNormal,
+                     [&gate_started, &gate]() {
+                       gate_started.CountDown();
+                       gate.Await(kTimeout);
+                       return false;
+                     });
+  EXPECT_TRUE(gate_started.Await(kTimeout).result());
+  scheduler.Schedule("normal", PayloadScheduler::Priority::kNormal,
+                     [&log, &done]() {
+                       log.Add("normal");
+                       done.CountDown();
+                       return false;
+                     });
+  for (const char* lane : {"h1", "h2", "h3", "h4", "h5", "h6"}) {
+    scheduler.Schedule(lane, PayloadScheduler::Priority::kHigh,
+                       [&log, &done, lane]() {
+                         log.Add(lane);
+                         done.CountDown();
+                         return false;
+                       });
+  }
+  gate.CountDown();
+
+  EXPECT_TRUE(done.Await(kTimeout).result());
+  EXPECT_THAT(log.Get(), ElementsAre("h1", "h2", "h3", "h4", "normal", "h5",
+                                     "h6"));
+}
+
+TEST(PayloadSchedulerTest, ScheduleAfterShutdownIsIgnored) {
+  bool step_ran = false;
+  PayloadScheduler scheduler(1);
+  scheduler.Shutdown();
+
+  scheduler.Schedule("lane", PayloadScheduler::Priority::kHigh,
+                     [&step_ran]() {
+                       step_ran = true;
+                       return false;
+                     });
+  scheduler.Shutdown();
+
+  EXPECT_FALSE(step_ran);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
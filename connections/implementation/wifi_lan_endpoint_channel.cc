@@ -15,7 +15,9 @@
 #include "connections/implementation/wifi_lan_endpoint_channel.h"
 
 #include <string>
+#include <utility>
 
+#include "absl/functional/any_invocable.h"
 #include "internal/platform/logging.h"
 #include "internal/platform/wifi_lan.h"
 
@@ -33,6 +35,12 @@ location::nearby::proto::connections::Medium WifiLanEndpointChannel::GetMedium()
   return location::nearby::proto::connections::Medium::WIFI_LAN;
 }
 
+bool WifiLanEndpointChannel::NotifyWhenReadable(
+    absl::AnyInvocable<void()> callback) {
+  if (IsPipelined()) return false;
+  return socket_.NotifyWhenReadable(std::move(callback));
+}
+
 void WifiLanEndpointChannel::CloseImpl() {
   auto status = socket_.Close();
   if (!status.Ok()) {
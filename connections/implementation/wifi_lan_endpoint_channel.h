@@ -17,6 +17,7 @@
 
 #include <string>
 
+#include "absl/functional/any_invocable.h"
 #include "connections/implementation/base_endpoint_channel.h"
 #include "internal/platform/wifi_lan.h"
 
@@ -31,6 +32,9 @@ class WifiLanEndpointChannel final : public BaseEndpointChannel {
 
   location::nearby::proto::connections::Medium GetMedium() const override;
 
+  // Forwards to the socket, unless frames are read ahead of Read().
+  bool NotifyWhenReadable(absl::AnyInvocable<void()> callback) override;
+
  private:
   void CloseImpl() override;
 
@@ -108,21 +108,36 @@ enum PairingState {
   kPairingStateWaitingForPairingResult,
   kPairingStateWaitingForAccountKeyWrite,
   kPairingStateWaitingForAdditionalData
-} pairing_state;
+};
+
+// Fast Pair procedure of one seeker. A session is bound to the seeker's BLE
+// address when it writes to the Key-based Pairing characteristic, and learns
+// the seeker's BR/EDR address during pairing.
+typedef struct {
+  // BLE address of the seeker, INVALID_PEER_ADDRESS if the session is free
+  uint64_t gatt_peer_address;
+  // BR/EDR address of the seeker
+  uint64_t peer_public_address;
+  enum PairingState pairing_state;
+  // When the seeker took the session
+  unsigned int start_ms;
+  unsigned int timeout_start_ms;
+  nearby_platform_AccountKeyInfo account_key_info;
+  nearby_platform_AccountKeyInfo pending_account_key_info;
+  // When |pending_account_key_info| was written
+  unsigned int pending_account_key_time_ms;
+#if NEARBY_FP_ENABLE_ADDITIONAL_DATA
+  uint8_t additional_data_id;
+#endif /* NEARBY_FP_ENABLE_ADDITIONAL_DATA */
+} pairing_session;
+
+static pairing_session pairing_sessions[NEARBY_MAX_PAIRING_SESSIONS];
 static const nearby_fp_client_Callbacks* client_callbacks;
-static unsigned int timeout_start_ms;
 static uint8_t pairing_failure_count;
 static unsigned int reject_pairing_time_start_ms;
-static uint64_t peer_public_address;
 static int advertisement_mode;
-static nearby_platform_AccountKeyInfo account_key_info;
-static nearby_platform_AccountKeyInfo pending_account_key_info;
-static uint64_t gatt_peer_address;
 static uint32_t address_rotation_timestamp;
 static void* address_rotation_task = NULL;
-#if NEARBY_FP_ENABLE_ADDITIONAL_DATA
-static uint8_t additional_data_id;
-#endif /* NEARBY_FP_ENABLE_ADDITIONAL_DATA */
 #ifdef NEARBY_FP_ENABLE_SASS
 static const uint16_t kSassVersion = 0x101;
 static uint8_t sass_custom_data = 0;
@@ -322,11 +337,87 @@ static uint8_t* SelectInUseKey() {
 #endif /* NEARBY_FP_ENABLE_SASS */
 }
 
+// Gets the session of the seeker with BLE address |peer_address|. Returns NULL
+// if not found.
+static pairing_session* GetPairingSession(uint64_t peer_address) {
+  if (peer_address == INVALID_PEER_ADDRESS) return NULL;
+  for (int i = 0; i < NEARBY_MAX_PAIRING_SESSIONS; i++) {
+    if (pairing_sessions[i].gatt_peer_address == peer_address) {
+      return &pairing_sessions[i];
+    }
+  }
+  return NULL;
+}
+
+// Gets the session of the seeker with BR/EDR address |peer_address|. Returns
+// NULL if not found.
+static pairing_session* GetPairingSessionByPublicAddress(
+    uint64_t peer_address) {
+  if (peer_address == INVALID_PEER_ADDRESS) return NULL;
+  for (int i = 0; i < NEARBY_MAX_PAIRING_SESSIONS; i++) {
+    if (pairing_sessions[i].gatt_peer_address != INVALID_PEER_ADDRESS &&
+        pairing_sessions[i].peer_public_address == peer_address) {
+      return &pairing_sessions[i];
+    }
+  }
+  return NULL;
+}
+
+static bool IsPairing(const pairing_session* session) {
+  return session->pairing_state != kPairingStateIdle &&
+         session->pairing_state != kPairingStateWaitingForAccountKeyWrite &&
+         session->pairing_state != kPairingStateWaitingForAdditionalData;
+}
+
+// Gets the session of |peer_address|, or binds a free one to it. When all
+// sessions are taken, the oldest session of a seeker that is done pairing is
+// reused, or else the oldest session.
+static pairing_session* AcquirePairingSession(uint64_t peer_address) {
+  pairing_session* session = GetPairingSession(peer_address);
+  if (session) return session;
+
+  unsigned int now = nearby_platform_GetCurrentTimeMs();
+  session = &pairing_sessions[0];
+  for (int i = 0; i < NEARBY_MAX_PAIRING_SESSIONS; i++) {
+    pairing_session* candidate = &pairing_sessions[i];
+    if (candidate->gatt_peer_address == INVALID_PEER_ADDRESS) {
+      session = candidate;
+      break;
+    }
+    if (IsPairing(candidate) != IsPairing(session)) {
+      if (IsPairing(session)) session = candidate;
+    } else if (now - candidate->start_ms > now - session->start_ms) {
+      session = candidate;
+    }
+  }
+  if (session->gatt_peer_address != INVALID_PEER_ADDRESS) {
+    NEARBY_TRACE(WARNING, "Too many concurrent pairings, dropping %s",
+                 nearby_utils_MacToString(session->gatt_peer_address));
+  }
+  memset(session, 0, sizeof(*session));
+  session->gatt_peer_address = peer_address;
+  session->pairing_state = kPairingStateIdle;
+  session->start_ms = now;
+  return session;
+}
+
+static void ReleasePairingSession(pairing_session* session) {
+  memset(session, 0, sizeof(*session));
+}
+
+// Returns true if any seeker is in the middle of pairing.
+static bool IsPairingInProgress() {
+  for (int i = 0; i < NEARBY_MAX_PAIRING_SESSIONS; i++) {
+    if (pairing_sessions[i].gatt_peer_address != INVALID_PEER_ADDRESS &&
+        IsPairing(&pairing_sessions[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
 static bool IsInPairingMode() {
-  return nearby_platform_IsInPairingMode() ||
-         (pairing_state != kPairingStateIdle &&
-          pairing_state != kPairingStateWaitingForAccountKeyWrite &&
-          pairing_state != kPairingStateWaitingForAdditionalData);
+  return nearby_platform_IsInPairingMode() || IsPairingInProgress();
 }
 
 #if NEARBY_FP_ENABLE_BATTERY_NOTIFICATION
@@ -398,21 +489,38 @@ static void AccountKeyRejected() {
   }
 }
 
-static void DiscardAccountKey() {
-  memset(&account_key_info, 0, sizeof(account_key_info));
+static void DiscardAccountKey(pairing_session* session) {
+  memset(&session->account_key_info, 0, sizeof(session->account_key_info));
 }
 
-static bool ShouldTimeout(unsigned int timeout_ms) {
-  return nearby_platform_GetCurrentTimeMs() - timeout_start_ms > timeout_ms;
+static bool ShouldTimeout(const pairing_session* session,
+                          unsigned int timeout_ms) {
+  return nearby_platform_GetCurrentTimeMs() - session->timeout_start_ms >
+         timeout_ms;
 }
 
-static bool HasPendingAccountKey() {
-  return pending_account_key_info.account_key[0] ==
+static bool HasPendingAccountKey(const pairing_session* session) {
+  return session->pending_account_key_info.account_key[0] ==
          ACCOUNT_KEY_WRITE_MESSAGE_TYPE;
 }
 
-static void DiscardPendingAccountKey() {
-  memset(&pending_account_key_info, 0, sizeof(pending_account_key_info));
+static void DiscardPendingAccountKey(pairing_session* session) {
+  memset(&session->pending_account_key_info, 0,
+         sizeof(session->pending_account_key_info));
+}
+
+// Discards the account keys that have been waiting for the pairing result for
+// too long.
+static void DiscardExpiredPendingAccountKeys() {
+  unsigned int now = nearby_platform_GetCurrentTimeMs();
+  for (int i = 0; i < NEARBY_MAX_PAIRING_SESSIONS; i++) {
+    pairing_session* session = &pairing_sessions[i];
+    if (HasPendingAccountKey(session) &&
+        now - session->pending_account_key_time_ms >=
+            WAIT_FOR_PAIRING_RESULT_AFTER_ACCOUNT_KEY_TIME_MS) {
+      DiscardPendingAccountKey(session);
+    }
+  }
 }
 
 static void RotateBleAddress() {
@@ -440,12 +548,13 @@ static void RotateBleAddress() {
 }
 
 static nearby_platform_status SendKeyBasedPairingResponse(
-    uint64_t peer_address, bool extended_response) {
+    const pairing_session* session, uint64_t peer_address,
+    bool extended_response) {
   nearby_platform_status status;
   uint8_t raw[AES_MESSAGE_SIZE_BYTES], encrypted[AES_MESSAGE_SIZE_BYTES];
   nearby_fp_CreateRawKeybasedPairingResponse(raw, extended_response);
   status = nearby_platform_Aes128Encrypt(raw, encrypted,
-                                         account_key_info.account_key);
+                                         session->account_key_info.account_key);
   if (status != kNearbyStatusOK) {
     NEARBY_TRACE(ERROR, "Failed to encrypt key-based pairing response");
     return status;
@@ -459,7 +568,8 @@ static nearby_platform_status SendKeyBasedPairingResponse(
 }
 
 #if NEARBY_FP_ENABLE_ADDITIONAL_DATA
-static nearby_platform_status NotifyPersonalizedName(uint64_t peer_address) {
+static nearby_platform_status NotifyPersonalizedName(
+    const pairing_session* session, uint64_t peer_address) {
   NEARBY_TRACE(VERBOSE, "NotifyPersonalizedName");
   uint8_t data[ADDITIONAL_DATA_HEADER_SIZE + PERSONALIZED_NAME_MAX_SIZE];
   size_t length = PERSONALIZED_NAME_MAX_SIZE;
@@ -476,8 +586,8 @@ static nearby_platform_status NotifyPersonalizedName(uint64_t peer_address) {
   }
 
   length += ADDITIONAL_DATA_HEADER_SIZE;
-  status = nearby_fp_EncodeAdditionalData(data, length,
-                                          account_key_info.account_key);
+  status = nearby_fp_EncodeAdditionalData(
+      data, length, session->account_key_info.account_key);
   if (kNearbyStatusOK != status) {
     NEARBY_TRACE(ERROR, "Failed to encrypt additional data, status: %d",
                  status);
@@ -494,7 +604,8 @@ static nearby_platform_status NotifyPersonalizedName(uint64_t peer_address) {
   return kNearbyStatusOK;
 }
 
-static nearby_platform_status SaveAdditionalData(const uint8_t* data,
+static nearby_platform_status SaveAdditionalData(uint8_t additional_data_id,
+                                                 const uint8_t* data,
                                                  size_t length) {
   if (additional_data_id == PERSONALIZED_NAME_DATA_ID) {
     char name[PERSONALIZED_NAME_MAX_SIZE * sizeof(uint8_t) / sizeof(char) + 1];
@@ -512,32 +623,39 @@ static nearby_platform_status OnAdditionalDataWrite(uint64_t peer_address,
                                                     const uint8_t* request,
                                                     size_t length) {
   NEARBY_TRACE(VERBOSE, "OnAdditionalDataWrite");
-  if (pairing_state != kPairingStateWaitingForAdditionalData) {
+  pairing_session* session = GetPairingSession(peer_address);
+  if (!session) {
+    NEARBY_TRACE(WARNING, "Not expecting a write to Additional Data from %s",
+                 nearby_utils_MacToString(peer_address));
+    return kNearbyStatusError;
+  }
+  if (session->pairing_state != kPairingStateWaitingForAdditionalData) {
     NEARBY_TRACE(WARNING,
                  "Not expecting a write to Additional Data. Current state: %d",
-                 pairing_state);
+                 session->pairing_state);
     return kNearbyStatusError;
   }
   nearby_platform_status status = nearby_fp_DecodeAdditionalData(
-      (uint8_t*)request, length, account_key_info.account_key);
-  DiscardAccountKey();
+      (uint8_t*)request, length, session->account_key_info.account_key);
   if (kNearbyStatusOK == status) {
-    status = SaveAdditionalData(request + ADDITIONAL_DATA_HEADER_SIZE,
+    status = SaveAdditionalData(session->additional_data_id,
+                                request + ADDITIONAL_DATA_HEADER_SIZE,
                                 length - ADDITIONAL_DATA_HEADER_SIZE);
   }
-  pairing_state = kPairingStateIdle;
+  ReleasePairingSession(session);
   return status;
 }
 #endif /* NEARBY_FP_ENABLE_ADDITIONAL_DATA */
 
 static nearby_platform_status HandleKeyBasedPairingRequest(
-    uint64_t peer_address, uint8_t request[ENCRYPTED_REQUEST_LENGTH]) {
+    pairing_session* session, uint64_t peer_address,
+    uint8_t request[ENCRYPTED_REQUEST_LENGTH]) {
   NEARBY_TRACE(VERBOSE, "HandleKeyBasedPairingRequest");
   int flags;
   flags = request[1];
 #if NEARBY_FP_ENABLE_ADDITIONAL_DATA
   if (flags & KBPR_NOTIFY_EXISTING_NAME_MASK) {
-    NotifyPersonalizedName(peer_address);
+    NotifyPersonalizedName(session, peer_address);
   }
 #endif /* NEARBY_FP_ENABLE_ADDITIONAL_DATA */
 
@@ -573,21 +691,22 @@ static nearby_platform_status HandleKeyBasedPairingRequest(
 
   nearby_platform_SetFastPairCapabilities();
   if (flags & KBPR_INITIATE_PAIRING_MASK) {
-    peer_public_address =
+    session->peer_public_address =
         nearby_utils_GetBigEndian48(request + KBPR_SEEKER_ADDRESS_OFFSET);
     NEARBY_TRACE(INFO, "Send pairing request to %s",
-                 nearby_utils_MacToString(peer_public_address));
-    nearby_platform_SendPairingRequest(peer_public_address);
-    pairing_state = kPairingStateWaitingForPasskey;
+                 nearby_utils_MacToString(session->peer_public_address));
+    nearby_platform_SendPairingRequest(session->peer_public_address);
+    session->pairing_state = kPairingStateWaitingForPasskey;
   } else {
-    pairing_state = kPairingStateWaitingForPairingRequest;
-    timeout_start_ms = nearby_platform_GetCurrentTimeMs();
+    session->pairing_state = kPairingStateWaitingForPairingRequest;
+    session->timeout_start_ms = nearby_platform_GetCurrentTimeMs();
   }
   return kNearbyStatusOK;
 }
 
 static nearby_platform_status HandleActionRequest(
-    uint64_t peer_address, uint8_t request[ENCRYPTED_REQUEST_LENGTH]) {
+    pairing_session* session, uint64_t peer_address,
+    uint8_t request[ENCRYPTED_REQUEST_LENGTH]) {
   NEARBY_TRACE(VERBOSE, "HandleActionRequest");
   int flags;
   flags = request[1];
@@ -597,8 +716,8 @@ static nearby_platform_status HandleActionRequest(
   }
 #if NEARBY_FP_ENABLE_ADDITIONAL_DATA
   if (flags & ACTION_REQUEST_WILL_WRITE_DATA_CHARACTERISTIC_MASK) {
-    pairing_state = kPairingStateWaitingForAdditionalData;
-    additional_data_id = request[10];
+    session->pairing_state = kPairingStateWaitingForAdditionalData;
+    session->additional_data_id = request[10];
   }
   return kNearbyStatusOK;
 #else
@@ -613,6 +732,8 @@ static nearby_platform_status OnWriteKeyBasedPairing(uint64_t peer_address,
   uint8_t decrypted_request[ENCRYPTED_REQUEST_LENGTH];
   uint8_t ble_address[BT_ADDRESS_LENGTH];
   uint8_t public_address[BT_ADDRESS_LENGTH];
+  nearby_platform_AccountKeyInfo account_key_info;
+  pairing_session* session;
 
   NEARBY_TRACE(VERBOSE, "OnWriteKeyBasedPairing");
   if (pairing_failure_count >= MAX_PAIRING_FAILURE_COUNT) {
@@ -704,14 +825,16 @@ static nearby_platform_status OnWriteKeyBasedPairing(uint64_t peer_address,
     return kNearbyStatusError;
   }
   pairing_failure_count = 0;
-  gatt_peer_address = peer_address;
+  session = AcquirePairingSession(peer_address);
+  session->account_key_info = account_key_info;
 
-  DiscardPendingAccountKey();
+  DiscardPendingAccountKey(session);
 
   bool extended_response =
       decrypted_request[0] == KEY_BASED_PAIRING_REQUEST_FLAG &&
       decrypted_request[1] & KBPR_SEEKER_SUPPORTS_BLE_DEVICES_MASK;
-  status = SendKeyBasedPairingResponse(peer_address, extended_response);
+  status =
+      SendKeyBasedPairingResponse(session, peer_address, extended_response);
   if (status != kNearbyStatusOK) return status;
 
   // TODO(jsobczak): Note that at the end of the packet there is a salt
@@ -719,19 +842,22 @@ static nearby_platform_status OnWriteKeyBasedPairing(uint64_t peer_address,
   // Provider receives a request containing an already used salt, the request
   // should be ignored to prevent replay attacks.
   if (decrypted_request[0] == KEY_BASED_PAIRING_REQUEST_FLAG) {
-    return HandleKeyBasedPairingRequest(peer_address, decrypted_request);
+    return HandleKeyBasedPairingRequest(session, peer_address,
+                                        decrypted_request);
   } else if (decrypted_request[0] == ACTION_REQUEST_FLAG) {
-    return HandleActionRequest(peer_address, decrypted_request);
+    return HandleActionRequest(session, peer_address, decrypted_request);
   }
   return kNearbyStatusOK;
 }
 
-static nearby_platform_status NotifyProviderPasskey(uint64_t peer_address) {
+static nearby_platform_status NotifyProviderPasskey(
+    const pairing_session* session, uint64_t peer_address) {
   uint8_t raw_passkey_block[AES_MESSAGE_SIZE_BYTES];
   uint8_t encrypted[AES_MESSAGE_SIZE_BYTES];
   uint32_t provider_passkey;
   nearby_platform_status status;
-  provider_passkey = nearby_platfrom_GetPairingPassKey();
+  provider_passkey =
+      nearby_platfrom_GetPairingPassKey(session->peer_public_address);
 
   raw_passkey_block[0] = PROVIDER_PASSKEY_MESSAGE_TYPE;
   nearby_utils_CopyBigEndian(raw_passkey_block + 1, provider_passkey, 3);
@@ -740,7 +866,7 @@ static nearby_platform_status NotifyProviderPasskey(uint64_t peer_address) {
     raw_passkey_block[i] = nearby_platform_Rand();
   }
   status = nearby_platform_Aes128Encrypt(raw_passkey_block, encrypted,
-                                         account_key_info.account_key);
+                                         session->account_key_info.account_key);
   if (status != kNearbyStatusOK) {
     NEARBY_TRACE(ERROR, "Failed to encrypt passkey block");
     return status;
@@ -764,21 +890,18 @@ static nearby_platform_status OnPasskeyWrite(uint64_t peer_address,
   uint8_t raw_passkey_block[AES_MESSAGE_SIZE_BYTES];
   nearby_platform_status status;
   uint32_t seeker_passkey;
-  if (pairing_state != kPairingStateWaitingForPasskey) {
-    NEARBY_TRACE(INFO, "Not expecting a passkey write. Current state: %d",
-                 pairing_state);
+  pairing_session* session = GetPairingSession(peer_address);
+  if (!session) {
+    NEARBY_TRACE(INFO, "Ignoring passkey write from unexpected client %s",
+                 nearby_utils_MacToString(peer_address));
     return kNearbyStatusError;
   }
-  if (gatt_peer_address != peer_address) {
-    NEARBY_TRACE(INFO,
-                 "Ignoring passkey write from unexpected client, expected GATT "
-                 "peer address: %s",
-                 nearby_utils_MacToString(gatt_peer_address));
-    NEARBY_TRACE(INFO, "Peer address: %s",
-                 nearby_utils_MacToString(peer_address));
+  if (session->pairing_state != kPairingStateWaitingForPasskey) {
+    NEARBY_TRACE(INFO, "Not expecting a passkey write. Current state: %d",
+                 session->pairing_state);
     return kNearbyStatusError;
   }
-  if (ShouldTimeout(PASSKEY_MAX_WAIT_TIME_MS)) {
+  if (ShouldTimeout(session, PASSKEY_MAX_WAIT_TIME_MS)) {
     NEARBY_TRACE(INFO, "Not expecting a passkey write");
     return kNearbyStatusTimeout;
   }
@@ -788,11 +911,11 @@ static nearby_platform_status OnPasskeyWrite(uint64_t peer_address,
                  nearby_utils_ArrayToString(request, length));
     return kNearbyStatusError;
   }
-  status = nearby_platform_Aes128Decrypt(request, raw_passkey_block,
-                                         account_key_info.account_key);
+  status = nearby_platform_Aes128Decrypt(
+      request, raw_passkey_block, session->account_key_info.account_key);
   if (status != kNearbyStatusOK) {
     NEARBY_TRACE(WARNING, "Failed to decrypt passkey block");
-    DiscardAccountKey();
+    DiscardAccountKey(session);
     return status;
   }
   if (raw_passkey_block[0] != SEEKER_PASSKEY_MESSAGE_TYPE) {
@@ -800,10 +923,11 @@ static nearby_platform_status OnPasskeyWrite(uint64_t peer_address,
                  raw_passkey_block[0]);
     return kNearbyStatusError;
   }
-  pairing_state = kPairingStateWaitingForPairingResult;
-  NotifyProviderPasskey(peer_address);
+  session->pairing_state = kPairingStateWaitingForPairingResult;
+  NotifyProviderPasskey(session, peer_address);
   seeker_passkey = nearby_utils_GetBigEndian24(raw_passkey_block + 1);
-  nearby_platform_SetRemotePasskey(seeker_passkey);
+  nearby_platform_SetRemotePasskey(session->peer_public_address,
+                                   seeker_passkey);
   return kNearbyStatusOK;
 }
 
@@ -855,10 +979,11 @@ static nearby_platform_status SetNonDiscoverableAdvertisement() {
 // Steps executed after successful pairing with a seeker and receiving the
 // account key.
 static void RunPostPairingSteps(
-    uint64_t peer_address, const nearby_platform_AccountKeyInfo* account_key) {
+    pairing_session* session, uint64_t peer_address,
+    const nearby_platform_AccountKeyInfo* account_key) {
   nearby_fp_AddAccountKey(account_key);
   nearby_fp_SaveAccountKeys();
-  DiscardPendingAccountKey();
+  DiscardPendingAccountKey(session);
 #if NEARBY_FP_RETROACTIVE_PAIRING
   if (RetroactivePairingPeerPending(peer_address)) {
     RemoveRetroactivePairingPeer(peer_address);
@@ -867,7 +992,7 @@ static void RunPostPairingSteps(
       NEARBY_TRACE(WARNING, "peer is still pending %s",
                    nearby_utils_MacToString(peer_address));
     }
-    if (pairing_state != kPairingStateIdle) {
+    if (session->pairing_state != kPairingStateIdle) {
       NEARBY_TRACE(WARNING,
                    "Another fp pairing process has launched, do not change "
                    "pairing state");
@@ -876,10 +1001,11 @@ static void RunPostPairingSteps(
   }
 #endif /* NEARBY_FP_RETROACTIVE_PAIRING */
 
-  pairing_state = kPairingStateIdle;
 #if NEARBY_FP_ENABLE_ADDITIONAL_DATA
-  pairing_state = kPairingStateWaitingForAdditionalData;
-  additional_data_id = PERSONALIZED_NAME_DATA_ID;
+  session->pairing_state = kPairingStateWaitingForAdditionalData;
+  session->additional_data_id = PERSONALIZED_NAME_DATA_ID;
+#else
+  ReleasePairingSession(session);
 #endif
   if (advertisement_mode & NEARBY_FP_ADVERTISEMENT_NON_DISCOVERABLE) {
     NEARBY_TRACE(INFO, "Account key added, update advertisement");
@@ -895,6 +1021,14 @@ static nearby_platform_status OnAccountKeyWrite(uint64_t peer_address,
   uint8_t* decrypted_request = key_info.account_key;
   nearby_platform_status status;
   bool wait_until_paired = false;
+  pairing_session* session = GetPairingSession(peer_address);
+  if (!session) session = GetPairingSessionByPublicAddress(peer_address);
+  if (!session) {
+    NEARBY_TRACE(INFO, "Ignoring account key write from unexpected client");
+    NEARBY_TRACE(ERROR, "Peer address: %s",
+                 nearby_utils_MacToString(peer_address));
+    return kNearbyStatusError;
+  }
 
 #if NEARBY_FP_RETROACTIVE_PAIRING
   if (RetroactivePairingPeerPending(peer_address)) {
@@ -908,30 +1042,18 @@ static nearby_platform_status OnAccountKeyWrite(uint64_t peer_address,
     }
   } else {
 #endif /* NEARBY_FP_RETROACTIVE_PAIRING */
-    if (pairing_state == kPairingStateWaitingForPairingRequest ||
-        pairing_state == kPairingStateWaitingForPairingResult ||
-        pairing_state == kPairingStateWaitingForPasskey) {
+    if (IsPairing(session)) {
       NEARBY_TRACE(VERBOSE, "Account key write before paired event");
       wait_until_paired = true;
-    } else if (pairing_state != kPairingStateWaitingForAccountKeyWrite) {
+    } else if (session->pairing_state !=
+               kPairingStateWaitingForAccountKeyWrite) {
       NEARBY_TRACE(INFO,
                    "Not expecting an account key write. Current state: %d",
-                   pairing_state);
-      return kNearbyStatusError;
-    }
-    if (gatt_peer_address != peer_address &&
-        peer_public_address != peer_address) {
-      NEARBY_TRACE(INFO, "Ignoring account key write from unexpected client");
-      NEARBY_TRACE(ERROR, "Peer address: %s",
-                   nearby_utils_MacToString(peer_address));
-      NEARBY_TRACE(ERROR, "Expected BLE peer address: %s",
-                   nearby_utils_MacToString(gatt_peer_address));
-      NEARBY_TRACE(ERROR, "Expected BT peer address: %s",
-                   nearby_utils_MacToString(peer_public_address));
+                   session->pairing_state);
       return kNearbyStatusError;
     }
 
-    if (ShouldTimeout(ACCOUNT_KEY_WRITE_TIME_MS)) {
+    if (ShouldTimeout(session, ACCOUNT_KEY_WRITE_TIME_MS)) {
       NEARBY_TRACE(INFO, "Not expecting an account key write. Timeout");
       return kNearbyStatusTimeout;
     }
@@ -943,8 +1065,8 @@ static nearby_platform_status OnAccountKeyWrite(uint64_t peer_address,
                  AES_MESSAGE_SIZE_BYTES, length);
     return kNearbyStatusError;
   }
-  status = nearby_platform_Aes128Decrypt(request, decrypted_request,
-                                         account_key_info.account_key);
+  status = nearby_platform_Aes128Decrypt(
+      request, decrypted_request, session->account_key_info.account_key);
   if (status != kNearbyStatusOK) {
     NEARBY_TRACE(WARNING, "Failed to decrypt account key block");
     return status;
@@ -958,14 +1080,14 @@ static nearby_platform_status OnAccountKeyWrite(uint64_t peer_address,
   key_info.peer_address = peer_address;
 #endif /* NEARBY_FP_ENABLE_SASS */
   if (wait_until_paired) {
-    memcpy(pending_account_key_info.account_key, decrypted_request,
-           ACCOUNT_KEY_SIZE_BYTES);
+    session->pending_account_key_info = key_info;
+    session->pending_account_key_time_ms = nearby_platform_GetCurrentTimeMs();
     nearby_platform_StartTimer(
-        DiscardPendingAccountKey,
+        DiscardExpiredPendingAccountKeys,
         WAIT_FOR_PAIRING_RESULT_AFTER_ACCOUNT_KEY_TIME_MS);
     return kNearbyStatusOK;
   }
-  RunPostPairingSteps(peer_address, &key_info);
+  RunPostPairingSteps(session, peer_address, &key_info);
   return kNearbyStatusOK;
 }
 
@@ -1043,28 +1165,46 @@ static nearby_platform_status OnGattRead(
 static void OnPairingRequest(uint64_t peer_address) {
   NEARBY_TRACE(VERBOSE, "Pairing request from %s",
                nearby_utils_MacToString(peer_address));
-  if (pairing_state == kPairingStateWaitingForPairingRequest) {
-    if (ShouldTimeout(WAIT_FOR_PAIRING_REQUEST_TIME_MS)) {
-      pairing_state = kPairingStateIdle;
+  pairing_session* session = GetPairingSessionByPublicAddress(peer_address);
+  if (!session) {
+    // The seeker's BR/EDR address is not known yet. Assume the request comes
+    // from the seeker that has been waiting the longest.
+    unsigned int now = nearby_platform_GetCurrentTimeMs();
+    for (int i = 0; i < NEARBY_MAX_PAIRING_SESSIONS; i++) {
+      pairing_session* candidate = &pairing_sessions[i];
+      if (candidate->gatt_peer_address != INVALID_PEER_ADDRESS &&
+          candidate->pairing_state == kPairingStateWaitingForPairingRequest &&
+          (!session || now - candidate->timeout_start_ms >
+                           now - session->timeout_start_ms)) {
+        session = candidate;
+      }
+    }
+  }
+  if (session &&
+      session->pairing_state == kPairingStateWaitingForPairingRequest) {
+    if (ShouldTimeout(session, WAIT_FOR_PAIRING_REQUEST_TIME_MS)) {
+      session->pairing_state = kPairingStateIdle;
     } else {
-      pairing_state = kPairingStateWaitingForPasskey;
-      peer_public_address = peer_address;
-      timeout_start_ms = nearby_platform_GetCurrentTimeMs();
+      session->pairing_state = kPairingStateWaitingForPasskey;
+      session->peer_public_address = peer_address;
+      session->timeout_start_ms = nearby_platform_GetCurrentTimeMs();
     }
   }
 }
 
 static void OnPaired(uint64_t peer_address) {
   NEARBY_TRACE(INFO, "Paired with %s", nearby_utils_MacToString(peer_address));
-  if (peer_public_address == peer_address && HasPendingAccountKey()) {
+  pairing_session* session = GetPairingSessionByPublicAddress(peer_address);
+  if (session && HasPendingAccountKey(session)) {
     NEARBY_TRACE(INFO, "Saving pending account key");
-    RunPostPairingSteps(peer_address, &pending_account_key_info);
+    RunPostPairingSteps(session, peer_address,
+                        &session->pending_account_key_info);
     return;
   }
-  peer_public_address = peer_address;
-  if (pairing_state == kPairingStateWaitingForPairingResult) {
-    pairing_state = kPairingStateWaitingForAccountKeyWrite;
-    timeout_start_ms = nearby_platform_GetCurrentTimeMs();
+  if (session &&
+      session->pairing_state == kPairingStateWaitingForPairingResult) {
+    session->pairing_state = kPairingStateWaitingForAccountKeyWrite;
+    session->timeout_start_ms = nearby_platform_GetCurrentTimeMs();
   }
 #if NEARBY_FP_RETROACTIVE_PAIRING
   else if (AddRetroactivePairingPeer(peer_address) == false) {
@@ -1076,8 +1216,10 @@ static void OnPaired(uint64_t peer_address) {
 static void OnPairingFailed(uint64_t peer_address) {
   NEARBY_TRACE(ERROR, "Pairing failed with %s",
                nearby_utils_MacToString(peer_address));
-  DiscardAccountKey();
-  DiscardPendingAccountKey();
+  pairing_session* session = GetPairingSessionByPublicAddress(peer_address);
+  if (session) {
+    ReleasePairingSession(session);
+  }
 }
 
 #if NEARBY_FP_MESSAGE_STREAM
@@ -1757,9 +1899,7 @@ nearby_platform_status nearby_fp_client_SendNack(
 #if NEARBY_FP_ENABLE_BATTERY_NOTIFICATION
 static void OnBatteryChanged(void) {
   nearby_platform_status status;
-  if (pairing_state != kPairingStateIdle &&
-      pairing_state != kPairingStateWaitingForAccountKeyWrite &&
-      pairing_state != kPairingStateWaitingForAdditionalData) {
+  if (IsPairingInProgress()) {
     NEARBY_TRACE(ERROR, "%s: device is in pairing process", __func__);
     return;
   }
@@ -1837,9 +1977,7 @@ static nearby_platform_status EnterDisabledMode() {
 static nearby_platform_status EnterDiscoverableMode() {
   size_t length;
   uint8_t advertisement[DISCOVERABLE_ADV_SIZE_BYTES];
-  if (pairing_state != kPairingStateIdle &&
-      pairing_state != kPairingStateWaitingForAccountKeyWrite &&
-      pairing_state != kPairingStateWaitingForAdditionalData) {
+  if (IsPairingInProgress()) {
     NEARBY_TRACE(ERROR, "%s: device is in pairing process", __func__);
     return kNearbyStatusError;
   }
@@ -1853,9 +1991,7 @@ static nearby_platform_status EnterDiscoverableMode() {
 }
 
 static nearby_platform_status EnterNonDiscoverableMode() {
-  if (pairing_state != kPairingStateIdle &&
-      pairing_state != kPairingStateWaitingForAccountKeyWrite &&
-      pairing_state != kPairingStateWaitingForAdditionalData) {
+  if (IsPairingInProgress()) {
     NEARBY_TRACE(ERROR, "%s: device is in pairing process", __func__);
     return kNearbyStatusError;
   }
@@ -1971,15 +2107,13 @@ nearby_platform_status nearby_fp_client_Init(
   nearby_platform_status status;
 
   client_callbacks = callbacks;
-  pairing_state = kPairingStateIdle;
+  memset(pairing_sessions, 0, sizeof(pairing_sessions));
   pairing_failure_count = 0;
 #if NEARBY_FP_MESSAGE_STREAM
   memset(rfcomm_inputs, 0, sizeof(rfcomm_inputs));
 #endif /* NEARBY_FP_MESSAGE_STREAM */
   advertisement_mode = NEARBY_FP_ADVERTISEMENT_NONE;
   address_rotation_task = NULL;
-  peer_public_address = 0;
-  DiscardPendingAccountKey();
 
   status = nearby_platform_OsInit();
   if (status != kNearbyStatusOK) return status;
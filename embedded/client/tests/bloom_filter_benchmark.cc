@@ -0,0 +1,118 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Cost of rebuilding the non-discoverable advertisement against the number of
+// account keys, up to NEARBY_MAX_ACCOUNT_KEYS. Cycles are read from the time
+// stamp counter on x86 and are nanoseconds elsewhere.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "fakes.h"
+#include "gtest/gtest.h"
+#include "nearby.h"
+#include "nearby_fp_client.h"
+#include "nearby_fp_library.h"
+
+constexpr int kRebuilds = 2000;
+constexpr size_t kAdvertisementSize = 64;
+
+static uint64_t ReadCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+// Stores `count` distinct account keys.
+static void SetAccountKeys(size_t count) {
+  std::vector<AccountKeyPair> account_keys;
+  for (size_t i = 0; i < count; i++) {
+    std::vector<uint8_t> account_key(ACCOUNT_KEY_SIZE_BYTES, 0x5A);
+    account_key[0] = 0x04;
+    account_key[1] = i;
+    account_keys.push_back(AccountKeyPair(0xA0A1A2A3A400 + i, account_key));
+  }
+  nearby_test_fakes_SetAccountKeys(account_keys);
+  nearby_fp_LoadAccountKeys();
+}
+
+static size_t CreateAdvertisement(uint8_t* advertisement) {
+#if NEARBY_FP_ENABLE_BATTERY_NOTIFICATION
+  nearby_platform_BatteryInfo battery_info = {};
+  battery_info.right_bud_battery_level = 80;
+  battery_info.left_bud_battery_level = 70;
+  battery_info.charging_case_battery_level = 60;
+  return nearby_fp_CreateNondiscoverableAdvertisementWithBattery(
+      advertisement, kAdvertisementSize, false, true, &battery_info);
+#else
+  return nearby_fp_CreateNondiscoverableAdvertisement(
+      advertisement, kAdvertisementSize, false);
+#endif /* NEARBY_FP_ENABLE_BATTERY_NOTIFICATION */
+}
+
+class BloomFilterBenchmark : public ::testing::Test {
+ protected:
+  void SetUp() override { nearby_fp_client_Init(NULL); }
+};
+
+// A new salt: the whole advertisement is rebuilt, as on every rotation.
+TEST_F(BloomFilterBenchmark, RebuildWithNewSalt) {
+  for (size_t n = 1; n <= NEARBY_MAX_ACCOUNT_KEYS; n++) {
+    SetAccountKeys(n);
+    uint8_t advertisement[kAdvertisementSize];
+    uint64_t start = ReadCycleCounter();
+    for (int i = 0; i < kRebuilds; i++) {
+      nearby_test_fakes_SetRandomNumber(i);
+      CreateAdvertisement(advertisement);
+      ASSERT_EQ((6 * n + 15) / 5,
+                nearby_fp_SetBloomFilter(advertisement, false, NULL));
+    }
+    std::cout << "keys: " << n << " cycles per rebuild: "
+              << (ReadCycleCounter() - start) / kRebuilds << std::endl;
+  }
+}
+
+// The same salt with a new battery level: only the filter is recomputed.
+TEST_F(BloomFilterBenchmark, RebuildFilterOnly) {
+  for (size_t n = 1; n <= NEARBY_MAX_ACCOUNT_KEYS; n++) {
+    SetAccountKeys(n);
+    uint8_t advertisement[kAdvertisementSize];
+    size_t length = CreateAdvertisement(advertisement);
+    uint64_t start = ReadCycleCounter();
+    for (int i = 0; i < kRebuilds; i++) {
+      // The last byte is the case battery level when battery info is included,
+      // or else part of the salt.
+      advertisement[length - 1] = i;
+      ASSERT_EQ((6 * n + 15) / 5,
+                nearby_fp_SetBloomFilter(advertisement, false, NULL));
+    }
+    std::cout << "keys: " << n << " cycles per filter: "
+              << (ReadCycleCounter() - start) / kRebuilds << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -24,10 +24,14 @@
 #include "nearby_platform_se.h"
 
 constexpr uint64_t kDefaultBleAddress = 0xbabababa;
+constexpr uint64_t kDefaultPeerAddress = 0x345678ab;
 static uint64_t ble_address = kDefaultBleAddress;
-static uint64_t peer_address = 0x345678ab;
+static uint64_t peer_address = kDefaultPeerAddress;
 static const nearby_platform_BleInterface* ble_interface;
 static std::map<nearby_fp_Characteristic, std::vector<uint8_t>> notifications;
+static std::map<uint64_t,
+                std::map<nearby_fp_Characteristic, std::vector<uint8_t>>>
+    peer_notifications;
 static std::vector<uint8_t> advertisement;
 static nearby_fp_AvertisementInterval interval;
 constexpr int32_t kDefaultPsm = -1;
@@ -38,6 +42,15 @@ nearby_test_fakes_GetGattNotifications() {
   return notifications;
 }
 
+std::map<nearby_fp_Characteristic, std::vector<uint8_t>>&
+nearby_test_fakes_GetGattNotifications(uint64_t peer_address) {
+  return peer_notifications[peer_address];
+}
+
+void nearby_test_fakes_SetGattPeerAddress(uint64_t address) {
+  peer_address = address;
+}
+
 // Gets BLE address.
 uint64_t nearby_platform_GetBleAddress() { return ble_address; }
 
@@ -70,6 +83,8 @@ nearby_platform_status nearby_platform_GattNotify(
     const uint8_t* message, size_t length) {
   notifications.emplace(characteristic,
                         std::vector<uint8_t>(message, message + length));
+  peer_notifications[peer_address][characteristic].assign(message,
+                                                          message + length);
   return kNearbyStatusOK;
 }
 
@@ -92,9 +107,11 @@ nearby_platform_status nearby_platform_BleInit(
     const nearby_platform_BleInterface* callbacks) {
   ble_interface = callbacks;
   notifications.clear();
+  peer_notifications.clear();
   advertisement.clear();
   interval = kDisabled;
   ble_address = kDefaultBleAddress;
+  peer_address = kDefaultPeerAddress;
   psm = kDefaultPsm;
   return kNearbyStatusOK;
 }
@@ -46,14 +46,17 @@ uint64_t nearby_platform_GetSecondaryPublicAddress() {
 }
 
 // Returns passkey used during pairing
-uint32_t nearby_platfrom_GetPairingPassKey() { return kLocalPasskey; }
+uint32_t nearby_platfrom_GetPairingPassKey(uint64_t peer_address) {
+  return kLocalPasskey;
+}
 
-void nearby_platform_SetRemotePasskey(uint32_t passkey) {
+void nearby_platform_SetRemotePasskey(uint64_t peer_address,
+                                      uint32_t passkey) {
   remote_passkey = passkey;
   if (remote_passkey == kLocalPasskey &&
-      remote_address != 0 & bt_interface != NULL) {
-    paired_peer_address = remote_address;
-    bt_interface->on_paired(remote_address);
+      peer_address != 0 & bt_interface != NULL) {
+    paired_peer_address = peer_address;
+    bt_interface->on_paired(peer_address);
   }
 }
 
@@ -55,6 +55,11 @@ std::vector<uint8_t>& nearby_test_fakes_GetAdvertisement();
 
 std::map<nearby_fp_Characteristic, std::vector<uint8_t>>&
 nearby_test_fakes_GetGattNotifications();
+// Gets the latest notification of each characteristic sent to |peer_address|.
+std::map<nearby_fp_Characteristic, std::vector<uint8_t>>&
+nearby_test_fakes_GetGattNotifications(uint64_t peer_address);
+// Sets the BLE address of the seeker that the GATT requests come from.
+void nearby_test_fakes_SetGattPeerAddress(uint64_t address);
 
 void nearby_test_fakes_SimulatePairing(uint64_t peer_address);
 nearby_platform_status nearby_fp_fakes_ReceiveKeyBasedPairingRequest(
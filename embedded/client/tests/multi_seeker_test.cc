@@ -0,0 +1,280 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Several seekers going through Fast Pair with the provider at the same time.
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "fakes.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "nearby.h"
+#include "nearby_fp_client.h"
+#include "nearby_fp_library.h"
+#include "nearby_utils.h"
+
+static_assert(NEARBY_MAX_PAIRING_SESSIONS <= NEARBY_MAX_ACCOUNT_KEYS,
+              "Every seeker must be able to save its account key");
+
+constexpr uint8_t kBobPrivateKey[32] = {
+    0x02, 0xB4, 0x37, 0xB0, 0xED, 0xD6, 0xBB, 0xD4, 0x29, 0x06, 0x4A,
+    0x4E, 0x52, 0x9F, 0xCB, 0xF1, 0xC4, 0x8D, 0x0D, 0x62, 0x49, 0x24,
+    0xD5, 0x92, 0x27, 0x4B, 0x7E, 0xD8, 0x11, 0x93, 0xD7, 0x63};
+constexpr uint8_t kBobPublicKey[64] = {
+    0xF7, 0xD4, 0x96, 0xA6, 0x2E, 0xCA, 0x41, 0x63, 0x51, 0x54, 0x0A,
+    0xA3, 0x43, 0xBC, 0x69, 0x0A, 0x61, 0x09, 0xF5, 0x51, 0x50, 0x06,
+    0x66, 0xB8, 0x3B, 0x12, 0x51, 0xFB, 0x84, 0xFA, 0x28, 0x60, 0x79,
+    0x5E, 0xBD, 0x63, 0xD3, 0xB8, 0x83, 0x6F, 0x44, 0xA9, 0xA3, 0xE2,
+    0x8B, 0xB3, 0x40, 0x17, 0xE0, 0x15, 0xF5, 0x97, 0x93, 0x05, 0xD8,
+    0x49, 0xFD, 0xF8, 0xDE, 0x10, 0x12, 0x3B, 0x61, 0xD2};
+constexpr uint8_t kAlicePublicKey[64] = {
+    0x36, 0xAC, 0x68, 0x2C, 0x50, 0x82, 0x15, 0x66, 0x8F, 0xBE, 0xFE,
+    0x24, 0x7D, 0x01, 0xD5, 0xEB, 0x96, 0xE6, 0x31, 0x8E, 0x85, 0x5B,
+    0x2D, 0x64, 0xB5, 0x19, 0x5D, 0x38, 0xEE, 0x7E, 0x37, 0xBE, 0x18,
+    0x38, 0xC0, 0xB9, 0x48, 0xC3, 0xF7, 0x55, 0x20, 0xE0, 0x7E, 0x70,
+    0xF0, 0x72, 0x91, 0x41, 0x9A, 0xCE, 0x2D, 0x28, 0x14, 0x3C, 0x5A,
+    0xDB, 0x2D, 0xBD, 0x98, 0xEE, 0x3C, 0x8E, 0x4F, 0xBF};
+// Key shared by every seeker, derived from Bob's and Alice's keys
+constexpr uint8_t kAesKey[16] = {0xB0, 0x7F, 0x1F, 0x17, 0xC2, 0x36,
+                                 0xCB, 0xD3, 0x35, 0x23, 0xC5, 0x15,
+                                 0xF3, 0x50, 0xAE, 0x57};
+constexpr uint32_t kBtPasskey = 123456;
+constexpr int kRounds = 50;
+
+using ::testing::UnorderedElementsAreArray;
+
+enum Step {
+  kWriteKeyBasedPairing,
+  kWritePasskey,
+  kWriteAccountKey,
+};
+
+class Seeker {
+ public:
+  explicit Seeker(int index)
+      : ble_address_(0x34567800 + index),
+        public_address_(0xB0B1B2B3B400 + index),
+        account_key_{0x04, static_cast<uint8_t>(index), 0x11, 0x12, 0x13,
+                     0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C,
+                     0x1D, 0x1E} {}
+
+  uint64_t public_address() const { return public_address_; }
+  const std::vector<uint8_t>& account_key() const { return account_key_; }
+
+  nearby_platform_status WriteKeyBasedPairing() {
+    uint8_t request[16] = {0x00, 0x40, 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5};
+    nearby_utils_CopyBigEndian(request + 8, public_address_, 6);
+    request[14] = 0xCD;
+    request[15] = 0xEF;
+    uint8_t encrypted[16 + 64];
+    nearby_test_fakes_Aes128Encrypt(request, encrypted, kAesKey);
+    memcpy(encrypted + 16, kAlicePublicKey, 64);
+    nearby_test_fakes_SetGattPeerAddress(ble_address_);
+    return nearby_fp_fakes_ReceiveKeyBasedPairingRequest(encrypted,
+                                                         sizeof(encrypted));
+  }
+
+  nearby_platform_status WritePasskey() {
+    uint8_t raw_passkey_block[16] = {0x02};
+    nearby_utils_CopyBigEndian(raw_passkey_block + 1, kBtPasskey, 3);
+    uint8_t encrypted[16];
+    nearby_test_fakes_Aes128Encrypt(raw_passkey_block, encrypted, kAesKey);
+    nearby_test_fakes_SetGattPeerAddress(ble_address_);
+    return nearby_fp_fakes_ReceivePasskey(encrypted, sizeof(encrypted));
+  }
+
+  nearby_platform_status WriteAccountKey() {
+    uint8_t encrypted[16];
+    nearby_test_fakes_Aes128Encrypt(account_key_.data(), encrypted, kAesKey);
+    nearby_test_fakes_SetGattPeerAddress(ble_address_);
+    return nearby_fp_fakes_ReceiveAccountKeyWrite(encrypted, sizeof(encrypted));
+  }
+
+  // Returns the passkey the provider notified to this seeker, or 0.
+  uint32_t GetProviderPasskey() {
+    auto& notifications = nearby_test_fakes_GetGattNotifications(ble_address_);
+    auto it = notifications.find(kPasskey);
+    if (it == notifications.end()) return 0;
+    uint8_t decrypted[16];
+    nearby_test_fakes_Aes128Decrypt(it->second.data(), decrypted, kAesKey);
+    if (decrypted[0] != 0x03) return 0;
+    return nearby_utils_GetBigEndian24(decrypted + 1);
+  }
+
+  nearby_platform_status Run(Step step) {
+    switch (step) {
+      case kWriteKeyBasedPairing:
+        return WriteKeyBasedPairing();
+      case kWritePasskey:
+        return WritePasskey();
+      case kWriteAccountKey:
+        return WriteAccountKey();
+    }
+    return kNearbyStatusError;
+  }
+
+ private:
+  uint64_t ble_address_;
+  uint64_t public_address_;
+  std::vector<uint8_t> account_key_;
+};
+
+static void StartProvider() {
+  ASSERT_EQ(kNearbyStatusOK, nearby_fp_client_Init(NULL));
+  ASSERT_EQ(kNearbyStatusOK, nearby_test_fakes_SetAntiSpoofingKey(
+                                 kBobPrivateKey, kBobPublicKey));
+  ASSERT_EQ(kNearbyStatusOK, nearby_fp_client_SetAdvertisement(
+                                 NEARBY_FP_ADVERTISEMENT_DISCOVERABLE));
+}
+
+static std::vector<std::vector<uint8_t>> GetAccountKeys() {
+  AccountKeyList keys = nearby_test_fakes_GetAccountKeys();
+  std::vector<std::vector<uint8_t>> result;
+  for (size_t i = 0; i < keys.size(); i++) {
+    result.push_back(keys.GetKey(i));
+  }
+  return result;
+}
+
+static std::vector<std::vector<uint8_t>> GetAccountKeys(
+    const std::vector<Seeker>& seekers) {
+  std::vector<std::vector<uint8_t>> result;
+  for (const Seeker& seeker : seekers) {
+    result.push_back(seeker.account_key());
+  }
+  return result;
+}
+
+TEST(MultiSeeker, InterleavedPairings_AllSeekersSaveTheirAccountKey) {
+  std::mt19937 random(1234);
+  for (int round = 0; round < kRounds; round++) {
+    SCOPED_TRACE(round);
+    StartProvider();
+    std::vector<Seeker> seekers;
+    // Remaining steps of each seeker, in order. Some seekers write their
+    // account key before the pairing result.
+    std::vector<std::vector<Step>> steps;
+    for (int i = 0; i < NEARBY_MAX_PAIRING_SESSIONS; i++) {
+      seekers.emplace_back(i);
+      if (random() % 2) {
+        steps.push_back(
+            {kWriteKeyBasedPairing, kWritePasskey, kWriteAccountKey});
+      } else {
+        steps.push_back(
+            {kWriteKeyBasedPairing, kWriteAccountKey, kWritePasskey});
+      }
+    }
+
+    int remaining = 3 * NEARBY_MAX_PAIRING_SESSIONS;
+    while (remaining > 0) {
+      int i = random() % seekers.size();
+      if (steps[i].empty()) continue;
+      Step step = steps[i].front();
+      steps[i].erase(steps[i].begin());
+      remaining--;
+      ASSERT_EQ(kNearbyStatusOK, seekers[i].Run(step))
+          << "seeker " << i << " step " << step;
+      if (step == kWritePasskey) {
+        EXPECT_EQ(kBtPasskey, seekers[i].GetProviderPasskey());
+        EXPECT_EQ(seekers[i].public_address(),
+                  nearby_test_fakes_GetPairedDevice());
+      }
+    }
+
+    EXPECT_THAT(GetAccountKeys(),
+                UnorderedElementsAreArray(GetAccountKeys(seekers)));
+  }
+}
+
+TEST(MultiSeeker, AllSessionsPairing_NewSeekerTakesOverOldestSession) {
+  StartProvider();
+  std::vector<Seeker> seekers;
+  for (int i = 0; i <= NEARBY_MAX_PAIRING_SESSIONS; i++) {
+    seekers.emplace_back(i);
+    nearby_test_fakes_SetCurrentTimeMs(i);
+    ASSERT_EQ(kNearbyStatusOK, seekers[i].WriteKeyBasedPairing());
+  }
+
+  // The first seeker lost its session.
+  EXPECT_NE(kNearbyStatusOK, seekers[0].WritePasskey());
+  for (int i = 1; i <= NEARBY_MAX_PAIRING_SESSIONS; i++) {
+    ASSERT_EQ(kNearbyStatusOK, seekers[i].WritePasskey());
+    ASSERT_EQ(kNearbyStatusOK, seekers[i].WriteAccountKey());
+  }
+
+  EXPECT_THAT(GetAccountKeys(),
+              UnorderedElementsAreArray(GetAccountKeys(std::vector<Seeker>(
+                  seekers.begin() + 1, seekers.end()))));
+}
+
+TEST(MultiSeeker, PairedSeekerSession_IsReusedBeforePairingOnes) {
+  StartProvider();
+  std::vector<Seeker> seekers;
+  for (int i = 0; i <= NEARBY_MAX_PAIRING_SESSIONS; i++) {
+    seekers.emplace_back(i);
+  }
+  // The first seeker completes pairing, the others are still pairing.
+  ASSERT_EQ(kNearbyStatusOK, seekers[0].WriteKeyBasedPairing());
+  ASSERT_EQ(kNearbyStatusOK, seekers[0].WritePasskey());
+  ASSERT_EQ(kNearbyStatusOK, seekers[0].WriteAccountKey());
+  for (int i = 1; i <= NEARBY_MAX_PAIRING_SESSIONS; i++) {
+    ASSERT_EQ(kNearbyStatusOK, seekers[i].WriteKeyBasedPairing());
+  }
+
+  for (int i = 1; i <= NEARBY_MAX_PAIRING_SESSIONS; i++) {
+    ASSERT_EQ(kNearbyStatusOK, seekers[i].WritePasskey());
+    ASSERT_EQ(kNearbyStatusOK, seekers[i].WriteAccountKey());
+  }
+
+  EXPECT_THAT(GetAccountKeys(),
+              UnorderedElementsAreArray(GetAccountKeys(seekers)));
+}
+
+#if NEARBY_FP_MESSAGE_STREAM
+TEST(MultiSeeker, PairedSeekers_OpenMessageStreams) {
+  StartProvider();
+  std::vector<Seeker> seekers;
+  for (int i = 0; i < NEARBY_MAX_RFCOMM_CONNECTIONS &&
+                  i < NEARBY_MAX_PAIRING_SESSIONS;
+       i++) {
+    seekers.emplace_back(i);
+    ASSERT_EQ(kNearbyStatusOK, seekers[i].WriteKeyBasedPairing());
+  }
+  for (Seeker& seeker : seekers) {
+    ASSERT_EQ(kNearbyStatusOK, seeker.WritePasskey());
+    ASSERT_EQ(kNearbyStatusOK, seeker.WriteAccountKey());
+  }
+
+  for (Seeker& seeker : seekers) {
+    nearby_test_fakes_MessageStreamConnected(seeker.public_address());
+  }
+
+  nearby_fp_client_SeekerInfo seeker_infos[NEARBY_MAX_RFCOMM_CONNECTIONS];
+  size_t length = NEARBY_MAX_RFCOMM_CONNECTIONS;
+  ASSERT_EQ(kNearbyStatusOK,
+            nearby_fp_client_GetSeekerInfo(seeker_infos, &length));
+  EXPECT_EQ(seekers.size(), length);
+  for (Seeker& seeker : seekers) {
+    EXPECT_FALSE(
+        nearby_test_fakes_GetRfcommOutput(seeker.public_address()).empty());
+  }
+}
+#endif /* NEARBY_FP_MESSAGE_STREAM */
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -47,7 +47,17 @@
 #define MAX_MESSAGE_STREAM_PAYLOAD_SIZE 22
 
 // The maximum number of concurrent RFCOMM connections
+#ifndef NEARBY_MAX_RFCOMM_CONNECTIONS
 #define NEARBY_MAX_RFCOMM_CONNECTIONS 2
+#endif /* NEARBY_MAX_RFCOMM_CONNECTIONS */
+
+// The maximum number of seekers that can go through key-based pairing, passkey
+// exchange and account key write at the same time. When all sessions are in
+// use, a new seeker takes over the session of a seeker that is done pairing,
+// or else the session that started the longest time ago.
+#ifndef NEARBY_MAX_PAIRING_SESSIONS
+#define NEARBY_MAX_PAIRING_SESSIONS 2
+#endif /* NEARBY_MAX_PAIRING_SESSIONS */
 
 // Support Retroactive pairing extension
 #ifndef NEARBY_FP_RETROACTIVE_PAIRING
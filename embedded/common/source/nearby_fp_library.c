@@ -56,6 +56,11 @@ typedef struct {
 // the battery level
 #define BATTERY_LEVEL_MASK 0x7F
 #define SALT_FIELD_LENGTH_AND_TYPE_BYTE ((NEARBY_FP_SALT_SIZE << 4) | 1)
+// The longest LTV field, as its length is a nibble
+#define MAX_LTV_FIELD_SIZE (LTV_HEADER_SIZE + 0x0F)
+// Account key followed by salt, battery info and random resolvable field
+#define MAX_BLOOM_FILTER_HASH_INPUT_SIZE \
+  (ACCOUNT_KEY_SIZE_BYTES + 3 * MAX_LTV_FIELD_SIZE)
 #define BATTERY_INFO_SIZE_BYTES 4
 // Response for seekers that don't support BLE-only devices.
 #define KEY_BASED_PAIRING_RESPONSE_FLAG 0x01
@@ -95,6 +100,12 @@ static const uint8_t kSassRrdKey[] = {'S', 'A', 'S', 'S', '-', 'R',
 
 static AccountKeyList account_key_list;
 
+// Indexes of the unique keys in `account_key_list`, in list order. Kept up to
+// date with the key list, so that advertisements can be rebuilt without
+// comparing every pair of keys again.
+static uint8_t unique_account_key_index[NEARBY_MAX_ACCOUNT_KEYS];
+static size_t unique_account_key_count;
+
 static uint8_t sha_buffer[32];
 
 #define RETURN_IF_ERROR(X)                        \
@@ -137,26 +148,23 @@ static bool IsAccountKeyInRange(const uint8_t* account_key, size_t end_offset) {
 
 size_t nearby_fp_GetAccountKeyCount() { return account_key_list.num_keys; }
 
-size_t nearby_fp_GetUniqueAccountKeyCount() {
-  size_t count = 0;
-  int offset = 0;
-  while (true) {
-    offset = nearby_fp_GetNextUniqueAccountKeyIndex(offset);
-    if (offset == -1) break;
-    count++;
-    offset++;
+// Recomputes the unique key indexes. Must be called whenever
+// `account_key_list` changes.
+static void UpdateUniqueAccountKeys() {
+  unique_account_key_count = 0;
+  for (size_t i = 0; i < nearby_fp_GetAccountKeyCount(); i++) {
+    if (!IsAccountKeyInRange(nearby_fp_GetAccountKey(i)->account_key, i)) {
+      unique_account_key_index[unique_account_key_count++] = i;
+    }
   }
-  return count;
 }
 
+size_t nearby_fp_GetUniqueAccountKeyCount() { return unique_account_key_count; }
+
 int nearby_fp_GetNextUniqueAccountKeyIndex(int offset) {
-  while (offset < nearby_fp_GetAccountKeyCount()) {
-    const nearby_platform_AccountKeyInfo* account_key_info =
-        nearby_fp_GetAccountKey(offset);
-    if (IsAccountKeyInRange(account_key_info->account_key, offset)) {
-      offset++;
-    } else {
-      return offset;
+  for (size_t i = 0; i < unique_account_key_count; i++) {
+    if (unique_account_key_index[i] >= offset) {
+      return unique_account_key_index[i];
     }
   }
   return -1;
@@ -177,6 +185,7 @@ void nearby_fp_MarkAccountKeyAsActive(unsigned key_number) {
     account_key_list.key[i] = account_key_list.key[i - 1];
   }
   account_key_list.key[0] = tmp;
+  UpdateUniqueAccountKeys();
 }
 
 void nearby_fp_CopyAccountKey(nearby_platform_AccountKeyInfo* dest,
@@ -223,6 +232,7 @@ void nearby_fp_AddAccountKey(const nearby_platform_AccountKeyInfo* key) {
   if (key_count < NEARBY_MAX_ACCOUNT_KEYS) {
     account_key_list.num_keys++;
   }
+  UpdateUniqueAccountKeys();
 }
 size_t nearby_fp_CreateDiscoverableAdvertisement(uint8_t* output,
                                                  size_t length) {
@@ -374,9 +384,21 @@ static const uint8_t* FindBatteryInfoLt(const uint8_t* advertisement) {
   return battery_info;
 }
 
+// Appends `length` bytes of `field` to the bloom filter hash input at
+// `offset`. Returns the new input length.
+static size_t AppendHashInput(uint8_t* input, size_t offset,
+                              const uint8_t* field, size_t length) {
+  NEARBY_ASSERT(offset + length <= MAX_BLOOM_FILTER_HASH_INPUT_SIZE);
+  if (length > 0) memcpy(input + offset, field, length);
+  return offset + length;
+}
+
 size_t nearby_fp_SetBloomFilter(uint8_t* advertisement, bool use_sass_format,
                                 const uint8_t* in_use_key) {
-  unsigned key_offset = 0;
+  // The hash input is the account key followed by fields that are the same for
+  // every key. They are copied once, after room for the key.
+  uint8_t hash_input[MAX_BLOOM_FILTER_HASH_INPUT_SIZE];
+  size_t hash_input_length = ACCOUNT_KEY_SIZE_BYTES;
   if (advertisement[ACCOUNT_KEY_DATA_OFFSET] == 0) {
     NEARBY_TRACE(INFO, "Empty account key filter");
     return 0;
@@ -384,52 +406,47 @@ size_t nearby_fp_SetBloomFilter(uint8_t* advertisement, bool use_sass_format,
   // Salt is mandatory and is included in the calculation without the LT header
   const uint8_t* salt_field = nearby_fp_FindLtv(advertisement, SALT_FIELD_TYPE);
   NEARBY_ASSERT(salt_field != NULL);
-  const uint8_t* salt = salt_field + LTV_HEADER_SIZE;
-  int salt_length = GetLtLength(*salt_field);
+  hash_input_length =
+      AppendHashInput(hash_input, hash_input_length,
+                      salt_field + LTV_HEADER_SIZE, GetLtLength(*salt_field));
   // Battery info is optional and is included in the calculation with the LT
   // header
   const uint8_t* battery_info_field = FindBatteryInfoLt(advertisement);
-  int battery_info_field_length =
-      battery_info_field != NULL
-          ? GetLtLength(*battery_info_field) + LTV_HEADER_SIZE
-          : 0;
+  if (battery_info_field != NULL) {
+    hash_input_length = AppendHashInput(
+        hash_input, hash_input_length, battery_info_field,
+        GetLtLength(*battery_info_field) + LTV_HEADER_SIZE);
+  }
   // Random resolvable field is optional and is included in the calculation with
   // the LT header
   const uint8_t* random_resolvable_field =
       nearby_fp_FindLtv(advertisement, RANDOM_RESOLVABLE_FIELD_TYPE);
-  int random_resolvable_field_length =
-      random_resolvable_field != NULL
-          ? GetLtLength(*random_resolvable_field) + LTV_HEADER_SIZE
-          : 0;
+  if (random_resolvable_field != NULL) {
+    hash_input_length = AppendHashInput(
+        hash_input, hash_input_length, random_resolvable_field,
+        GetLtLength(*random_resolvable_field) + LTV_HEADER_SIZE);
+  }
   const size_t n = nearby_fp_GetUniqueAccountKeyCount();
   const size_t s = (6 * n + 15) / 5;
   NEARBY_ASSERT(s == GetLtLength(advertisement[ACCOUNT_KEY_DATA_OFFSET]));
   uint8_t* output = advertisement + ACCOUNT_KEY_DATA_OFFSET + LTV_HEADER_SIZE;
   memset(output, 0, s);
   for (size_t k = 0; k < n; k++) {
-    key_offset = nearby_fp_GetNextUniqueAccountKeyIndex(key_offset);
-    NEARBY_ASSERT(key_offset >= 0);
-    const uint8_t* key = nearby_fp_GetAccountKey(key_offset)->account_key;
-    uint8_t flags = key[0];
+    const uint8_t* key =
+        nearby_fp_GetAccountKey(unique_account_key_index[k])->account_key;
+    memcpy(hash_input, key, ACCOUNT_KEY_SIZE_BYTES);
     if (use_sass_format) {
       if (in_use_key != NULL) {
         if (!memcmp(key, in_use_key, ACCOUNT_KEY_SIZE_BYTES)) {
-          flags |= IN_USE_ACCOUNT_KEY_BIT;
+          hash_input[0] |= IN_USE_ACCOUNT_KEY_BIT;
         }
       } else if (k == 0) {
         // The first key is the most recently used one
-        flags |= MOST_RECENTLY_USED_ACCOUNT_KEY_BIT;
+        hash_input[0] |= MOST_RECENTLY_USED_ACCOUNT_KEY_BIT;
       }
     }
-    key_offset++;
     nearby_platform_Sha256Start();
-    nearby_platform_Sha256Update(&flags, sizeof(flags));
-    nearby_platform_Sha256Update(key + sizeof(flags),
-                                 ACCOUNT_KEY_SIZE_BYTES - sizeof(flags));
-    nearby_platform_Sha256Update(salt, salt_length);
-    nearby_platform_Sha256Update(battery_info_field, battery_info_field_length);
-    nearby_platform_Sha256Update(random_resolvable_field,
-                                 random_resolvable_field_length);
+    nearby_platform_Sha256Update(hash_input, hash_input_length);
     nearby_platform_Sha256Finish(sha_buffer);
     for (unsigned j = 0; j < 8; j++) {
       uint32_t x = nearby_utils_GetBigEndian32(sha_buffer + 4 * j);
@@ -461,8 +478,10 @@ size_t nearby_fp_AppendTxPower(uint8_t* advertisement, size_t length,
 nearby_platform_status nearby_fp_LoadAccountKeys() {
   size_t length = sizeof(account_key_list);
   memset(&account_key_list, 0, length);
-  return nearby_platform_LoadValue(kStoredKeyAccountKeyList,
-                                   (uint8_t*)&account_key_list, &length);
+  nearby_platform_status status = nearby_platform_LoadValue(
+      kStoredKeyAccountKeyList, (uint8_t*)&account_key_list, &length);
+  UpdateUniqueAccountKeys();
+  return status;
 }
 
 nearby_platform_status nearby_fp_SaveAccountKeys() {
@@ -56,15 +56,19 @@ uint64_t nearby_platform_GetPublicAddress();
 // Return 0 if this device does not have a secondary identity address.
 uint64_t nearby_platform_GetSecondaryPublicAddress();
 
-// Returns passkey used during pairing
-uint32_t nearby_platfrom_GetPairingPassKey();
+// Returns passkey used during pairing with the peer. Several seekers may be
+// pairing at the same time.
+//
+// peer_address - BT address of peer.
+uint32_t nearby_platfrom_GetPairingPassKey(uint64_t peer_address);
 
 // Provides the passkey received from the remote party.
 // The system should compare local and remote party and accept/decline pairing
 // request accordingly.
 //
-// passkey - Passkey
-void nearby_platform_SetRemotePasskey(uint32_t passkey);
+// peer_address - BT address of peer.
+// passkey      - Passkey
+void nearby_platform_SetRemotePasskey(uint64_t peer_address, uint32_t passkey);
 
 // Sends a pairing request to the Seeker
 //
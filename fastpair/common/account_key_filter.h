@@ -16,6 +16,7 @@
 #define THIRD_PARTY_NEARBY_FASTPAIR_COMMON_ACCOUNT_KEY_FILTER_H_
 
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "fastpair/common/account_key.h"
@@ -38,6 +39,17 @@ class AccountKeyFilter {
   // Return false if `account_key` is definitely not in set.
   bool IsPossiblyInSet(const AccountKey& account_key);
 
+  // Filters are equal if they come from advertisements with the same filter
+  // and salt, which then match the same account keys.
+  friend bool operator==(const AccountKeyFilter& a, const AccountKeyFilter& b) {
+    return a.bit_sets_ == b.bit_sets_ && a.salt_values_ == b.salt_values_;
+  }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const AccountKeyFilter& filter) {
+    return H::combine(std::move(h), filter.bit_sets_, filter.salt_values_);
+  }
+
  private:
   std::vector<uint8_t> bit_sets_;
   std::vector<uint8_t> salt_values_;
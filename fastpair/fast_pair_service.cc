@@ -14,6 +14,7 @@
 
 #include "fastpair/fast_pair_service.h"
 
+#include <filesystem>  // NOLINT(build/c++17)
 #include <memory>
 #include <string>
 #include <utility>
@@ -22,12 +23,14 @@
 #include "absl/strings/str_format.h"
 #include "fastpair/common/fast_pair_prefs.h"
 #include "fastpair/fast_pair_plugin.h"
+#include "fastpair/proto/cache.proto.h"
 #include "fastpair/internal/fast_pair_seeker_impl.h"
 #include "fastpair/repository/fast_pair_repository_impl.h"
 #include "fastpair/server_access/fast_pair_client_impl.h"
 #include "fastpair/server_access/fast_pair_http_notifier.h"
 #include "internal/account/account_manager_impl.h"
 #include "internal/auth/authentication_manager_impl.h"
+#include "internal/data/leveldb_data_set.h"
 #include "internal/flags/nearby_flags.h"
 #include "internal/network/http_client_impl.h"
 #include "internal/platform/device_info_impl.h"
@@ -41,6 +44,8 @@ namespace fastpair {
 
 namespace {
 constexpr char kFastPairPreferencesFilePath[] = "Google/Nearby/FastPair";
+constexpr char kFastPairDeviceMetadataDatabasePath[] =
+    "Google/Nearby/FastPair/device_metadata";
 constexpr FeatureFlags::Flags fast_pair_feature_flags = FeatureFlags::Flags{
     .enable_scan_for_fast_pair_advertisement = true,
     .skip_service_discovery_before_connecting_to_rfcomm = true,
@@ -69,8 +74,12 @@ FastPairService::FastPairService(
       fast_pair_client_(std::make_unique<FastPairClientImpl>(
           authentication_manager_.get(), account_manager_.get(),
           http_client_.get(), &fast_pair_http_notifier_, device_info_.get())),
-      fast_pair_repository_(
-          std::make_unique<FastPairRepositoryImpl>(fast_pair_client_.get())),
+      fast_pair_repository_(std::make_unique<FastPairRepositoryImpl>(
+          fast_pair_client_.get(), account_manager_.get(),
+          std::make_unique<data::LeveldbDataSet<proto::CachedDeviceMetadata>>(
+              (device_info_->GetAppDataPath() /
+               kFastPairDeviceMetadataDatabasePath)
+                  .string()))),
       on_device_destroyed_callback_(
           [this](const FastPairDevice& device) { OnDeviceDestroyed(device); }) {
   NearbyFlags::GetInstance().OverrideBoolFlagValue(
@@ -0,0 +1,152 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fastpair/repository/account_key_index.h"
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "fastpair/common/account_key.h"
+#include "fastpair/common/account_key_filter.h"
+#include "fastpair/proto/data.proto.h"
+#include "fastpair/repository/fast_pair_repository.h"
+#include "internal/platform/logging.h"
+
+namespace nearby {
+namespace fastpair {
+
+namespace {
+// This forget pattern is defined in the Android codebase as FORGET_PREFIX_BYTE
+// and FORGET_PREFIX_LENGTH_IN_BYTES. Currently, those values evaluate to the
+// string of bytes defined below, which is used as the prefix for the sha256
+// field of the device.
+constexpr absl::string_view kForgetPattern = "\xf0\xf0\xf0\xf0";
+
+// For all intents and purposes, a device that has the "Forget pattern" is no
+// longer associated to the user's account, and should be treated as removed.
+bool DoesDeviceHaveForgetPattern(const proto::FastPairDevice& device) {
+  // The device info is modified to have no account key upon removal from
+  // Fast Pair Saved Devices
+  if (device.account_key().empty() ||
+      device.sha256_account_key_public_address().empty()) {
+    return true;
+  }
+
+  // To match Android behavior, we check if the SHA256 of a device begins with
+  // the Forget pattern, defined in Android Fast Pair code. When a device is
+  // forgotten from Android Bluetooth Settings, the SHA256 hash is modified to
+  // contain this pattern.
+  return absl::StartsWith(device.sha256_account_key_public_address(),
+                          kForgetPattern);
+}
+}  // namespace
+
+void AccountKeyIndex::Update(const proto::UserReadDevicesResponse& response) {
+  devices_.clear();
+  remembered_filters_.clear();
+  opt_in_status_ = proto::OptInStatus::OPT_IN_STATUS_UNKNOWN;
+  for (const auto& info : response.fast_pair_info()) {
+    if (info.has_opt_in_status()) {
+      opt_in_status_ = info.opt_in_status();
+    }
+    if (info.has_device()) {
+      AddDevice(info.device());
+    }
+  }
+}
+
+void AccountKeyIndex::AddDevice(const proto::FastPairDevice& device) {
+  RemoveDevice(AccountKey(device.account_key()));
+  SavedDevice saved_device{.device = device};
+  proto::StoredDiscoveryItem item;
+  if (item.ParseFromString(device.discovery_item_bytes())) {
+    saved_device.model_id = item.id();
+  }
+  devices_.push_back(std::move(saved_device));
+}
+
+void AccountKeyIndex::RemoveDevice(const AccountKey& account_key) {
+  remembered_filters_.clear();
+  devices_.erase(
+      std::remove_if(devices_.begin(), devices_.end(),
+                     [&account_key](const SavedDevice& saved_device) {
+                       return saved_device.device.account_key() ==
+                              account_key.GetAsBytes();
+                     }),
+      devices_.end());
+}
+
+std::optional<AccountKeyIndex::Match> AccountKeyIndex::FindMatch(
+    const AccountKeyFilter& filter) {
+  auto it = remembered_filters_.find(filter);
+  if (it != remembered_filters_.end()) {
+    return it->second;
+  }
+  // IsPossiblyInSet() is not const.
+  AccountKeyFilter account_key_filter = filter;
+  std::optional<Match> match;
+  for (const SavedDevice& saved_device : devices_) {
+    AccountKey account_key(saved_device.device.account_key());
+    if (!saved_device.model_id.has_value() ||
+        !account_key_filter.IsPossiblyInSet(account_key)) {
+      continue;
+    }
+    match = Match{.account_key = account_key,
+                  .model_id = *saved_device.model_id};
+    break;
+  }
+  if (remembered_filters_.size() >= kMaxRememberedFilters) {
+    remembered_filters_.clear();
+  }
+  remembered_filters_.emplace(filter, match);
+  return match;
+}
+
+std::vector<proto::FastPairDevice> AccountKeyIndex::GetSavedDevices() const {
+  std::vector<proto::FastPairDevice> saved_devices;
+  for (const SavedDevice& saved_device : devices_) {
+    // We have to check that the devices in Footprints don't use the "forget
+    // pattern" which Android uses in some cases to mark a device as removed
+    // from the user's account.
+    if (!DoesDeviceHaveForgetPattern(saved_device.device)) {
+      saved_devices.push_back(saved_device.device);
+    }
+  }
+  return saved_devices;
+}
+
+bool AccountKeyIndex::IsDeviceSaved(absl::string_view mac_address) const {
+  for (const SavedDevice& saved_device : devices_) {
+    // Checks if the mac address of the device is `mac_address` by checking if
+    // its SHA256 equals SHA256(concat(account key, `mac_address`)).
+    const proto::FastPairDevice& device = saved_device.device;
+    if (DoesDeviceHaveForgetPattern(device)) {
+      continue;
+    }
+    if (device.sha256_account_key_public_address() ==
+        FastPairRepository::GenerateSha256OfAccountKeyAndMacAddress(
+            AccountKey(device.account_key()), mac_address)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace fastpair
+}  // namespace nearby
@@ -0,0 +1,91 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_NEARBY_FASTPAIR_REPOSITORY_ACCOUNT_KEY_INDEX_H_
+#define THIRD_PARTY_NEARBY_FASTPAIR_REPOSITORY_ACCOUNT_KEY_INDEX_H_
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "fastpair/common/account_key.h"
+#include "fastpair/common/account_key_filter.h"
+#include "fastpair/proto/data.proto.h"
+#include "fastpair/proto/enum.proto.h"
+#include "fastpair/proto/fastpair_rpcs.proto.h"
+
+namespace nearby {
+namespace fastpair {
+
+// Local copy of the devices saved to the user's account, so that
+// non-discoverable advertisements can be matched against the user's account
+// keys without a round trip to the backend.
+//
+// Not thread-safe; FastPairRepositoryImpl only uses it on its executor.
+class AccountKeyIndex {
+ public:
+  struct Match {
+    AccountKey account_key;
+    std::string model_id;
+  };
+
+  // Upper bound on the number of filters whose result is remembered. Devices
+  // keep advertising the same filter and salt for minutes, so a handful of
+  // nearby devices only need a few entries.
+  static constexpr int kMaxRememberedFilters = 64;
+
+  // Replaces the saved devices with those of `response`.
+  void Update(const proto::UserReadDevicesResponse& response);
+
+  // Adds `device`, or replaces the saved device with the same account key.
+  void AddDevice(const proto::FastPairDevice& device);
+
+  // Removes the saved device with `account_key`.
+  void RemoveDevice(const AccountKey& account_key);
+
+  // Returns the saved devices, without those removed from the account.
+  std::vector<proto::FastPairDevice> GetSavedDevices() const;
+
+  // Returns the opt-in status of the last Update().
+  proto::OptInStatus opt_in_status() const { return opt_in_status_; }
+
+  // Returns the saved device that possibly matches `filter`, or std::nullopt
+  // if none does.
+  std::optional<Match> FindMatch(const AccountKeyFilter& filter);
+
+  // Returns true if the device at `mac_address` is saved to the account.
+  bool IsDeviceSaved(absl::string_view mac_address) const;
+
+  int size() const { return devices_.size(); }
+
+ private:
+  struct SavedDevice {
+    proto::FastPairDevice device;
+    // Model id of the parsed discovery item, if it could be parsed.
+    std::optional<std::string> model_id;
+  };
+
+  proto::OptInStatus opt_in_status_ = proto::OptInStatus::OPT_IN_STATUS_UNKNOWN;
+  std::vector<SavedDevice> devices_;
+  // Result of FindMatch() per filter, dropped whenever `devices_` changes.
+  absl::flat_hash_map<AccountKeyFilter, std::optional<Match>>
+      remembered_filters_;
+};
+
+}  // namespace fastpair
+}  // namespace nearby
+
+#endif  // THIRD_PARTY_NEARBY_FASTPAIR_REPOSITORY_ACCOUNT_KEY_INDEX_H_
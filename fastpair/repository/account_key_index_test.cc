@@ -0,0 +1,141 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fastpair/repository/account_key_index.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/string_view.h"
+#include "fastpair/common/account_key.h"
+#include "fastpair/common/account_key_filter.h"
+#include "fastpair/proto/data.proto.h"
+#include "fastpair/proto/enum.proto.h"
+#include "fastpair/proto/fastpair_rpcs.proto.h"
+#include "fastpair/repository/fast_pair_repository.h"
+
+namespace nearby {
+namespace fastpair {
+namespace {
+
+constexpr absl::string_view kModelId = "718C17";
+constexpr absl::string_view kPublicAddress = "20:64:DE:40:F8:93";
+
+// Test data comes from:
+// https://developers.google.com/nearby/fast-pair/specifications/appendix/testcases#test_cases
+const std::vector<uint8_t> kFilter{0x02, 0x0C, 0x80, 0x2A};
+const std::vector<uint8_t> kSalt{0xC7, 0xC8};
+const std::vector<uint8_t> kMatchingAccountKey{
+    0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88,
+    0x99, 0x00, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+const std::vector<uint8_t> kOtherAccountKey{0x11, 0x11, 0x22, 0x22, 0x33, 0x33,
+                                            0x44, 0x44, 0x55, 0x55, 0x66, 0x66,
+                                            0x77, 0x77, 0x88, 0x88};
+
+proto::FastPairDevice CreateDevice(const AccountKey& account_key) {
+  proto::FastPairDevice device;
+  device.set_account_key(std::string(account_key.GetAsBytes()));
+  device.set_sha256_account_key_public_address(
+      FastPairRepository::GenerateSha256OfAccountKeyAndMacAddress(
+          account_key, kPublicAddress));
+  proto::StoredDiscoveryItem item;
+  item.set_id(std::string(kModelId));
+  device.set_discovery_item_bytes(item.SerializeAsString());
+  return device;
+}
+
+proto::UserReadDevicesResponse CreateResponse(
+    const std::vector<AccountKey>& account_keys) {
+  proto::UserReadDevicesResponse response;
+  response.add_fast_pair_info()->set_opt_in_status(
+      proto::OptInStatus::OPT_IN_STATUS_OPTED_IN);
+  for (const AccountKey& account_key : account_keys) {
+    *response.add_fast_pair_info()->mutable_device() =
+        CreateDevice(account_key);
+  }
+  return response;
+}
+
+TEST(AccountKeyIndexTest, FindsDeviceMatchingFilter) {
+  AccountKeyIndex index;
+  AccountKey account_key(kMatchingAccountKey);
+  index.Update(CreateResponse({AccountKey(kOtherAccountKey), account_key}));
+
+  std::optional<AccountKeyIndex::Match> match =
+      index.FindMatch(AccountKeyFilter(kFilter, kSalt));
+
+  ASSERT_TRUE(match.has_value());
+  EXPECT_EQ(match->account_key, account_key);
+  EXPECT_EQ(match->model_id, kModelId);
+  EXPECT_EQ(index.size(), 2);
+  EXPECT_EQ(index.opt_in_status(), proto::OptInStatus::OPT_IN_STATUS_OPTED_IN);
+}
+
+TEST(AccountKeyIndexTest, NoDeviceMatchesFilter) {
+  AccountKeyIndex index;
+  index.Update(CreateResponse({AccountKey(kOtherAccountKey)}));
+
+  EXPECT_FALSE(index.FindMatch(AccountKeyFilter(kFilter, kSalt)).has_value());
+}
+
+TEST(AccountKeyIndexTest, RememberedResultFollowsChanges) {
+  AccountKeyIndex index;
+  AccountKey account_key(kMatchingAccountKey);
+  AccountKeyFilter filter(kFilter, kSalt);
+  index.Update(CreateResponse({}));
+  EXPECT_FALSE(index.FindMatch(filter).has_value());
+
+  index.AddDevice(CreateDevice(account_key));
+  EXPECT_TRUE(index.FindMatch(filter).has_value());
+
+  index.RemoveDevice(account_key);
+  EXPECT_FALSE(index.FindMatch(filter).has_value());
+  EXPECT_EQ(index.size(), 0);
+}
+
+TEST(AccountKeyIndexTest, AddingSameAccountKeyReplacesDevice) {
+  AccountKeyIndex index;
+  AccountKey account_key(kMatchingAccountKey);
+  index.AddDevice(CreateDevice(account_key));
+  index.AddDevice(CreateDevice(account_key));
+
+  EXPECT_EQ(index.size(), 1);
+}
+
+TEST(AccountKeyIndexTest, IsDeviceSaved) {
+  AccountKeyIndex index;
+  index.Update(CreateResponse({AccountKey(kMatchingAccountKey)}));
+
+  EXPECT_TRUE(index.IsDeviceSaved(kPublicAddress));
+  EXPECT_FALSE(index.IsDeviceSaved("11:22:33:44:55:66"));
+}
+
+TEST(AccountKeyIndexTest, ForgottenDeviceIsNotSaved) {
+  AccountKeyIndex index;
+  proto::FastPairDevice device = CreateDevice(AccountKey(kMatchingAccountKey));
+  device.set_sha256_account_key_public_address(
+      absl::HexStringToBytes("f0f0f0f0"));
+  index.AddDevice(device);
+
+  EXPECT_FALSE(index.IsDeviceSaved(kPublicAddress));
+  EXPECT_TRUE(index.GetSavedDevices().empty());
+}
+
+}  // namespace
+}  // namespace fastpair
+}  // namespace nearby
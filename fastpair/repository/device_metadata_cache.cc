@@ -0,0 +1,203 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fastpair/repository/device_metadata_cache.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/synchronization/mutex.h"
+#include "fastpair/common/device_metadata.h"
+#include "fastpair/proto/cache.proto.h"
+#include "internal/data/data_set.h"
+#include "internal/platform/logging.h"
+
+namespace nearby {
+namespace fastpair {
+
+DeviceMetadataCache::DeviceMetadataCache(std::unique_ptr<Store> store)
+    : store_(std::move(store)) {
+  if (store_ != nullptr) {
+    StartLoadingStore();
+  }
+}
+
+const DeviceMetadataCache::Entry* DeviceMetadataCache::Get(
+    absl::string_view hex_model_id) {
+  LoadStore();
+  auto it = entries_.find(hex_model_id);
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+  usage_order_.splice(usage_order_.begin(), usage_order_,
+                      it->second.position);
+  return &it->second.entry;
+}
+
+bool DeviceMetadataCache::IsFresh(const Entry& entry, absl::Time now) {
+  absl::Duration time_to_live =
+      entry.metadata.has_value() ? kTimeToLive : kNotFoundTimeToLive;
+  return now - entry.download_time < time_to_live;
+}
+
+void DeviceMetadataCache::Put(absl::string_view hex_model_id,
+                              const DeviceMetadata& metadata,
+                              absl::Time download_time) {
+  LoadStore();
+  std::vector<std::string> evicted = Insert(
+      hex_model_id, {.metadata = metadata, .download_time = download_time});
+  auto entries_to_save = std::make_unique<Store::KeyEntryVector>();
+  proto::CachedDeviceMetadata cached_metadata;
+  cached_metadata.set_hex_model_id(std::string(hex_model_id));
+  *cached_metadata.mutable_response() = metadata.GetResponse();
+  cached_metadata.set_download_timestamp_millis(
+      absl::ToUnixMillis(download_time));
+  entries_to_save->emplace_back(std::string(hex_model_id),
+                                std::move(cached_metadata));
+  UpdateStore(std::move(entries_to_save), std::move(evicted));
+}
+
+void DeviceMetadataCache::PutNotFound(absl::string_view hex_model_id,
+                                      absl::Time now) {
+  LoadStore();
+  auto it = entries_.find(hex_model_id);
+  if (it != entries_.end() && it->second.entry.metadata.has_value()) {
+    return;
+  }
+  UpdateStore(/*entries_to_save=*/nullptr,
+              Insert(hex_model_id, {.download_time = now}));
+}
+
+void DeviceMetadataCache::StartLoadingStore() {
+  store_->Initialize([this](data::InitStatus status) {
+    if (status != data::InitStatus::kOK) {
+      NEARBY_LOGS(WARNING) << __func__
+                           << ": Failed to open the device metadata store.";
+      absl::MutexLock lock(&mutex_);
+      store_failed_ = true;
+      store_load_finished_ = true;
+      return;
+    }
+    store_->LoadEntries(
+        [this](bool success,
+               std::unique_ptr<std::vector<proto::CachedDeviceMetadata>>
+                   entries) {
+          absl::MutexLock lock(&mutex_);
+          store_load_finished_ = true;
+          if (!success) {
+            NEARBY_LOGS(WARNING)
+                << __func__ << ": Failed to load the device metadata store.";
+            return;
+          }
+          loaded_entries_ = std::move(entries);
+        });
+  });
+}
+
+void DeviceMetadataCache::LoadStore() {
+  if (store_ == nullptr) {
+    return;
+  }
+  std::unique_ptr<std::vector<proto::CachedDeviceMetadata>> loaded_entries;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (!initial_load_awaited_) {
+      initial_load_awaited_ = true;
+      if (!mutex_.AwaitWithTimeout(absl::Condition(&store_load_finished_),
+                                   kInitialLoadTimeout)) {
+        NEARBY_LOGS(WARNING)
+            << __func__ << ": The device metadata store is still loading.";
+      }
+    }
+    loaded_entries = std::move(loaded_entries_);
+  }
+  if (loaded_entries != nullptr) {
+    OnStoreLoaded(*loaded_entries);
+  }
+}
+
+void DeviceMetadataCache::OnStoreLoaded(
+    const std::vector<proto::CachedDeviceMetadata>& cached_entries) {
+  std::vector<std::string> evicted;
+  for (const proto::CachedDeviceMetadata& cached_metadata : cached_entries) {
+    // Metadata downloaded while the store was loading is more recent.
+    if (entries_.contains(cached_metadata.hex_model_id())) {
+      continue;
+    }
+    for (std::string& model_id : Insert(
+             cached_metadata.hex_model_id(),
+             {.metadata = DeviceMetadata(cached_metadata.response()),
+              .download_time = absl::FromUnixMillis(
+                  cached_metadata.download_timestamp_millis())})) {
+      evicted.push_back(std::move(model_id));
+    }
+  }
+  NEARBY_LOGS(INFO) << __func__ << ": Loaded " << cached_entries.size()
+                    << " device models.";
+  UpdateStore(/*entries_to_save=*/nullptr, std::move(evicted));
+}
+
+std::vector<std::string> DeviceMetadataCache::Insert(
+    absl::string_view hex_model_id, Entry entry) {
+  auto it = entries_.find(hex_model_id);
+  if (it != entries_.end()) {
+    it->second.entry = std::move(entry);
+    usage_order_.splice(usage_order_.begin(), usage_order_,
+                        it->second.position);
+    return {};
+  }
+  usage_order_.push_front(std::string(hex_model_id));
+  entries_.emplace(hex_model_id,
+                   Node{.entry = std::move(entry),
+                        .position = usage_order_.begin()});
+  std::vector<std::string> evicted;
+  while (entries_.size() > kMaxEntries) {
+    entries_.erase(usage_order_.back());
+    evicted.push_back(std::move(usage_order_.back()));
+    usage_order_.pop_back();
+  }
+  return evicted;
+}
+
+void DeviceMetadataCache::UpdateStore(
+    std::unique_ptr<Store::KeyEntryVector> entries_to_save,
+    std::vector<std::string> keys_to_remove) {
+  if (store_ == nullptr ||
+      (entries_to_save == nullptr && keys_to_remove.empty())) {
+    return;
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    if (store_failed_) {
+      return;
+    }
+  }
+  store_->UpdateEntries(
+      entries_to_save != nullptr ? std::move(entries_to_save)
+                                 : std::make_unique<Store::KeyEntryVector>(),
+      std::make_unique<std::vector<std::string>>(std::move(keys_to_remove)),
+      [](bool success) {
+        if (!success) {
+          NEARBY_LOGS(WARNING)
+              << "Failed to update the device metadata store.";
+        }
+      });
+}
+
+}  // namespace fastpair
+}  // namespace nearby
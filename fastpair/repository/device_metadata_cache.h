@@ -0,0 +1,132 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_NEARBY_FASTPAIR_REPOSITORY_DEVICE_METADATA_CACHE_H_
+#define THIRD_PARTY_NEARBY_FASTPAIR_REPOSITORY_DEVICE_METADATA_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "fastpair/common/device_metadata.h"
+#include "fastpair/proto/cache.proto.h"
+#include "internal/data/data_set.h"
+
+namespace nearby {
+namespace fastpair {
+
+// Least recently used cache of the metadata of device models, optionally
+// backed by a persistent store so that it survives restarts.
+//
+// Models the server does not know are remembered too, for a shorter time and
+// in memory only.
+//
+// Not thread-safe; FastPairRepositoryImpl only uses it on its executor. The
+// store may invoke its callbacks on any thread: what they return is handed
+// over under a lock and only applied by the next call to the cache.
+class DeviceMetadataCache {
+ public:
+  using Store = data::DataSet<proto::CachedDeviceMetadata>;
+
+  // Upper bound on the number of models kept in memory and in the store.
+  static constexpr int kMaxEntries = 64;
+  // How long downloaded metadata is used before it is downloaded again.
+  static constexpr absl::Duration kTimeToLive = absl::Hours(24);
+  // How long a model unknown to the server is not looked up again.
+  static constexpr absl::Duration kNotFoundTimeToLive = absl::Minutes(30);
+  // How long the first call to the cache waits for the store to be read.
+  static constexpr absl::Duration kInitialLoadTimeout =
+      absl::Milliseconds(100);
+
+  struct Entry {
+    // Unset if the server does not know the model.
+    std::optional<DeviceMetadata> metadata;
+    absl::Time download_time;
+  };
+
+  // `store` may be null, in which case nothing is persisted. The store is read
+  // right away, and the first call to the cache waits up to
+  // kInitialLoadTimeout for it, so that the first lookup after a restart is
+  // served from the store. Models it returns later are only added if they are
+  // not already cached.
+  explicit DeviceMetadataCache(std::unique_ptr<Store> store = nullptr);
+
+  // Returns the entry of `hex_model_id`, or nullptr if there is none. The
+  // entry becomes the most recently used one. The pointer is valid until the
+  // cache is next modified.
+  const Entry* Get(absl::string_view hex_model_id);
+
+  // Returns true if `entry` is recent enough at `now` to be used without
+  // asking the server again.
+  static bool IsFresh(const Entry& entry, absl::Time now);
+
+  // Adds or replaces the metadata of `hex_model_id`, and persists it.
+  void Put(absl::string_view hex_model_id, const DeviceMetadata& metadata,
+           absl::Time download_time);
+
+  // Remembers that the server does not know `hex_model_id`. Metadata already
+  // cached for the model is kept.
+  void PutNotFound(absl::string_view hex_model_id, absl::Time now);
+
+  int size() const { return entries_.size(); }
+
+ private:
+  struct Node {
+    Entry entry;
+    std::list<std::string>::iterator position;
+  };
+
+  // Opens the store and reads its entries.
+  void StartLoadingStore();
+  // Applies the entries the store has returned since the last call. The first
+  // call waits for them up to kInitialLoadTimeout.
+  void LoadStore();
+  void OnStoreLoaded(
+      const std::vector<proto::CachedDeviceMetadata>& cached_entries);
+  // Adds or replaces the entry of `hex_model_id`, evicting the least recently
+  // used entries beyond kMaxEntries. Returns the evicted model ids.
+  std::vector<std::string> Insert(absl::string_view hex_model_id,
+                                  Entry entry);
+  void UpdateStore(std::unique_ptr<Store::KeyEntryVector> entries_to_save,
+                   std::vector<std::string> keys_to_remove);
+
+  bool initial_load_awaited_ = false;
+  absl::Mutex mutex_;
+  // Set once the store has returned its entries, or failed to.
+  bool store_load_finished_ ABSL_GUARDED_BY(mutex_) = false;
+  // Set if the store cannot be opened; nothing is written to it after.
+  // Writes made while it is opening are expected to be queued by the store.
+  bool store_failed_ ABSL_GUARDED_BY(mutex_) = false;
+  // Entries read from the store, not applied to the cache yet.
+  std::unique_ptr<std::vector<proto::CachedDeviceMetadata>> loaded_entries_
+      ABSL_GUARDED_BY(mutex_);
+  // Model ids, from the most to the least recently used.
+  std::list<std::string> usage_order_;
+  absl::flat_hash_map<std::string, Node> entries_;
+  // Declared last, so that the callbacks it still has to invoke when it is
+  // destroyed find the rest of the cache alive.
+  std::unique_ptr<Store> store_;
+};
+
+}  // namespace fastpair
+}  // namespace nearby
+
+#endif  // THIRD_PARTY_NEARBY_FASTPAIR_REPOSITORY_DEVICE_METADATA_CACHE_H_
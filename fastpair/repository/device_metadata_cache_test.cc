@@ -0,0 +1,242 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fastpair/repository/device_metadata_cache.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "fastpair/common/device_metadata.h"
+#include "fastpair/proto/cache.proto.h"
+#include "fastpair/proto/fastpair_rpcs.proto.h"
+#include "internal/data/data_set.h"
+
+namespace nearby {
+namespace fastpair {
+namespace {
+
+constexpr absl::string_view kHexModelId = "718C17";
+constexpr absl::string_view kDeviceName = "Test Device";
+
+// Store of entries kept in `entries`, which outlives the store. If
+// `load_delay` is set, loaded entries are returned that much later, from
+// another thread, as a store doing its work on another thread would.
+class FakeStore : public DeviceMetadataCache::Store {
+ public:
+  explicit FakeStore(
+      std::map<std::string, proto::CachedDeviceMetadata>* entries,
+      absl::Duration load_delay = absl::ZeroDuration())
+      : entries_(entries), load_delay_(load_delay) {}
+  ~FakeStore() override {
+    if (load_thread_.joinable()) {
+      load_thread_.join();
+    }
+  }
+
+  void Initialize(
+      absl::AnyInvocable<void(data::InitStatus) &&> callback) override {
+    std::move(callback)(data::InitStatus::kOK);
+  }
+  void LoadEntries(
+      absl::AnyInvocable<
+          void(bool, std::unique_ptr<std::vector<proto::CachedDeviceMetadata>>)
+              &&>
+          callback) override {
+    auto entries = std::make_unique<std::vector<proto::CachedDeviceMetadata>>();
+    for (const auto& [key, entry] : *entries_) {
+      entries->push_back(entry);
+    }
+    if (load_delay_ > absl::ZeroDuration()) {
+      load_thread_ = std::thread([load_delay = load_delay_,
+                                  callback = std::move(callback),
+                                  entries = std::move(entries)]() mutable {
+        absl::SleepFor(load_delay);
+        std::move(callback)(true, std::move(entries));
+      });
+      return;
+    }
+    std::move(callback)(true, std::move(entries));
+  }
+  void UpdateEntries(std::unique_ptr<KeyEntryVector> entries_to_save,
+                     std::unique_ptr<std::vector<std::string>> keys_to_remove,
+                     absl::AnyInvocable<void(bool) &&> callback) override {
+    for (auto& [key, entry] : *entries_to_save) {
+      (*entries_)[key] = std::move(entry);
+    }
+    for (const std::string& key : *keys_to_remove) {
+      entries_->erase(key);
+    }
+    std::move(callback)(true);
+  }
+  void Destroy(absl::AnyInvocable<void(bool) &&> callback) override {
+    entries_->clear();
+    std::move(callback)(true);
+  }
+
+ private:
+  std::map<std::string, proto::CachedDeviceMetadata>* entries_;
+  absl::Duration load_delay_;
+  std::thread load_thread_;
+};
+
+DeviceMetadata CreateMetadata(absl::string_view name) {
+  proto::GetObservedDeviceResponse response;
+  response.mutable_device()->set_name(std::string(name));
+  return DeviceMetadata(response);
+}
+
+class DeviceMetadataCacheTest : public ::testing::Test {
+ protected:
+  absl::Time now_ = absl::FromUnixSeconds(1700000000);
+};
+
+TEST_F(DeviceMetadataCacheTest, GetReturnsPutMetadata) {
+  DeviceMetadataCache cache;
+  EXPECT_EQ(cache.Get(kHexModelId), nullptr);
+
+  cache.Put(kHexModelId, CreateMetadata(kDeviceName), now_);
+
+  const DeviceMetadataCache::Entry* entry = cache.Get(kHexModelId);
+  ASSERT_NE(entry, nullptr);
+  ASSERT_TRUE(entry->metadata.has_value());
+  EXPECT_EQ(entry->metadata->GetDetails().name(), kDeviceName);
+  EXPECT_TRUE(DeviceMetadataCache::IsFresh(*entry, now_));
+}
+
+TEST_F(DeviceMetadataCacheTest, EntryExpires) {
+  DeviceMetadataCache cache;
+  cache.Put(kHexModelId, CreateMetadata(kDeviceName), now_);
+  const DeviceMetadataCache::Entry* entry = cache.Get(kHexModelId);
+
+  ASSERT_NE(entry, nullptr);
+  EXPECT_TRUE(DeviceMetadataCache::IsFresh(
+      *entry, now_ + DeviceMetadataCache::kTimeToLive - absl::Seconds(1)));
+  EXPECT_FALSE(DeviceMetadataCache::IsFresh(
+      *entry, now_ + DeviceMetadataCache::kTimeToLive));
+}
+
+TEST_F(DeviceMetadataCacheTest, NotFoundExpiresSooner) {
+  DeviceMetadataCache cache;
+  cache.PutNotFound(kHexModelId, now_);
+  const DeviceMetadataCache::Entry* entry = cache.Get(kHexModelId);
+
+  ASSERT_NE(entry, nullptr);
+  EXPECT_FALSE(entry->metadata.has_value());
+  EXPECT_TRUE(DeviceMetadataCache::IsFresh(*entry, now_));
+  EXPECT_FALSE(DeviceMetadataCache::IsFresh(
+      *entry, now_ + DeviceMetadataCache::kNotFoundTimeToLive));
+}
+
+TEST_F(DeviceMetadataCacheTest, NotFoundKeepsDownloadedMetadata) {
+  DeviceMetadataCache cache;
+  cache.Put(kHexModelId, CreateMetadata(kDeviceName), now_);
+  cache.PutNotFound(kHexModelId, now_ + absl::Hours(48));
+
+  const DeviceMetadataCache::Entry* entry = cache.Get(kHexModelId);
+  ASSERT_NE(entry, nullptr);
+  EXPECT_TRUE(entry->metadata.has_value());
+}
+
+TEST_F(DeviceMetadataCacheTest, EvictsLeastRecentlyUsed) {
+  DeviceMetadataCache cache;
+  for (int i = 0; i < DeviceMetadataCache::kMaxEntries; ++i) {
+    cache.Put(absl::StrCat(i), CreateMetadata(kDeviceName), now_);
+  }
+  // Model "0" is now the most recently used one.
+  ASSERT_NE(cache.Get("0"), nullptr);
+
+  cache.Put(kHexModelId, CreateMetadata(kDeviceName), now_);
+
+  EXPECT_EQ(cache.size(), DeviceMetadataCache::kMaxEntries);
+  EXPECT_NE(cache.Get("0"), nullptr);
+  EXPECT_EQ(cache.Get("1"), nullptr);
+  EXPECT_NE(cache.Get(kHexModelId), nullptr);
+}
+
+TEST_F(DeviceMetadataCacheTest, MetadataSurvivesRestart) {
+  std::map<std::string, proto::CachedDeviceMetadata> stored_entries;
+  {
+    DeviceMetadataCache cache(std::make_unique<FakeStore>(&stored_entries));
+    cache.Put(kHexModelId, CreateMetadata(kDeviceName), now_);
+    cache.PutNotFound("000000", now_);
+  }
+  // Models unknown to the server are not persisted.
+  EXPECT_EQ(stored_entries.size(), 1);
+
+  DeviceMetadataCache cache(std::make_unique<FakeStore>(&stored_entries));
+  const DeviceMetadataCache::Entry* entry = cache.Get(kHexModelId);
+
+  ASSERT_NE(entry, nullptr);
+  ASSERT_TRUE(entry->metadata.has_value());
+  EXPECT_EQ(entry->metadata->GetDetails().name(), kDeviceName);
+  EXPECT_EQ(entry->download_time, now_);
+  EXPECT_EQ(cache.Get("000000"), nullptr);
+}
+
+TEST_F(DeviceMetadataCacheTest, EvictedMetadataIsRemovedFromStore) {
+  std::map<std::string, proto::CachedDeviceMetadata> stored_entries;
+  DeviceMetadataCache cache(std::make_unique<FakeStore>(&stored_entries));
+  for (int i = 0; i <= DeviceMetadataCache::kMaxEntries; ++i) {
+    cache.Put(absl::StrCat(i), CreateMetadata(kDeviceName), now_);
+  }
+
+  EXPECT_EQ(stored_entries.size(), DeviceMetadataCache::kMaxEntries);
+  EXPECT_EQ(stored_entries.count("0"), 0);
+}
+
+TEST_F(DeviceMetadataCacheTest, FirstGetWaitsForStoreToLoad) {
+  std::map<std::string, proto::CachedDeviceMetadata> stored_entries;
+  {
+    DeviceMetadataCache cache(std::make_unique<FakeStore>(&stored_entries));
+    cache.Put(kHexModelId, CreateMetadata(kDeviceName), now_);
+  }
+
+  DeviceMetadataCache cache(std::make_unique<FakeStore>(
+      &stored_entries, DeviceMetadataCache::kInitialLoadTimeout / 4));
+  const DeviceMetadataCache::Entry* entry = cache.Get(kHexModelId);
+
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->download_time, now_);
+}
+
+TEST_F(DeviceMetadataCacheTest, EntriesLoadedLaterAreApplied) {
+  std::map<std::string, proto::CachedDeviceMetadata> stored_entries;
+  {
+    DeviceMetadataCache cache(std::make_unique<FakeStore>(&stored_entries));
+    cache.Put(kHexModelId, CreateMetadata(kDeviceName), now_);
+  }
+  DeviceMetadataCache cache(std::make_unique<FakeStore>(
+      &stored_entries, DeviceMetadataCache::kInitialLoadTimeout * 3));
+
+  // The first lookup gives up on a store that is too slow.
+  EXPECT_EQ(cache.Get(kHexModelId), nullptr);
+  absl::SleepFor(DeviceMetadataCache::kInitialLoadTimeout * 4);
+
+  const DeviceMetadataCache::Entry* entry = cache.Get(kHexModelId);
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->download_time, now_);
+}
+
+}  // namespace
+}  // namespace fastpair
+}  // namespace nearby
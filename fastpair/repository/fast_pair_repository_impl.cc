@@ -14,6 +14,7 @@
 
 #include "fastpair/repository/fast_pair_repository_impl.h"
 
+#include <algorithm>
 #include <memory>
 #include <optional>
 #include <string>
@@ -21,59 +22,28 @@
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "fastpair/common/device_metadata.h"
 #include "fastpair/proto/data.proto.h"
 #include "fastpair/proto/enum.proto.h"
 #include "fastpair/proto/proto_builder.h"
+#include "fastpair/repository/account_key_index.h"
+#include "internal/platform/implementation/account_manager.h"
 #include "internal/platform/logging.h"
 #include "internal/platform/single_thread_executor.h"
 
 namespace nearby {
 namespace fastpair {
 
-namespace {
-// This forget pattern is defined in the Android codebase as FORGET_PREFIX_BYTE
-// and FORGET_PREFIX_LENGTH_IN_BYTES. Currently, those values evaluate to the
-// string of bytes defined below, which is used as the prefix for the sha256
-// field of the device.
-constexpr absl::string_view kForgetPattern = "\xf0\xf0\xf0\xf0";
-
-// For all intents and purposes, a device that has the "Forget pattern" is no
-// longer associated to the user's account, and should be treated as removed.
-bool DoesDeviceHaveForgetPattern(const proto::FastPairDevice& device) {
-  // The device info is modified to have no account key upon removal from
-  // Fast Pair Saved Devices
-  if (device.account_key().empty() ||
-      device.sha256_account_key_public_address().empty()) {
-    return true;
-  }
-
-  // To match Android behavior, we check if the SHA256 of a device begins with
-  // the Forget pattern, defined in Android Fast Pair code. When a device is
-  // forgotten from Android Bluetooth Settings, the SHA256 hash is modified to
-  // contain this pattern.
-  return (device.sha256_account_key_public_address().compare(
-              0, kForgetPattern.length(), kForgetPattern) == 0);
-}
-
-// Checks if the mac address of a FastPairDevice is the same as the given
-// |mac_address| by checking if the SHA256 from the given |device| equals to
-// SHA256(concat(account_key of |device|, |mac_address|)).
-bool IsDeviceSha256Matched(const proto::FastPairDevice& device,
-                           absl::string_view mac_address) {
-  if (DoesDeviceHaveForgetPattern(device)) {
-    return false;
-  }
-
-  return device.sha256_account_key_public_address() ==
-         FastPairRepository::GenerateSha256OfAccountKeyAndMacAddress(
-             AccountKey(device.account_key()), mac_address);
-}
-}  // namespace
-
-FastPairRepositoryImpl::FastPairRepositoryImpl(FastPairClient* fast_pair_client)
-    : fast_pair_client_(fast_pair_client) {}
+FastPairRepositoryImpl::FastPairRepositoryImpl(
+    FastPairClient* fast_pair_client, AccountManager* account_manager,
+    std::unique_ptr<DeviceMetadataCache::Store> metadata_store)
+    : fast_pair_client_(fast_pair_client),
+      account_manager_(account_manager),
+      metadata_cache_(std::move(metadata_store)) {}
 
 void FastPairRepositoryImpl::AddObserver(Observer* observer) {
   observers_.AddObserver(observer);
@@ -89,6 +59,21 @@ void FastPairRepositoryImpl::GetDeviceMetadata(
   executor_.Execute(
       "Get Device Metadata", [this, hex_model_id = std::string(hex_model_id),
                               callback = std::move(callback)]() mutable {
+        // Requests run one at a time, so concurrent requests for the same
+        // model are served from the cache once the first one is downloaded.
+        absl::Time now = absl::Now();
+        std::optional<DeviceMetadata> cached_metadata;
+        const DeviceMetadataCache::Entry* entry =
+            metadata_cache_.Get(hex_model_id);
+        if (entry != nullptr) {
+          if (DeviceMetadataCache::IsFresh(*entry, now)) {
+            NEARBY_LOGS(INFO)
+                << __func__ << ": Got device metadata from cache.";
+            callback(entry->metadata);
+            return;
+          }
+          cached_metadata = entry->metadata;
+        }
         NEARBY_LOGS(INFO) << __func__ << ": Start to get devic metadata.";
         proto::GetObservedDeviceRequest request;
         int64_t device_id;
@@ -99,15 +84,21 @@ void FastPairRepositoryImpl::GetDeviceMetadata(
             fast_pair_client_->GetObservedDevice(request);
         if (response.ok()) {
           NEARBY_LOGS(WARNING) << "Got GetObservedDeviceResponse from backend.";
-          metadata_cache_[hex_model_id] =
-              std::make_unique<DeviceMetadata>(response.value());
-          // TODO(b/289139378) : save device's metadata in local cache.
-          callback(*metadata_cache_[hex_model_id]);
-        } else {
-          NEARBY_LOGS(WARNING)
-              << "Failed to get GetObservedDeviceResponse from backend.";
+          DeviceMetadata metadata(*response);
+          metadata_cache_.Put(hex_model_id, metadata, now);
+          callback(std::move(metadata));
+          return;
+        }
+        NEARBY_LOGS(WARNING)
+            << "Failed to get GetObservedDeviceResponse from backend.";
+        if (absl::IsNotFound(response.status())) {
+          metadata_cache_.PutNotFound(hex_model_id, now);
           callback(std::nullopt);
+          return;
         }
+        // Expired metadata is better than none while the backend is
+        // unreachable.
+        callback(std::move(cached_metadata));
       });
 }
 
@@ -127,6 +118,7 @@ void FastPairRepositoryImpl::WriteAccountAssociationToFootprints(
         if (response.ok()) {
           NEARBY_LOGS(INFO)
               << __func__ << "Got GetWriteDeviceResponse from backend.";
+          account_key_index_.AddDevice(request.fast_pair_info().device());
           std::move(callback)(absl::OkStatus());
         } else {
           NEARBY_LOGS(WARNING)
@@ -143,7 +135,7 @@ void FastPairRepositoryImpl::DeleteAssociatedDeviceByAccountKey(
   absl::AsciiStrToUpper(&hex_string);
   executor_.Execute(
       "Delete associated device",
-      [this, hex_account_key = std::move(hex_string),
+      [this, account_key, hex_account_key = std::move(hex_string),
        callback = std::move(callback)]() mutable {
         NEARBY_LOGS(INFO)
             << __func__
@@ -156,6 +148,7 @@ void FastPairRepositoryImpl::DeleteAssociatedDeviceByAccountKey(
           if (response->success()) {
             NEARBY_LOGS(INFO)
                 << __func__ << "Successfully deleted associated device.";
+            account_key_index_.RemoveDevice(account_key);
             std::move(callback)(absl::OkStatus());
           } else {
             NEARBY_LOGS(WARNING) << __func__ << "Failed to delete device.";
@@ -175,36 +168,16 @@ void FastPairRepositoryImpl::GetUserSavedDevices() {
   executor_.Execute("Get associated devices", [this]() mutable {
     NEARBY_LOGS(INFO) << __func__
                       << ": Start to get all account associated devices.";
-    proto::UserReadDevicesRequest request;
-    absl::StatusOr<proto::UserReadDevicesResponse> response =
-        fast_pair_client_->UserReadDevices(request);
-    if (!response.ok()) {
-      NEARBY_LOGS(WARNING)
-          << __func__ << "Failed to get UserReadDevicesResponse from backend.";
+    if (!SyncAccountKeyIndex(/*force=*/true).ok()) {
       return;
     }
-    NEARBY_LOGS(INFO) << __func__
-                      << "Got UserReadDevicesResponse from backend.";
-    proto::OptInStatus opt_in_status =
-        proto::OptInStatus::OPT_IN_STATUS_UNKNOWN;
-    std::vector<proto::FastPairDevice> saved_devices;
-    for (const auto& info : response->fast_pair_info()) {
-      if (info.has_opt_in_status()) {
-        opt_in_status = info.opt_in_status();
-      }
-      // We have to check that the devices in Footprints don't use the
-      // "forget pattern" which Android uses in some cases to mark a device
-      // as removed from the user's account.
-      if (!info.has_device() || DoesDeviceHaveForgetPattern(info.device())) {
-        continue;
-      }
-      saved_devices.push_back(info.device());
-    }
+    std::vector<proto::FastPairDevice> saved_devices =
+        account_key_index_.GetSavedDevices();
     NEARBY_LOGS(INFO) << __func__ << ": Got " << saved_devices.size()
                       << " saved devices.";
-    // TODO(b/289139378) : save device's in local cache.
     for (auto& observer : observers_.GetObservers()) {
-      observer->OnGetUserSavedDevices(opt_in_status, saved_devices);
+      observer->OnGetUserSavedDevices(account_key_index_.opt_in_status(),
+                                      saved_devices);
     }
   });
 }
@@ -218,25 +191,14 @@ void FastPairRepositoryImpl::CheckIfAssociatedWithCurrentAccount(
                                                  callback)]() mutable {
     NEARBY_LOGS(INFO) << __func__
                       << ": Start to check if associated with current account.";
-    proto::UserReadDevicesRequest request;
-    absl::StatusOr<proto::UserReadDevicesResponse> response =
-        fast_pair_client_->UserReadDevices(request);
-    if (response.ok()) {
-      for (const auto& info : response->fast_pair_info()) {
-        if (!info.has_device()) {
-          continue;
-        }
-        AccountKey account_key(info.device().account_key());
-        if (!account_key_filter.IsPossiblyInSet(account_key)) {
-          continue;
-        }
-        proto::StoredDiscoveryItem device;
-        if (device.ParseFromString(info.device().discovery_item_bytes())) {
-          NEARBY_LOGS(INFO)
-              << "Account key matched with a paired device: " << device.title();
-          std::move(callback)(account_key, device.id());
-          return;
-        }
+    if (SyncAccountKeyIndex(/*force=*/false).ok()) {
+      std::optional<AccountKeyIndex::Match> match =
+          account_key_index_.FindMatch(account_key_filter);
+      if (match.has_value()) {
+        NEARBY_LOGS(INFO) << "Account key matched with a paired device: "
+                          << match->model_id;
+        std::move(callback)(match->account_key, match->model_id);
+        return;
       }
     }
     NEARBY_LOGS(INFO) << "Account key does not match any paired devices.";
@@ -252,30 +214,83 @@ void FastPairRepositoryImpl::IsDeviceSavedToAccount(
        callback = std::move(callback)]() mutable {
         NEARBY_LOGS(INFO) << __func__
                           << ": Start to check is device saved to account.";
-        proto::UserReadDevicesRequest request;
-        absl::StatusOr<proto::UserReadDevicesResponse> response =
-            fast_pair_client_->UserReadDevices(request);
-        if (!response.ok()) {
-          NEARBY_LOGS(WARNING)
-              << __func__
-              << "Failed to get UserDeleteDeviceResponse from backend.";
-          std::move(callback)(response.status());
+        absl::Status status = SyncAccountKeyIndex(/*force=*/false);
+        if (!status.ok()) {
+          std::move(callback)(status);
           return;
         }
-        for (const auto& info : response->fast_pair_info()) {
-          if (info.has_device() &&
-              IsDeviceSha256Matched(info.device(), mac_address)) {
-            NEARBY_LOGS(VERBOSE)
-                << __func__ << ": found a SHA256 match for device at address = "
-                << mac_address;
-            std::move(callback)(absl::OkStatus());
-            return;
-          }
+        if (account_key_index_.IsDeviceSaved(mac_address)) {
+          NEARBY_LOGS(VERBOSE)
+              << __func__ << ": found a SHA256 match for device at address = "
+              << mac_address;
+          std::move(callback)(absl::OkStatus());
+          return;
         }
         std::move(callback)(absl::NotFoundError("Device " + mac_address +
                                                 " is not saved to account."));
       });
 }
 
+absl::Status FastPairRepositoryImpl::SyncAccountKeyIndex(bool force) {
+  std::optional<AccountManager::Account> account =
+      account_manager_->GetCurrentAccount();
+  if (!account.has_value()) {
+    NEARBY_LOGS(INFO) << __func__ << ": No account is signed in.";
+    ClearAccountKeyIndex();
+    index_account_id_.clear();
+    return absl::FailedPreconditionError("No account is signed in.");
+  }
+  if (account->id != index_account_id_) {
+    ClearAccountKeyIndex();
+    index_account_id_ = account->id;
+  }
+
+  absl::Time now = absl::Now();
+  if (!force && last_sync_time_.has_value() &&
+      now - *last_sync_time_ < kSavedDevicesSyncInterval) {
+    return absl::OkStatus();
+  }
+  // Keeps a backend that is down, or an account that can't read its devices,
+  // from being asked again for every advertisement.
+  if (!force && last_failed_sync_time_.has_value() &&
+      now - *last_failed_sync_time_ < sync_retry_delay_) {
+    return last_sync_time_.has_value() ? absl::OkStatus() : last_sync_error_;
+  }
+  proto::UserReadDevicesRequest request;
+  absl::StatusOr<proto::UserReadDevicesResponse> response =
+      fast_pair_client_->UserReadDevices(request);
+  if (!response.ok()) {
+    NEARBY_LOGS(WARNING) << __func__
+                         << ": Failed to get UserReadDevicesResponse from "
+                            "backend.";
+    if (absl::IsUnauthenticated(response.status()) ||
+        absl::IsPermissionDenied(response.status())) {
+      // The saved devices may no longer belong to whoever is signed in.
+      ClearAccountKeyIndex();
+    } else if (last_failed_sync_time_.has_value()) {
+      sync_retry_delay_ =
+          std::min(sync_retry_delay_ * 2, kSavedDevicesSyncInterval);
+    }
+    last_failed_sync_time_ = now;
+    last_sync_error_ = response.status();
+    // Keeps matching against the saved devices that were last read.
+    return last_sync_time_.has_value() ? absl::OkStatus() : response.status();
+  }
+  NEARBY_LOGS(INFO) << __func__
+                    << ": Got UserReadDevicesResponse from backend.";
+  account_key_index_.Update(*response);
+  last_sync_time_ = now;
+  last_failed_sync_time_.reset();
+  sync_retry_delay_ = kSavedDevicesSyncRetryDelay;
+  return absl::OkStatus();
+}
+
+void FastPairRepositoryImpl::ClearAccountKeyIndex() {
+  account_key_index_ = AccountKeyIndex();
+  last_sync_time_.reset();
+  last_failed_sync_time_.reset();
+  sync_retry_delay_ = kSavedDevicesSyncRetryDelay;
+}
+
 }  // namespace fastpair
 }  // namespace nearby
@@ -16,13 +16,19 @@
 #define THIRD_PARTY_NEARBY_FASTPAIR_REPOSITORY_FAST_PAIR_REPOSITORY_IMPL_H_
 
 #include <memory>
+#include <optional>
 #include <string>
 
+#include "absl/status/status.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "fastpair/common/device_metadata.h"
+#include "fastpair/repository/account_key_index.h"
+#include "fastpair/repository/device_metadata_cache.h"
 #include "fastpair/repository/fast_pair_repository.h"
 #include "fastpair/server_access/fast_pair_client.h"
 #include "internal/base/observer_list.h"
+#include "internal/platform/implementation/account_manager.h"
 #include "internal/platform/single_thread_executor.h"
 
 namespace nearby {
@@ -30,7 +36,21 @@ namespace fastpair {
 
 class FastPairRepositoryImpl : public FastPairRepository {
  public:
-  explicit FastPairRepositoryImpl(FastPairClient* fast_pair_client);
+  // How long the local copy of the user's saved devices is used before it is
+  // read again from the backend.
+  static constexpr absl::Duration kSavedDevicesSyncInterval =
+      absl::Minutes(30);
+  // How long a failed read of the user's saved devices is not retried. The
+  // delay doubles with each failure in a row, up to kSavedDevicesSyncInterval.
+  static constexpr absl::Duration kSavedDevicesSyncRetryDelay =
+      absl::Minutes(1);
+
+  // The saved devices are those of the current account of `account_manager`.
+  // `metadata_store` persists downloaded device metadata across restarts; it
+  // may be null.
+  FastPairRepositoryImpl(
+      FastPairClient* fast_pair_client, AccountManager* account_manager,
+      std::unique_ptr<DeviceMetadataCache::Store> metadata_store = nullptr);
 
   FastPairRepositoryImpl(const FastPairRepositoryImpl&) = delete;
   FastPairRepositoryImpl& operator=(const FastPairRepositoryImpl&) = delete;
@@ -58,12 +78,33 @@ class FastPairRepositoryImpl : public FastPairRepository {
                               OperationCallback callback) override;
 
  private:
+  // Reads the user's saved devices from the backend into the account key
+  // index. Unless `force` is set, does nothing while the index is recent, or
+  // while a failed read is backed off. Drops the index of another account, and
+  // drops it when no account is signed in or the backend rejects the
+  // credentials. Returns an error if there is no index for the current
+  // account. Runs on executor_.
+  absl::Status SyncAccountKeyIndex(bool force);
+  // Drops the saved devices and the state of their last read.
+  void ClearAccountKeyIndex();
+
   // A thread for running blocking tasks.
   SingleThreadExecutor executor_;
   FastPairClient* fast_pair_client_;
-  absl::flat_hash_map<std::string, std::unique_ptr<DeviceMetadata>>
-      metadata_cache_;
+  AccountManager* account_manager_;
+  // Only accessed on executor_.
+  DeviceMetadataCache metadata_cache_;
   ObserverList<FastPairRepository::Observer> observers_;
+  // Only accessed on executor_.
+  AccountKeyIndex account_key_index_;
+  // Account whose saved devices are in `account_key_index_`.
+  std::string index_account_id_;
+  std::optional<absl::Time> last_sync_time_;
+  // Time and error of the last failed read, and how long to wait before the
+  // next one.
+  std::optional<absl::Time> last_failed_sync_time_;
+  absl::Status last_sync_error_;
+  absl::Duration sync_retry_delay_ = kSavedDevicesSyncRetryDelay;
 };
 }  // namespace fastpair
 }  // namespace nearby
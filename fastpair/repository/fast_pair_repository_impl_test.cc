@@ -14,6 +14,8 @@
 
 #include "fastpair/repository/fast_pair_repository_impl.h"
 
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -29,6 +31,8 @@
 #include "fastpair/proto/proto_builder.h"
 #include "fastpair/server_access/fake_fast_pair_client.h"
 #include "internal/platform/count_down_latch.h"
+#include "internal/platform/implementation/account_manager.h"
+#include "internal/test/fake_account_manager.h"
 
 namespace nearby {
 namespace fastpair {
@@ -43,6 +47,21 @@ constexpr absl::string_view kInitialPairingdescription =
 constexpr absl::string_view kExpectedSha256Hash =
     "6353c0075a35b7d81bb30a6190ab246da4b8c55a6111d387400579133c090ed8";
 constexpr absl::Duration kWaitTimeout = absl::Milliseconds(200);
+constexpr absl::string_view kAccountId = "account_id";
+constexpr absl::string_view kOtherAccountId = "other_account_id";
+constexpr std::array<uint8_t, 4> kMatchingFilter{0x02, 0x0C, 0x80, 0x2A};
+constexpr std::array<uint8_t, 2> kMatchingSalt{0xC7, 0xC8};
+constexpr std::array<uint8_t, 16> kMatchingAccountKey{
+    0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88,
+    0x99, 0x00, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+
+std::unique_ptr<FakeAccountManager> CreateSignedInAccountManager() {
+  auto account_manager = std::make_unique<FakeAccountManager>();
+  AccountManager::Account account;
+  account.id = std::string(kAccountId);
+  account_manager->SetAccount(account);
+  return account_manager;
+}
 
 // A gMock matcher to match proto values. Use this matcher like:
 // request/response proto, expected_proto;
@@ -79,8 +98,10 @@ class FastPairRepositoryObserver : public FastPairRepository::Observer {
 
 TEST(FastPairRepositoryImplTest, MetadataDownloadSuccess) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   // Sets up proto::GetObservedDeviceResponse
   proto::GetObservedDeviceResponse response_proto;
@@ -118,8 +139,10 @@ TEST(FastPairRepositoryImplTest, MetadataDownloadSuccess) {
 
 TEST(FastPairRepositoryImplTest, FailedToDownloadMetadata) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   fake_fast_pair_client.SetGetObservedDeviceResponse(
       absl::InternalError("No response"));
@@ -133,10 +156,73 @@ TEST(FastPairRepositoryImplTest, FailedToDownloadMetadata) {
   latch.Await();
 }
 
+TEST(FastPairRepositoryImplTest, MetadataIsDownloadedOnce) {
+  FakeFastPairClient fake_fast_pair_client;
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
+  proto::GetObservedDeviceResponse response_proto;
+  response_proto.mutable_strings()->set_initial_pairing_description(
+      kInitialPairingdescription);
+  fake_fast_pair_client.SetGetObservedDeviceResponse(response_proto);
+
+  CountDownLatch first_latch(1);
+  fast_pair_repository->GetDeviceMetadata(
+      kHexModelId, [&](std::optional<DeviceMetadata> device_metadata) {
+        EXPECT_TRUE(device_metadata.has_value());
+        first_latch.CountDown();
+      });
+  EXPECT_TRUE(first_latch.Await(kWaitTimeout).result());
+
+  // The backend is not asked again.
+  fake_fast_pair_client.SetGetObservedDeviceResponse(
+      absl::InternalError("No response"));
+  CountDownLatch second_latch(1);
+  fast_pair_repository->GetDeviceMetadata(
+      kHexModelId, [&](std::optional<DeviceMetadata> device_metadata) {
+        ASSERT_TRUE(device_metadata.has_value());
+        EXPECT_THAT(device_metadata->GetResponse(),
+                    MatchesProto(response_proto));
+        second_latch.CountDown();
+      });
+  EXPECT_TRUE(second_latch.Await(kWaitTimeout).result());
+}
+
+TEST(FastPairRepositoryImplTest, UnknownModelIsNotDownloadedAgain) {
+  FakeFastPairClient fake_fast_pair_client;
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
+  fake_fast_pair_client.SetGetObservedDeviceResponse(
+      absl::NotFoundError("Unknown model"));
+
+  CountDownLatch first_latch(1);
+  fast_pair_repository->GetDeviceMetadata(
+      kHexModelId, [&](std::optional<DeviceMetadata> device_metadata) {
+        EXPECT_FALSE(device_metadata.has_value());
+        first_latch.CountDown();
+      });
+  EXPECT_TRUE(first_latch.Await(kWaitTimeout).result());
+
+  fake_fast_pair_client.SetGetObservedDeviceResponse(
+      proto::GetObservedDeviceResponse());
+  CountDownLatch second_latch(1);
+  fast_pair_repository->GetDeviceMetadata(
+      kHexModelId, [&](std::optional<DeviceMetadata> device_metadata) {
+        EXPECT_FALSE(device_metadata.has_value());
+        second_latch.CountDown();
+      });
+  EXPECT_TRUE(second_latch.Await(kWaitTimeout).result());
+}
+
 TEST(FastPairRepositoryImplTest, GetUserSavedDevicesSuccess) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   // Sets up two devices to proto::UserReadDevicesResponse.
   // Adds device 1.
@@ -195,8 +281,10 @@ TEST(FastPairRepositoryImplTest, GetUserSavedDevicesSuccess) {
 
 TEST(FastPairRepositoryImplTest, FailedToGetUserSavedDevices) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   fake_fast_pair_client.SetUserReadDevicesResponse(
       absl::InternalError("No response"));
@@ -213,8 +301,10 @@ TEST(FastPairRepositoryImplTest, FailedToGetUserSavedDevices) {
 
 TEST(FastPairRepositoryImplTest, WriteAccountAssociationToFootprintsSuccess) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   // Sets up proto::UserWriteDeviceResponse.
   proto::UserWriteDeviceResponse response_proto;
@@ -266,8 +356,10 @@ TEST(FastPairRepositoryImplTest, WriteAccountAssociationToFootprintsSuccess) {
 
 TEST(FastPairRepositoryImplTest, FailedToWriteAccountAssociationToFootprints) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   fake_fast_pair_client.SetUserWriteDeviceResponse(
       absl::InternalError("No response"));
@@ -300,8 +392,10 @@ TEST(FastPairRepositoryImplTest, FailedToWriteAccountAssociationToFootprints) {
 
 TEST(FastPairRepositoryImplTest, DeleteAssociatedDeviceByAccountKeySuccess) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   // Sets up proto::UserDeleteDeviceResponse
   proto::UserDeleteDeviceResponse response_proto;
@@ -330,8 +424,10 @@ TEST(FastPairRepositoryImplTest, DeleteAssociatedDeviceByAccountKeySuccess) {
 
 TEST(FastPairRepositoryImplTest, FailedToDeleteAssociatedDeviceWithNoResponse) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   fake_fast_pair_client.SetUserDeleteDeviceResponse(
       absl::InternalError("No response"));
@@ -352,8 +448,10 @@ TEST(FastPairRepositoryImplTest, FailedToDeleteAssociatedDeviceWithNoResponse) {
 
 TEST(FastPairRepositoryImplTest, FailedToDeleteAssociatedDeviceWithError) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   // Sets up proto::UserDeleteDeviceResponse
   proto::UserDeleteDeviceResponse response_proto;
@@ -383,8 +481,10 @@ TEST(FastPairRepositoryImplTest, DeviceAssociatedWithCurrentAccountSuccess) {
                                              0x77, 0x88, 0x99, 0x00, 0xAA, 0xBB,
                                              0xCC, 0xDD, 0xEE, 0xFF};
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   // Sets up two devices to proto::UserReadDevicesResponse.
   proto::UserReadDevicesResponse response_proto;
@@ -436,8 +536,10 @@ TEST(FastPairRepositoryImplTest, DeviceNotAssociatedWithCurrentAccount) {
                                              0x77, 0x77, 0x88, 0x88};
 
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   // Sets up two devices to proto::UserReadDevicesResponse.
   // Adds device 1.
@@ -471,8 +573,10 @@ TEST(FastPairRepositoryImplTest, DeviceNotAssociatedWithCurrentAccount) {
 
 TEST(FastPairRepositoryImplTest, DeviceIsSavedToCurrentAccount) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   // Sets up two devices to proto::UserReadDevicesResponse.
   proto::UserReadDevicesResponse response_proto;
@@ -504,8 +608,10 @@ TEST(FastPairRepositoryImplTest, DeviceIsSavedToCurrentAccount) {
 
 TEST(FastPairRepositoryImplTest, DeviceIsNotSavedToCurrentAccount) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   // Sets up two devices to proto::UserReadDevicesResponse.
   proto::UserReadDevicesResponse response_proto;
@@ -532,8 +638,10 @@ TEST(FastPairRepositoryImplTest, DeviceIsNotSavedToCurrentAccount) {
 
 TEST(FastPairRepositoryImplTest, FailedToCheckDeviceIsSavedToCurrentAccount) {
   FakeFastPairClient fake_fast_pair_client;
-  auto fast_pair_repository =
-      std::make_unique<FastPairRepositoryImpl>(&fake_fast_pair_client);
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
 
   CountDownLatch latch(1);
   fast_pair_repository->IsDeviceSavedToAccount(kPublicAddress,
@@ -543,6 +651,240 @@ TEST(FastPairRepositoryImplTest, FailedToCheckDeviceIsSavedToCurrentAccount) {
                                                });
   latch.Await();
 }
+
+TEST(FastPairRepositoryImplTest, RepeatedChecksReadSavedDevicesOnce) {
+  const std::vector<uint8_t> filter{0x02, 0x0C, 0x80, 0x2A};
+  const std::vector<uint8_t> salt{0xC7, 0xC8};
+  const std::vector<uint8_t> account_key_vec{0x11, 0x22, 0x33, 0x44, 0x55, 0x66,
+                                             0x77, 0x88, 0x99, 0x00, 0xAA, 0xBB,
+                                             0xCC, 0xDD, 0xEE, 0xFF};
+  FakeFastPairClient fake_fast_pair_client;
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
+
+  proto::UserReadDevicesResponse response_proto;
+  FastPairDevice device(kHexModelId, kBleAddress,
+                        Protocol::kFastPairInitialPairing);
+  AccountKey account_key(account_key_vec);
+  device.SetAccountKey(account_key);
+  device.SetPublicAddress(kPublicAddress);
+  proto::GetObservedDeviceResponse get_observed_device_response;
+  DeviceMetadata device_metadata(get_observed_device_response);
+  device.SetMetadata(device_metadata);
+  BuildFastPairInfo(response_proto.add_fast_pair_info(), device);
+  fake_fast_pair_client.SetUserReadDevicesResponse(response_proto);
+
+  CountDownLatch latch(3);
+  for (int i = 0; i < 3; ++i) {
+    AccountKeyFilter account_key_filter(filter, salt);
+    fast_pair_repository->CheckIfAssociatedWithCurrentAccount(
+        account_key_filter, [&](std::optional<AccountKey> cb_account_key,
+                                std::optional<absl::string_view> cb_model_id) {
+          EXPECT_EQ(cb_account_key, account_key);
+          EXPECT_EQ(cb_model_id, kHexModelId);
+          latch.CountDown();
+        });
+  }
+  fast_pair_repository->IsDeviceSavedToAccount(kPublicAddress,
+                                               [&](absl::Status status) {
+                                                 EXPECT_OK(status);
+                                                 latch.CountDown();
+                                               });
+  EXPECT_TRUE(latch.Await(kWaitTimeout).result());
+  EXPECT_EQ(fake_fast_pair_client.read_devices_count(), 1);
+}
+
+TEST(FastPairRepositoryImplTest, WrittenAndDeletedDevicesUpdateSavedDevices) {
+  FakeFastPairClient fake_fast_pair_client;
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
+  fake_fast_pair_client.SetUserReadDevicesResponse(
+      proto::UserReadDevicesResponse());
+  fake_fast_pair_client.SetUserWriteDeviceResponse(
+      proto::UserWriteDeviceResponse());
+  proto::UserDeleteDeviceResponse delete_response;
+  delete_response.set_success(true);
+  fake_fast_pair_client.SetUserDeleteDeviceResponse(delete_response);
+
+  FastPairDevice device(kHexModelId, kBleAddress,
+                        Protocol::kFastPairInitialPairing);
+  AccountKey account_key(absl::HexStringToBytes(kAccountKey));
+  device.SetAccountKey(account_key);
+  device.SetPublicAddress(kPublicAddress);
+  proto::GetObservedDeviceResponse get_observed_device_response;
+  DeviceMetadata device_metadata(get_observed_device_response);
+  device.SetMetadata(device_metadata);
+
+  CountDownLatch not_saved_latch(1);
+  fast_pair_repository->IsDeviceSavedToAccount(
+      kPublicAddress, [&](absl::Status status) {
+        EXPECT_EQ(status.code(), absl::StatusCode::kNotFound);
+        not_saved_latch.CountDown();
+      });
+  EXPECT_TRUE(not_saved_latch.Await(kWaitTimeout).result());
+
+  CountDownLatch saved_latch(2);
+  fast_pair_repository->WriteAccountAssociationToFootprints(
+      device, [&](absl::Status status) {
+        EXPECT_OK(status);
+        saved_latch.CountDown();
+      });
+  fast_pair_repository->IsDeviceSavedToAccount(kPublicAddress,
+                                               [&](absl::Status status) {
+                                                 EXPECT_OK(status);
+                                                 saved_latch.CountDown();
+                                               });
+  EXPECT_TRUE(saved_latch.Await(kWaitTimeout).result());
+
+  CountDownLatch deleted_latch(2);
+  fast_pair_repository->DeleteAssociatedDeviceByAccountKey(
+      account_key, [&](absl::Status status) {
+        EXPECT_OK(status);
+        deleted_latch.CountDown();
+      });
+  fast_pair_repository->IsDeviceSavedToAccount(
+      kPublicAddress, [&](absl::Status status) {
+        EXPECT_EQ(status.code(), absl::StatusCode::kNotFound);
+        deleted_latch.CountDown();
+      });
+  EXPECT_TRUE(deleted_latch.Await(kWaitTimeout).result());
+  EXPECT_EQ(fake_fast_pair_client.read_devices_count(), 1);
+}
+// Saves a device with `kMatchingAccountKey`, which matches `kMatchingFilter`.
+proto::UserReadDevicesResponse CreateSavedDevicesResponse() {
+  proto::UserReadDevicesResponse response_proto;
+  FastPairDevice device(kHexModelId, kBleAddress,
+                        Protocol::kFastPairInitialPairing);
+  device.SetAccountKey(AccountKey(std::vector<uint8_t>(
+      kMatchingAccountKey.begin(), kMatchingAccountKey.end())));
+  device.SetPublicAddress(kPublicAddress);
+  proto::GetObservedDeviceResponse get_observed_device_response;
+  DeviceMetadata device_metadata(get_observed_device_response);
+  device.SetMetadata(device_metadata);
+  BuildFastPairInfo(response_proto.add_fast_pair_info(), device);
+  return response_proto;
+}
+
+// Returns the account key that `kMatchingFilter` is matched with.
+std::optional<AccountKey> FindMatchingAccountKey(
+    FastPairRepositoryImpl& fast_pair_repository) {
+  AccountKeyFilter account_key_filter(
+      std::vector<uint8_t>(kMatchingFilter.begin(), kMatchingFilter.end()),
+      std::vector<uint8_t>(kMatchingSalt.begin(), kMatchingSalt.end()));
+  std::optional<AccountKey> matched_account_key;
+  CountDownLatch latch(1);
+  fast_pair_repository.CheckIfAssociatedWithCurrentAccount(
+      account_key_filter, [&](std::optional<AccountKey> cb_account_key,
+                              std::optional<absl::string_view> cb_model_id) {
+        matched_account_key = cb_account_key;
+        latch.CountDown();
+      });
+  EXPECT_TRUE(latch.Await(kWaitTimeout).result());
+  return matched_account_key;
+}
+
+TEST(FastPairRepositoryImplTest, SignOutDropsSavedDevices) {
+  FakeFastPairClient fake_fast_pair_client;
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
+  fake_fast_pair_client.SetUserReadDevicesResponse(
+      CreateSavedDevicesResponse());
+  ASSERT_TRUE(FindMatchingAccountKey(*fast_pair_repository).has_value());
+
+  account_manager->SetAccount(std::nullopt);
+
+  EXPECT_FALSE(FindMatchingAccountKey(*fast_pair_repository).has_value());
+  CountDownLatch latch(1);
+  fast_pair_repository->IsDeviceSavedToAccount(
+      kPublicAddress, [&](absl::Status status) {
+        EXPECT_EQ(status.code(), absl::StatusCode::kFailedPrecondition);
+        latch.CountDown();
+      });
+  EXPECT_TRUE(latch.Await(kWaitTimeout).result());
+  EXPECT_EQ(fake_fast_pair_client.read_devices_count(), 1);
+}
+
+TEST(FastPairRepositoryImplTest, AccountSwitchReadsSavedDevicesAgain) {
+  FakeFastPairClient fake_fast_pair_client;
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
+  fake_fast_pair_client.SetUserReadDevicesResponse(
+      CreateSavedDevicesResponse());
+  ASSERT_TRUE(FindMatchingAccountKey(*fast_pair_repository).has_value());
+
+  AccountManager::Account other_account;
+  other_account.id = std::string(kOtherAccountId);
+  account_manager->SetAccount(other_account);
+  fake_fast_pair_client.SetUserReadDevicesResponse(
+      proto::UserReadDevicesResponse());
+
+  EXPECT_FALSE(FindMatchingAccountKey(*fast_pair_repository).has_value());
+  EXPECT_EQ(fake_fast_pair_client.read_devices_count(), 2);
+}
+
+TEST(FastPairRepositoryImplTest, UnauthenticatedErrorDropsSavedDevices) {
+  FakeFastPairClient fake_fast_pair_client;
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
+  fake_fast_pair_client.SetUserReadDevicesResponse(
+      CreateSavedDevicesResponse());
+  ASSERT_TRUE(FindMatchingAccountKey(*fast_pair_repository).has_value());
+
+  fake_fast_pair_client.SetUserReadDevicesResponse(
+      absl::UnauthenticatedError("Token revoked"));
+  fast_pair_repository->GetUserSavedDevices();
+
+  EXPECT_FALSE(FindMatchingAccountKey(*fast_pair_repository).has_value());
+  CountDownLatch latch(1);
+  fast_pair_repository->IsDeviceSavedToAccount(
+      kPublicAddress, [&](absl::Status status) {
+        EXPECT_EQ(status.code(), absl::StatusCode::kUnauthenticated);
+        latch.CountDown();
+      });
+  EXPECT_TRUE(latch.Await(kWaitTimeout).result());
+  // The failed read is not retried for each check.
+  EXPECT_EQ(fake_fast_pair_client.read_devices_count(), 2);
+}
+
+TEST(FastPairRepositoryImplTest, FailedReadIsNotRetriedRightAway) {
+  FakeFastPairClient fake_fast_pair_client;
+  std::unique_ptr<FakeAccountManager> account_manager =
+      CreateSignedInAccountManager();
+  auto fast_pair_repository = std::make_unique<FastPairRepositoryImpl>(
+      &fake_fast_pair_client, account_manager.get());
+  fake_fast_pair_client.SetUserReadDevicesResponse(
+      absl::UnavailableError("Backend unavailable"));
+
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_FALSE(FindMatchingAccountKey(*fast_pair_repository).has_value());
+  }
+  CountDownLatch latch(1);
+  fast_pair_repository->IsDeviceSavedToAccount(
+      kPublicAddress, [&](absl::Status status) {
+        EXPECT_EQ(status.code(), absl::StatusCode::kUnavailable);
+        latch.CountDown();
+      });
+  EXPECT_TRUE(latch.Await(kWaitTimeout).result());
+  EXPECT_EQ(fake_fast_pair_client.read_devices_count(), 1);
+
+  // An explicit request still reads the saved devices.
+  fake_fast_pair_client.SetUserReadDevicesResponse(
+      CreateSavedDevicesResponse());
+  fast_pair_repository->GetUserSavedDevices();
+  EXPECT_TRUE(FindMatchingAccountKey(*fast_pair_repository).has_value());
+  EXPECT_EQ(fake_fast_pair_client.read_devices_count(), 2);
+}
+
 }  // namespace
 }  // namespace fastpair
 }  // namespace nearby
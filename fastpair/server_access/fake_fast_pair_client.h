@@ -45,6 +45,8 @@ class FakeFastPairClient : public FastPairClient {
     return read_devices_response_.value();
   }
 
+  int read_devices_count() const { return read_devices_count_; }
+
   proto::UserWriteDeviceRequest& write_device_request() {
     return write_device_request_.value();
   }
@@ -87,6 +89,7 @@ class FakeFastPairClient : public FastPairClient {
   absl::StatusOr<proto::UserReadDevicesResponse> UserReadDevices(
       const proto::UserReadDevicesRequest& request) override {
     read_devices_request_ = request;
+    ++read_devices_count_;
     return read_devices_response_;
   }
 
@@ -112,6 +115,7 @@ class FakeFastPairClient : public FastPairClient {
       get_observer_device_response_;
   std::optional<proto::UserReadDevicesRequest> read_devices_request_;
   absl::StatusOr<proto::UserReadDevicesResponse> read_devices_response_;
+  int read_devices_count_ = 0;
   std::optional<proto::UserWriteDeviceRequest> write_device_request_;
   absl::StatusOr<proto::UserWriteDeviceResponse> write_device_response_;
   std::optional<proto::UserDeleteDeviceRequest> delete_device_request_;
@@ -42,8 +42,8 @@ class DataSet {
   virtual ~DataSet() = default;
 
   // Asynchronously initializes the object, which must have been created by the
-  // DataManager::GetDataSet<T> function. |callback| will be invoked on the
-  // calling thread when complete.
+  // DataManager::GetDataSet<T> function. |callback| can be invoked on an
+  // executor thread when complete.
   virtual void Initialize(absl::AnyInvocable<void(InitStatus) &&> callback) = 0;
 
   // Asynchronously loads all entries from the database and invokes |callback|
@@ -53,8 +53,8 @@ class DataSet {
           callback) = 0;
 
   // Asynchronously saves |entries_to_save| and deletes entries from
-  // |keys_to_remove| from the database. |callback| will be invoked on the
-  // calling thread when complete. |entries_to_save| and |keys_to_remove| must
+  // |keys_to_remove| from the database. |callback| can be invoked on an
+  // executor thread when complete. |entries_to_save| and |keys_to_remove| must
   // be non-null.
   virtual void UpdateEntries(
       std::unique_ptr<KeyEntryVector> entries_to_save,
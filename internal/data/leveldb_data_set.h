@@ -15,6 +15,8 @@
 #ifndef THIRD_PARTY_NEARBY_INTERNAL_DATA_LEVELDB_DATA_SET_H_
 #define THIRD_PARTY_NEARBY_INTERNAL_DATA_LEVELDB_DATA_SET_H_
 
+#include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <type_traits>
@@ -22,26 +24,36 @@
 #include <vector>
 
 #include "absl/functional/any_invocable.h"
+#include "absl/functional/function_ref.h"
 #include "absl/strings/string_view.h"
 #include "third_party/leveldb/include/db.h"
 #include "third_party/leveldb/include/iterator.h"
 #include "third_party/leveldb/include/options.h"
 #include "third_party/leveldb/include/slice.h"
 #include "third_party/leveldb/include/status.h"
+#include "third_party/leveldb/include/write_batch.h"
 #include "internal/data/data_set.h"
 #include "internal/platform/logging.h"
+#include "internal/platform/single_thread_executor.h"
 #include "google/protobuf/message_lite.h"
 
 namespace nearby {
 namespace data {
 // DataSet implementation using leveldb as its persistent storage. Values are
 // serialized and stored in leveldb databases.
+//
+// Database operations run in order on a worker thread owned by the data set,
+// which is also the thread callbacks are invoked on. Callbacks may call the
+// data set again, but must not block. Pending operations complete before the
+// data set is destroyed.
 template <typename T,
           std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value,
                            bool> = true>
 class LeveldbDataSet : public DataSet<T> {
  public:
   using KeyEntryVector = std::vector<std::pair<std::string, T>>;
+  using LoadEntriesWithKeysCallback = absl::AnyInvocable<void(
+      bool, std::unique_ptr<std::vector<std::pair<std::string, T>>>) &&>;
 
   explicit LeveldbDataSet(absl::string_view path) : path_(path) {}
   ~LeveldbDataSet() override = default;
@@ -50,24 +62,51 @@ class LeveldbDataSet : public DataSet<T> {
   void LoadEntries(
       absl::AnyInvocable<void(bool, std::unique_ptr<std::vector<T>>) &&>
           callback) override;
-  void LoadEntriesWithKeys(
-      absl::AnyInvocable<
-          void(bool,
-               std::unique_ptr<std::vector<std::pair<std::string, T>>>) &&>
-          callback);
+  void LoadEntriesWithKeys(LoadEntriesWithKeysCallback callback);
+  // Loads the entries whose key starts with `prefix`, in key order.
+  void LoadEntriesWithPrefix(absl::string_view prefix,
+                             LoadEntriesWithKeysCallback callback);
+  // Loads the entries whose key is in [`start`, `limit`), in key order. An
+  // empty `limit` loads up to the last entry.
+  void LoadEntriesInRange(absl::string_view start, absl::string_view limit,
+                          LoadEntriesWithKeysCallback callback);
+  // Loads all entries in key order, handing them to `on_batch` at most
+  // `batch_size` at a time, so that they never all have to be in memory.
+  // `callback` is invoked after the last batch; on failure, the batches
+  // already delivered are incomplete.
+  void LoadEntriesInBatches(
+      size_t batch_size,
+      absl::AnyInvocable<void(std::unique_ptr<KeyEntryVector>)> on_batch,
+      absl::AnyInvocable<void(bool) &&> callback);
+  // Saves and removes entries in a single atomic write: either all changes
+  // are persisted or none is.
   void UpdateEntries(std::unique_ptr<KeyEntryVector> entries_to_save,
                      std::unique_ptr<std::vector<std::string>> keys_to_remove,
                      absl::AnyInvocable<void(bool) &&> callback) override;
   void Destroy(absl::AnyInvocable<void(bool) &&> callback) override;
 
  private:
+  // Calls `visit` in key order for the entries from `start` on, while
+  // `in_range` returns true for their key. Returns false if the database is
+  // not open or cannot be read.
+  bool ForEachEntry(
+      const leveldb::Slice& start,
+      absl::FunctionRef<bool(const leveldb::Slice&)> in_range,
+      absl::FunctionRef<void(const leveldb::Slice&, T)> visit);
+  void LoadEntriesWithKeysInRange(
+      std::string start,
+      absl::AnyInvocable<bool(const leveldb::Slice&) const> in_range,
+      LoadEntriesWithKeysCallback callback);
   void Serialize(T const& value, std::string& str);
-  void Deserialize(absl::string_view str, T& value);
+  void Deserialize(const leveldb::Slice& slice, T& value);
 
  private:
   std::string path_;
   std::unique_ptr<leveldb::DB> db_ = nullptr;
   InitStatus status_ = InitStatus::kNotInitialized;
+  // Declared last, so that pending operations complete before the database
+  // is closed.
+  SingleThreadExecutor executor_;
 };
 
 template <typename T,
@@ -75,25 +114,28 @@ template <typename T,
               isMessageLite>
 void LeveldbDataSet<T, isMessageLite>::Initialize(
     absl::AnyInvocable<void(InitStatus) &&> callback) {
-  leveldb::Options options;
-  options.create_if_missing = true;
-
-  leveldb::DB* db;
-  leveldb::Status status = leveldb::DB::Open(options, path_, &db);
-  db_ = std::unique_ptr<leveldb::DB>(db);
-
-  if (status.ok()) {
-    status_ = InitStatus::kOK;
-    NEARBY_LOGS(INFO) << "Database is initialized successfully..";
-  } else if (status.IsCorruption() || status.IsIOError()) {
-    status_ = InitStatus::kCorrupt;
-    NEARBY_LOGS(INFO) << "Database is corrupt.";
-
-  } else {
-    status_ = InitStatus::kError;
-    NEARBY_LOGS(INFO) << "Failed to initialize database due to unknown error.";
-  }
-  std::move(callback)(status_);
+  executor_.Execute([this, callback = std::move(callback)]() mutable {
+    leveldb::Options options;
+    options.create_if_missing = true;
+
+    leveldb::DB* db;
+    leveldb::Status status = leveldb::DB::Open(options, path_, &db);
+    db_ = std::unique_ptr<leveldb::DB>(db);
+
+    if (status.ok()) {
+      status_ = InitStatus::kOK;
+      NEARBY_LOGS(INFO) << "Database is initialized successfully..";
+    } else if (status.IsCorruption() || status.IsIOError()) {
+      status_ = InitStatus::kCorrupt;
+      NEARBY_LOGS(INFO) << "Database is corrupt.";
+
+    } else {
+      status_ = InitStatus::kError;
+      NEARBY_LOGS(INFO)
+          << "Failed to initialize database due to unknown error.";
+    }
+    std::move(callback)(status_);
+  });
 }
 
 template <typename T,
@@ -102,63 +144,97 @@ template <typename T,
 void LeveldbDataSet<T, isMessageLite>::LoadEntries(
     absl::AnyInvocable<void(bool, std::unique_ptr<std::vector<T>>) &&>
         callback) {
-  auto result = std::make_unique<std::vector<T>>();
-  if (status_ != InitStatus::kOK) {
-    std::move(callback)(false, std::move(result));
-    return;
-  }
+  executor_.Execute([this, callback = std::move(callback)]() mutable {
+    auto result = std::make_unique<std::vector<T>>();
+    bool success = ForEachEntry(
+        leveldb::Slice(), [](const leveldb::Slice&) { return true; },
+        [&result](const leveldb::Slice&, T value) {
+          result->push_back(std::move(value));
+        });
 
-  std::unique_ptr<leveldb::Iterator> it(
-      db_->NewIterator(leveldb::ReadOptions()));
-
-  for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    T value;
-    Deserialize(it->value().ToString(), value);
-    result->push_back(value);
-  }
-
-  if (it->status().ok()) {
-    NEARBY_LOGS(INFO) << "Loaded " << result->size()
-                      << " entries from database.";
-    std::move(callback)(true, std::move(result));
-  } else {
-    NEARBY_LOGS(INFO) << "Failed to load entries from database.";
-    result->clear();
-    std::move(callback)(false, std::move(result));
-  }
+    if (success) {
+      NEARBY_LOGS(INFO) << "Loaded " << result->size()
+                        << " entries from database.";
+    } else {
+      NEARBY_LOGS(INFO) << "Failed to load entries from database.";
+      result->clear();
+    }
+    std::move(callback)(success, std::move(result));
+  });
 }
 
 template <typename T,
           std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
               isMessageLite>
 void LeveldbDataSet<T, isMessageLite>::LoadEntriesWithKeys(
-    absl::AnyInvocable<
-        void(bool, std::unique_ptr<std::vector<std::pair<std::string, T>>>) &&>
-        callback) {
-  auto result = std::make_unique<std::vector<std::pair<std::string, T>>>();
-  if (status_ != InitStatus::kOK) {
-    std::move(callback)(false, std::move(result));
-    return;
-  }
+    LoadEntriesWithKeysCallback callback) {
+  LoadEntriesWithKeysInRange(
+      std::string(), [](const leveldb::Slice&) { return true; },
+      std::move(callback));
+}
 
-  std::unique_ptr<leveldb::Iterator> it(
-      db_->NewIterator(leveldb::ReadOptions()));
+template <typename T,
+          std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
+              isMessageLite>
+void LeveldbDataSet<T, isMessageLite>::LoadEntriesWithPrefix(
+    absl::string_view prefix, LoadEntriesWithKeysCallback callback) {
+  LoadEntriesWithKeysInRange(
+      std::string(prefix),
+      [prefix = std::string(prefix)](const leveldb::Slice& key) {
+        return key.starts_with(prefix);
+      },
+      std::move(callback));
+}
 
-  for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    T value;
-    Deserialize(it->value().ToString(), value);
-    result->push_back({it->key().ToString(), value});
-  }
+template <typename T,
+          std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
+              isMessageLite>
+void LeveldbDataSet<T, isMessageLite>::LoadEntriesInRange(
+    absl::string_view start, absl::string_view limit,
+    LoadEntriesWithKeysCallback callback) {
+  LoadEntriesWithKeysInRange(
+      std::string(start),
+      [limit = std::string(limit)](const leveldb::Slice& key) {
+        return limit.empty() || key.compare(limit) < 0;
+      },
+      std::move(callback));
+}
 
-  if (it->status().ok()) {
-    NEARBY_LOGS(INFO) << "Loaded " << result->size()
-                      << " entries from database.";
-    std::move(callback)(true, std::move(result));
-  } else {
-    NEARBY_LOGS(INFO) << "Failed to load entries from database.";
-    result->clear();
-    std::move(callback)(false, std::move(result));
-  }
+template <typename T,
+          std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
+              isMessageLite>
+void LeveldbDataSet<T, isMessageLite>::LoadEntriesInBatches(
+    size_t batch_size,
+    absl::AnyInvocable<void(std::unique_ptr<KeyEntryVector>)> on_batch,
+    absl::AnyInvocable<void(bool) &&> callback) {
+  executor_.Execute([this, batch_size = std::max<size_t>(batch_size, 1),
+                     on_batch = std::move(on_batch),
+                     callback = std::move(callback)]() mutable {
+    auto batch = std::make_unique<KeyEntryVector>();
+    batch->reserve(batch_size);
+    size_t count = 0;
+    bool success = ForEachEntry(
+        leveldb::Slice(), [](const leveldb::Slice&) { return true; },
+        [&](const leveldb::Slice& key, T value) {
+          batch->emplace_back(key.ToString(), std::move(value));
+          ++count;
+          if (batch->size() == batch_size) {
+            on_batch(std::move(batch));
+            batch = std::make_unique<KeyEntryVector>();
+            batch->reserve(batch_size);
+          }
+        });
+    if (success && !batch->empty()) {
+      on_batch(std::move(batch));
+    }
+
+    if (success) {
+      NEARBY_LOGS(INFO) << "Loaded " << count << " entries from database.";
+    } else {
+      NEARBY_LOGS(INFO) << "Failed to load entries from database.";
+    }
+    std::move(callback)(success);
+  });
 }
 
 template <typename T,
@@ -169,26 +245,37 @@ void LeveldbDataSet<T, isMessageLite>::UpdateEntries(
     std::unique_ptr<std::vector<std::string>> keys_to_remove,
     absl::AnyInvocable<void(bool) &&> callback) {
   NEARBY_LOGS(INFO) << "UpdateEntries is called.";
-  if (status_ != InitStatus::kOK) {
-    std::move(callback)(false);
-    return;
-  }
+  executor_.Execute([this, entries_to_save = std::move(entries_to_save),
+                     keys_to_remove = std::move(keys_to_remove),
+                     callback = std::move(callback)]() mutable {
+    if (status_ != InitStatus::kOK) {
+      std::move(callback)(false);
+      return;
+    }
 
-  if (entries_to_save != nullptr) {
-    for (const auto& [key, value] : *entries_to_save) {
+    leveldb::WriteBatch batch;
+    if (entries_to_save != nullptr) {
       std::string str;
-      Serialize(value, str);
-      db_->Put(leveldb::WriteOptions(), key, leveldb::Slice(str));
+      for (const auto& [key, value] : *entries_to_save) {
+        // The batch keeps its own copy, so the buffer can be reused.
+        Serialize(value, str);
+        batch.Put(key, leveldb::Slice(str));
+      }
     }
-  }
 
-  if (keys_to_remove != nullptr) {
-    for (const auto& it : *keys_to_remove) {
-      db_->Delete(leveldb::WriteOptions(), it);
+    if (keys_to_remove != nullptr) {
+      for (const auto& it : *keys_to_remove) {
+        batch.Delete(it);
+      }
     }
-  }
 
-  std::move(callback)(true);
+    leveldb::Status status = db_->Write(leveldb::WriteOptions(), &batch);
+    if (!status.ok()) {
+      NEARBY_LOGS(WARNING) << "Failed to update entries in database: "
+                           << status.ToString();
+    }
+    std::move(callback)(status.ok());
+  });
 }
 
 template <typename T,
@@ -197,9 +284,61 @@ template <typename T,
 void LeveldbDataSet<T, isMessageLite>::Destroy(
     absl::AnyInvocable<void(bool) &&> callback) {
   NEARBY_LOGS(INFO) << "Destroy is called.";
-  db_.reset();
-  leveldb::DestroyDB(path_, leveldb::Options());
-  std::move(callback)(true);
+  executor_.Execute([this, callback = std::move(callback)]() mutable {
+    db_.reset();
+    status_ = InitStatus::kNotInitialized;
+    leveldb::DestroyDB(path_, leveldb::Options());
+    std::move(callback)(true);
+  });
+}
+
+template <typename T,
+          std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
+              isMessageLite>
+bool LeveldbDataSet<T, isMessageLite>::ForEachEntry(
+    const leveldb::Slice& start,
+    absl::FunctionRef<bool(const leveldb::Slice&)> in_range,
+    absl::FunctionRef<void(const leveldb::Slice&, T)> visit) {
+  if (status_ != InitStatus::kOK) {
+    return false;
+  }
+
+  std::unique_ptr<leveldb::Iterator> it(
+      db_->NewIterator(leveldb::ReadOptions()));
+
+  for (it->Seek(start); it->Valid() && in_range(it->key()); it->Next()) {
+    T value;
+    Deserialize(it->value(), value);
+    visit(it->key(), std::move(value));
+  }
+  return it->status().ok();
+}
+
+template <typename T,
+          std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
+              isMessageLite>
+void LeveldbDataSet<T, isMessageLite>::LoadEntriesWithKeysInRange(
+    std::string start,
+    absl::AnyInvocable<bool(const leveldb::Slice&) const> in_range,
+    LoadEntriesWithKeysCallback callback) {
+  executor_.Execute([this, start = std::move(start),
+                     in_range = std::move(in_range),
+                     callback = std::move(callback)]() mutable {
+    auto result = std::make_unique<std::vector<std::pair<std::string, T>>>();
+    bool success = ForEachEntry(
+        start, in_range, [&result](const leveldb::Slice& key, T value) {
+          result->emplace_back(key.ToString(), std::move(value));
+        });
+
+    if (success) {
+      NEARBY_LOGS(INFO) << "Loaded " << result->size()
+                        << " entries from database.";
+    } else {
+      NEARBY_LOGS(INFO) << "Failed to load entries from database.";
+      result->clear();
+    }
+    std::move(callback)(success, std::move(result));
+  });
 }
 
 // Functions for serializing/deserializing data values to/from strings. Strings
@@ -214,12 +353,13 @@ void LeveldbDataSet<T, isMessageLite>::Serialize(T const& value,
   value.SerializeToString(&str);
 }
 
+// Values are parsed in place from the memory of the database iterator.
 template <typename T,
           std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
               isMessageLite>
-void LeveldbDataSet<T, isMessageLite>::Deserialize(absl::string_view str,
+void LeveldbDataSet<T, isMessageLite>::Deserialize(const leveldb::Slice& slice,
                                                    T& value) {
-  value.ParseFromString(str);
+  value.ParseFromArray(slice.data(), static_cast<int>(slice.size()));
 }
 
 }  // namespace data
@@ -29,6 +29,7 @@
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
 #include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "internal/data/data_set.h"
@@ -38,6 +39,7 @@ namespace nearby {
 namespace data {
 namespace {
 
+using ::testing::ElementsAre;
 using ::testing::SizeIs;
 
 // Generate a unique directory under temp directory for leveldb storage
@@ -128,6 +130,23 @@ absl::flat_hash_map<std::string, T> LoadEntriesWithKeysAndWait(
   return entry_map;
 }
 
+// Returns the keys of the entries loaded by `load`, in the order they were
+// returned.
+template <typename T, typename Load>
+std::vector<std::string> LoadKeysAndWait(Load load) {
+  std::vector<std::string> keys;
+  absl::Notification notification;
+  load([&keys, &notification](
+           bool, std::unique_ptr<std::vector<std::pair<std::string, T>>> res) {
+    for (const auto& it : *res) {
+      keys.push_back(it.first);
+    }
+    notification.Notify();
+  });
+  notification.WaitForNotificationWithTimeout(absl::Seconds(5));
+  return keys;
+}
+
 template <typename T>
 void WipeCleanAndWait(std::unique_ptr<LeveldbDataSet<T>>& dataset,
                       std::filesystem::path path) {
@@ -254,6 +273,106 @@ TEST(LeveldbDataSet, RemoveEntriesDiceRoll) {
   EXPECT_EQ(result["id4"].nickname(), diceroll4.nickname());
 }
 
+TEST(LeveldbDataSet, LoadEntriesWithPrefixAndInRange) {
+  std::filesystem::path path = GenerateLeveldbPath();
+  std::unique_ptr<LeveldbDataSet<DiceRoll>> diceroll_set =
+      CreateDataSet<DiceRoll>(path);
+
+  InitializeAndWait(diceroll_set);
+
+  auto data = std::make_unique<LeveldbDataSet<DiceRoll>::KeyEntryVector>(
+      LeveldbDataSet<DiceRoll>::KeyEntryVector({{"a/1", GenerateDiceRoll(1)},
+                                                {"b/1", GenerateDiceRoll(2)},
+                                                {"b/2", GenerateDiceRoll(3)},
+                                                {"c/1", GenerateDiceRoll(4)}}));
+  UpdateEntriesAndWait(diceroll_set, std::move(data), nullptr);
+
+  std::vector<std::string> prefix_keys =
+      LoadKeysAndWait<DiceRoll>([&diceroll_set](auto callback) {
+        diceroll_set->LoadEntriesWithPrefix("b/", std::move(callback));
+      });
+  std::vector<std::string> range_keys =
+      LoadKeysAndWait<DiceRoll>([&diceroll_set](auto callback) {
+        diceroll_set->LoadEntriesInRange("a/2", "c/1", std::move(callback));
+      });
+  std::vector<std::string> open_range_keys =
+      LoadKeysAndWait<DiceRoll>([&diceroll_set](auto callback) {
+        diceroll_set->LoadEntriesInRange("b/2", "", std::move(callback));
+      });
+  WipeCleanAndWait(diceroll_set, path);
+
+  EXPECT_THAT(prefix_keys, ElementsAre("b/1", "b/2"));
+  EXPECT_THAT(range_keys, ElementsAre("b/1", "b/2"));
+  EXPECT_THAT(open_range_keys, ElementsAre("b/2", "c/1"));
+}
+
+TEST(LeveldbDataSet, LoadEntriesInBatches) {
+  std::filesystem::path path = GenerateLeveldbPath();
+  std::unique_ptr<LeveldbDataSet<DiceRoll>> diceroll_set =
+      CreateDataSet<DiceRoll>(path);
+
+  InitializeAndWait(diceroll_set);
+
+  auto data = std::make_unique<LeveldbDataSet<DiceRoll>::KeyEntryVector>();
+  for (int i = 0; i < 5; ++i) {
+    data->push_back({absl::StrCat("id", i), GenerateDiceRoll(i + 2)});
+  }
+  UpdateEntriesAndWait(diceroll_set, std::move(data), nullptr);
+
+  std::vector<int> batch_sizes;
+  std::vector<int> values;
+  bool result = false;
+  absl::Notification notification;
+  diceroll_set->LoadEntriesInBatches(
+      2,
+      [&batch_sizes, &values](
+          std::unique_ptr<LeveldbDataSet<DiceRoll>::KeyEntryVector> batch) {
+        batch_sizes.push_back(batch->size());
+        for (const auto& it : *batch) {
+          values.push_back(it.second.value());
+        }
+      },
+      [&result, &notification](bool res) {
+        result = res;
+        notification.Notify();
+      });
+  notification.WaitForNotificationWithTimeout(absl::Seconds(5));
+  WipeCleanAndWait(diceroll_set, path);
+
+  EXPECT_TRUE(result);
+  EXPECT_THAT(batch_sizes, ElementsAre(2, 2, 1));
+  EXPECT_THAT(values, ElementsAre(2, 3, 4, 5, 6));
+}
+
+TEST(LeveldbDataSet, OperationsRunInOrderWithoutWaiting) {
+  std::filesystem::path path = GenerateLeveldbPath();
+  std::unique_ptr<LeveldbDataSet<DiceRoll>> diceroll_set =
+      CreateDataSet<DiceRoll>(path);
+
+  diceroll_set->Initialize([](InitStatus) {});
+  auto data = std::make_unique<LeveldbDataSet<DiceRoll>::KeyEntryVector>(
+      LeveldbDataSet<DiceRoll>::KeyEntryVector({{"id1", GenerateDiceRoll(2)}}));
+  diceroll_set->UpdateEntries(std::move(data),
+                              std::make_unique<std::vector<std::string>>(),
+                              [](bool) {});
+  auto result = LoadEntriesWithKeysAndWait(diceroll_set);
+  WipeCleanAndWait(diceroll_set, path);
+
+  EXPECT_THAT(result, SizeIs(1));
+  EXPECT_EQ(result["id1"].nickname(), "snake eyes");
+}
+
+TEST(LeveldbDataSet, UpdateEntriesFailsBeforeInitialize) {
+  std::filesystem::path path = GenerateLeveldbPath();
+  std::unique_ptr<LeveldbDataSet<DiceRoll>> diceroll_set =
+      CreateDataSet<DiceRoll>(path);
+
+  auto data = std::make_unique<LeveldbDataSet<DiceRoll>::KeyEntryVector>(
+      LeveldbDataSet<DiceRoll>::KeyEntryVector({{"id1", GenerateDiceRoll(2)}}));
+  EXPECT_FALSE(UpdateEntriesAndWait(diceroll_set, std::move(data), nullptr));
+  WipeCleanAndWait(diceroll_set, path);
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace nearby
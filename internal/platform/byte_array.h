@@ -99,6 +99,11 @@ class ByteArray {
     return absl::string_view(data(), size());
   }
 
+  // Returns a reference to the internal representation, for APIs that take a
+  // `const std::string&` and would otherwise force a copy.
+  const std::string& AsStringRef() const& { return data_; }
+  const std::string& AsStringRef() && = delete;
+
   // Hashable
   template <typename H>
   friend H AbslHashValue(H h, const ByteArray& m) {
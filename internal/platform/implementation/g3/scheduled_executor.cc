@@ -15,10 +15,17 @@
 #include "internal/platform/implementation/g3/scheduled_executor.h"
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <utility>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "internal/platform/implementation/cancelable.h"
+#include "internal/platform/implementation/shared/timer_wheel.h"
 #include "internal/platform/medium_environment.h"
 #include "internal/platform/runnable.h"
 #include "internal/test/fake_clock.h"
@@ -26,14 +33,91 @@
 namespace nearby {
 namespace g3 {
 
+// Tracks the armed tasks of one ScheduledExecutor. Timers keep it alive, so a
+// timer that fires after the executor is destroyed finds it detached.
+class ScheduledTimers : public std::enable_shared_from_this<ScheduledTimers> {
+ public:
+  ScheduledTimers(std::shared_ptr<shared::TimerWheel> wheel,
+                  ScheduledExecutor* executor)
+      : wheel_(std::move(wheel)), executor_(executor) {}
+
+  shared::TimerWheel& wheel() { return *wheel_; }
+
+  std::uint64_t NewTaskId() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    return next_task_id_++;
+  }
+
+  // Hands `task` to the executor at `deadline`.
+  void Arm(std::uint64_t task_id, absl::Time deadline, Runnable task)
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    if (executor_ == nullptr) return;
+    // The timer can fire before this returns, but then waits for mutex_.
+    timer_ids_[task_id] = wheel_->Schedule(
+        deadline, [timers = shared_from_this(), task_id,
+                   task = std::move(task)]() mutable {
+          timers->Fire(task_id, std::move(task));
+        });
+  }
+
+  // Drops the task `task_id` if it has not fired yet.
+  void Disarm(std::uint64_t task_id) ABSL_LOCKS_EXCLUDED(mutex_) {
+    std::uint64_t timer_id;
+    {
+      absl::MutexLock lock(&mutex_);
+      auto it = timer_ids_.find(task_id);
+      if (it == timer_ids_.end()) return;
+      timer_id = it->second;
+      timer_ids_.erase(it);
+    }
+    wheel_->Cancel(timer_id);
+  }
+
+  // Drops all tasks, and stops handing any to the executor.
+  void Detach() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::flat_hash_map<std::uint64_t, std::uint64_t> timer_ids;
+    {
+      absl::MutexLock lock(&mutex_);
+      executor_ = nullptr;
+      timer_ids = std::move(timer_ids_);
+      timer_ids_.clear();
+    }
+    for (const auto& [task_id, timer_id] : timer_ids) {
+      wheel_->Cancel(timer_id);
+    }
+  }
+
+ private:
+  void Fire(std::uint64_t task_id, Runnable task) ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    if (timer_ids_.erase(task_id) == 0 || executor_ == nullptr) return;
+    executor_->Execute(std::move(task));
+  }
+
+  const std::shared_ptr<shared::TimerWheel> wheel_;
+  absl::Mutex mutex_;
+  ScheduledExecutor* executor_ ABSL_GUARDED_BY(mutex_);
+  std::uint64_t next_task_id_ ABSL_GUARDED_BY(mutex_) = 1;
+  // Wheel timer ids by task id.
+  absl::flat_hash_map<std::uint64_t, std::uint64_t> timer_ids_
+      ABSL_GUARDED_BY(mutex_);
+};
+
 namespace {
 
 class ScheduledCancelable : public api::Cancelable {
  public:
+  ScheduledCancelable(std::weak_ptr<ScheduledTimers> timers,
+                      std::uint64_t task_id)
+      : timers_(std::move(timers)), task_id_(task_id) {}
+
   bool Cancel() override {
     Status expected = kNotRun;
     while (expected == kNotRun) {
       if (status_.compare_exchange_strong(expected, kCanceled)) {
+        // Frees the timer now rather than when it would have fired.
+        if (auto timers = timers_.lock()) timers->Disarm(task_id_);
         return true;
       }
     }
@@ -56,6 +140,8 @@ class ScheduledCancelable : public api::Cancelable {
     kCanceled,
   };
   std::atomic<Status> status_ = kNotRun;
+  const std::weak_ptr<ScheduledTimers> timers_;
+  const std::uint64_t task_id_;
 };
 
 }  // namespace
@@ -63,67 +149,75 @@ class ScheduledCancelable : public api::Cancelable {
 ScheduledExecutor::ScheduledExecutor() {
   absl::optional<FakeClock*> fake_clock =
       MediumEnvironment::Instance().GetSimulatedClock();
-  if (fake_clock.has_value()) {
-    name_ = absl::StrFormat("G3 scheduled executor %p", this);
-    (*fake_clock)->AddObserver(name_, [this]() { RunReadyTasks(); });
+  if (!fake_clock.has_value()) {
+    timers_ = std::make_shared<ScheduledTimers>(
+        shared::TimerWheel::GetDefault(), this);
+    return;
   }
+  timers_ = std::make_shared<ScheduledTimers>(
+      std::make_shared<shared::TimerWheel>((*fake_clock)->Now()), this);
+  name_ = absl::StrFormat("G3 scheduled executor %p", this);
+  (*fake_clock)->AddObserver(name_, [timers = timers_]() {
+    absl::optional<FakeClock*> fake_clock =
+        MediumEnvironment::Instance().GetSimulatedClock();
+    if (fake_clock.has_value()) {
+      timers->wheel().AdvanceTo((*fake_clock)->Now());
+    }
+  });
 }
 
 ScheduledExecutor::~ScheduledExecutor() {
   absl::optional<FakeClock*> fake_clock =
       MediumEnvironment::Instance().GetSimulatedClock();
-  if (fake_clock.has_value()) {
+  if (fake_clock.has_value() && !name_.empty()) {
     (*fake_clock)->RemoveObserver(name_);
   }
-  executor_.Shutdown();
+  timers_->Detach();
+  Shutdown();
+}
+
+void ScheduledExecutor::Execute(Runnable&& runnable) {
+  if (shutdown_) return;
+  GetExecutor().Execute(std::move(runnable));
 }
 
 std::shared_ptr<api::Cancelable> ScheduledExecutor::Schedule(
     Runnable&& runnable, absl::Duration delay) {
-  auto scheduled_cancelable = std::make_shared<ScheduledCancelable>();
-  if (executor_.InShutdown()) {
+  std::uint64_t task_id = timers_->NewTaskId();
+  auto scheduled_cancelable =
+      std::make_shared<ScheduledCancelable>(timers_, task_id);
+  if (shutdown_) {
     return scheduled_cancelable;
   }
   Runnable task = [this, scheduled_cancelable,
                    runnable = std::move(runnable)]() mutable {
-    if (!executor_.InShutdown() && scheduled_cancelable->MarkExecuted()) {
+    if (!shutdown_ && scheduled_cancelable->MarkExecuted()) {
       runnable();
     }
   };
-  absl::optional<FakeClock*> fake_clock =
-      MediumEnvironment::Instance().GetSimulatedClock();
-  if (fake_clock.has_value()) {
-    absl::Time trigger_time = (*fake_clock)->Now() + delay;
-    absl::MutexLock lock(&mutex_);
-    tasks_.insert(std::pair<absl::Time, std::unique_ptr<Runnable>>(
-        trigger_time, std::make_unique<Runnable>(std::move(task))));
-  } else {
-    executor_.ScheduleAfter(delay, std::move(task));
+  absl::Time now = absl::Now();
+  if (!name_.empty()) {
+    // The wheel of this executor follows the simulated clock.
+    absl::optional<FakeClock*> fake_clock =
+        MediumEnvironment::Instance().GetSimulatedClock();
+    if (fake_clock.has_value()) now = (*fake_clock)->Now();
   }
+  timers_->Arm(task_id, now + delay, std::move(task));
   return scheduled_cancelable;
 }
 
-void ScheduledExecutor::RunReadyTasks() {
-  absl::optional<FakeClock*> fake_clock =
-      MediumEnvironment::Instance().GetSimulatedClock();
-  if (executor_.InShutdown()) {
-    return;
-  }
-  if (!fake_clock.has_value()) {
-    return;
-  }
-  absl::Time current_time = (*fake_clock)->Now();
+void ScheduledExecutor::Shutdown() {
+  shutdown_ = true;
   absl::MutexLock lock(&mutex_);
-  for (auto it = tasks_.begin(); it != tasks_.end();) {
-    if (it->first <= current_time) {
-      executor_.Execute(
-          [task = std::move(it->second)]() mutable { (*task)(); });
-      it = tasks_.erase(it);
-    } else {
-      // Tasks are sorted. We can stop iterating.
-      break;
-    }
+  if (executor_ != nullptr) executor_->Shutdown();
+}
+
+SingleThreadExecutor& ScheduledExecutor::GetExecutor() {
+  absl::MutexLock lock(&mutex_);
+  if (executor_ == nullptr) {
+    executor_ = std::make_unique<SingleThreadExecutor>();
   }
+  return *executor_;
 }
 
 }  // namespace g3
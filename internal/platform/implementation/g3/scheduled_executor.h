@@ -20,7 +20,8 @@
 #include <string>
 #include <utility>
 
-#include "absl/container/btree_map.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "internal/platform/implementation/cancelable.h"
 #include "internal/platform/implementation/g3/single_thread_executor.h"
@@ -30,27 +31,32 @@
 namespace nearby {
 namespace g3 {
 
-// An Executor that reuses a fixed number of threads operating off a shared
-// unbounded queue.
+// Timers of a ScheduledExecutor; defined in scheduled_executor.cc.
+class ScheduledTimers;
+
+// Delayed tasks are armed on a shared::TimerWheel: the process-wide one, or a
+// private one driven by the simulated clock when MediumEnvironment has one.
+// The thread that runs tasks is only started when the first task is due, so
+// an executor whose timeouts are all cancelled never costs a thread.
 class ScheduledExecutor final : public api::ScheduledExecutor {
  public:
   ScheduledExecutor();
   ~ScheduledExecutor() override;
 
-  void Execute(Runnable&& runnable) override {
-    executor_.Execute(std::move(runnable));
-  }
+  void Execute(Runnable&& runnable) override;
   std::shared_ptr<api::Cancelable> Schedule(Runnable&& runnable,
                                             absl::Duration delay) override;
-  void Shutdown() override { executor_.Shutdown(); }
+  void Shutdown() override ABSL_LOCKS_EXCLUDED(mutex_);
 
  private:
-  void RunReadyTasks();
-  SingleThreadExecutor executor_;
+  // Returns the executor, starting its thread on first use.
+  SingleThreadExecutor& GetExecutor() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  std::atomic_bool shutdown_ = false;
   std::string name_;
   absl::Mutex mutex_;
-  absl::btree_multimap<absl::Time, std::unique_ptr<Runnable>> tasks_
-      ABSL_GUARDED_BY(mutex_);
+  std::unique_ptr<SingleThreadExecutor> executor_ ABSL_GUARDED_BY(mutex_);
+  std::shared_ptr<ScheduledTimers> timers_;
 };
 
 }  // namespace g3
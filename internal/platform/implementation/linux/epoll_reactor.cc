@@ -0,0 +1,159 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/linux/epoll_reactor.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "absl/synchronization/mutex.h"
+#include "internal/platform/logging.h"
+
+namespace nearby {
+namespace linux_impl {
+
+namespace {
+
+// Event data of the wake descriptor; registrations are numbered from 1, so it
+// is also the id of no registration.
+constexpr std::uint64_t kWakeId = 0;
+constexpr int kMaxEventsPerWait = 64;
+
+}  // namespace
+
+EpollReactor& EpollReactor::GetDefault() {
+  static EpollReactor* reactor = new EpollReactor();
+  return *reactor;
+}
+
+EpollReactor::EpollReactor()
+    : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+      wake_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = kWakeId;
+  if (epoll_fd_ < 0 || wake_fd_ < 0 ||
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) != 0) {
+    NEARBY_LOGS(ERROR) << "Failed to set up epoll reactor, errno=" << errno;
+    return;
+  }
+  thread_ = std::thread([this]() { Run(); });
+}
+
+EpollReactor::~EpollReactor() {
+  if (thread_.joinable()) {
+    std::uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+      NEARBY_LOGS(ERROR) << "Failed to wake epoll reactor, errno=" << errno;
+    }
+    thread_.join();
+  }
+  if (wake_fd_ >= 0) close(wake_fd_);
+  if (epoll_fd_ >= 0) close(epoll_fd_);
+}
+
+bool EpollReactor::Add(int fd, std::uint32_t events, Callback callback) {
+  absl::MutexLock lock(&mutex_);
+  if (!thread_.joinable() || fd_to_id_.contains(fd)) return false;
+  std::uint64_t id = next_id_++;
+  epoll_event event = {};
+  event.events = events | EPOLLET;
+  event.data.u64 = id;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+    NEARBY_LOGS(ERROR) << "Failed to watch fd " << fd << ", errno=" << errno;
+    return false;
+  }
+  fd_to_id_.emplace(fd, id);
+  callbacks_.emplace(id, std::make_shared<Callback>(std::move(callback)));
+  return true;
+}
+
+bool EpollReactor::Rearm(int fd, std::uint32_t events) {
+  absl::MutexLock lock(&mutex_);
+  auto it = fd_to_id_.find(fd);
+  if (it == fd_to_id_.end()) return false;
+  epoll_event event = {};
+  event.events = events | EPOLLET;
+  event.data.u64 = it->second;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) != 0) {
+    NEARBY_LOGS(ERROR) << "Failed to rearm fd " << fd << ", errno=" << errno;
+    return false;
+  }
+  return true;
+}
+
+void EpollReactor::Remove(int fd) {
+  std::shared_ptr<Callback> callback;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = fd_to_id_.find(fd);
+    if (it == fd_to_id_.end()) return;
+    std::uint64_t id = it->second;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    auto callback_it = callbacks_.find(id);
+    callback = std::move(callback_it->second);
+    callbacks_.erase(callback_it);
+    fd_to_id_.erase(it);
+    // A callback that removes its own descriptor would wait for itself.
+    if (std::this_thread::get_id() != thread_.get_id()) {
+      while (running_id_ == id) callback_done_.Wait(&mutex_);
+    }
+  }
+  // The callback is destroyed outside of the lock, in case its captures
+  // unregister something themselves. If it is running, Run() destroys it once
+  // it returns.
+}
+
+void EpollReactor::Run() {
+  epoll_event events[kMaxEventsPerWait];
+  while (true) {
+    int count = epoll_wait(epoll_fd_, events, kMaxEventsPerWait, -1);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      NEARBY_LOGS(ERROR) << "epoll_wait failed, errno=" << errno;
+      return;
+    }
+    for (int i = 0; i < count; ++i) {
+      std::uint64_t id = events[i].data.u64;
+      if (id == kWakeId) return;
+      std::shared_ptr<Callback> callback;
+      {
+        absl::MutexLock lock(&mutex_);
+        // Ids are never reused, so events of a descriptor that was removed
+        // while epoll_wait() was returning, or by an earlier callback, are
+        // dropped here.
+        auto it = callbacks_.find(id);
+        if (it == callbacks_.end()) continue;
+        callback = it->second;
+        running_id_ = id;
+      }
+      (*callback)(events[i].events);
+      // Destroyed before Remove() returns, if it removed the descriptor.
+      callback.reset();
+      absl::MutexLock lock(&mutex_);
+      running_id_ = kWakeId;
+      callback_done_.SignalAll();
+    }
+  }
+}
+
+}  // namespace linux_impl
+}  // namespace nearby
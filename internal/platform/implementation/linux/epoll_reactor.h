@@ -0,0 +1,91 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_LINUX_EPOLL_REACTOR_H_
+#define PLATFORM_IMPL_LINUX_EPOLL_REACTOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/synchronization/mutex.h"
+
+namespace nearby {
+namespace linux_impl {
+
+// Watches many non-blocking file descriptors from a single thread.
+//
+// Descriptors are registered edge-triggered: the callback of a descriptor runs
+// on the reactor thread each time it becomes readable or writable again, and
+// is expected to only record the readiness and wake up whoever waits for it.
+// Blocking reads and writes therefore cost a condition variable wait instead of
+// a thread per socket. Callbacks run without the reactor lock held, so they may
+// call Add(), Rearm() and Remove() themselves.
+class EpollReactor {
+ public:
+  // Receives the ready epoll events (EPOLLIN, EPOLLOUT, EPOLLHUP, ...).
+  using Callback = absl::AnyInvocable<void(std::uint32_t events)>;
+
+  // Returns the reactor shared by all sockets of the process.
+  static EpollReactor& GetDefault();
+
+  EpollReactor();
+  ~EpollReactor();
+
+  EpollReactor(const EpollReactor&) = delete;
+  EpollReactor& operator=(const EpollReactor&) = delete;
+
+  // Starts watching `fd` for `events`; EPOLLET is always added. Returns false
+  // if the descriptor could not be registered.
+  bool Add(int fd, std::uint32_t events, Callback callback)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Registers `fd` again with `events`, which makes epoll report the events
+  // that are pending right now as if they had just occurred. Edge-triggered
+  // events are otherwise only reported on a change. Returns false if `fd` is
+  // not being watched.
+  bool Rearm(int fd, std::uint32_t events) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Stops watching `fd`. Once this returns, the callback of `fd` is neither
+  // running nor called again, so its captures may be destroyed. Called from a
+  // callback, it doesn't wait for that callback to return.
+  void Remove(int fd) ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  void Run();
+
+  const int epoll_fd_;
+  // Signalled by the destructor to stop Run().
+  const int wake_fd_;
+  absl::Mutex mutex_;
+  // Signalled when a callback returns.
+  absl::CondVar callback_done_;
+  std::uint64_t next_id_ ABSL_GUARDED_BY(mutex_) = 1;
+  // Id of the registration whose callback is running, if any.
+  std::uint64_t running_id_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::flat_hash_map<int, std::uint64_t> fd_to_id_ ABSL_GUARDED_BY(mutex_);
+  // Shared with Run() while a callback runs, so that a callback removing its
+  // own descriptor is not destroyed under it.
+  absl::flat_hash_map<std::uint64_t, std::shared_ptr<Callback>> callbacks_
+      ABSL_GUARDED_BY(mutex_);
+  std::thread thread_;
+};
+
+}  // namespace linux_impl
+}  // namespace nearby
+
+#endif  // PLATFORM_IMPL_LINUX_EPOLL_REACTOR_H_
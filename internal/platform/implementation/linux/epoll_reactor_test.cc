@@ -0,0 +1,111 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/linux/epoll_reactor.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace linux_impl {
+namespace {
+
+constexpr absl::Duration kTimeout = absl::Seconds(1);
+
+// An eventfd that becomes readable once Signal() is called.
+class Event {
+ public:
+  Event() : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+  ~Event() { close(fd_); }
+
+  int fd() const { return fd_; }
+  void Signal() {
+    std::uint64_t one = 1;
+    ASSERT_EQ(write(fd_, &one, sizeof(one)), sizeof(one));
+  }
+
+ private:
+  const int fd_;
+};
+
+TEST(EpollReactorTest, CallsCallbackWhenReadable) {
+  EpollReactor reactor;
+  Event event;
+  absl::Notification readable;
+  ASSERT_TRUE(reactor.Add(event.fd(), EPOLLIN, [&](std::uint32_t events) {
+    if (events & EPOLLIN) readable.Notify();
+  }));
+
+  event.Signal();
+
+  EXPECT_TRUE(readable.WaitForNotificationWithTimeout(kTimeout));
+  reactor.Remove(event.fd());
+}
+
+TEST(EpollReactorTest, CallbackCanAddAndRemoveDescriptors) {
+  EpollReactor reactor;
+  Event first;
+  Event second;
+  absl::Notification second_readable;
+  ASSERT_TRUE(reactor.Add(first.fd(), EPOLLIN, [&](std::uint32_t events) {
+    reactor.Remove(first.fd());
+    EXPECT_TRUE(reactor.Add(second.fd(), EPOLLIN, [&](std::uint32_t events) {
+      second_readable.Notify();
+    }));
+    second.Signal();
+  }));
+
+  first.Signal();
+
+  EXPECT_TRUE(second_readable.WaitForNotificationWithTimeout(kTimeout));
+  reactor.Remove(second.fd());
+}
+
+TEST(EpollReactorTest, RemoveWaitsForRunningCallback) {
+  EpollReactor reactor;
+  Event event;
+  absl::Notification callback_started;
+  absl::Notification release_callback;
+  std::atomic<bool> callback_returned = false;
+  ASSERT_TRUE(reactor.Add(event.fd(), EPOLLIN, [&](std::uint32_t events) {
+    callback_started.Notify();
+    release_callback.WaitForNotification();
+    callback_returned = true;
+  }));
+  event.Signal();
+  ASSERT_TRUE(callback_started.WaitForNotificationWithTimeout(kTimeout));
+
+  std::thread releaser([&]() {
+    absl::SleepFor(absl::Milliseconds(100));
+    release_callback.Notify();
+  });
+  reactor.Remove(event.fd());
+
+  EXPECT_TRUE(callback_returned);
+  releaser.join();
+}
+
+}  // namespace
+}  // namespace linux_impl
+}  // namespace nearby
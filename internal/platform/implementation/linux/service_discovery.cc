@@ -0,0 +1,418 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/linux/service_discovery.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
+#include "internal/platform/logging.h"
+#include "internal/platform/nsd_service_info.h"
+
+namespace nearby {
+namespace linux_impl {
+
+namespace {
+
+constexpr absl::string_view kMessageMagic = "NCWL";
+constexpr std::uint8_t kMessageVersion = 1;
+// Large enough for any UDP datagram.
+constexpr size_t kMaxMessageSize = 65536;
+
+void AppendUint16(std::string& out, std::uint16_t value) {
+  out.push_back(static_cast<char>(value >> 8));
+  out.push_back(static_cast<char>(value & 0xff));
+}
+
+void AppendField(std::string& out, absl::string_view field) {
+  AppendUint16(out, static_cast<std::uint16_t>(field.size()));
+  out.append(field.data(), field.size());
+}
+
+bool ReadUint16(absl::string_view& in, std::uint16_t& value) {
+  if (in.size() < 2) return false;
+  value = static_cast<std::uint16_t>(static_cast<std::uint8_t>(in[0]) << 8 |
+                                     static_cast<std::uint8_t>(in[1]));
+  in.remove_prefix(2);
+  return true;
+}
+
+bool ReadField(absl::string_view& in, std::string& field) {
+  std::uint16_t size;
+  if (!ReadUint16(in, size) || in.size() < size) return false;
+  field.assign(in.data(), size);
+  in.remove_prefix(size);
+  return true;
+}
+
+}  // namespace
+
+// LoopbackServiceDiscovery
+
+LoopbackServiceDiscovery::LoopbackServiceDiscovery(
+    std::shared_ptr<Network> network)
+    : network_(std::move(network)) {}
+
+LoopbackServiceDiscovery::~LoopbackServiceDiscovery() {
+  absl::MutexLock lock(&network_->mutex_);
+  for (auto& [service_type, services] : network_->services_) {
+    absl::erase_if(services, [this](const auto& entry) {
+      return entry.second.owner == this;
+    });
+  }
+  for (auto& [service_type, callbacks] : network_->discoveries_) {
+    callbacks.erase(this);
+  }
+}
+
+bool LoopbackServiceDiscovery::StartAdvertising(
+    const NsdServiceInfo& nsd_service_info) {
+  {
+    absl::MutexLock lock(&network_->mutex_);
+    auto& services = network_->services_[nsd_service_info.GetServiceType()];
+    if (!services
+             .try_emplace(nsd_service_info.GetServiceName(),
+                          Network::Service{this, nsd_service_info})
+             .second) {
+      return false;
+    }
+  }
+  Notify(nsd_service_info, /*found=*/true);
+  return true;
+}
+
+bool LoopbackServiceDiscovery::StopAdvertising(
+    const NsdServiceInfo& nsd_service_info) {
+  {
+    absl::MutexLock lock(&network_->mutex_);
+    auto it = network_->services_.find(nsd_service_info.GetServiceType());
+    if (it == network_->services_.end()) return false;
+    auto service_it = it->second.find(nsd_service_info.GetServiceName());
+    if (service_it == it->second.end() || service_it->second.owner != this) {
+      return false;
+    }
+    it->second.erase(service_it);
+  }
+  Notify(nsd_service_info, /*found=*/false);
+  return true;
+}
+
+bool LoopbackServiceDiscovery::StartDiscovery(
+    const std::string& service_type, DiscoveredServiceCallback callback) {
+  auto shared_callback =
+      std::make_shared<DiscoveredServiceCallback>(std::move(callback));
+  std::vector<NsdServiceInfo> found;
+  {
+    absl::MutexLock lock(&network_->mutex_);
+    if (!network_->discoveries_[service_type]
+             .try_emplace(this, shared_callback)
+             .second) {
+      return false;
+    }
+    for (const auto& [name, service] : network_->services_[service_type]) {
+      if (service.owner != this) found.push_back(service.nsd_service_info);
+    }
+  }
+  for (NsdServiceInfo& nsd_service_info : found) {
+    shared_callback->service_discovered_cb(std::move(nsd_service_info));
+  }
+  return true;
+}
+
+bool LoopbackServiceDiscovery::StopDiscovery(const std::string& service_type) {
+  absl::MutexLock lock(&network_->mutex_);
+  auto it = network_->discoveries_.find(service_type);
+  return it != network_->discoveries_.end() && it->second.erase(this) > 0;
+}
+
+void LoopbackServiceDiscovery::Notify(const NsdServiceInfo& nsd_service_info,
+                                      bool found) {
+  std::vector<std::shared_ptr<DiscoveredServiceCallback>> callbacks;
+  {
+    absl::MutexLock lock(&network_->mutex_);
+    auto it = network_->discoveries_.find(nsd_service_info.GetServiceType());
+    if (it == network_->discoveries_.end()) return;
+    for (const auto& [discovery, callback] : it->second) {
+      if (discovery != this) callbacks.push_back(callback);
+    }
+  }
+  for (const auto& callback : callbacks) {
+    if (found) {
+      callback->service_discovered_cb(nsd_service_info);
+    } else {
+      callback->service_lost_cb(nsd_service_info);
+    }
+  }
+}
+
+// MulticastServiceDiscovery
+
+MulticastServiceDiscovery::MulticastServiceDiscovery(const Options& options,
+                                                     EpollReactor& reactor)
+    : reactor_(reactor), port_(options.port) {
+  if (inet_pton(AF_INET, options.group.c_str(), &group_address_) != 1) {
+    NEARBY_LOGS(ERROR) << "Invalid discovery group " << options.group;
+    return;
+  }
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    NEARBY_LOGS(ERROR) << "Failed to create discovery socket, errno=" << errno;
+    return;
+  }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+  // Announcements stay on the local link, and are looped back so that other
+  // processes on this host see them as well.
+  unsigned char ttl = 1;
+  unsigned char loop = 1;
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port_);
+  ip_mreq membership = {};
+  membership.imr_multiaddr.s_addr = group_address_;
+  membership.imr_interface.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership,
+                 sizeof(membership)) != 0) {
+    NEARBY_LOGS(ERROR) << "Failed to join discovery group " << options.group
+                       << ":" << port_ << ", errno=" << errno;
+    close(fd);
+    return;
+  }
+  fd_ = fd;
+  if (!reactor_.Add(fd_, EPOLLIN, [this](std::uint32_t) { OnReadable(); })) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+MulticastServiceDiscovery::~MulticastServiceDiscovery() {
+  if (fd_ < 0) return;
+  reactor_.Remove(fd_);
+  close(fd_);
+}
+
+bool MulticastServiceDiscovery::StartAdvertising(
+    const NsdServiceInfo& nsd_service_info) {
+  if (fd_ < 0) return false;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto& services = advertised_[nsd_service_info.GetServiceType()];
+    if (!services.try_emplace(nsd_service_info.GetServiceName(), nsd_service_info)
+             .second) {
+      return false;
+    }
+  }
+  return Send(MessageType::kAnnounce, nsd_service_info);
+}
+
+bool MulticastServiceDiscovery::StopAdvertising(
+    const NsdServiceInfo& nsd_service_info) {
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = advertised_.find(nsd_service_info.GetServiceType());
+    if (it == advertised_.end() ||
+        it->second.erase(nsd_service_info.GetServiceName()) == 0) {
+      return false;
+    }
+  }
+  return Send(MessageType::kGoodbye, nsd_service_info);
+}
+
+bool MulticastServiceDiscovery::StartDiscovery(
+    const std::string& service_type, DiscoveredServiceCallback callback) {
+  if (fd_ < 0) return false;
+  {
+    absl::MutexLock lock(&mutex_);
+    Discovery discovery;
+    discovery.callback =
+        std::make_shared<DiscoveredServiceCallback>(std::move(callback));
+    if (!discoveries_.try_emplace(service_type, std::move(discovery)).second) {
+      return false;
+    }
+  }
+  NsdServiceInfo query;
+  query.SetServiceType(service_type);
+  return Send(MessageType::kQuery, query);
+}
+
+bool MulticastServiceDiscovery::StopDiscovery(const std::string& service_type) {
+  absl::MutexLock lock(&mutex_);
+  return discoveries_.erase(service_type) > 0;
+}
+
+std::string MulticastServiceDiscovery::EncodeMessage(
+    MessageType type, const NsdServiceInfo& nsd_service_info) {
+  std::string message(kMessageMagic);
+  message.push_back(static_cast<char>(kMessageVersion));
+  message.push_back(static_cast<char>(type));
+  AppendField(message, nsd_service_info.GetServiceType());
+  if (type == MessageType::kQuery) return message;
+
+  AppendField(message, nsd_service_info.GetServiceName());
+  AppendField(message, nsd_service_info.GetIPAddress());
+  AppendUint16(message, static_cast<std::uint16_t>(nsd_service_info.GetPort()));
+  auto txt_records = nsd_service_info.GetTxtRecords();
+  AppendUint16(message, static_cast<std::uint16_t>(txt_records.size()));
+  for (const auto& [key, value] : txt_records) {
+    AppendField(message, key);
+    AppendField(message, value);
+  }
+  return message;
+}
+
+bool MulticastServiceDiscovery::DecodeMessage(
+    absl::string_view message, MessageType& type,
+    NsdServiceInfo& nsd_service_info) {
+  if (!absl::ConsumePrefix(&message, kMessageMagic) || message.size() < 2 ||
+      static_cast<std::uint8_t>(message[0]) != kMessageVersion) {
+    return false;
+  }
+  type = static_cast<MessageType>(message[1]);
+  message.remove_prefix(2);
+  std::string service_type;
+  if (!ReadField(message, service_type)) return false;
+  nsd_service_info.SetServiceType(service_type);
+  if (type == MessageType::kQuery) return true;
+  if (type != MessageType::kAnnounce && type != MessageType::kGoodbye) {
+    return false;
+  }
+
+  std::string service_name;
+  std::string ip_address;
+  std::uint16_t port;
+  std::uint16_t txt_record_count;
+  if (!ReadField(message, service_name) || !ReadField(message, ip_address) ||
+      !ReadUint16(message, port) || !ReadUint16(message, txt_record_count)) {
+    return false;
+  }
+  nsd_service_info.SetServiceName(service_name);
+  nsd_service_info.SetIPAddress(ip_address);
+  nsd_service_info.SetPort(port);
+  for (int i = 0; i < txt_record_count; ++i) {
+    std::string key;
+    std::string value;
+    if (!ReadField(message, key) || !ReadField(message, value)) return false;
+    nsd_service_info.SetTxtRecord(key, value);
+  }
+  return true;
+}
+
+bool MulticastServiceDiscovery::Send(MessageType type,
+                                     const NsdServiceInfo& nsd_service_info) {
+  std::string message = EncodeMessage(type, nsd_service_info);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = group_address_;
+  address.sin_port = htons(port_);
+  if (sendto(fd_, message.data(), message.size(), 0,
+             reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+    NEARBY_LOGS(WARNING) << "Failed to send discovery message, errno="
+                         << errno;
+    return false;
+  }
+  return true;
+}
+
+void MulticastServiceDiscovery::OnReadable() {
+  std::string buffer(kMaxMessageSize, '\0');
+  while (true) {
+    sockaddr_in sender = {};
+    socklen_t sender_size = sizeof(sender);
+    ssize_t size = recvfrom(fd_, buffer.data(), buffer.size(), 0,
+                            reinterpret_cast<sockaddr*>(&sender), &sender_size);
+    if (size < 0) {
+      if (errno == EINTR) continue;
+      // EAGAIN: drained until the next edge.
+      return;
+    }
+    std::string sender_ip(reinterpret_cast<const char*>(&sender.sin_addr), 4);
+    HandleMessage(absl::string_view(buffer.data(), size), sender_ip);
+  }
+}
+
+void MulticastServiceDiscovery::HandleMessage(absl::string_view message,
+                                              const std::string& sender_ip) {
+  MessageType type;
+  NsdServiceInfo nsd_service_info;
+  if (!DecodeMessage(message, type, nsd_service_info)) return;
+  const std::string service_type = nsd_service_info.GetServiceType();
+
+  if (type == MessageType::kQuery) {
+    std::vector<NsdServiceInfo> answers;
+    {
+      absl::MutexLock lock(&mutex_);
+      auto it = advertised_.find(service_type);
+      if (it == advertised_.end()) return;
+      for (const auto& [name, info] : it->second) answers.push_back(info);
+    }
+    for (const NsdServiceInfo& answer : answers) {
+      Send(MessageType::kAnnounce, answer);
+    }
+    return;
+  }
+
+  // Advertisers may not know their own address; the sender's is as good.
+  if (nsd_service_info.GetIPAddress().size() != 4) {
+    nsd_service_info.SetIPAddress(sender_ip);
+  }
+  std::shared_ptr<DiscoveredServiceCallback> callback;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto advertised_it = advertised_.find(service_type);
+    if (advertised_it != advertised_.end() &&
+        advertised_it->second.contains(nsd_service_info.GetServiceName())) {
+      return;  // Our own announcement.
+    }
+    auto it = discoveries_.find(service_type);
+    if (it == discoveries_.end()) return;
+    Discovery& discovery = it->second;
+    bool changed =
+        type == MessageType::kAnnounce
+            ? discovery.found_service_names
+                  .insert(nsd_service_info.GetServiceName())
+                  .second
+            : discovery.found_service_names.erase(
+                  nsd_service_info.GetServiceName()) > 0;
+    if (!changed) return;
+    callback = discovery.callback;
+  }
+  if (type == MessageType::kAnnounce) {
+    callback->service_discovered_cb(std::move(nsd_service_info));
+  } else {
+    callback->service_lost_cb(std::move(nsd_service_info));
+  }
+}
+
+}  // namespace linux_impl
+}  // namespace nearby
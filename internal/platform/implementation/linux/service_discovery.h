@@ -0,0 +1,163 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_LINUX_SERVICE_DISCOVERY_H_
+#define PLATFORM_IMPL_LINUX_SERVICE_DISCOVERY_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "internal/platform/implementation/linux/epoll_reactor.h"
+#include "internal/platform/implementation/wifi_lan.h"
+#include "internal/platform/nsd_service_info.h"
+
+namespace nearby {
+namespace linux_impl {
+
+// Advertises and discovers WifiLan services for the Linux WifiLanMedium.
+//
+// Callbacks may run on an internal thread and must not block.
+class ServiceDiscovery {
+ public:
+  using DiscoveredServiceCallback =
+      api::WifiLanMedium::DiscoveredServiceCallback;
+
+  virtual ~ServiceDiscovery() = default;
+
+  // Same contracts as the matching api::WifiLanMedium methods.
+  virtual bool StartAdvertising(const NsdServiceInfo& nsd_service_info) = 0;
+  virtual bool StopAdvertising(const NsdServiceInfo& nsd_service_info) = 0;
+  virtual bool StartDiscovery(const std::string& service_type,
+                              DiscoveredServiceCallback callback) = 0;
+  virtual bool StopDiscovery(const std::string& service_type) = 0;
+};
+
+// Discovery between ServiceDiscovery instances of one process that share a
+// Network. Services are reported synchronously; used by tests and benchmarks.
+class LoopbackServiceDiscovery : public ServiceDiscovery {
+ public:
+  // State shared by the connected instances.
+  class Network {
+   private:
+    friend class LoopbackServiceDiscovery;
+
+    struct Service {
+      const LoopbackServiceDiscovery* owner;
+      NsdServiceInfo nsd_service_info;
+    };
+
+    absl::Mutex mutex_;
+    // Advertised services by service type and name.
+    absl::flat_hash_map<std::string, absl::flat_hash_map<std::string, Service>>
+        services_ ABSL_GUARDED_BY(mutex_);
+    // Discovery callbacks by service type and discovering instance.
+    absl::flat_hash_map<
+        std::string,
+        absl::flat_hash_map<const LoopbackServiceDiscovery*,
+                            std::shared_ptr<DiscoveredServiceCallback>>>
+        discoveries_ ABSL_GUARDED_BY(mutex_);
+  };
+
+  explicit LoopbackServiceDiscovery(std::shared_ptr<Network> network);
+  ~LoopbackServiceDiscovery() override;
+
+  bool StartAdvertising(const NsdServiceInfo& nsd_service_info) override;
+  bool StopAdvertising(const NsdServiceInfo& nsd_service_info) override;
+  bool StartDiscovery(const std::string& service_type,
+                      DiscoveredServiceCallback callback) override;
+  bool StopDiscovery(const std::string& service_type) override;
+
+ private:
+  // Reports `nsd_service_info` to every other instance discovering its type.
+  void Notify(const NsdServiceInfo& nsd_service_info, bool found);
+
+  std::shared_ptr<Network> network_;
+};
+
+// Discovery over UDP multicast on the local network, with a private protocol.
+//
+// This is not mDNS or DNS-SD: only other MulticastServiceDiscovery instances
+// see the services, and system resolvers such as Avahi neither see them nor
+// are seen. Messages start with "NCWL" and a version byte, and go to a group
+// and port of their own (239.255.77.77:47777 by default). Advertisers answer
+// queries for their service type and announce services when they start and
+// stop advertising; discoverers send a query when they start.
+class MulticastServiceDiscovery : public ServiceDiscovery {
+ public:
+  struct Options {
+    std::string group = "239.255.77.77";
+    int port = 47777;
+  };
+
+  explicit MulticastServiceDiscovery(
+      EpollReactor& reactor = EpollReactor::GetDefault())
+      : MulticastServiceDiscovery(Options(), reactor) {}
+  MulticastServiceDiscovery(const Options& options, EpollReactor& reactor);
+  ~MulticastServiceDiscovery() override;
+
+  bool StartAdvertising(const NsdServiceInfo& nsd_service_info) override
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  bool StopAdvertising(const NsdServiceInfo& nsd_service_info) override
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  bool StartDiscovery(const std::string& service_type,
+                      DiscoveredServiceCallback callback) override
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  bool StopDiscovery(const std::string& service_type) override
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  enum class MessageType : std::uint8_t {
+    kQuery = 1,
+    kAnnounce = 2,
+    kGoodbye = 3,
+  };
+
+  struct Discovery {
+    std::shared_ptr<DiscoveredServiceCallback> callback;
+    absl::flat_hash_set<std::string> found_service_names;
+  };
+
+  static std::string EncodeMessage(MessageType type,
+                                   const NsdServiceInfo& nsd_service_info);
+  static bool DecodeMessage(absl::string_view message, MessageType& type,
+                            NsdServiceInfo& nsd_service_info);
+
+  bool Send(MessageType type, const NsdServiceInfo& nsd_service_info);
+  void OnReadable() ABSL_LOCKS_EXCLUDED(mutex_);
+  void HandleMessage(absl::string_view message, const std::string& sender_ip)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  EpollReactor& reactor_;
+  int fd_ = -1;
+  std::uint32_t group_address_ = 0;  // Network byte order.
+  int port_ = 0;
+  absl::Mutex mutex_;
+  // Advertised services by service type and name.
+  absl::flat_hash_map<std::string,
+                      absl::flat_hash_map<std::string, NsdServiceInfo>>
+      advertised_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, Discovery> discoveries_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace linux_impl
+}  // namespace nearby
+
+#endif  // PLATFORM_IMPL_LINUX_SERVICE_DISCOVERY_H_
@@ -0,0 +1,434 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/linux/wifi_lan.h"
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/cancellation_flag.h"
+#include "internal/platform/cancellation_flag_listener.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/logging.h"
+#include "internal/platform/nsd_service_info.h"
+
+namespace nearby {
+namespace linux_impl {
+
+namespace {
+
+// Upper bound of a single Read(); callers read in a loop anyway.
+constexpr std::int64_t kMaxReadSize = 1024 * 1024;
+// Events a connected socket is watched for.
+constexpr std::uint32_t kSocketEvents = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+
+// Returns the address of the first IPv4 interface that is up and not
+// loopback, as 4 bytes in network order. Returns an empty string if none.
+std::string GetLanIpAddress() {
+  ifaddrs* interfaces = nullptr;
+  if (getifaddrs(&interfaces) != 0) return {};
+  std::string ip_address;
+  for (ifaddrs* it = interfaces; it != nullptr; it = it->ifa_next) {
+    if (it->ifa_addr == nullptr || it->ifa_addr->sa_family != AF_INET ||
+        !(it->ifa_flags & IFF_UP) || (it->ifa_flags & IFF_LOOPBACK)) {
+      continue;
+    }
+    const in_addr& address =
+        reinterpret_cast<const sockaddr_in*>(it->ifa_addr)->sin_addr;
+    ip_address.assign(reinterpret_cast<const char*>(&address), 4);
+    break;
+  }
+  freeifaddrs(interfaces);
+  return ip_address;
+}
+
+}  // namespace
+
+// WifiLanSocket
+
+WifiLanSocket::WifiLanSocket(EpollReactor& reactor, int fd)
+    : reactor_(reactor), fd_(fd) {
+  // Frames are written whole, so there is nothing to gain from Nagle.
+  int one = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (!reactor_.Add(fd_, kSocketEvents,
+                    [this](std::uint32_t events) { OnEvents(events); })) {
+    absl::MutexLock lock(&mutex_);
+    closed_ = true;
+  }
+}
+
+WifiLanSocket::~WifiLanSocket() {
+  Close();
+  close(fd_);
+}
+
+Exception WifiLanSocket::Close() {
+  absl::AnyInvocable<void()> read_callback;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (closed_) return {Exception::kSuccess};
+    closed_ = true;
+    read_callback = std::exchange(read_callback_, nullptr);
+    cond_.SignalAll();
+  }
+  reactor_.Remove(fd_);
+  shutdown(fd_, SHUT_RDWR);
+  // Lets the reader find out that the socket is closed.
+  if (read_callback) read_callback();
+  return {Exception::kSuccess};
+}
+
+bool WifiLanSocket::NotifyWhenReadable(absl::AnyInvocable<void()> callback) {
+  {
+    absl::MutexLock lock(&mutex_);
+    if (closed_) return false;
+    read_callback_ = std::move(callback);
+  }
+  // Data that arrived before the callback was set has already had its edge,
+  // so ask the reactor to report the current state once more. This runs
+  // outside of mutex_, which OnEvents() takes under the reactor lock.
+  if (reactor_.Rearm(fd_, kSocketEvents)) return true;
+  absl::MutexLock lock(&mutex_);
+  // Close() won the race and took the callback, so it has been called.
+  if (!read_callback_) return true;
+  read_callback_ = nullptr;
+  return false;
+}
+
+bool WifiLanSocket::AwaitConnected(absl::Duration timeout) {
+  absl::Time deadline = absl::Now() + timeout;
+  while (true) {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (closed_) return false;
+      writable_ = false;
+    }
+    int error = 0;
+    socklen_t error_size = sizeof(error);
+    if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &error_size) != 0 ||
+        error != 0) {
+      NEARBY_LOGS(WARNING) << "Failed to connect, errno=" << error;
+      return false;
+    }
+    sockaddr_in peer = {};
+    socklen_t peer_size = sizeof(peer);
+    if (getpeername(fd_, reinterpret_cast<sockaddr*>(&peer), &peer_size) == 0) {
+      return true;
+    }
+
+    absl::MutexLock lock(&mutex_);
+    while (!writable_ && !closed_) {
+      if (cond_.WaitWithDeadline(&mutex_, deadline)) {
+        NEARBY_LOGS(WARNING) << "Timed out connecting.";
+        return false;
+      }
+    }
+  }
+}
+
+ExceptionOr<ByteArray> WifiLanSocket::Read(std::int64_t size) {
+  if (size <= 0) return ExceptionOr<ByteArray>(ByteArray());
+  std::string buffer(std::min(size, kMaxReadSize), '\0');
+  while (true) {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (closed_) return {Exception::kIo};
+      readable_ = false;
+    }
+    ssize_t result = recv(fd_, buffer.data(), buffer.size(), 0);
+    if (result > 0) {
+      buffer.resize(result);
+      return ExceptionOr<ByteArray>(ByteArray(std::move(buffer)));
+    }
+    if (result == 0) {
+      // The peer shut down its side; report the end of the stream.
+      return ExceptionOr<ByteArray>(ByteArray());
+    }
+    if (errno == EINTR) continue;
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      NEARBY_LOGS(WARNING) << "Failed to read from socket, errno=" << errno;
+      return {Exception::kIo};
+    }
+
+    absl::MutexLock lock(&mutex_);
+    while (!readable_ && !closed_) cond_.Wait(&mutex_);
+  }
+}
+
+Exception WifiLanSocket::Write(absl::Span<const absl::string_view> slices) {
+  std::vector<iovec> iovecs;
+  iovecs.reserve(slices.size());
+  for (absl::string_view slice : slices) {
+    if (slice.empty()) continue;
+    iovecs.push_back({const_cast<char*>(slice.data()), slice.size()});
+  }
+
+  size_t next = 0;
+  while (next < iovecs.size()) {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (closed_) return {Exception::kIo};
+      writable_ = false;
+    }
+    msghdr message = {};
+    message.msg_iov = &iovecs[next];
+    message.msg_iovlen = std::min<size_t>(iovecs.size() - next, IOV_MAX);
+    // MSG_NOSIGNAL turns a write to a reset connection into EPIPE instead of
+    // SIGPIPE.
+    ssize_t result = sendmsg(fd_, &message, MSG_NOSIGNAL);
+    if (result >= 0) {
+      size_t written = result;
+      while (next < iovecs.size() && written >= iovecs[next].iov_len) {
+        written -= iovecs[next].iov_len;
+        ++next;
+      }
+      if (written > 0) {
+        iovecs[next].iov_base = static_cast<char*>(iovecs[next].iov_base) +
+                                written;
+        iovecs[next].iov_len -= written;
+      }
+      continue;
+    }
+    if (errno == EINTR) continue;
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      NEARBY_LOGS(WARNING) << "Failed to write to socket, errno=" << errno;
+      return {Exception::kIo};
+    }
+
+    absl::MutexLock lock(&mutex_);
+    while (!writable_ && !closed_) cond_.Wait(&mutex_);
+  }
+  return {Exception::kSuccess};
+}
+
+void WifiLanSocket::OnEvents(std::uint32_t events) {
+  absl::AnyInvocable<void()> read_callback;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+      readable_ = true;
+      read_callback = std::exchange(read_callback_, nullptr);
+    }
+    if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) writable_ = true;
+    cond_.SignalAll();
+  }
+  if (read_callback) read_callback();
+}
+
+// WifiLanServerSocket
+
+WifiLanServerSocket::WifiLanServerSocket(EpollReactor& reactor, int fd,
+                                         std::string ip_address, int port)
+    : reactor_(reactor),
+      ip_address_(std::move(ip_address)),
+      port_(port),
+      fd_(fd) {
+  if (!reactor_.Add(fd, EPOLLIN,
+                    [this](std::uint32_t events) { OnEvents(events); })) {
+    absl::MutexLock lock(&mutex_);
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+WifiLanServerSocket::~WifiLanServerSocket() { Close(); }
+
+std::unique_ptr<api::WifiLanSocket> WifiLanServerSocket::Accept() {
+  int client_fd = -1;
+  {
+    absl::MutexLock lock(&mutex_);
+    while (fd_ >= 0) {
+      acceptable_ = false;
+      client_fd = accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (client_fd >= 0) break;
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        NEARBY_LOGS(WARNING) << "Failed to accept, errno=" << errno;
+        return nullptr;
+      }
+      while (!acceptable_ && fd_ >= 0) cond_.Wait(&mutex_);
+    }
+  }
+  if (client_fd < 0) return nullptr;
+  // Created outside of the lock: registering with the reactor takes the
+  // reactor lock, which OnEvents() is called under.
+  return std::make_unique<WifiLanSocket>(reactor_, client_fd);
+}
+
+Exception WifiLanServerSocket::Close() {
+  int fd;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (fd_ < 0) return {Exception::kSuccess};
+    fd = fd_;
+    fd_ = -1;
+    cond_.SignalAll();
+  }
+  reactor_.Remove(fd);
+  if (close(fd) != 0) return {Exception::kIo};
+  return {Exception::kSuccess};
+}
+
+void WifiLanServerSocket::OnEvents(std::uint32_t events) {
+  absl::MutexLock lock(&mutex_);
+  acceptable_ = true;
+  cond_.SignalAll();
+}
+
+// WifiLanMedium
+
+WifiLanMedium::WifiLanMedium()
+    : WifiLanMedium(std::make_unique<MulticastServiceDiscovery>()) {}
+
+WifiLanMedium::WifiLanMedium(
+    std::unique_ptr<ServiceDiscovery> service_discovery, EpollReactor& reactor)
+    : service_discovery_(std::move(service_discovery)), reactor_(reactor) {}
+
+bool WifiLanMedium::IsNetworkConnected() const {
+  return !GetLanIpAddress().empty();
+}
+
+bool WifiLanMedium::StartAdvertising(const NsdServiceInfo& nsd_service_info) {
+  return service_discovery_->StartAdvertising(nsd_service_info);
+}
+
+bool WifiLanMedium::StopAdvertising(const NsdServiceInfo& nsd_service_info) {
+  return service_discovery_->StopAdvertising(nsd_service_info);
+}
+
+bool WifiLanMedium::StartDiscovery(const std::string& service_type,
+                                   DiscoveredServiceCallback callback) {
+  return service_discovery_->StartDiscovery(service_type, std::move(callback));
+}
+
+bool WifiLanMedium::StopDiscovery(const std::string& service_type) {
+  return service_discovery_->StopDiscovery(service_type);
+}
+
+std::unique_ptr<api::WifiLanSocket> WifiLanMedium::ConnectToService(
+    const NsdServiceInfo& remote_service_info,
+    CancellationFlag* cancellation_flag) {
+  return ConnectToService(remote_service_info.GetIPAddress(),
+                          remote_service_info.GetPort(), cancellation_flag);
+}
+
+std::unique_ptr<api::WifiLanSocket> WifiLanMedium::ConnectToService(
+    const std::string& ip_address, int port,
+    CancellationFlag* cancellation_flag) {
+  if (ip_address.size() != 4 || port <= 0 || port > 65535) {
+    NEARBY_LOGS(ERROR) << "no valid service address and port to connect.";
+    return nullptr;
+  }
+  if (cancellation_flag != nullptr && cancellation_flag->Cancelled()) {
+    NEARBY_LOGS(INFO) << "WifiLan connect cancelled.";
+    return nullptr;
+  }
+
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    NEARBY_LOGS(ERROR) << "Failed to create socket, errno=" << errno;
+    return nullptr;
+  }
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  std::copy(ip_address.begin(), ip_address.end(),
+            reinterpret_cast<char*>(&address.sin_addr));
+  address.sin_port = htons(port);
+  if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) !=
+          0 &&
+      errno != EINPROGRESS) {
+    NEARBY_LOGS(WARNING) << "Failed to connect, errno=" << errno;
+    close(fd);
+    return nullptr;
+  }
+
+  auto socket = std::make_unique<WifiLanSocket>(reactor_, fd);
+  std::unique_ptr<CancellationFlagListener> cancellation_listener;
+  if (cancellation_flag != nullptr) {
+    cancellation_listener = std::make_unique<CancellationFlagListener>(
+        cancellation_flag, [socket = socket.get()]() { socket->Close(); });
+  }
+  if (!socket->AwaitConnected(kConnectTimeout)) return nullptr;
+  return socket;
+}
+
+std::unique_ptr<api::WifiLanServerSocket> WifiLanMedium::ListenForService(
+    int port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    NEARBY_LOGS(ERROR) << "Failed to create socket, errno=" << errno;
+    return nullptr;
+  }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  socklen_t address_size = sizeof(address);
+  if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(fd, SOMAXCONN) != 0 ||
+      getsockname(fd, reinterpret_cast<sockaddr*>(&address), &address_size) !=
+          0) {
+    NEARBY_LOGS(ERROR) << "Failed to listen on port " << port
+                       << ", errno=" << errno;
+    close(fd);
+    return nullptr;
+  }
+
+  std::string ip_address = GetLanIpAddress();
+  if (ip_address.empty()) {
+    in_addr loopback = {htonl(INADDR_LOOPBACK)};
+    ip_address.assign(reinterpret_cast<const char*>(&loopback), 4);
+  }
+  return std::make_unique<WifiLanServerSocket>(reactor_, fd, ip_address,
+                                               ntohs(address.sin_port));
+}
+
+absl::optional<std::pair<std::int32_t, std::int32_t>>
+WifiLanMedium::GetDynamicPortRange() {
+  std::ifstream range_file("/proc/sys/net/ipv4/ip_local_port_range");
+  std::int32_t min_port;
+  std::int32_t max_port;
+  if (!(range_file >> min_port >> max_port)) return absl::nullopt;
+  return std::make_pair(min_port, max_port);
+}
+
+}  // namespace linux_impl
+}  // namespace nearby
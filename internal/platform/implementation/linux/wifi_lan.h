@@ -0,0 +1,208 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_LINUX_WIFI_LAN_H_
+#define PLATFORM_IMPL_LINUX_WIFI_LAN_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/cancellation_flag.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/implementation/linux/epoll_reactor.h"
+#include "internal/platform/implementation/linux/service_discovery.h"
+#include "internal/platform/implementation/wifi_lan.h"
+#include "internal/platform/input_stream.h"
+#include "internal/platform/nsd_service_info.h"
+#include "internal/platform/output_stream.h"
+
+namespace nearby {
+namespace linux_impl {
+
+// A connected, non-blocking TCP socket. Blocked reads and writes wait for the
+// reactor to report the socket ready again.
+class WifiLanSocket : public api::WifiLanSocket {
+ public:
+  // Takes ownership of the connected, non-blocking `fd`.
+  WifiLanSocket(EpollReactor& reactor, int fd);
+  ~WifiLanSocket() override;
+
+  // Returns the InputStream of this connected WifiLanSocket.
+  InputStream& GetInputStream() override { return input_stream_; }
+
+  // Returns the OutputStream of this connected WifiLanSocket.
+  OutputStream& GetOutputStream() override { return output_stream_; }
+
+  // Returns Exception::kIo on error, Exception::kSuccess otherwise.
+  Exception Close() override ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Calls `callback` from the reactor thread once the socket has data, has
+  // been shut down by the peer, or fails; or from Close(). Returns false if
+  // the socket is already closed.
+  bool NotifyWhenReadable(absl::AnyInvocable<void()> callback) override
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Waits until a non-blocking connect() on the socket completes. Returns
+  // false on error, timeout or Close().
+  bool AwaitConnected(absl::Duration timeout) ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  class SocketInputStream : public InputStream {
+   public:
+    explicit SocketInputStream(WifiLanSocket& socket) : socket_(socket) {}
+
+    ExceptionOr<ByteArray> Read(std::int64_t size) override {
+      return socket_.Read(size);
+    }
+    Exception Close() override { return socket_.Close(); }
+
+   private:
+    WifiLanSocket& socket_;
+  };
+
+  class SocketOutputStream : public OutputStream {
+   public:
+    explicit SocketOutputStream(WifiLanSocket& socket) : socket_(socket) {}
+
+    Exception Write(const ByteArray& data) override {
+      absl::string_view slice = data.AsStringView();
+      return socket_.Write(absl::MakeConstSpan(&slice, 1));
+    }
+    Exception WriteV(absl::Span<const absl::string_view> slices) override {
+      return socket_.Write(slices);
+    }
+    Exception Flush() override { return {Exception::kSuccess}; }
+    Exception Close() override { return socket_.Close(); }
+
+   private:
+    WifiLanSocket& socket_;
+  };
+
+  ExceptionOr<ByteArray> Read(std::int64_t size) ABSL_LOCKS_EXCLUDED(mutex_);
+  // Writes all of `slices` with as few system calls as the socket allows.
+  Exception Write(absl::Span<const absl::string_view> slices)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void OnEvents(std::uint32_t events) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  EpollReactor& reactor_;
+  // Closed by the destructor only, so that a concurrent read or write never
+  // sees the descriptor reused.
+  const int fd_;
+  absl::Mutex mutex_;
+  absl::CondVar cond_;
+  // Set by the reactor, cleared before each attempt that may hit EAGAIN.
+  bool readable_ ABSL_GUARDED_BY(mutex_) = true;
+  bool writable_ ABSL_GUARDED_BY(mutex_) = true;
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+  // Set by NotifyWhenReadable() until the socket is readable.
+  absl::AnyInvocable<void()> read_callback_ ABSL_GUARDED_BY(mutex_);
+  SocketInputStream input_stream_{*this};
+  SocketOutputStream output_stream_{*this};
+};
+
+class WifiLanServerSocket : public api::WifiLanServerSocket {
+ public:
+  // Takes ownership of the listening, non-blocking `fd`.
+  WifiLanServerSocket(EpollReactor& reactor, int fd, std::string ip_address,
+                      int port);
+  ~WifiLanServerSocket() override;
+
+  // Returns the ip address as 4 bytes in network order.
+  std::string GetIPAddress() const override { return ip_address_; }
+
+  int GetPort() const override { return port_; }
+
+  // Blocks until a connection is accepted or the socket is closed.
+  // Returns nullptr on error.
+  std::unique_ptr<api::WifiLanSocket> Accept() override
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns Exception::kIo on error, Exception::kSuccess otherwise.
+  Exception Close() override ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  void OnEvents(std::uint32_t events) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  EpollReactor& reactor_;
+  const std::string ip_address_;
+  const int port_;
+  absl::Mutex mutex_;
+  absl::CondVar cond_;
+  // Reset to -1 by Close(); accept() runs under the lock.
+  int fd_ ABSL_GUARDED_BY(mutex_);
+  bool acceptable_ ABSL_GUARDED_BY(mutex_) = true;
+};
+
+// WifiLan medium on top of the Linux TCP/IP stack.
+//
+// All sockets created by a medium share one EpollReactor, so the number of
+// threads does not grow with the number of connections. Service discovery is
+// delegated to a ServiceDiscovery, which is MulticastServiceDiscovery unless
+// one is injected.
+class WifiLanMedium : public api::WifiLanMedium {
+ public:
+  // Time given to a TCP connection to be established.
+  static constexpr absl::Duration kConnectTimeout = absl::Seconds(10);
+
+  WifiLanMedium();
+  explicit WifiLanMedium(std::unique_ptr<ServiceDiscovery> service_discovery,
+                         EpollReactor& reactor = EpollReactor::GetDefault());
+  ~WifiLanMedium() override = default;
+
+  // Returns true if an IPv4 interface other than loopback is up.
+  bool IsNetworkConnected() const override;
+
+  bool StartAdvertising(const NsdServiceInfo& nsd_service_info) override;
+  bool StopAdvertising(const NsdServiceInfo& nsd_service_info) override;
+  bool StartDiscovery(const std::string& service_type,
+                      DiscoveredServiceCallback callback) override;
+  bool StopDiscovery(const std::string& service_type) override;
+
+  std::unique_ptr<api::WifiLanSocket> ConnectToService(
+      const NsdServiceInfo& remote_service_info,
+      CancellationFlag* cancellation_flag) override;
+
+  // `ip_address` is 4 bytes in network order.
+  std::unique_ptr<api::WifiLanSocket> ConnectToService(
+      const std::string& ip_address, int port,
+      CancellationFlag* cancellation_flag) override;
+
+  // Listens on all interfaces; the server socket reports the address of the
+  // first one that is up, or loopback when there is none.
+  std::unique_ptr<api::WifiLanServerSocket> ListenForService(
+      int port) override;
+
+  // Returns the kernel's ephemeral port range.
+  absl::optional<std::pair<std::int32_t, std::int32_t>> GetDynamicPortRange()
+      override;
+
+ private:
+  std::unique_ptr<ServiceDiscovery> service_discovery_;
+  EpollReactor& reactor_;
+};
+
+}  // namespace linux_impl
+}  // namespace nearby
+
+#endif  // PLATFORM_IMPL_LINUX_WIFI_LAN_H_
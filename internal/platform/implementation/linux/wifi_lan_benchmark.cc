@@ -0,0 +1,116 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// End-to-end throughput of the Linux WifiLan medium over localhost.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/cancellation_flag.h"
+#include "internal/platform/implementation/linux/service_discovery.h"
+#include "internal/platform/implementation/linux/wifi_lan.h"
+
+namespace nearby {
+namespace linux_impl {
+namespace {
+
+constexpr std::int64_t kBytesPerStream = 16 * 1024 * 1024;
+
+struct SocketPair {
+  std::unique_ptr<api::WifiLanSocket> client;
+  std::unique_ptr<api::WifiLanSocket> server;
+};
+
+std::vector<SocketPair> ConnectPairs(WifiLanMedium& medium, int count) {
+  std::unique_ptr<api::WifiLanServerSocket> server_socket =
+      medium.ListenForService(0);
+  std::vector<SocketPair> pairs(count);
+  CancellationFlag flag;
+  for (SocketPair& pair : pairs) {
+    pair.client = medium.ConnectToService(std::string({127, 0, 0, 1}),
+                                          server_socket->GetPort(), &flag);
+    pair.server = server_socket->Accept();
+  }
+  return pairs;
+}
+
+// Sends kBytesPerStream over one connection in chunks of state.range(0).
+void BM_StreamThroughput(benchmark::State& state) {
+  WifiLanMedium medium(std::make_unique<LoopbackServiceDiscovery>(
+      std::make_shared<LoopbackServiceDiscovery::Network>()));
+  std::vector<SocketPair> pairs = ConnectPairs(medium, 1);
+  ByteArray chunk(std::string(state.range(0), 'x'));
+
+  for (auto _ : state) {
+    std::thread writer([&]() {
+      for (std::int64_t sent = 0; sent < kBytesPerStream;
+           sent += chunk.size()) {
+        pairs[0].client->GetOutputStream().Write(chunk);
+      }
+    });
+    for (std::int64_t received = 0; received < kBytesPerStream;) {
+      received +=
+          pairs[0].server->GetInputStream().Read(state.range(0)).result().size();
+    }
+    writer.join();
+  }
+  state.SetBytesProcessed(state.iterations() * kBytesPerStream);
+}
+BENCHMARK(BM_StreamThroughput)
+    ->Arg(4 * 1024)
+    ->Arg(64 * 1024)
+    ->Arg(512 * 1024)
+    ->UseRealTime();
+
+// Sends kBytesPerStream over each of state.range(0) concurrent connections,
+// all served by the one shared reactor thread.
+void BM_ConcurrentStreams(benchmark::State& state) {
+  constexpr std::int64_t kChunkSize = 64 * 1024;
+  WifiLanMedium medium(std::make_unique<LoopbackServiceDiscovery>(
+      std::make_shared<LoopbackServiceDiscovery::Network>()));
+  std::vector<SocketPair> pairs = ConnectPairs(medium, state.range(0));
+  ByteArray chunk(std::string(kChunkSize, 'x'));
+
+  for (auto _ : state) {
+    std::vector<std::thread> threads;
+    for (SocketPair& pair : pairs) {
+      threads.emplace_back([&]() {
+        for (std::int64_t sent = 0; sent < kBytesPerStream;
+             sent += chunk.size()) {
+          pair.client->GetOutputStream().Write(chunk);
+        }
+      });
+      threads.emplace_back([&]() {
+        for (std::int64_t received = 0; received < kBytesPerStream;) {
+          received +=
+              pair.server->GetInputStream().Read(kChunkSize).result().size();
+        }
+      });
+    }
+    for (std::thread& thread : threads) thread.join();
+  }
+  state.SetBytesProcessed(state.iterations() * kBytesPerStream *
+                          state.range(0));
+}
+BENCHMARK(BM_ConcurrentStreams)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+
+}  // namespace
+}  // namespace linux_impl
+}  // namespace nearby
@@ -0,0 +1,258 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/linux/wifi_lan.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/cancellation_flag.h"
+#include "internal/platform/implementation/linux/service_discovery.h"
+#include "internal/platform/nsd_service_info.h"
+
+namespace nearby {
+namespace linux_impl {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr char kLoopbackIp[] = {127, 0, 0, 1};
+constexpr char kServiceType[] = "_nearby._tcp";
+
+std::string LoopbackIp() { return std::string(kLoopbackIp, 4); }
+
+class WifiLanMediumTest : public ::testing::Test {
+ protected:
+  WifiLanMediumTest()
+      : network_(std::make_shared<LoopbackServiceDiscovery::Network>()),
+        medium_(std::make_unique<LoopbackServiceDiscovery>(network_)) {}
+
+  // Returns a connected pair of sockets: the client first, then the server
+  // side.
+  std::pair<std::unique_ptr<api::WifiLanSocket>,
+            std::unique_ptr<api::WifiLanSocket>>
+  Connect() {
+    std::unique_ptr<api::WifiLanServerSocket> server_socket =
+        medium_.ListenForService(0);
+    EXPECT_NE(server_socket, nullptr);
+    std::unique_ptr<api::WifiLanSocket> server_side;
+    std::thread acceptor(
+        [&]() { server_side = server_socket->Accept(); });
+    CancellationFlag flag;
+    std::unique_ptr<api::WifiLanSocket> client_side = medium_.ConnectToService(
+        LoopbackIp(), server_socket->GetPort(), &flag);
+    acceptor.join();
+    EXPECT_NE(client_side, nullptr);
+    EXPECT_NE(server_side, nullptr);
+    return {std::move(client_side), std::move(server_side)};
+  }
+
+  std::shared_ptr<LoopbackServiceDiscovery::Network> network_;
+  WifiLanMedium medium_;
+};
+
+TEST_F(WifiLanMediumTest, ConnectedSocketsExchangeData) {
+  auto [client, server] = Connect();
+
+  EXPECT_TRUE(client->GetOutputStream().Write(ByteArray("ping")).Ok());
+  ExceptionOr<ByteArray> received = server->GetInputStream().ReadExactly(4);
+  ASSERT_TRUE(received.ok());
+  EXPECT_EQ(std::string(received.result()), "ping");
+
+  EXPECT_TRUE(server->GetOutputStream().Write(ByteArray("pong")).Ok());
+  received = client->GetInputStream().ReadExactly(4);
+  ASSERT_TRUE(received.ok());
+  EXPECT_EQ(std::string(received.result()), "pong");
+}
+
+TEST_F(WifiLanMediumTest, WriteVSendsLargeSlicesWhileBlocked) {
+  auto [client, server] = Connect();
+  // Larger than the socket buffers, so the writer has to wait for the reader.
+  std::string header(4, 'h');
+  std::string body(8 * 1024 * 1024, 'b');
+  std::vector<absl::string_view> slices = {header, body};
+
+  std::thread writer([&, &client = client]() {
+    EXPECT_TRUE(client->GetOutputStream().WriteV(slices).Ok());
+  });
+  ExceptionOr<ByteArray> received =
+      server->GetInputStream().ReadExactly(header.size() + body.size());
+  writer.join();
+
+  ASSERT_TRUE(received.ok());
+  EXPECT_EQ(std::string(received.result()), header + body);
+}
+
+TEST_F(WifiLanMediumTest, ReadReturnsEmptyAtEndOfStream) {
+  auto [client, server] = Connect();
+
+  client->Close();
+  ExceptionOr<ByteArray> received = server->GetInputStream().Read(16);
+
+  ASSERT_TRUE(received.ok());
+  EXPECT_TRUE(received.result().Empty());
+}
+
+TEST_F(WifiLanMediumTest, CloseUnblocksRead) {
+  auto [client, server] = Connect();
+
+  std::thread closer([&, &server = server]() {
+    absl::SleepFor(absl::Milliseconds(100));
+    server->Close();
+  });
+  ExceptionOr<ByteArray> received = server->GetInputStream().Read(16);
+  closer.join();
+
+  EXPECT_TRUE(received.exception() == Exception::kIo);
+}
+
+TEST_F(WifiLanMediumTest, NotifyWhenReadableReportsNewData) {
+  auto [client, server] = Connect();
+  absl::Notification readable;
+
+  ASSERT_TRUE(server->NotifyWhenReadable([&]() { readable.Notify(); }));
+  EXPECT_FALSE(readable.WaitForNotificationWithTimeout(absl::Milliseconds(50)));
+  EXPECT_TRUE(client->GetOutputStream().Write(ByteArray("ping")).Ok());
+
+  EXPECT_TRUE(readable.WaitForNotificationWithTimeout(absl::Seconds(1)));
+}
+
+TEST_F(WifiLanMediumTest, NotifyWhenReadableReportsPendingData) {
+  auto [client, server] = Connect();
+  EXPECT_TRUE(client->GetOutputStream().Write(ByteArray("ping")).Ok());
+  // Consumes part of the data, so that the rest arrived before the callback
+  // was set.
+  ASSERT_TRUE(server->GetInputStream().ReadExactly(2).ok());
+  absl::Notification readable;
+
+  ASSERT_TRUE(server->NotifyWhenReadable([&]() { readable.Notify(); }));
+
+  EXPECT_TRUE(readable.WaitForNotificationWithTimeout(absl::Seconds(1)));
+}
+
+TEST_F(WifiLanMediumTest, CloseCallsReadableCallback) {
+  auto [client, server] = Connect();
+  absl::Notification readable;
+  ASSERT_TRUE(server->NotifyWhenReadable([&]() { readable.Notify(); }));
+
+  server->Close();
+
+  EXPECT_TRUE(readable.HasBeenNotified());
+  EXPECT_FALSE(server->NotifyWhenReadable([]() {}));
+}
+
+TEST_F(WifiLanMediumTest, CloseUnblocksAccept) {
+  std::unique_ptr<api::WifiLanServerSocket> server_socket =
+      medium_.ListenForService(0);
+  ASSERT_NE(server_socket, nullptr);
+
+  std::thread closer([&]() {
+    absl::SleepFor(absl::Milliseconds(100));
+    server_socket->Close();
+  });
+  std::unique_ptr<api::WifiLanSocket> socket = server_socket->Accept();
+  closer.join();
+
+  EXPECT_EQ(socket, nullptr);
+}
+
+TEST_F(WifiLanMediumTest, ConnectToClosedPortFails) {
+  std::unique_ptr<api::WifiLanServerSocket> server_socket =
+      medium_.ListenForService(0);
+  ASSERT_NE(server_socket, nullptr);
+  int port = server_socket->GetPort();
+  server_socket->Close();
+
+  CancellationFlag flag;
+  EXPECT_EQ(medium_.ConnectToService(LoopbackIp(), port, &flag), nullptr);
+}
+
+TEST_F(WifiLanMediumTest, ConnectWithCancelledFlagFails) {
+  std::unique_ptr<api::WifiLanServerSocket> server_socket =
+      medium_.ListenForService(0);
+  ASSERT_NE(server_socket, nullptr);
+
+  CancellationFlag flag(true);
+  EXPECT_EQ(medium_.ConnectToService(LoopbackIp(), server_socket->GetPort(),
+                                     &flag),
+            nullptr);
+}
+
+TEST_F(WifiLanMediumTest, LoopbackDiscoveryReportsFoundAndLost) {
+  WifiLanMedium discoverer(std::make_unique<LoopbackServiceDiscovery>(network_));
+  std::vector<std::string> events;
+  EXPECT_TRUE(discoverer.StartDiscovery(
+      kServiceType,
+      {
+          .service_discovered_cb =
+              [&events](NsdServiceInfo service_info) {
+                events.push_back("found " + service_info.GetServiceName());
+              },
+          .service_lost_cb =
+              [&events](NsdServiceInfo service_info) {
+                events.push_back("lost " + service_info.GetServiceName());
+              },
+      }));
+
+  NsdServiceInfo service_info;
+  service_info.SetServiceType(kServiceType);
+  service_info.SetServiceName("service");
+  service_info.SetIPAddress(LoopbackIp());
+  service_info.SetPort(1234);
+  EXPECT_TRUE(medium_.StartAdvertising(service_info));
+  EXPECT_FALSE(medium_.StartAdvertising(service_info));
+  EXPECT_TRUE(medium_.StopAdvertising(service_info));
+  EXPECT_TRUE(discoverer.StopDiscovery(kServiceType));
+  EXPECT_TRUE(medium_.StartAdvertising(service_info));
+
+  EXPECT_THAT(events, ElementsAre("found service", "lost service"));
+}
+
+TEST_F(WifiLanMediumTest, DiscoveryReportsServicesAdvertisedBeforeStart) {
+  NsdServiceInfo service_info;
+  service_info.SetServiceType(kServiceType);
+  service_info.SetServiceName("service");
+  EXPECT_TRUE(medium_.StartAdvertising(service_info));
+
+  WifiLanMedium discoverer(std::make_unique<LoopbackServiceDiscovery>(network_));
+  std::vector<std::string> found;
+  EXPECT_TRUE(discoverer.StartDiscovery(
+      kServiceType, {.service_discovered_cb = [&found](
+                         NsdServiceInfo service_info) {
+        found.push_back(service_info.GetServiceName());
+      }}));
+
+  EXPECT_THAT(found, ElementsAre("service"));
+}
+
+TEST_F(WifiLanMediumTest, GetDynamicPortRange) {
+  auto range = medium_.GetDynamicPortRange();
+
+  ASSERT_TRUE(range.has_value());
+  EXPECT_LT(range->first, range->second);
+}
+
+}  // namespace
+}  // namespace linux_impl
+}  // namespace nearby
@@ -85,6 +85,11 @@ class PreferencesManager {
 
   // Removes preferences
   virtual void Remove(absl::string_view key) = 0;
+
+  // Implementations may write changes to storage some time after they are
+  // made, but must write all of them before they are destroyed. Writes all
+  // changes made so far before returning.
+  virtual void Flush() {}
 };
 
 }  // namespace api
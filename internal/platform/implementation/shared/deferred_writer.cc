@@ -0,0 +1,93 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/deferred_writer.h"
+
+#include <utility>
+
+#include "absl/functional/any_invocable.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace shared {
+
+DeferredWriter::DeferredWriter(absl::Duration delay,
+                               absl::AnyInvocable<void()> write)
+    : delay_(delay), write_(std::move(write)) {
+  thread_ = std::thread([this]() { Run(); });
+}
+
+DeferredWriter::~DeferredWriter() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopped_ = true;
+  }
+  thread_.join();
+  Flush();
+}
+
+void DeferredWriter::Request() {
+  absl::MutexLock lock(&mutex_);
+  if (pending_) return;
+  pending_ = true;
+  deadline_ = absl::Now() + delay_;
+}
+
+void DeferredWriter::Flush() {
+  absl::MutexLock lock(&mutex_);
+  // A write that is running may have started before the latest request.
+  mutex_.Await(absl::Condition(this, &DeferredWriter::IsIdle));
+  if (pending_) {
+    WritePending();
+  }
+}
+
+void DeferredWriter::Run() {
+  absl::MutexLock lock(&mutex_);
+  while (true) {
+    mutex_.Await(absl::Condition(this, &DeferredWriter::HasWork));
+    if (stopped_) return;
+    // Waits for the deadline, unless Flush() takes over the write first.
+    mutex_.AwaitWithDeadline(
+        absl::Condition(this, &DeferredWriter::ShouldStopWaiting), deadline_);
+    if (stopped_) return;
+    if (pending_ && !writing_) {
+      WritePending();
+    }
+  }
+}
+
+bool DeferredWriter::IsIdle() const { return !writing_; }
+
+bool DeferredWriter::HasWork() const {
+  return stopped_ || (pending_ && !writing_);
+}
+
+bool DeferredWriter::ShouldStopWaiting() const {
+  return stopped_ || !pending_ || writing_;
+}
+
+void DeferredWriter::WritePending() {
+  pending_ = false;
+  writing_ = true;
+  mutex_.Unlock();
+  write_();
+  mutex_.Lock();
+  writing_ = false;
+}
+
+}  // namespace shared
+}  // namespace nearby
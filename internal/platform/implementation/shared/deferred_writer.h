@@ -0,0 +1,72 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_SHARED_DEFERRED_WRITER_H_
+#define PLATFORM_IMPL_SHARED_DEFERRED_WRITER_H_
+
+#include <thread>  // NOLINT
+
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace shared {
+
+// Runs `write` on a thread of its own at most `delay` after it is requested,
+// so that a burst of requests costs a single write. `write` is expected to
+// save the latest state of its owner, whatever the number of requests.
+//
+// Calls to `write` never overlap.
+class DeferredWriter {
+ public:
+  DeferredWriter(absl::Duration delay, absl::AnyInvocable<void()> write);
+  // Runs the pending write, if any.
+  ~DeferredWriter();
+
+  DeferredWriter(const DeferredWriter&) = delete;
+  DeferredWriter& operator=(const DeferredWriter&) = delete;
+
+  // Schedules a write, unless one is already pending. Does not block.
+  void Request() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Runs the pending write, if any, on the calling thread. When it returns,
+  // everything requested before the call has been written.
+  void Flush() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  void Run() ABSL_LOCKS_EXCLUDED(mutex_);
+  // Conditions for mutex_.Await().
+  bool IsIdle() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool ShouldStopWaiting() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Runs the pending write with mutex_ released; waits for a running one
+  // first.
+  void WritePending() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const absl::Duration delay_;
+  absl::AnyInvocable<void()> write_;
+  absl::Mutex mutex_;
+  bool pending_ ABSL_GUARDED_BY(mutex_) = false;
+  bool writing_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  absl::Time deadline_ ABSL_GUARDED_BY(mutex_);
+  std::thread thread_;
+};
+
+}  // namespace shared
+}  // namespace nearby
+
+#endif  // PLATFORM_IMPL_SHARED_DEFERRED_WRITER_H_
@@ -0,0 +1,95 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/deferred_writer.h"
+
+#include <atomic>
+
+#include "gtest/gtest.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace shared {
+namespace {
+
+TEST(DeferredWriterTest, BurstOfRequestsIsWrittenOnce) {
+  std::atomic<int> writes = 0;
+  absl::Notification written;
+  DeferredWriter writer(absl::Milliseconds(50), [&]() {
+    ++writes;
+    written.Notify();
+  });
+
+  for (int i = 0; i < 100; ++i) {
+    writer.Request();
+  }
+
+  EXPECT_TRUE(written.WaitForNotificationWithTimeout(absl::Seconds(5)));
+  absl::SleepFor(absl::Milliseconds(100));
+  EXPECT_EQ(writes, 1);
+}
+
+TEST(DeferredWriterTest, WritesNoEarlierThanDelay) {
+  absl::Notification written;
+  DeferredWriter writer(absl::Milliseconds(50), [&]() { written.Notify(); });
+  absl::Time start = absl::Now();
+
+  writer.Request();
+
+  EXPECT_TRUE(written.WaitForNotificationWithTimeout(absl::Seconds(5)));
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(50));
+}
+
+TEST(DeferredWriterTest, RequestAfterWriteIsWrittenAgain) {
+  std::atomic<int> writes = 0;
+  DeferredWriter writer(absl::Milliseconds(10), [&]() { ++writes; });
+
+  writer.Request();
+  absl::SleepFor(absl::Milliseconds(100));
+  writer.Request();
+  absl::SleepFor(absl::Milliseconds(100));
+
+  EXPECT_EQ(writes, 2);
+}
+
+TEST(DeferredWriterTest, FlushWritesPendingRequestNow) {
+  std::atomic<int> writes = 0;
+  DeferredWriter writer(absl::Hours(1), [&]() { ++writes; });
+
+  writer.Flush();
+  EXPECT_EQ(writes, 0);
+
+  writer.Request();
+  writer.Flush();
+  EXPECT_EQ(writes, 1);
+
+  writer.Flush();
+  EXPECT_EQ(writes, 1);
+}
+
+TEST(DeferredWriterTest, DestructorWritesPendingRequest) {
+  std::atomic<int> writes = 0;
+  {
+    DeferredWriter writer(absl::Hours(1), [&]() { ++writes; });
+    writer.Request();
+  }
+
+  EXPECT_EQ(writes, 1);
+}
+
+}  // namespace
+}  // namespace shared
+}  // namespace nearby
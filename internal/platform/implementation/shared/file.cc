@@ -14,11 +14,20 @@
 
 #include "internal/platform/implementation/shared/file.h"
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <algorithm>
+#include <cerrno>
 #include <cstddef>
+#include <cstdint>
 #include <ios>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
@@ -27,12 +36,29 @@
 namespace nearby {
 namespace shared {
 
+#if !defined(_WIN32)
+namespace {
+// Pages of an input file are dropped from the page cache in steps of this
+// size once they have been read.
+constexpr std::int64_t kDropCacheStep = 8 * 1024 * 1024;
+// Disk space for an output file is reserved in steps of this size.
+constexpr std::int64_t kReserveStep = 8 * 1024 * 1024;
+}  // namespace
+#endif  // !defined(_WIN32)
+
 // InputFile
 std::unique_ptr<IOFile> IOFile::CreateInputFile(
     const absl::string_view file_path, size_t size) {
   return absl::WrapUnique(new IOFile(file_path, size));
 }
 
+std::unique_ptr<IOFile> IOFile::CreateOutputFile(const absl::string_view path) {
+  return std::unique_ptr<IOFile>(new IOFile(path));
+}
+
+IOFile::~IOFile() { Close(); }
+
+#if defined(_WIN32)
 IOFile::IOFile(const absl::string_view file_path, size_t size)
     : file_(std::string(file_path.data(), file_path.size()),
             std::ios::binary | std::ios::in | std::ios::ate),
@@ -41,10 +67,6 @@ IOFile::IOFile(const absl::string_view file_path, size_t size)
   file_.seekg(0);
 }
 
-std::unique_ptr<IOFile> IOFile::CreateOutputFile(const absl::string_view path) {
-  return std::unique_ptr<IOFile>(new IOFile(path));
-}
-
 IOFile::IOFile(const absl::string_view file_path)
     : file_(), path_(file_path), total_size_(0) {
   file_.open(path_, std::ios::binary | std::ios::out);
@@ -63,15 +85,33 @@ ExceptionOr<ByteArray> IOFile::Read(std::int64_t size) {
     return ExceptionOr<ByteArray>{Exception::kIo};
   }
 
-  ByteArray bytes(size);
-  std::unique_ptr<char[]> read_bytes{new char[size]};
-  file_.read(read_bytes.get(), static_cast<ptrdiff_t>(size));
+  std::string bytes(size, '\0');
+  file_.read(bytes.data(), static_cast<std::streamsize>(size));
   auto num_bytes_read = file_.gcount();
   if (num_bytes_read == 0) {
     return ExceptionOr<ByteArray>{Exception::kIo};
   }
+  bytes.resize(num_bytes_read);
+
+  return ExceptionOr<ByteArray>(ByteArray(std::move(bytes)));
+}
+
+ExceptionOr<size_t> IOFile::Skip(size_t offset) {
+  if (!file_.is_open()) {
+    return ExceptionOr<size_t>{Exception::kIo};
+  }
+  if (file_.eof()) {
+    return ExceptionOr<size_t>(0);
+  }
+  std::int64_t position = file_.tellg();
+  if (position < 0) {
+    return ExceptionOr<size_t>{Exception::kIo};
+  }
 
-  return ExceptionOr<ByteArray>(ByteArray(read_bytes.get(), num_bytes_read));
+  size_t skipped = std::min<std::int64_t>(
+      offset, std::max<std::int64_t>(total_size_ - position, 0));
+  file_.seekg(skipped, std::ios::cur);
+  return ExceptionOr<size_t>(skipped);
 }
 
 Exception IOFile::Close() {
@@ -99,6 +139,133 @@ Exception IOFile::Flush() {
   file_.flush();
   return {file_.good() ? Exception::kSuccess : Exception::kIo};
 }
+#else  // !defined(_WIN32)
+IOFile::IOFile(const absl::string_view file_path, size_t size)
+    : path_(file_path), total_size_(-1) {
+  fd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) return;
+  total_size_ = GetFileSize();
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+IOFile::IOFile(const absl::string_view file_path)
+    : path_(file_path), total_size_(0) {
+  fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+}
+
+std::int64_t IOFile::GetFileSize() const {
+  struct stat file_stat;
+  if (fstat(fd_, &file_stat) != 0) {
+    return -1;
+  }
+  return file_stat.st_size;
+}
+
+ExceptionOr<ByteArray> IOFile::Read(std::int64_t size) {
+  if (fd_ < 0 || size < 0) {
+    return ExceptionOr<ByteArray>{Exception::kIo};
+  }
+
+  // Read straight into the string that the ByteArray takes over, so the data
+  // is copied only once, from the kernel.
+  std::string bytes(size, '\0');
+  std::int64_t num_bytes_read = 0;
+  while (num_bytes_read < size) {
+    ssize_t result = pread(fd_, bytes.data() + num_bytes_read,
+                           size - num_bytes_read, offset_ + num_bytes_read);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      return ExceptionOr<ByteArray>{Exception::kIo};
+    }
+    if (result == 0) break;  // End of file.
+    num_bytes_read += result;
+  }
+  offset_ += num_bytes_read;
+  bytes.resize(num_bytes_read);
+
+#ifdef POSIX_FADV_DONTNEED
+  // The file is read once, front to back; keep large transfers from filling
+  // the page cache with pages that won't be read again.
+  if (offset_ - dropped_offset_ >= kDropCacheStep) {
+    posix_fadvise(fd_, dropped_offset_, offset_ - dropped_offset_,
+                  POSIX_FADV_DONTNEED);
+    dropped_offset_ = offset_;
+  }
+#endif
+
+  return ExceptionOr<ByteArray>(ByteArray(std::move(bytes)));
+}
+
+ExceptionOr<size_t> IOFile::Skip(size_t offset) {
+  if (fd_ < 0) {
+    return ExceptionOr<size_t>{Exception::kIo};
+  }
+  std::int64_t file_size = GetFileSize();
+  if (file_size < 0) {
+    return ExceptionOr<size_t>{Exception::kIo};
+  }
+
+  size_t skipped = std::min<std::int64_t>(
+      offset, std::max<std::int64_t>(file_size - offset_, 0));
+  offset_ += skipped;
+  return ExceptionOr<size_t>(skipped);
+}
+
+Exception IOFile::Close() {
+  if (fd_ >= 0) {
+    // Give back the space reserved past the end of the file. Truncating to
+    // the current size frees the blocks allocated beyond it.
+    if (reserved_offset_ > offset_) {
+      ftruncate(fd_, offset_);
+      reserved_offset_ = offset_;
+    }
+    close(fd_);
+    fd_ = -1;
+  }
+  return {Exception::kSuccess};
+}
+
+Exception IOFile::Write(const ByteArray& data) {
+  if (fd_ < 0) {
+    return {Exception::kIo};
+  }
+
+#ifdef FALLOC_FL_KEEP_SIZE
+  // Reserve space ahead of the writes so that a large file is laid out in few
+  // extents. The visible file size is left alone; failures are harmless.
+  std::int64_t end = offset_ + data.size();
+  if (end > reserved_offset_) {
+    std::int64_t length = std::max<std::int64_t>(kReserveStep, end - offset_);
+    if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, offset_, length) == 0) {
+      reserved_offset_ = offset_ + length;
+    } else {
+      reserved_offset_ = end;
+    }
+  }
+#endif
+
+  size_t num_bytes_written = 0;
+  while (num_bytes_written < data.size()) {
+    ssize_t result = pwrite(fd_, data.data() + num_bytes_written,
+                            data.size() - num_bytes_written,
+                            offset_ + num_bytes_written);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      return {Exception::kIo};
+    }
+    num_bytes_written += result;
+  }
+  offset_ += num_bytes_written;
+  return {Exception::kSuccess};
+}
+
+Exception IOFile::Flush() {
+  // Writes go straight to the file descriptor; there is no buffer to flush.
+  return {fd_ >= 0 ? Exception::kSuccess : Exception::kIo};
+}
+#endif  // defined(_WIN32)
 
 }  // namespace shared
 }  // namespace nearby
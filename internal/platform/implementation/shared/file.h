@@ -15,9 +15,13 @@
 #ifndef PLATFORM_IMPL_SHARED_FILE_H_
 #define PLATFORM_IMPL_SHARED_FILE_H_
 
+#include <cstddef>
 #include <cstdint>
-#include <fstream>
+#include <memory>
 #include <string>
+#if defined(_WIN32)
+#include <fstream>
+#endif
 
 #include "absl/strings/string_view.h"
 #include "internal/platform/exception.h"
@@ -27,6 +31,13 @@
 namespace nearby {
 namespace shared {
 
+// File backed by a POSIX file descriptor, or by a std::fstream on Windows.
+//
+// Skip() only moves the read offset, so resuming a transfer does not read the
+// skipped bytes. With a file descriptor, reads use pread() straight into the
+// returned ByteArray. Where supported, input files are read with a sequential
+// access hint and pages already read are dropped from the page cache, and
+// output files reserve disk space ahead of the writes.
 class IOFile final : public api::InputFile, public api::OutputFile {
  public:
   static std::unique_ptr<IOFile> CreateInputFile(
@@ -34,7 +45,10 @@ class IOFile final : public api::InputFile, public api::OutputFile {
 
   static std::unique_ptr<IOFile> CreateOutputFile(const absl::string_view path);
 
+  ~IOFile() override;
+
   ExceptionOr<ByteArray> Read(std::int64_t size) override;
+  ExceptionOr<size_t> Skip(size_t offset) override;
 
   std::string GetFilePath() const override { return path_; }
 
@@ -48,9 +62,24 @@ class IOFile final : public api::InputFile, public api::OutputFile {
   explicit IOFile(const absl::string_view file_path, size_t size);
   explicit IOFile(const absl::string_view file_path);
 
+#if defined(_WIN32)
   std::fstream file_;
   std::string path_;
   std::int64_t total_size_;
+#else
+  // Returns the current size of the open file, or -1 on error.
+  std::int64_t GetFileSize() const;
+
+  int fd_ = -1;
+  std::string path_;
+  std::int64_t total_size_;
+  // Offset of the next Read() or Write().
+  std::int64_t offset_ = 0;
+  // Input: offset up to which pages were dropped from the page cache.
+  std::int64_t dropped_offset_ = 0;
+  // Output: offset up to which disk space is reserved.
+  std::int64_t reserved_offset_ = 0;
+#endif  // defined(_WIN32)
 };
 
 }  // namespace shared
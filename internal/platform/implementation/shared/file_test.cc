@@ -14,6 +14,11 @@
 
 #include "internal/platform/implementation/shared/file.h"
 
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#endif
+
+#include <cstdint>
 #include <cstring>
 #include <fstream>
 #include <memory>
@@ -145,5 +150,63 @@ TEST_F(FileTest, IOFile_CloseOutput) {
   EXPECT_EQ(io_file->Write(bytes), Exception{Exception::kIo});
 }
 
+TEST_F(FileTest, IOFile_SkipThenRead) {
+  WriteToFile("abcdef");
+  auto io_file = shared::IOFile::CreateInputFile(path_, GetSize());
+  ExceptionOr<size_t> skipped = io_file->Skip(4);
+  EXPECT_TRUE(skipped.ok());
+  EXPECT_EQ(skipped.result(), 4);
+  AssertEquals(io_file->Read(kMaxSize), "ef");
+  AssertEmpty(io_file->Read(kMaxSize));
+}
+
+TEST_F(FileTest, IOFile_SkipPastEOF) {
+  WriteToFile("abc");
+  auto io_file = shared::IOFile::CreateInputFile(path_, GetSize());
+  AssertEquals(io_file->Read(1), "a");
+  ExceptionOr<size_t> skipped = io_file->Skip(10);
+  EXPECT_TRUE(skipped.ok());
+  EXPECT_EQ(skipped.result(), 2);
+  AssertEmpty(io_file->Read(kMaxSize));
+}
+
+TEST_F(FileTest, IOFile_SkipAfterClose) {
+  WriteToFile("abc");
+  auto io_file = shared::IOFile::CreateInputFile(path_, GetSize());
+  io_file->Close();
+  EXPECT_TRUE(io_file->Skip(1).GetException().Raised(Exception::kIo));
+}
+
+TEST_F(FileTest, IOFile_WriteKeepsFileSizeToDataWritten) {
+  auto io_file_output = shared::IOFile::CreateOutputFile(path_);
+  std::string data(100 * 1024, 'x');
+  EXPECT_EQ(io_file_output->Write(ByteArray(data)),
+            Exception{Exception::kSuccess});
+  auto io_file_input =
+      shared::IOFile::CreateInputFile(io_file_output->GetFilePath(), 0);
+  // Space reserved ahead of the writes must not show up as file content.
+  EXPECT_EQ(io_file_input->GetTotalSize(), data.size());
+  AssertEquals(io_file_input->Read(data.size() + 1), data);
+}
+
+#if !defined(_WIN32)
+TEST_F(FileTest, IOFile_CloseReleasesReservedSpace) {
+  auto io_file_output = shared::IOFile::CreateOutputFile(path_);
+  std::string data(100, 'x');
+  EXPECT_EQ(io_file_output->Write(ByteArray(data)),
+            Exception{Exception::kSuccess});
+
+  EXPECT_EQ(io_file_output->Close(), Exception{Exception::kSuccess});
+
+  struct stat file_stat;
+  ASSERT_EQ(stat(path_.c_str(), &file_stat), 0);
+  EXPECT_EQ(file_stat.st_size, data.size());
+  std::int64_t rounded_up_size =
+      (file_stat.st_size + file_stat.st_blksize - 1) / file_stat.st_blksize *
+      file_stat.st_blksize;
+  EXPECT_LE(file_stat.st_blocks * 512, rounded_up_size);
+}
+#endif  // !defined(_WIN32)
+
 }  // namespace shared
 }  // namespace nearby
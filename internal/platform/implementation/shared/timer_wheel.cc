@@ -0,0 +1,251 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/timer_wheel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/numeric/bits.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace shared {
+
+namespace {
+
+constexpr int kSlotBits = 6;
+static_assert(TimerWheel::kSlotsPerLevel == 1 << kSlotBits);
+
+// Number of ticks covered by one slot of `level`.
+constexpr std::int64_t TicksPerSlot(int level) {
+  return std::int64_t{1} << (kSlotBits * level);
+}
+
+}  // namespace
+
+std::shared_ptr<TimerWheel> TimerWheel::GetDefault() {
+  static std::shared_ptr<TimerWheel>* wheel =
+      new std::shared_ptr<TimerWheel>(new TimerWheel(
+          absl::Now(), kRealTimeTick, /*follow_real_clock=*/true));
+  return *wheel;
+}
+
+TimerWheel::TimerWheel(absl::Time start, absl::Duration tick)
+    : TimerWheel(start, tick, /*follow_real_clock=*/false) {}
+
+TimerWheel::TimerWheel(absl::Time start, absl::Duration tick,
+                       bool follow_real_clock)
+    : origin_(start), tick_(tick) {
+  if (follow_real_clock) {
+    thread_ = std::thread([this]() { RunRealClock(); });
+  }
+}
+
+TimerWheel::~TimerWheel() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopped_ = true;
+    cond_.Signal();
+  }
+  if (thread_.joinable()) thread_.join();
+}
+
+std::uint64_t TimerWheel::Schedule(absl::Time deadline, Callback callback) {
+  absl::MutexLock lock(&mutex_);
+  std::uint64_t id = next_id_++;
+  Timer& timer = timers_[id];
+  timer.deadline = deadline;
+  absl::Duration remainder;
+  // Timers already past due are filed as due by Insert().
+  timer.tick = deadline < origin_ ? 0
+                                  : absl::IDivDuration(deadline - origin_,
+                                                       tick_, &remainder);
+  timer.callback = std::move(callback);
+  Insert(id, timer);
+  cond_.Signal();
+  return id;
+}
+
+bool TimerWheel::Cancel(std::uint64_t id) {
+  Callback callback;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = timers_.find(id);
+    if (it == timers_.end()) return false;
+    Unlink(it->second, id);
+    callback = std::move(it->second.callback);
+    timers_.erase(it);
+  }
+  // Destroyed outside of the lock, as it may own arbitrary state.
+  return true;
+}
+
+void TimerWheel::AdvanceTo(absl::Time now) {
+  std::vector<Callback> expired;
+  {
+    absl::MutexLock lock(&mutex_);
+    expired = CollectExpired(now);
+  }
+  for (Callback& callback : expired) {
+    callback();
+  }
+}
+
+int TimerWheel::GetTimerCount() const {
+  absl::MutexLock lock(&mutex_);
+  return timers_.size();
+}
+
+void TimerWheel::Insert(std::uint64_t id, Timer& timer) {
+  std::int64_t delta = timer.tick - current_tick_;
+  if (delta <= 0) {
+    timer.level = kDueLevel;
+    due_.insert(id);
+    return;
+  }
+  int level = 0;
+  while (level < kLevels - 1 && delta >= TicksPerSlot(level + 1)) ++level;
+  std::int64_t tick = timer.tick;
+  if (delta >= TicksPerSlot(kLevels)) {
+    // Beyond the range of the wheel: park it in the farthest slot, and file it
+    // again when that slot is cascaded.
+    tick = current_tick_ + TicksPerSlot(kLevels) - 1;
+  }
+  timer.level = level;
+  timer.slot = (tick >> (kSlotBits * level)) & (kSlotsPerLevel - 1);
+  slots_[level][timer.slot].insert(id);
+  occupancy_[level] |= std::uint64_t{1} << timer.slot;
+}
+
+void TimerWheel::Unlink(const Timer& timer, std::uint64_t id) {
+  if (timer.level == kDueLevel) {
+    due_.erase(id);
+    return;
+  }
+  absl::flat_hash_set<std::uint64_t>& slot = slots_[timer.level][timer.slot];
+  slot.erase(id);
+  if (slot.empty()) {
+    occupancy_[timer.level] &= ~(std::uint64_t{1} << timer.slot);
+  }
+}
+
+void TimerWheel::Cascade(int level, int slot) {
+  absl::flat_hash_set<std::uint64_t> ids = std::move(slots_[level][slot]);
+  slots_[level][slot].clear();
+  occupancy_[level] &= ~(std::uint64_t{1} << slot);
+  for (std::uint64_t id : ids) {
+    Insert(id, timers_[id]);
+  }
+}
+
+std::int64_t TimerWheel::GetNextEventTick() const {
+  std::int64_t next_tick = -1;
+  for (int level = 0; level < kLevels; ++level) {
+    if (occupancy_[level] == 0) continue;
+    // The slot of `level` being passed through now is visited again only
+    // after a full turn, so look from the slot after it.
+    std::int64_t block = current_tick_ >> (kSlotBits * level);
+    int position = block & (kSlotsPerLevel - 1);
+    int distance =
+        absl::countr_zero(absl::rotr(occupancy_[level],
+                                     (position + 1) & (kSlotsPerLevel - 1))) +
+        1;
+    std::int64_t tick = (block + distance) << (kSlotBits * level);
+    if (next_tick < 0 || tick < next_tick) next_tick = tick;
+  }
+  return next_tick;
+}
+
+std::vector<TimerWheel::Callback> TimerWheel::CollectExpired(absl::Time now) {
+  absl::Duration remainder;
+  std::int64_t now_tick =
+      now < origin_ ? 0 : absl::IDivDuration(now - origin_, tick_, &remainder);
+  while (current_tick_ < now_tick) {
+    // Skips the ticks at which there is nothing to do.
+    std::int64_t next_tick = GetNextEventTick();
+    if (next_tick < 0 || next_tick > now_tick) {
+      current_tick_ = now_tick;
+      break;
+    }
+    current_tick_ = next_tick;
+    // Coarse levels first, so that timers they hand down to a level whose slot
+    // is also due now are processed in the same pass.
+    for (int level = kLevels - 1; level > 0; --level) {
+      if (current_tick_ % TicksPerSlot(level) == 0) {
+        Cascade(level, (current_tick_ >> (kSlotBits * level)) &
+                           (kSlotsPerLevel - 1));
+      }
+    }
+    Cascade(0, current_tick_ & (kSlotsPerLevel - 1));
+  }
+
+  std::vector<std::pair<absl::Time, std::uint64_t>> fired;
+  for (std::uint64_t id : due_) {
+    absl::Time deadline = timers_[id].deadline;
+    if (deadline <= now) fired.emplace_back(deadline, id);
+  }
+  std::sort(fired.begin(), fired.end());
+  std::vector<Callback> callbacks;
+  callbacks.reserve(fired.size());
+  for (const auto& [deadline, id] : fired) {
+    due_.erase(id);
+    auto it = timers_.find(id);
+    callbacks.push_back(std::move(it->second.callback));
+    timers_.erase(it);
+  }
+  return callbacks;
+}
+
+absl::Time TimerWheel::GetNextWakeUpTime() const {
+  absl::Time wake_up_time = absl::InfiniteFuture();
+  for (std::uint64_t id : due_) {
+    wake_up_time = std::min(wake_up_time, timers_.at(id).deadline);
+  }
+  std::int64_t next_tick = GetNextEventTick();
+  if (next_tick >= 0) {
+    wake_up_time = std::min(wake_up_time, origin_ + next_tick * tick_);
+  }
+  return wake_up_time;
+}
+
+void TimerWheel::RunRealClock() {
+  while (true) {
+    std::vector<Callback> expired;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (stopped_) return;
+      absl::Time now = absl::Now();
+      absl::Time wake_up_time = GetNextWakeUpTime();
+      if (wake_up_time > now) {
+        // Woken up early by Schedule() or the destructor; look again.
+        cond_.WaitWithDeadline(&mutex_, wake_up_time);
+        continue;
+      }
+      expired = CollectExpired(now);
+    }
+    for (Callback& callback : expired) {
+      callback();
+    }
+  }
+}
+
+}  // namespace shared
+}  // namespace nearby
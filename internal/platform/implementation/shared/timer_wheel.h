@@ -0,0 +1,128 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_SHARED_TIMER_WHEEL_H_
+#define PLATFORM_IMPL_SHARED_TIMER_WHEEL_H_
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace shared {
+
+// Hierarchical timer wheel: kLevels wheels of kSlotsPerLevel slots, where a
+// slot of level L spans kSlotsPerLevel^L ticks. Scheduling and cancelling a
+// timer are O(1); timers move to a finer level at most kLevels - 1 times
+// before they fire.
+//
+// The wheel only keeps time. Callbacks run on the thread that advances the
+// wheel and must not block: they are expected to hand the actual work to an
+// executor of the caller's choice.
+class TimerWheel {
+ public:
+  using Callback = absl::AnyInvocable<void()>;
+
+  static constexpr absl::Duration kRealTimeTick = absl::Milliseconds(1);
+  static constexpr int kLevels = 4;
+  static constexpr int kSlotsPerLevel = 64;
+
+  // Returns the wheel shared by the whole process. It follows the real clock
+  // on its own thread.
+  static std::shared_ptr<TimerWheel> GetDefault();
+
+  // Creates a wheel that only moves when AdvanceTo() is called, which is how
+  // a simulated clock drives it. `start` is the current time of that clock.
+  explicit TimerWheel(absl::Time start, absl::Duration tick = kRealTimeTick);
+  ~TimerWheel();
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // Arms a timer that calls `callback` once the clock driving the wheel
+  // reaches `deadline`. Returns an id for Cancel(); ids are never 0.
+  std::uint64_t Schedule(absl::Time deadline, Callback callback)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Disarms the timer `id`. Returns false if it has already fired or is
+  // unknown.
+  bool Cancel(std::uint64_t id) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Fires, in deadline order, every timer due at `now`.
+  void AdvanceTo(absl::Time now) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the number of armed timers.
+  int GetTimerCount() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // Marks a timer as due, but kept until its exact deadline has passed.
+  static constexpr int kDueLevel = -1;
+
+  struct Timer {
+    absl::Time deadline;
+    std::int64_t tick;
+    int level;
+    int slot;
+    Callback callback;
+  };
+
+  TimerWheel(absl::Time start, absl::Duration tick, bool follow_real_clock);
+
+  // Files timer `id` into the slot matching its distance from current_tick_.
+  void Insert(std::uint64_t id, Timer& timer)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void Unlink(const Timer& timer, std::uint64_t id)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Redistributes the timers of a coarse slot into finer levels.
+  void Cascade(int level, int slot) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Returns the first tick after current_tick_ at which a slot has to be
+  // visited, or -1 if all slots are empty.
+  std::int64_t GetNextEventTick() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Moves the wheel to `now` and returns the callbacks of the fired timers.
+  std::vector<Callback> CollectExpired(absl::Time now)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Returns when the wheel thread has to wake up next.
+  absl::Time GetNextWakeUpTime() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void RunRealClock() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  const absl::Time origin_;
+  const absl::Duration tick_;
+  mutable absl::Mutex mutex_;
+  // Wakes up the real clock thread when a timer is armed.
+  absl::CondVar cond_;
+  std::int64_t current_tick_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::uint64_t next_id_ ABSL_GUARDED_BY(mutex_) = 1;
+  absl::flat_hash_map<std::uint64_t, Timer> timers_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_set<std::uint64_t> slots_[kLevels][kSlotsPerLevel]
+      ABSL_GUARDED_BY(mutex_);
+  // Bit s of occupancy_[L] is set while slots_[L][s] is not empty.
+  std::uint64_t occupancy_[kLevels] ABSL_GUARDED_BY(mutex_) = {};
+  // Timers whose tick has passed but whose deadline has not.
+  absl::flat_hash_set<std::uint64_t> due_ ABSL_GUARDED_BY(mutex_);
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  std::thread thread_;
+};
+
+}  // namespace shared
+}  // namespace nearby
+
+#endif  // PLATFORM_IMPL_SHARED_TIMER_WHEEL_H_
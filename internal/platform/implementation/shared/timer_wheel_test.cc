@@ -0,0 +1,169 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/timer_wheel.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace shared {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+class TimerWheelTest : public ::testing::Test {
+ protected:
+  absl::Time start_ = absl::FromUnixSeconds(1000);
+  TimerWheel wheel_{start_};
+  std::vector<std::string> fired_;
+
+  std::uint64_t Arm(absl::Duration delay, const std::string& name) {
+    return wheel_.Schedule(start_ + delay,
+                           [this, name]() { fired_.push_back(name); });
+  }
+};
+
+TEST_F(TimerWheelTest, FiresOnlyOnceDeadlineIsReached) {
+  Arm(absl::Milliseconds(10), "a");
+
+  wheel_.AdvanceTo(start_ + absl::Milliseconds(9));
+  EXPECT_THAT(fired_, IsEmpty());
+  wheel_.AdvanceTo(start_ + absl::Milliseconds(10));
+  EXPECT_THAT(fired_, ElementsAre("a"));
+  EXPECT_EQ(wheel_.GetTimerCount(), 0);
+}
+
+TEST_F(TimerWheelTest, FiresInDeadlineOrder) {
+  Arm(absl::Hours(3), "hours");
+  Arm(absl::Seconds(5), "seconds");
+  Arm(absl::Milliseconds(5), "millis");
+  Arm(absl::Milliseconds(5), "millis again");
+  Arm(absl::Minutes(2), "minutes");
+
+  wheel_.AdvanceTo(start_ + absl::Hours(4));
+
+  EXPECT_THAT(fired_, ElementsAre("millis", "millis again", "seconds",
+                                  "minutes", "hours"));
+}
+
+TEST_F(TimerWheelTest, SubTickDeadlinesAreNotFiredEarly) {
+  Arm(absl::Microseconds(1500), "a");
+
+  wheel_.AdvanceTo(start_ + absl::Microseconds(1200));
+  EXPECT_THAT(fired_, IsEmpty());
+  wheel_.AdvanceTo(start_ + absl::Microseconds(1500));
+  EXPECT_THAT(fired_, ElementsAre("a"));
+}
+
+TEST_F(TimerWheelTest, CascadedTimersFireAtTheirTick) {
+  // Spread over every level, including across level boundaries.
+  for (std::int64_t millis : {63, 64, 65, 4095, 4096, 4097, 262143, 262144}) {
+    Arm(absl::Milliseconds(millis), std::to_string(millis));
+  }
+
+  for (std::int64_t millis : {63, 64, 65, 4095, 4096, 4097, 262143, 262144}) {
+    wheel_.AdvanceTo(start_ + absl::Milliseconds(millis - 1));
+    EXPECT_THAT(fired_, IsEmpty()) << millis;
+    wheel_.AdvanceTo(start_ + absl::Milliseconds(millis));
+    EXPECT_THAT(fired_, ElementsAre(std::to_string(millis)));
+    fired_.clear();
+  }
+}
+
+TEST_F(TimerWheelTest, TimerBeyondRangeOfWheelFires) {
+  Arm(absl::Hours(24 * 7), "week");
+
+  wheel_.AdvanceTo(start_ + absl::Hours(24 * 7) - absl::Milliseconds(1));
+  EXPECT_THAT(fired_, IsEmpty());
+  wheel_.AdvanceTo(start_ + absl::Hours(24 * 7));
+  EXPECT_THAT(fired_, ElementsAre("week"));
+}
+
+TEST_F(TimerWheelTest, ScheduleAfterAdvanceIsRelativeToDeadline) {
+  wheel_.AdvanceTo(start_ + absl::Seconds(100));
+  wheel_.Schedule(start_ + absl::Seconds(100) + absl::Milliseconds(70),
+                  [this]() { fired_.push_back("a"); });
+
+  wheel_.AdvanceTo(start_ + absl::Seconds(100) + absl::Milliseconds(69));
+  EXPECT_THAT(fired_, IsEmpty());
+  wheel_.AdvanceTo(start_ + absl::Seconds(100) + absl::Milliseconds(70));
+  EXPECT_THAT(fired_, ElementsAre("a"));
+}
+
+TEST_F(TimerWheelTest, PastDeadlineFiresOnNextAdvance) {
+  wheel_.AdvanceTo(start_ + absl::Seconds(1));
+  Arm(absl::ZeroDuration(), "a");
+
+  wheel_.AdvanceTo(start_ + absl::Seconds(1));
+  EXPECT_THAT(fired_, ElementsAre("a"));
+}
+
+TEST_F(TimerWheelTest, CancelledTimerDoesNotFire) {
+  std::uint64_t id = Arm(absl::Seconds(1), "a");
+  Arm(absl::Seconds(2), "b");
+
+  EXPECT_TRUE(wheel_.Cancel(id));
+  EXPECT_FALSE(wheel_.Cancel(id));
+  wheel_.AdvanceTo(start_ + absl::Seconds(3));
+
+  EXPECT_THAT(fired_, ElementsAre("b"));
+}
+
+TEST_F(TimerWheelTest, CallbackCanScheduleAnotherTimer) {
+  wheel_.Schedule(start_ + absl::Seconds(1), [this]() {
+    fired_.push_back("first");
+    Arm(absl::Seconds(2), "second");
+  });
+
+  wheel_.AdvanceTo(start_ + absl::Seconds(1));
+  wheel_.AdvanceTo(start_ + absl::Seconds(2));
+
+  EXPECT_THAT(fired_, ElementsAre("first", "second"));
+}
+
+TEST(TimerWheelRealClockTest, DefaultWheelFiresOnItsThread) {
+  absl::Notification fired;
+  absl::Time start = absl::Now();
+
+  TimerWheel::GetDefault()->Schedule(start + absl::Milliseconds(20),
+                                     [&fired]() { fired.Notify(); });
+
+  EXPECT_TRUE(fired.WaitForNotificationWithTimeout(absl::Seconds(5)));
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(20));
+}
+
+TEST(TimerWheelRealClockTest, DefaultWheelCancel) {
+  absl::Notification fired;
+  std::shared_ptr<TimerWheel> wheel = TimerWheel::GetDefault();
+
+  std::uint64_t id = wheel->Schedule(absl::Now() + absl::Milliseconds(20),
+                                     [&fired]() { fired.Notify(); });
+  EXPECT_TRUE(wheel->Cancel(id));
+
+  EXPECT_FALSE(fired.WaitForNotificationWithTimeout(absl::Milliseconds(100)));
+}
+
+}  // namespace
+}  // namespace shared
+}  // namespace nearby
@@ -17,6 +17,7 @@
 
 #include <string>
 
+#include "absl/functional/any_invocable.h"
 #include "internal/platform/cancellation_flag.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/listeners.h"
@@ -46,6 +47,14 @@ class WifiLanSocket {
 
   // Returns Exception::kIo on error, Exception::kSuccess otherwise.
   virtual Exception Close() = 0;
+
+  // Asks for `callback` to be called once, from any thread but never from
+  // within this call, as soon as a read from the InputStream would not block,
+  // or the socket is closed. Returns false if the platform can't tell, in which
+  // case the caller has to block on a read instead.
+  virtual bool NotifyWhenReadable(absl::AnyInvocable<void()> callback) {
+    return false;
+  }
 };
 
 class WifiLanServerSocket {
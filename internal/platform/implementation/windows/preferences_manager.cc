@@ -19,9 +19,11 @@
 #include <optional>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "nlohmann/json.hpp"
 #include "nlohmann/json_fwd.hpp"
 #include "internal/platform/implementation/windows/preferences_repository.h"
@@ -31,10 +33,14 @@ namespace nearby {
 namespace windows {
 namespace {
 using json = ::nlohmann::json;
+
+// Upper bound on how long a change waits before it is written to storage.
+constexpr absl::Duration kCommitDelay = absl::Milliseconds(500);
 }  // namespace
 
 PreferencesManager::PreferencesManager(absl::string_view file_path)
-    : api::PreferencesManager(file_path) {
+    : api::PreferencesManager(file_path),
+      writer_(kCommitDelay, [this]() { Write(); }) {
   std::optional<std::filesystem::path> path =
       nearby::api::ImplementationPlatform::CreateDeviceInfo()
           ->GetLocalAppDataPath();
@@ -179,18 +185,29 @@ absl::Time PreferencesManager::GetTime(absl::string_view key,
 // Removes preferences
 void PreferencesManager::Remove(absl::string_view key) {
   absl::MutexLock lock(&mutex_);
-  value_.erase(absl::StrCat(key));
+  if (value_.erase(absl::StrCat(key)) > 0) {
+    Commit();
+  }
 }
 
+void PreferencesManager::Flush() { writer_.Flush(); }
+
 // Private methods
 
-// Writes data to storage.
 bool PreferencesManager::Commit() {
-  if (!preferences_repository_->SavePreferences(value_)) {
+  writer_.Request();
+  return true;
+}
+
+void PreferencesManager::Write() {
+  json preferences;
+  {
+    absl::MutexLock lock(&mutex_);
+    preferences = value_;
+  }
+  if (!preferences_repository_->SavePreferences(std::move(preferences))) {
     NEARBY_LOGS(ERROR) << "Failed to save preference." << std::endl;
-    return false;
   }
-  return true;
 }
 
 bool PreferencesManager::SetValue(absl::string_view key, const json& value) {
@@ -29,6 +29,7 @@
 #include "nlohmann/json.hpp"
 #include "nlohmann/json_fwd.hpp"
 #include "internal/platform/implementation/preferences_manager.h"
+#include "internal/platform/implementation/shared/deferred_writer.h"
 #include "internal/platform/implementation/windows/preferences_repository.h"
 
 namespace nearby {
@@ -108,10 +109,16 @@ class PreferencesManager : public api::PreferencesManager {
   // Removes preferences
   void Remove(absl::string_view key) override ABSL_LOCKS_EXCLUDED(mutex_);
 
+  void Flush() override;
+
  private:
-  // Writes data to storage.
+  // Schedules a write of the preferences to storage. Changes made within
+  // kCommitDelay of each other are written together.
   bool Commit() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Writes the current preferences to storage.
+  void Write() ABSL_LOCKS_EXCLUDED(mutex_);
+
   bool SetValue(absl::string_view key, const nlohmann::json& value)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
@@ -129,10 +136,14 @@ class PreferencesManager : public api::PreferencesManager {
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   nlohmann::json value_ ABSL_GUARDED_BY(mutex_);
-  std::unique_ptr<PreferencesRepository> preferences_repository_
-      ABSL_GUARDED_BY(mutex_);
+  // Set on construction; the repository has its own lock.
+  std::unique_ptr<PreferencesRepository> preferences_repository_;
 
   mutable absl::Mutex mutex_;
+
+  // Declared last, so that the pending write runs before anything else is
+  // destroyed.
+  shared::DeferredWriter writer_;
 };
 
 }  // namespace windows
@@ -20,6 +20,7 @@
 #include <filesystem>  // NOLINT(build/c++17)
 #include <fstream>
 #include <locale>
+#include <optional>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -31,6 +32,9 @@
 #include "absl/types/span.h"
 #include "nlohmann/json.hpp"
 #include "nlohmann/json_fwd.hpp"
+#include "internal/platform/implementation/device_info.h"
+#include "internal/platform/implementation/platform.h"
+#include "internal/platform/implementation/windows/preferences_repository.h"
 #include "internal/platform/logging.h"
 
 namespace nearby {
@@ -185,5 +189,42 @@ TEST(PreferencesManager, RemoveKey) {
   EXPECT_EQ(result, "default key");
 }
 
+TEST(PreferencesManager, FlushPersistsCoalescedChanges) {
+  std::string int_key = "int_key";
+  auto pm = PreferencesManager(kPreferencesFilePath);
+  for (int i = 0; i < 100; ++i) {
+    pm.SetInteger(int_key, i);
+  }
+  pm.Flush();
+
+  std::optional<std::filesystem::path> app_data_path =
+      api::ImplementationPlatform::CreateDeviceInfo()->GetLocalAppDataPath();
+  ASSERT_TRUE(app_data_path.has_value());
+  PreferencesRepository preferences_repository{
+      (*app_data_path / kPreferencesFilePath).string()};
+  nlohmann::json result = preferences_repository.LoadPreferences();
+  EXPECT_EQ(result[int_key], 99);
+  pm.Remove(int_key);
+}
+
+TEST(PreferencesManager, DestructionPersistsCoalescedChanges) {
+  std::string int_key = "int_key";
+  {
+    auto pm = PreferencesManager(kPreferencesFilePath);
+    for (int i = 0; i < 100; ++i) {
+      pm.SetInteger(int_key, i);
+    }
+  }
+
+  std::optional<std::filesystem::path> app_data_path =
+      api::ImplementationPlatform::CreateDeviceInfo()->GetLocalAppDataPath();
+  ASSERT_TRUE(app_data_path.has_value());
+  PreferencesRepository preferences_repository{
+      (*app_data_path / kPreferencesFilePath).string()};
+  nlohmann::json result = preferences_repository.LoadPreferences();
+  EXPECT_EQ(result[int_key], 99);
+  PreferencesManager(kPreferencesFilePath).Remove(int_key);
+}
+
 }  // namespace windows
 }  // namespace nearby
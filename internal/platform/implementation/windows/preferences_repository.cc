@@ -14,10 +14,13 @@
 
 #include "internal/platform/implementation/windows/preferences_repository.h"
 
+#include <windows.h>
+
 #include <exception>
 #include <filesystem>  // NOLINT(build/c++17)
 #include <fstream>
 #include <optional>
+#include <string>
 
 #include "nlohmann/json.hpp"
 #include "nlohmann/json_fwd.hpp"
@@ -30,6 +33,32 @@ using json = ::nlohmann::json;
 
 constexpr char kPreferencesFileName[] = "preferences.json";
 constexpr char kPreferencesBackupFileName[] = "preferences_bak.json";
+constexpr char kPreferencesTempFileName[] = "preferences_tmp.json";
+
+// Writes `contents` to a new file at `path`, and flushes it to the disk so
+// that it can't be swapped in before its data is there.
+bool WriteFileToDisk(const std::filesystem::path& path,
+                     const std::string& contents) {
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, /*dwShareMode=*/0,
+                            /*lpSecurityAttributes=*/nullptr, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, /*hTemplateFile=*/nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    NEARBY_LOGS(ERROR) << "Failed to create preferences file, error="
+                       << GetLastError();
+    return false;
+  }
+  DWORD written = 0;
+  bool success = WriteFile(file, contents.data(),
+                           static_cast<DWORD>(contents.size()), &written,
+                           /*lpOverlapped=*/nullptr) &&
+                 written == contents.size() && FlushFileBuffers(file);
+  if (!success) {
+    NEARBY_LOGS(ERROR) << "Failed to write preferences file, error="
+                       << GetLastError();
+  }
+  CloseHandle(file);
+  return success;
+}
 
 }  // namespace
 
@@ -76,26 +105,30 @@ bool PreferencesRepository::SavePreferences(json preferences) {
 
     std::filesystem::path full_name = path / kPreferencesFileName;
     std::filesystem::path full_name_backup = path / kPreferencesBackupFileName;
+    std::filesystem::path full_name_temp = path / kPreferencesTempFileName;
 
-    // Create a backup without moving the bytes on disk
-    if (std::filesystem::exists(full_name)) {
-      NEARBY_LOGS(INFO) << "Making backup of preferences file.";
-      std::filesystem::rename(full_name, full_name_backup);
+    // Write to a temporary file first, so that a crash or a full disk while
+    // writing leaves the preferences file intact.
+    if (!WriteFileToDisk(full_name_temp, preferences.dump())) {
+      std::filesystem::remove(full_name_temp);
+      return false;
     }
 
-    std::ofstream preferences_file(full_name.c_str());
-    preferences_file << preferences;
-    preferences_file.close();
-
-    // Make sure the file wasn't saved in a corrupted state
-    if (!AttemptLoad().has_value()) {
-      NEARBY_LOGS(ERROR) << "Preferences saved to disk in corrupted state. "
-                            "Restoring from backup.";
-
-      if (!RestoreFromBackup().has_value()) {
-        NEARBY_LOGS(ERROR) << "Failed to restore preferences file.";
-        return false;
-      }
+    // Swap the new file in with a single call, which keeps the previous file
+    // as the backup.
+    bool replaced =
+        std::filesystem::exists(full_name)
+            ? ReplaceFileW(full_name.c_str(), full_name_temp.c_str(),
+                           full_name_backup.c_str(),
+                           REPLACEFILE_IGNORE_MERGE_ERRORS,
+                           /*lpExclude=*/nullptr, /*lpReserved=*/nullptr)
+            : MoveFileExW(full_name_temp.c_str(), full_name.c_str(),
+                          MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    if (!replaced) {
+      NEARBY_LOGS(ERROR) << "Failed to replace preferences file, error="
+                         << GetLastError();
+      std::filesystem::remove(full_name_temp);
+      return false;
     }
   } catch (const std::exception& e) {
     NEARBY_LOGS(ERROR) << "Failed to save preferences file: " << e.what();
@@ -14,6 +14,8 @@
 
 #include "internal/platform/implementation/windows/preferences_repository.h"
 
+#include <windows.h>
+
 #include <filesystem>  // NOLINT(build/c++17)
 #include <fstream>
 #include <optional>
@@ -32,6 +34,7 @@ using json = ::nlohmann::json;
 
 constexpr char kPreferencesFileName[] = "preferences.json";
 constexpr char kPreferencesBackupFileName[] = "preferences_bak.json";
+constexpr char kPreferencesTempFileName[] = "preferences_tmp.json";
 constexpr char kPreferencesPath[] = "Google/Nearby/Sharing";
 
 TEST(PreferencesRepository, LoadWithBadPath) {
@@ -156,6 +159,94 @@ TEST(PreferencesRepository, RecoverFromCorruption) {
   EXPECT_FALSE(std::filesystem::exists(full_name_backup));
 }
 
+TEST(PreferencesRepository, SaveReplacesFileThroughTemporaryFile) {
+  std::optional<std::filesystem::path> app_data_path =
+      api::ImplementationPlatform::CreateDeviceInfo()->GetLocalAppDataPath();
+  ASSERT_TRUE(app_data_path.has_value());
+  std::filesystem::path full_path = *app_data_path / kPreferencesPath;
+  std::filesystem::path full_name = full_path / kPreferencesFileName;
+  std::filesystem::path full_name_temp = full_path / kPreferencesTempFileName;
+
+  if (std::filesystem::exists(full_name)) {
+    std::filesystem::remove(full_name);
+  }
+
+  // Left over by a save that was interrupted.
+  std::filesystem::create_directories(full_path);
+  std::ofstream temp_file(full_name_temp.c_str());
+  temp_file << "[BAD JSON";
+  temp_file.close();
+
+  PreferencesRepository preferences_repository{full_path.string()};
+  json data;
+  data["key1"] = "value1";
+  EXPECT_TRUE(preferences_repository.SavePreferences(data));
+  EXPECT_FALSE(std::filesystem::exists(full_name_temp));
+  json result = preferences_repository.LoadPreferences();
+  EXPECT_EQ(result["key1"], "value1");
+  std::filesystem::remove(full_name);
+}
+
+TEST(PreferencesRepository, FailedWriteKeepsPreviousPreferences) {
+  std::optional<std::filesystem::path> app_data_path =
+      api::ImplementationPlatform::CreateDeviceInfo()->GetLocalAppDataPath();
+  ASSERT_TRUE(app_data_path.has_value());
+  std::filesystem::path full_path = *app_data_path / kPreferencesPath;
+  std::filesystem::path full_name = full_path / kPreferencesFileName;
+  std::filesystem::path full_name_temp = full_path / kPreferencesTempFileName;
+
+  PreferencesRepository preferences_repository{full_path.string()};
+  json data;
+  data["key1"] = "value1";
+  ASSERT_TRUE(preferences_repository.SavePreferences(data));
+
+  // A directory in the way of the temporary file stops the save before the
+  // preferences file is touched.
+  std::filesystem::create_directories(full_name_temp);
+  json new_data;
+  new_data["key1"] = "value2";
+  EXPECT_FALSE(preferences_repository.SavePreferences(new_data));
+  std::filesystem::remove_all(full_name_temp);
+
+  std::ifstream preferences_file(full_name.c_str());
+  EXPECT_EQ(json::parse(preferences_file, nullptr, false), data);
+  preferences_file.close();
+  EXPECT_EQ(preferences_repository.LoadPreferences(), data);
+  std::filesystem::remove(full_name);
+}
+
+TEST(PreferencesRepository, FailedReplaceKeepsPreviousPreferences) {
+  std::optional<std::filesystem::path> app_data_path =
+      api::ImplementationPlatform::CreateDeviceInfo()->GetLocalAppDataPath();
+  ASSERT_TRUE(app_data_path.has_value());
+  std::filesystem::path full_path = *app_data_path / kPreferencesPath;
+  std::filesystem::path full_name = full_path / kPreferencesFileName;
+  std::filesystem::path full_name_temp = full_path / kPreferencesTempFileName;
+
+  PreferencesRepository preferences_repository{full_path.string()};
+  json data;
+  data["key1"] = "value1";
+  ASSERT_TRUE(preferences_repository.SavePreferences(data));
+
+  // Holding the preferences file open without FILE_SHARE_DELETE makes the
+  // swap fail after the new file has been written.
+  HANDLE file = CreateFileW(full_name.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            /*lpSecurityAttributes=*/nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, /*hTemplateFile=*/nullptr);
+  ASSERT_NE(file, INVALID_HANDLE_VALUE);
+  json new_data;
+  new_data["key1"] = "value2";
+  EXPECT_FALSE(preferences_repository.SavePreferences(new_data));
+  CloseHandle(file);
+
+  EXPECT_FALSE(std::filesystem::exists(full_name_temp));
+  std::ifstream preferences_file(full_name.c_str());
+  EXPECT_EQ(json::parse(preferences_file, nullptr, false), data);
+  preferences_file.close();
+  EXPECT_EQ(preferences_repository.LoadPreferences(), data);
+  std::filesystem::remove(full_name);
+}
+
 }  // namespace
 }  // namespace windows
 }  // namespace nearby
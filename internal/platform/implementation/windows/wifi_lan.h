@@ -34,6 +34,7 @@
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/implementation/wifi_lan.h"
@@ -137,6 +138,7 @@ class WifiLanSocket : public api::WifiLanSocket {
     ~SocketOutputStream() = default;
 
     Exception Write(const ByteArray& data) override;
+    Exception WriteV(absl::Span<const absl::string_view> slices) override;
     Exception Flush() override;
     Exception Close() override;
 
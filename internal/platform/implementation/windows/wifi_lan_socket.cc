@@ -16,6 +16,8 @@
 #include <cstring>
 #include <exception>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "internal/platform/implementation/windows/wifi_lan.h"
 #include "internal/platform/logging.h"
 
@@ -168,6 +170,43 @@ Exception WifiLanSocket::SocketOutputStream::Write(const ByteArray& data) {
   }
 }
 
+Exception WifiLanSocket::SocketOutputStream::WriteV(
+    absl::Span<const absl::string_view> slices) {
+  try {
+    size_t total_size = 0;
+    for (absl::string_view slice : slices) {
+      total_size += slice.size();
+    }
+    // Gather the slices straight into the WinRT buffer, so a frame header and
+    // its body go out in a single WriteAsync call.
+    Buffer buffer = Buffer(total_size);
+    uint8_t* out = buffer.data();
+    for (absl::string_view slice : slices) {
+      if (slice.empty()) continue;
+      std::memcpy(out, slice.data(), slice.size());
+      out += slice.size();
+    }
+    buffer.Length(total_size);
+    uint32_t wrote_bytes = output_stream_.WriteAsync(buffer).get();
+    if (wrote_bytes != total_size) {
+      NEARBY_LOGS(WARNING) << "Only wrote partial of data:[" << wrote_bytes
+                           << "/" << total_size << "].";
+    }
+
+    return {Exception::kSuccess};
+  } catch (std::exception exception) {
+    NEARBY_LOGS(ERROR) << __func__ << ": Exception: " << exception.what();
+    return {Exception::kIo};
+  } catch (const winrt::hresult_error& error) {
+    NEARBY_LOGS(ERROR) << __func__ << ": WinRT exception: " << error.code()
+                       << ": " << winrt::to_string(error.message());
+    return {Exception::kIo};
+  } catch (...) {
+    NEARBY_LOGS(ERROR) << __func__ << ": Unknown exeption.";
+    return {Exception::kIo};
+  }
+}
+
 Exception WifiLanSocket::SocketOutputStream::Flush() {
   try {
     output_stream_.FlushAsync().get();
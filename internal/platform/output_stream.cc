@@ -0,0 +1,46 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/output_stream.h"
+
+#include <cstddef>
+#include <cstring>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+
+namespace nearby {
+
+Exception OutputStream::WriteV(absl::Span<const absl::string_view> slices) {
+  size_t total_size = 0;
+  for (absl::string_view slice : slices) {
+    total_size += slice.size();
+  }
+  if (total_size == 0) {
+    return {Exception::kSuccess};
+  }
+
+  ByteArray buffer(total_size);
+  char* out = buffer.data();
+  for (absl::string_view slice : slices) {
+    if (slice.empty()) continue;
+    std::memcpy(out, slice.data(), slice.size());
+    out += slice.size();
+  }
+  return Write(buffer);
+}
+
+}  // namespace nearby
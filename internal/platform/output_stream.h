@@ -15,6 +15,8 @@
 #ifndef PLATFORM_BASE_OUTPUT_STREAM_H_
 #define PLATFORM_BASE_OUTPUT_STREAM_H_
 
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 
@@ -28,6 +30,14 @@ class OutputStream {
   virtual ~OutputStream() = default;
 
   virtual Exception Write(const ByteArray& data) = 0;  // throws Exception::kIo
+
+  // Writes `slices` back to back, as a single logical write.
+  // Lets callers emit a frame header and its body without first concatenating
+  // them. The default implementation gathers the slices into one buffer and
+  // hands it to Write(); streams that can do a vectored write should override.
+  // Returns Exception::kIo on error.
+  virtual Exception WriteV(absl::Span<const absl::string_view> slices);
+
   virtual Exception Flush() = 0;                       // throws Exception::kIo
   virtual Exception Close() = 0;                       // throws Exception::kIo
 };
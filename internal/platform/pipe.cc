@@ -16,11 +16,16 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <deque>
 #include <memory>
 #include <utility>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "internal/platform/base_mutex_lock.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
@@ -37,7 +42,7 @@ using Platform = api::ImplementationPlatform;
 
 class Pipe {
  public:
-  Pipe() {
+  explicit Pipe(const PipeOptions& options) : options_(options) {
 #pragma push_macro("CreateMutex")
 #undef CreateMutex
     mutex_ = Platform::CreateMutex(api::Mutex::Mode::kRegular);
@@ -71,6 +76,9 @@ class Pipe {
     Exception Write(const ByteArray& data) override {
       return pipe_->Write(data);
     }
+    Exception WriteV(absl::Span<const absl::string_view> slices) override {
+      return pipe_->WriteV(slices);
+    }
     Exception Flush() override { return {Exception::kSuccess}; }
     Exception Close() override { return DoClose(); }
 
@@ -85,18 +93,25 @@ class Pipe {
  private:
   ExceptionOr<ByteArray> Read(size_t size) ABSL_LOCKS_EXCLUDED(mutex_);
   Exception Write(const ByteArray& data) ABSL_LOCKS_EXCLUDED(mutex_);
+  Exception WriteV(absl::Span<const absl::string_view> slices)
+      ABSL_LOCKS_EXCLUDED(mutex_);
 
   void MarkInputStreamClosed() ABSL_LOCKS_EXCLUDED(mutex_);
   void MarkOutputStreamClosed() ABSL_LOCKS_EXCLUDED(mutex_);
 
-  Exception WriteLocked(const ByteArray& data)
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Blocks while writes are paused by the high watermark. Returns kSuccess
+  // once the write may proceed, or why it may not.
+  Exception WaitForCapacityLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  Exception WriteLocked(ByteArray data) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  const PipeOptions options_;
   bool input_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
   bool output_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
   bool read_all_chunks_ ABSL_GUARDED_BY(mutex_) = false;
 
   std::deque<ByteArray> ABSL_GUARDED_BY(mutex_) buffer_;
+  size_t buffered_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool writes_paused_ ABSL_GUARDED_BY(mutex_) = false;
   // Order of declaration matters:
   // - mutex must be defined before condvar;
   std::unique_ptr<api::Mutex> mutex_;
@@ -129,31 +144,72 @@ ExceptionOr<ByteArray> Pipe::Read(size_t size) {
     return ExceptionOr<ByteArray>{ByteArray{}};
   }
 
-  ByteArray first_chunk{buffer_.front()};
+  // Take the chunk over from the queue rather than copying it.
+  ByteArray first_chunk{std::move(buffer_.front())};
   buffer_.pop_front();
 
+  ByteArray next_chunk;
   // If first_chunk is small enough to not overshoot the requested 'size', just
   // return that.
   if (first_chunk.size() <= size) {
-    return ExceptionOr<ByteArray>{first_chunk};
+    next_chunk = std::move(first_chunk);
   } else {
     // Break first_chunk into 2 parts -- the first one of which (next_chunk)
     // will be 'size' bytes long, and will be returned, and the second one of
     // which (overflow_chunk) will be re-inserted into buffer_, at the head of
     // the queue, to be served up in the next call to read().
-    ByteArray next_chunk(first_chunk.data(), size);
+    next_chunk = ByteArray(first_chunk.data(), size);
     buffer_.push_front(
         ByteArray(first_chunk.data() + size, first_chunk.size() - size));
-    return ExceptionOr<ByteArray>{next_chunk};
   }
+
+  buffered_bytes_ -= next_chunk.size();
+  if (writes_paused_ && buffered_bytes_ <= options_.low_watermark) {
+    writes_paused_ = false;
+    // Wake up writers blocked on the high watermark.
+    cond_->Notify();
+  }
+  return ExceptionOr<ByteArray>{std::move(next_chunk)};
 }
 
 Exception Pipe::Write(const ByteArray& data) {
   BaseMutexLock lock(mutex_.get());
 
+  Exception wait_exception = WaitForCapacityLocked();
+  if (wait_exception.Raised()) {
+    return wait_exception;
+  }
   return WriteLocked(data);
 }
 
+Exception Pipe::WriteV(absl::Span<const absl::string_view> slices) {
+  size_t total_size = 0;
+  for (absl::string_view slice : slices) {
+    total_size += slice.size();
+  }
+  // An empty chunk is the EOF sentinel, so never enqueue one here.
+  if (total_size == 0) {
+    return {Exception::kSuccess};
+  }
+
+  // Gather the slices straight into the chunk that will be queued, so that a
+  // header and its body end up as a single chunk with a single copy.
+  ByteArray chunk(total_size);
+  char* out = chunk.data();
+  for (absl::string_view slice : slices) {
+    if (slice.empty()) continue;
+    std::memcpy(out, slice.data(), slice.size());
+    out += slice.size();
+  }
+
+  BaseMutexLock lock(mutex_.get());
+  Exception wait_exception = WaitForCapacityLocked();
+  if (wait_exception.Raised()) {
+    return wait_exception;
+  }
+  return WriteLocked(std::move(chunk));
+}
+
 void Pipe::MarkInputStreamClosed() {
   BaseMutexLock lock(mutex_.get());
   if (input_stream_closed_) return;
@@ -171,12 +227,43 @@ void Pipe::MarkOutputStreamClosed() {
   output_stream_closed_ = true;
 }
 
-Exception Pipe::WriteLocked(const ByteArray& data) {
+Exception Pipe::WaitForCapacityLocked() {
+  if (!writes_paused_) {
+    return {Exception::kSuccess};
+  }
+
+  absl::Time deadline = absl::Now() + options_.write_timeout;
+  while (writes_paused_ && !input_stream_closed_ && !output_stream_closed_) {
+    Exception wait_exception{Exception::kSuccess};
+    if (options_.write_timeout == absl::InfiniteDuration()) {
+      wait_exception = cond_->Wait();
+    } else {
+      absl::Duration remaining = deadline - absl::Now();
+      if (remaining <= absl::ZeroDuration()) {
+        return {Exception::kTimeout};
+      }
+      wait_exception = cond_->Wait(remaining);
+    }
+
+    if (wait_exception.Raised()) {
+      return wait_exception;
+    }
+  }
+  // A closed pipe is reported by WriteLocked().
+  return {Exception::kSuccess};
+}
+
+Exception Pipe::WriteLocked(ByteArray data) {
   if (input_stream_closed_ || output_stream_closed_) {
     return {Exception::kIo};
   }
 
-  buffer_.push_back(data);
+  buffered_bytes_ += data.size();
+  if (options_.high_watermark > 0 &&
+      buffered_bytes_ >= options_.high_watermark) {
+    writes_paused_ = true;
+  }
+  buffer_.push_back(std::move(data));
   // Trigger cond_ to unblock a potentially-blocked call to read(), now that
   // there's more data for it to consume.
   cond_->Notify();
@@ -187,7 +274,12 @@ Exception Pipe::WriteLocked(const ByteArray& data) {
 
 std::pair<std::unique_ptr<InputStream>, std::unique_ptr<OutputStream>>
 CreatePipe() {
-  auto pipe = std::make_shared<Pipe>();
+  return CreatePipe(PipeOptions{});
+}
+
+std::pair<std::unique_ptr<InputStream>, std::unique_ptr<OutputStream>>
+CreatePipe(const PipeOptions& options) {
+  auto pipe = std::make_shared<Pipe>(options);
   return std::make_pair(std::make_unique<Pipe::PipeInputStream>(pipe),
                         std::make_unique<Pipe::PipeOutputStream>(pipe));
 }
@@ -15,9 +15,11 @@
 #ifndef PLATFORM_PUBLIC_PIPE_H_
 #define PLATFORM_PUBLIC_PIPE_H_
 
+#include <cstddef>
 #include <memory>
 #include <utility>
 
+#include "absl/time/time.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/output_stream.h"
 
@@ -33,6 +35,27 @@ namespace nearby {
 std::pair<std::unique_ptr<InputStream>, std::unique_ptr<OutputStream>>
 CreatePipe();
 
+// Limits of a bounded pipe. A pipe with a zero `high_watermark` is unbounded,
+// which is what CreatePipe() returns.
+struct PipeOptions {
+  // Writes are paused once at least this many bytes are buffered. A single
+  // write is never split, so it may take the pipe past this limit.
+  size_t high_watermark = 0;
+  // Paused writes resume once the reader has drained the pipe down to this
+  // many bytes.
+  size_t low_watermark = 0;
+  // How long a paused write waits for the reader before failing with
+  // Exception::kTimeout. A zero timeout makes writes to a full pipe fail
+  // right away instead of blocking.
+  absl::Duration write_timeout = absl::InfiniteDuration();
+};
+
+// Creates a pipe that buffers at most about `options.high_watermark` bytes.
+// A fast writer is then slowed down to the pace of the reader instead of
+// growing the buffer without limit.
+std::pair<std::unique_ptr<InputStream>, std::unique_ptr<OutputStream>>
+CreatePipe(const PipeOptions& options);
+
 }  // namespace nearby
 
 #endif  // PLATFORM_PUBLIC_PIPE_H_
@@ -119,6 +119,30 @@ TEST(PipeTest, SizedReadLessThanFirstChunkSize) {
   EXPECT_EQ(data_second_part, std::string(second_read_data.result()));
 }
 
+TEST(PipeTest, WriteVDeliversSlicesAsOneChunk) {
+  auto [input_stream, output_stream] = CreatePipe();
+  std::string header("ABCD");
+  std::string body("EFGHIJ");
+  EXPECT_TRUE(output_stream->WriteV({header, body}).Ok());
+
+  // The slices are gathered into a single chunk, so one read is enough to get
+  // both of them back.
+  ExceptionOr<ByteArray> read_data = input_stream->Read(kChunkSize);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_EQ(header + body, std::string(read_data.result()));
+}
+
+TEST(PipeTest, WriteVWithNoDataIsNotEndOfStream) {
+  auto [input_stream, output_stream] = CreatePipe();
+  std::string data("ABCD");
+  EXPECT_TRUE(output_stream->WriteV({absl::string_view()}).Ok());
+  EXPECT_TRUE(output_stream->Write(ByteArray(data)).Ok());
+
+  ExceptionOr<ByteArray> read_data = input_stream->Read(kChunkSize);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_EQ(data, std::string(read_data.result()));
+}
+
 TEST(PipeTest, ReadAfterInputStreamClosed) {
   auto [input_stream, output_stream] = CreatePipe();
 
@@ -337,4 +361,67 @@ TEST(PipeTest, ConcurrentWriteAndRead) {
   reader_thread.Join();
 }
 
+TEST(PipeTest, BoundedPipeWriteToFullPipeTimesOut) {
+  auto [input_stream, output_stream] = CreatePipe({
+      .high_watermark = 4,
+      .low_watermark = 0,
+      .write_timeout = absl::ZeroDuration(),
+  });
+
+  EXPECT_TRUE(output_stream->Write(ByteArray("ABCD")).Ok());
+  EXPECT_TRUE(output_stream->Write(ByteArray("E")).Raised(Exception::kTimeout));
+
+  ExceptionOr<ByteArray> read_data = input_stream->Read(kChunkSize);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_EQ(std::string(read_data.result()), "ABCD");
+  EXPECT_TRUE(output_stream->Write(ByteArray("E")).Ok());
+}
+
+TEST(PipeTest, BoundedPipeWriteResumesAtLowWatermark) {
+  auto [input_stream, output_stream] = CreatePipe({
+      .high_watermark = 8,
+      .low_watermark = 4,
+  });
+  EXPECT_TRUE(output_stream->Write(ByteArray("ABCD")).Ok());
+  EXPECT_TRUE(output_stream->Write(ByteArray("EFGH")).Ok());
+
+  std::atomic_bool write_done = false;
+  Thread writer_thread;
+  OutputStream* output = output_stream.get();
+  writer_thread.Start([output, &write_done]() {
+    EXPECT_TRUE(output->Write(ByteArray("IJKL")).Ok());
+    write_done = true;
+  });
+
+  // Draining to 6 bytes is still above the low watermark.
+  EXPECT_EQ(std::string(input_stream->Read(2).result()), "AB");
+  absl::SleepFor(absl::Milliseconds(100));
+  EXPECT_FALSE(write_done);
+
+  // Draining to 4 bytes lets the writer continue.
+  EXPECT_EQ(std::string(input_stream->Read(2).result()), "CD");
+  writer_thread.Join();
+  EXPECT_TRUE(write_done);
+  EXPECT_EQ(std::string(input_stream->Read(kChunkSize).result()), "EFGH");
+  EXPECT_EQ(std::string(input_stream->Read(kChunkSize).result()), "IJKL");
+}
+
+TEST(PipeTest, BoundedPipeInputCloseUnblocksWriter) {
+  auto [input_stream, output_stream] = CreatePipe({
+      .high_watermark = 4,
+      .low_watermark = 0,
+  });
+  EXPECT_TRUE(output_stream->Write(ByteArray("ABCD")).Ok());
+
+  Thread writer_thread;
+  OutputStream* output = output_stream.get();
+  writer_thread.Start([output]() {
+    EXPECT_TRUE(output->Write(ByteArray("EFGH")).Raised(Exception::kIo));
+  });
+  absl::SleepFor(absl::Milliseconds(100));
+  EXPECT_TRUE(input_stream->Close().Ok());
+
+  writer_thread.Join();
+}
+
 }  // namespace nearby
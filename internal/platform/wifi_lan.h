@@ -20,6 +20,7 @@
 #include <utility>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
 #include "internal/platform/cancellation_flag.h"
 #include "internal/platform/implementation/platform.h"
 #include "internal/platform/implementation/wifi_lan.h"
@@ -57,6 +58,12 @@ class WifiLanSocket final {
   // Returns Exception::kIo on error, Exception::kSuccess otherwise.
   Exception Close() { return impl_->Close(); }
 
+  // Calls `callback` once when the InputStream is readable or the socket is
+  // closed. Returns false if the platform can't tell.
+  bool NotifyWhenReadable(absl::AnyInvocable<void()> callback) {
+    return impl_->NotifyWhenReadable(std::move(callback));
+  }
+
   // Returns true if a socket is usable. If this method returns false,
   // it is not safe to call any other method.
   // NOTE(socket validity):
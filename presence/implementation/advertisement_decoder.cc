@@ -30,7 +30,7 @@
 #include "presence/data_element.h"
 #include "presence/implementation/action_factory.h"
 #include "presence/implementation/base_broadcast_request.h"
-#include "presence/implementation/ldt.h"
+#include "presence/implementation/ldt_decryptor_index.h"
 
 namespace nearby {
 namespace presence {
@@ -206,28 +206,21 @@ void AdvertisementDecoder::DecodeBaseAction(
 }
 
 absl::StatusOr<std::string> AdvertisementDecoder::DecryptLdt(
-    const std::vector<internal::SharedCredential>& credentials,
-    absl::string_view salt, absl::string_view data_elements) {
-  if (credentials.empty()) {
-    return absl::UnavailableError("No credentials");
+    LdtDecryptorIndex& decryptors, absl::string_view salt,
+    absl::string_view data_elements) {
+  absl::StatusOr<LdtDecryptorIndex::Result> result =
+      decryptors.DecryptAndVerify(data_elements, salt);
+  if (!result.ok()) {
+    return result.status();
   }
-  for (const auto& credential : credentials) {
-    absl::StatusOr<LdtEncryptor> encryptor = LdtEncryptor::Create(
-        credential.key_seed(),
-        credential.metadata_encryption_key_tag_v0());
-    if (encryptor.ok()) {
-      absl::StatusOr<std::string> result =
-          encryptor->DecryptAndVerify(data_elements, salt);
-      if (result.ok() && result->size() > kBaseMetadataSize) {
-        decoded_advertisement_.public_credential = credential;
-        decoded_advertisement_.metadata_key =
-            result->substr(0, kBaseMetadataSize);
-        return result->substr(kBaseMetadataSize);
-      }
-    }
+  if (result->plaintext.size() <= kBaseMetadataSize) {
+    return absl::UnavailableError(
+        "Couldn't decrypt the message with any credentials");
   }
-  return absl::UnavailableError(
-      "Couldn't decrypt the message with any credentials");
+  decoded_advertisement_.public_credential = *result->credential;
+  decoded_advertisement_.metadata_key =
+      result->plaintext.substr(0, kBaseMetadataSize);
+  return result->plaintext.substr(kBaseMetadataSize);
 }
 
 absl::Status AdvertisementDecoder::DecryptDataElements(
@@ -267,6 +260,31 @@ absl::Status AdvertisementDecoder::DecryptDataElements(
 
 absl::StatusOr<std::string> AdvertisementDecoder::Decrypt(
     absl::string_view salt, absl::string_view encrypted) {
+  for (LdtDecryptorIndex& decryptors : scan_filter_decryptors_) {
+    absl::StatusOr<std::string> decrypted =
+        DecryptLdt(decryptors, salt, encrypted);
+    if (decrypted.ok()) {
+      return decrypted;
+    }
+  }
+  if (!has_credentials_) {
+    return absl::FailedPreconditionError("Missing credentials");
+  }
+  auto it = decryptors_.find(decoded_advertisement_.identity_type);
+  if (it == decryptors_.end()) {
+    return absl::UnavailableError("No credentials");
+  }
+  return DecryptLdt(it->second, salt, encrypted);
+}
+
+void AdvertisementDecoder::UpdateCredentials(
+    IdentityType identity_type,
+    const std::vector<internal::SharedCredential>& credentials) {
+  has_credentials_ = true;
+  decryptors_[identity_type] = LdtDecryptorIndex(credentials);
+}
+
+void AdvertisementDecoder::AddScanFilterDecryptors() {
   for (const auto& scan_filter : scan_request_.scan_filters) {
     if (!absl::holds_alternative<LegacyPresenceScanFilter>(scan_filter)) {
       continue;
@@ -277,18 +295,8 @@ absl::StatusOr<std::string> AdvertisementDecoder::Decrypt(
     if (credentials.empty()) {
       continue;
     }
-    absl::StatusOr<std::string> decrypted =
-        DecryptLdt(credentials, salt, encrypted);
-    if (decrypted.ok()) {
-      return decrypted;
-    }
+    scan_filter_decryptors_.emplace_back(credentials);
   }
-  if (credentials_ == nullptr) {
-    return absl::FailedPreconditionError("Missing credentials");
-  }
-
-  return DecryptLdt((*credentials_)[decoded_advertisement_.identity_type], salt,
-                    encrypted);
 }
 
 void AdvertisementDecoder::AddBannedDataTypes() {
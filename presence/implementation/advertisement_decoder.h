@@ -25,6 +25,7 @@
 #include "internal/platform/implementation/credential_callbacks.h"
 #include "internal/proto/credential.pb.h"
 #include "presence/data_element.h"
+#include "presence/implementation/ldt_decryptor_index.h"
 #include "presence/scan_request.h"
 
 namespace nearby {
@@ -48,15 +49,25 @@ class AdvertisementDecoder {
       ScanRequest scan_request,
       absl::flat_hash_map<IdentityType,
                           std::vector<internal::SharedCredential>>* credentials)
-      : scan_request_(scan_request), credentials_(credentials) {
-    AddBannedDataTypes();
+      : AdvertisementDecoder(scan_request) {
+    for (const auto& [identity_type, identity_credentials] : *credentials) {
+      UpdateCredentials(identity_type, identity_credentials);
+    }
   }
 
   explicit AdvertisementDecoder(ScanRequest scan_request)
       : scan_request_(scan_request) {
     AddBannedDataTypes();
+    AddScanFilterDecryptors();
   }
 
+  // Replaces the credentials used to decrypt advertisements of
+  // `identity_type`. Their LDT keys are derived here, once, rather than for
+  // every advertisement.
+  void UpdateCredentials(
+      IdentityType identity_type,
+      const std::vector<internal::SharedCredential>& credentials);
+
   static std::vector<CredentialSelector> GetCredentialSelectors(
       const ScanRequest& scan_request);
 
@@ -77,18 +88,23 @@ class AdvertisementDecoder {
   absl::StatusOr<std::string> Decrypt(absl::string_view salt,
                                       absl::string_view encrypted);
   void DecodeBaseAction(absl::string_view serialized_action);
-  absl::StatusOr<std::string> DecryptLdt(
-      const std::vector<internal::SharedCredential>& credentials,
-      absl::string_view salt, absl::string_view data_elements);
+  absl::StatusOr<std::string> DecryptLdt(LdtDecryptorIndex& decryptors,
+                                         absl::string_view salt,
+                                         absl::string_view data_elements);
   void AddBannedDataTypes();
+  void AddScanFilterDecryptors();
   bool MatchesScanFilter(const std::vector<DataElement>& data_elements,
                          const PresenceScanFilter& filter);
   bool MatchesScanFilter(const std::vector<DataElement>& data_elements,
                          const LegacyPresenceScanFilter& filter);
 
   ScanRequest scan_request_;
-  absl::flat_hash_map<IdentityType, std::vector<internal::SharedCredential>>*
-      credentials_ = nullptr;
+  // Decryptors for the credentials in the legacy scan filters.
+  std::vector<LdtDecryptorIndex> scan_filter_decryptors_;
+  // Decryptors for the credentials of each identity type.
+  absl::flat_hash_map<IdentityType, LdtDecryptorIndex> decryptors_;
+  // Whether credentials have been provided at all.
+  bool has_credentials_ = false;
   absl::flat_hash_set<int> banned_data_types_;
   Advertisement decoded_advertisement_;
 };
@@ -0,0 +1,134 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Throughput of decoding encrypted advertisements against the number of
+// credentials of the scanning device.
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_format.h"
+#include "internal/proto/credential.pb.h"
+#include "presence/implementation/advertisement_decoder.h"
+#include "presence/implementation/ldt.h"
+#include "presence/scan_request.h"
+
+namespace nearby {
+namespace presence {
+namespace {
+
+using ::nearby::internal::IdentityType;
+using ::nearby::internal::SharedCredential;
+
+// A private identity advertisement, and the credential that encrypted it.
+constexpr absl::string_view kAdvertisementBase16 =
+    "00514142c2c30e79fee14599e36e34d5d42e49fc37b0df";
+constexpr absl::string_view kKeySeedBase16 =
+    "ccdb2489e9fcac42b39348b8941ed19a1d360e75e098c8c15e6b1cc2b620cd39";
+constexpr absl::string_view kMetadataKeyTagBase16 =
+    "dfb90a1f9b1fe28d18bbcca52240b5cc2ccb5f8d5289a3cb64eb3541ca614bb4";
+
+ScanRequest GetScanRequest() {
+  return {.account_name = "test account",
+          .identity_types = {IdentityType::IDENTITY_TYPE_PRIVATE}};
+}
+
+// Returns `count` credentials, only the last of which decrypts the
+// advertisement, so every credential has to be tried.
+std::vector<SharedCredential> GetCredentials(int count) {
+  std::vector<SharedCredential> credentials(count);
+  for (int i = 0; i < count - 1; ++i) {
+    credentials[i].set_key_seed(absl::StrFormat("%032d", i));
+    credentials[i].set_metadata_encryption_key_tag_v0(
+        absl::StrFormat("%032d", i));
+  }
+  credentials.back().set_key_seed(absl::HexStringToBytes(kKeySeedBase16));
+  credentials.back().set_metadata_encryption_key_tag_v0(
+      absl::HexStringToBytes(kMetadataKeyTagBase16));
+  return credentials;
+}
+
+// Decrypting the way the decoder used to: LDT keys are derived for every
+// credential, for every advertisement.
+void BM_DecryptDerivingKeys(benchmark::State& state) {
+  std::vector<SharedCredential> credentials = GetCredentials(state.range(0));
+  std::string advertisement = absl::HexStringToBytes(kAdvertisementBase16);
+  absl::string_view salt = absl::string_view(advertisement).substr(2, 2);
+  absl::string_view encrypted = absl::string_view(advertisement).substr(4);
+
+  for (auto _ : state) {
+    for (const SharedCredential& credential : credentials) {
+      absl::StatusOr<LdtEncryptor> encryptor = LdtEncryptor::Create(
+          credential.key_seed(), credential.metadata_encryption_key_tag_v0());
+      if (encryptor.ok() && encryptor->DecryptAndVerify(encrypted, salt).ok()) {
+        break;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecryptDerivingKeys)->Arg(10)->Arg(1000)->Arg(10000);
+
+// A device that is heard over and over, which is what a scan mostly sees.
+void BM_DecodeRepeatedAdvertisement(benchmark::State& state) {
+  AdvertisementDecoder decoder(GetScanRequest());
+  decoder.UpdateCredentials(IdentityType::IDENTITY_TYPE_PRIVATE,
+                            GetCredentials(state.range(0)));
+  std::string advertisement = absl::HexStringToBytes(kAdvertisementBase16);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decoder.DecodeAdvertisement(advertisement));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeRepeatedAdvertisement)->Arg(10)->Arg(1000)->Arg(10000);
+
+// A new salt every time, so every credential is tried for every
+// advertisement with the precomputed keys.
+void BM_DecodeNewAdvertisement(benchmark::State& state) {
+  AdvertisementDecoder decoder(GetScanRequest());
+  decoder.UpdateCredentials(IdentityType::IDENTITY_TYPE_PRIVATE,
+                            GetCredentials(state.range(0)));
+  std::string advertisement = absl::HexStringToBytes(kAdvertisementBase16);
+  int salt = 0;
+
+  for (auto _ : state) {
+    ++salt;
+    advertisement[2] = static_cast<char>(salt >> 8);
+    advertisement[3] = static_cast<char>(salt);
+    benchmark::DoNotOptimize(decoder.DecodeAdvertisement(advertisement));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeNewAdvertisement)->Arg(10)->Arg(1000)->Arg(10000);
+
+// The one-off cost of a credential update.
+void BM_UpdateCredentials(benchmark::State& state) {
+  AdvertisementDecoder decoder(GetScanRequest());
+  std::vector<SharedCredential> credentials = GetCredentials(state.range(0));
+
+  for (auto _ : state) {
+    decoder.UpdateCredentials(IdentityType::IDENTITY_TYPE_PRIVATE,
+                              credentials);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UpdateCredentials)->Arg(10)->Arg(1000)->Arg(10000);
+
+}  // namespace
+}  // namespace presence
+}  // namespace nearby
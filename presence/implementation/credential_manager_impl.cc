@@ -23,8 +23,12 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/variant.h"
 #include "internal/platform/count_down_latch.h"
@@ -62,6 +66,7 @@ using ::nearby::Future;
 using ::nearby::internal::IdentityType;
 using ::nearby::internal::LocalCredential;
 using ::nearby::internal::SharedCredential;
+using CredentialPair = CredentialManagerImpl::CredentialPair;
 
 // Key to retrieve local device's Private/Public Key Credentials from key store.
 constexpr char kPairedKeyAliasPrefix[] = "nearby_presence_paired_key_alias_";
@@ -84,6 +89,51 @@ std::string CustomizeBytesSize(absl::string_view bytes, size_t len) {
       /*info=*/"", /*derived_key_size=*/len);
 }
 
+// Removes the credentials that ended before `current_time_millis` and returns
+// the latest end time of the others, or `current_time_millis` if it is later.
+template <typename Credential>
+int64_t RemoveExpiredCredentials(std::vector<Credential>& credentials,
+                                 int64_t current_time_millis) {
+  credentials.erase(std::remove_if(credentials.begin(), credentials.end(),
+                                   [&](const Credential& credential) {
+                                     return credential.end_time_millis() <
+                                            current_time_millis;
+                                   }),
+                    credentials.end());
+  int64_t last_valid_end_time_millis = current_time_millis;
+  for (const Credential& credential : credentials) {
+    last_valid_end_time_millis =
+        std::max(last_valid_end_time_millis, credential.end_time_millis());
+  }
+  return last_valid_end_time_millis;
+}
+
+// Collects the results of tasks running on the crypto threads, and passes them
+// to `callback` once all of them are set.
+template <typename Result>
+class Batch {
+ public:
+  Batch(int size, absl::AnyInvocable<void(std::vector<Result>) &&> callback)
+      : results_(size), remaining_(size), callback_(std::move(callback)) {}
+
+  void Set(int index, Result result) ABSL_LOCKS_EXCLUDED(mutex_) {
+    std::vector<Result> results;
+    {
+      absl::MutexLock lock(&mutex_);
+      results_[index] = std::move(result);
+      if (--remaining_ > 0) return;
+      results = std::move(results_);
+    }
+    std::move(callback_)(std::move(results));
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<Result> results_ ABSL_GUARDED_BY(mutex_);
+  int remaining_ ABSL_GUARDED_BY(mutex_);
+  absl::AnyInvocable<void(std::vector<Result>) &&> callback_;
+};
+
 }  // namespace
 
 void CredentialManagerImpl::GenerateCredentials(
@@ -95,17 +145,17 @@ void CredentialManagerImpl::GenerateCredentials(
   std::vector<LocalCredential> private_credentials;
 
   for (auto identity_type : identity_types) {
-    absl::Time start_time = SystemClock::ElapsedRealtime();
     absl::Duration gap = credential_life_cycle_days * absl::Hours(24);
-    for (int index = 0; index < contiguous_copy_of_credentials; index++) {
-      auto public_private_credentials = CreateLocalCredential(
-          metadata, identity_type, start_time, start_time + gap);
+    for (auto& public_private_credentials : CreateLocalCredentialsSync(
+             metadata, identity_type, SystemClock::ElapsedRealtime(), gap,
+             contiguous_copy_of_credentials)) {
       if (public_private_credentials.second.identity_type() !=
           IdentityType::IDENTITY_TYPE_UNSPECIFIED) {
-        private_credentials.push_back(public_private_credentials.first);
-        public_credentials.push_back(public_private_credentials.second);
+        private_credentials.push_back(
+            std::move(public_private_credentials.first));
+        public_credentials.push_back(
+            std::move(public_private_credentials.second));
       }
-      start_time += gap;
     }
   }
 
@@ -219,6 +269,47 @@ CredentialManagerImpl::CreateLocalCredential(const Metadata& metadata,
       CreatePublicCredential(private_credential, metadata, public_key));
 }
 
+void CredentialManagerImpl::CreateLocalCredentials(
+    const Metadata& metadata, IdentityType identity_type,
+    absl::Time start_time, absl::Duration life_cycle, int count,
+    absl::AnyInvocable<void(std::vector<CredentialPair>) &&> callback) {
+  if (count <= 0) {
+    std::move(callback)({});
+    return;
+  }
+  auto batch =
+      std::make_shared<Batch<CredentialPair>>(count, std::move(callback));
+  for (int index = 0; index < count; index++) {
+    absl::Time credential_start_time = start_time + life_cycle * index;
+    crypto_executor_.Execute(
+        "create-local-credential",
+        [this, batch, index, metadata, identity_type, credential_start_time,
+         credential_end_time = credential_start_time + life_cycle]() {
+          batch->Set(index, CreateLocalCredential(metadata, identity_type,
+                                                  credential_start_time,
+                                                  credential_end_time));
+        });
+  }
+}
+
+std::vector<CredentialPair> CredentialManagerImpl::CreateLocalCredentialsSync(
+    const Metadata& metadata, IdentityType identity_type,
+    absl::Time start_time, absl::Duration life_cycle, int count) {
+  CountDownLatch create_credentials_latch(1);
+  std::vector<CredentialPair> credentials;
+  CreateLocalCredentials(
+      metadata, identity_type, start_time, life_cycle, count,
+      [create_credentials_latch,
+       &credentials](std::vector<CredentialPair> result) mutable {
+        credentials = std::move(result);
+        create_credentials_latch.CountDown();
+      });
+  if (!WaitForLatch("CreateLocalCredentials", &create_credentials_latch)) {
+    return {};
+  }
+  return credentials;
+}
+
 SharedCredential CredentialManagerImpl::CreatePublicCredential(
     const LocalCredential& private_credential, const Metadata& metadata,
     const std::vector<uint8_t>& public_key) {
@@ -282,10 +373,34 @@ std::string CredentialManagerImpl::DecryptMetadata(
                           /*nonce=*/
                           iv_bytes,
                           /*additional_data=*/CryptoSpan<uint8_t>());
+  if (!result.has_value()) {
+    NEARBY_LOGS(INFO) << "Failed to decrypt the device metadata.";
+    return "";
+  }
 
   return std::string(result.value().begin(), result.value().end());
 }
 
+void CredentialManagerImpl::DecryptMetadataBatch(
+    std::vector<EncryptedMetadata> batch,
+    absl::AnyInvocable<void(std::vector<std::string>) &&> callback) {
+  if (batch.empty()) {
+    std::move(callback)({});
+    return;
+  }
+  auto results =
+      std::make_shared<Batch<std::string>>(batch.size(), std::move(callback));
+  for (int index = 0; index < static_cast<int>(batch.size()); index++) {
+    crypto_executor_.Execute(
+        "decrypt-metadata",
+        [this, results, index, metadata = std::move(batch[index])]() {
+          results->Set(index, DecryptMetadata(metadata.metadata_encryption_key,
+                                              metadata.key_seed,
+                                              metadata.encrypted_metadata));
+        });
+  }
+}
+
 std::string CredentialManagerImpl::EncryptMetadata(
     absl::string_view metadata_encryption_key, absl::string_view key_seed,
     absl::string_view metadata_string) {
@@ -320,9 +435,9 @@ std::vector<uint8_t> CredentialManagerImpl::ExtendMetadataEncryptionKey(
       /*info=*/CryptoSpan<uint8_t>(), kNearbyPresenceNumBytesAesGcmKeySize);
 }
 
-void CredentialManagerImpl::GetLocalCredentials(
-    const CredentialSelector& credential_selector,
-    GetLocalCredentialsResultCallback callback) {
+absl::StatusOr<std::vector<LocalCredential>>
+CredentialManagerImpl::GetStoredLocalCredentials(
+    const CredentialSelector& credential_selector) {
   CountDownLatch get_local_credentials_latch(1);
   absl::StatusOr<std::vector<LocalCredential>> get_local_credentials_result;
   credential_storage_ptr_->GetLocalCredentials(
@@ -338,10 +453,41 @@ void CredentialManagerImpl::GetLocalCredentials(
       });
   if (!WaitForLatch("GetLocalCredentials", &get_local_credentials_latch)) {
     NEARBY_LOGS(INFO) << "Failed in awaiting GetLocalCredentials";
-    callback.credentials_fetched_cb(
-        absl::DeadlineExceededError("Failed in awaiting GetLocalCredentials"));
-    return;
+    return absl::DeadlineExceededError("Failed in awaiting GetLocalCredentials");
+  }
+  return get_local_credentials_result;
+}
+
+absl::StatusOr<std::vector<SharedCredential>>
+CredentialManagerImpl::GetStoredPublicCredentials(
+    const CredentialSelector& credential_selector,
+    PublicCredentialType public_credential_type) {
+  CountDownLatch get_shared_credentials_latch(1);
+  absl::StatusOr<std::vector<SharedCredential>> get_shared_credentials_result;
+  credential_storage_ptr_->GetPublicCredentials(
+      credential_selector, public_credential_type,
+      GetPublicCredentialsResultCallback{
+          .credentials_fetched_cb =
+              [get_shared_credentials_latch, &get_shared_credentials_result](
+                  absl::StatusOr<std::vector<SharedCredential>>
+                      credentials) mutable {
+                get_shared_credentials_result = std::move(credentials);
+                get_shared_credentials_latch.CountDown();
+              },
+      });
+  if (!WaitForLatch("GetSharedCredentials", &get_shared_credentials_latch)) {
+    NEARBY_LOGS(INFO) << "Failed in awaiting GetSharedCredentials";
+    return absl::DeadlineExceededError(
+        "Failed in awaiting GetsharedCredentials");
   }
+  return get_shared_credentials_result;
+}
+
+void CredentialManagerImpl::GetLocalCredentials(
+    const CredentialSelector& credential_selector,
+    GetLocalCredentialsResultCallback callback) {
+  absl::StatusOr<std::vector<LocalCredential>> get_local_credentials_result =
+      GetStoredLocalCredentials(credential_selector);
   if (!get_local_credentials_result.ok()) {
     callback.credentials_fetched_cb(get_local_credentials_result.status());
     return;
@@ -365,25 +511,8 @@ void CredentialManagerImpl::GetPublicCredentials(
     return;
   }
 
-  CountDownLatch get_shared_credentials_latch(1);
-  absl::StatusOr<std::vector<SharedCredential>> get_shared_credentials_result;
-  credential_storage_ptr_->GetPublicCredentials(
-      credential_selector, public_credential_type,
-      GetPublicCredentialsResultCallback{
-          .credentials_fetched_cb =
-              [get_shared_credentials_latch, &get_shared_credentials_result](
-                  absl::StatusOr<std::vector<SharedCredential>>
-                      credentials) mutable {
-                get_shared_credentials_result = std::move(credentials);
-                get_shared_credentials_latch.CountDown();
-              },
-      });
-  if (!WaitForLatch("GetSharedCredentials", &get_shared_credentials_latch)) {
-    NEARBY_LOGS(INFO) << "Failed in awaiting GetSharedCredentials";
-    callback.credentials_fetched_cb(
-        absl::DeadlineExceededError("Failed in awaiting GetsharedCredentials"));
-    return;
-  }
+  absl::StatusOr<std::vector<SharedCredential>> get_shared_credentials_result =
+      GetStoredPublicCredentials(credential_selector, public_credential_type);
   if (!get_shared_credentials_result.ok()) {
     callback.credentials_fetched_cb(get_shared_credentials_result.status());
     return;
@@ -574,45 +703,38 @@ void CredentialManagerImpl::CheckCredentialsAndRefillIfNeeded(
         callback_for_local_credentials,
     std::optional<GetPublicCredentialsResultCallback>
         callback_for_shared_credentials) {
-  bool invoked_for_local = false;
-  int valid_credentials_count = 0;
   int64_t current_time_millis =
       absl::ToUnixMillis(SystemClock::ElapsedRealtime());
-  int64_t last_valid_end_time_millis = current_time_millis;
 
-  std::vector<LocalCredential> valid_local_credentials;
-  std::vector<SharedCredential> valid_shared_credentials;
+  // Most invokes are expected to return early here as it already got enough
+  // valid credentials, no need to refill.
+  // Otherwise, the long process of refill (generate, another read, merge, then
+  // save) is started on `refill_executor_`, so that the caller, usually the
+  // service controller thread, is not blocked meanwhile.
   if (absl::holds_alternative<std::vector<nearby::internal::LocalCredential>*>(
           credential_list_variant) &&
       callback_for_local_credentials.has_value()) {
-    invoked_for_local = true;
-    for (auto& credential :
-         *absl::get<std::vector<nearby::internal::LocalCredential>*>(
-             credential_list_variant)) {
-      if (credential.end_time_millis() < current_time_millis) {
-        continue;
-      }
-      valid_credentials_count++;
-      if (last_valid_end_time_millis < credential.end_time_millis()) {
-        last_valid_end_time_millis = credential.end_time_millis();
-      }
-      valid_local_credentials.push_back(credential);
+    auto& credentials =
+        *absl::get<std::vector<nearby::internal::LocalCredential>*>(
+            credential_list_variant);
+    RemoveExpiredCredentials(credentials, current_time_millis);
+    if (credentials.size() >= kExpectedValidLocalCredtialSize) {
+      callback_for_local_credentials.value().credentials_fetched_cb(
+          std::move(credentials));
+      return;
     }
   } else if (absl::holds_alternative<
                  std::vector<nearby::internal::SharedCredential>*>(
                  credential_list_variant) &&
              callback_for_shared_credentials.has_value()) {
-    for (auto& credential :
-         *absl::get<std::vector<nearby::internal::SharedCredential>*>(
-             credential_list_variant)) {
-      if (credential.end_time_millis() < current_time_millis) {
-        continue;
-      }
-      valid_credentials_count++;
-      if (last_valid_end_time_millis < credential.end_time_millis()) {
-        last_valid_end_time_millis = credential.end_time_millis();
-      }
-      valid_shared_credentials.push_back(credential);
+    auto& credentials =
+        *absl::get<std::vector<nearby::internal::SharedCredential>*>(
+            credential_list_variant);
+    RemoveExpiredCredentials(credentials, current_time_millis);
+    if (credentials.size() >= kExpectedValidLocalCredtialSize) {
+      callback_for_shared_credentials.value().credentials_fetched_cb(
+          std::move(credentials));
+      return;
     }
   } else {
     NEARBY_LOGS(ERROR)
@@ -620,153 +742,115 @@ void CredentialManagerImpl::CheckCredentialsAndRefillIfNeeded(
     return;
   }
 
-  // Most invokes are expected to return early here as it already got enough
-  // valid credentials, no need to refill.
-  // Otherwise, the long process of refill (another read, merge, then save)
-  // would start.
-  if (valid_credentials_count >= kExpectedValidLocalCredtialSize) {
+  refill_executor_.Execute(
+      "refill-credentials",
+      [this, credential_selector, metadata = metadata_,
+       callback_for_local_credentials =
+           std::move(callback_for_local_credentials),
+       callback_for_shared_credentials =
+           std::move(callback_for_shared_credentials)]() mutable {
+        RefillCredentials(credential_selector, metadata,
+                          std::move(callback_for_local_credentials),
+                          std::move(callback_for_shared_credentials));
+      });
+}
+
+void CredentialManagerImpl::RefillCredentials(
+    const CredentialSelector& credential_selector, const Metadata& metadata,
+    std::optional<GetLocalCredentialsResultCallback>
+        callback_for_local_credentials,
+    std::optional<GetPublicCredentialsResultCallback>
+        callback_for_shared_credentials) {
+  bool invoked_for_local = callback_for_local_credentials.has_value();
+  auto report_error = [&](absl::Status status) {
     if (invoked_for_local) {
-      callback_for_local_credentials.value().credentials_fetched_cb(
-          valid_local_credentials);
+      callback_for_local_credentials.value().credentials_fetched_cb(status);
     } else {
-      callback_for_shared_credentials.value().credentials_fetched_cb(
-          valid_shared_credentials);
+      callback_for_shared_credentials.value().credentials_fetched_cb(status);
     }
+  };
+
+  absl::StatusOr<std::vector<LocalCredential>> local_credentials =
+      GetStoredLocalCredentials(credential_selector);
+  if (!local_credentials.ok()) {
+    report_error(local_credentials.status());
     return;
   }
-
-  std::vector<LocalCredential> newly_generated_local_credentials;
-  std::vector<SharedCredential> newly_generated_shared_credentials;
-  // Generate more credential pairs to refill the expired ones.
-  auto start_time = absl::FromUnixMillis(last_valid_end_time_millis);
-  auto gap = kCredentialLifeCycleDays * absl::Hours(24);
-  for (int i = 0; i < kExpectedValidLocalCredtialSize - valid_credentials_count;
-       i++) {
-    auto pair =
-        CreateLocalCredential(metadata_, credential_selector.identity_type,
-                              start_time, start_time + gap);
-    newly_generated_local_credentials.push_back(pair.first);
-    newly_generated_shared_credentials.push_back(pair.second);
-    start_time += gap;
+  absl::StatusOr<std::vector<SharedCredential>> shared_credentials =
+      GetStoredPublicCredentials(credential_selector,
+                                 PublicCredentialType::kLocalPublicCredential);
+  if (!shared_credentials.ok()) {
+    report_error(shared_credentials.status());
+    return;
   }
-
-  // Already got the merged valid credential list for either local or shared.
-  // Now get the other credentials list from storage.
-  CountDownLatch get_corresponding_credentials_latch(1);
-  if (invoked_for_local) {
-    absl::StatusOr<std::vector<nearby::internal::SharedCredential>>
-        get_shared_result;
-    credential_storage_ptr_->GetPublicCredentials(
-        credential_selector, PublicCredentialType::kLocalPublicCredential,
-        GetPublicCredentialsResultCallback{
-            .credentials_fetched_cb =
-                [get_corresponding_credentials_latch, &get_shared_result](
-                    absl::StatusOr<
-                        std::vector<nearby::internal::SharedCredential>>
-                        result) mutable {
-                  get_shared_result = std::move(result);
-                  get_corresponding_credentials_latch.CountDown();
-                },
-        });
-    if (!WaitForLatch(
-            "CheckCredentialsAndRefillIfNeeded-GetCorrespondingShared",
-            &get_corresponding_credentials_latch)) {
-      callback_for_local_credentials.value().credentials_fetched_cb(
-          absl::DeadlineExceededError("Failed in GetLocalCredentials"));
-      return;
-    }
-    if (!get_shared_result.ok()) {
-      callback_for_local_credentials.value().credentials_fetched_cb(
-          get_shared_result.status());
-      return;
-    }
-    for (const auto& credential : get_shared_result.value()) {
-      if (credential.end_time_millis() >= current_time_millis) {
-        valid_shared_credentials.push_back(credential);
-      }
+  int64_t current_time_millis =
+      absl::ToUnixMillis(SystemClock::ElapsedRealtime());
+  int64_t last_local_end_time_millis =
+      RemoveExpiredCredentials(*local_credentials, current_time_millis);
+  int64_t last_shared_end_time_millis =
+      RemoveExpiredCredentials(*shared_credentials, current_time_millis);
+  int valid_credentials_count = invoked_for_local ? local_credentials->size()
+                                                  : shared_credentials->size();
+
+  // An earlier refill may have topped the credentials up already.
+  if (valid_credentials_count < kExpectedValidLocalCredtialSize) {
+    // Generate more credential pairs to refill the expired ones.
+    std::vector<CredentialPair> newly_generated_credentials =
+        CreateLocalCredentialsSync(
+            metadata, credential_selector.identity_type,
+            absl::FromUnixMillis(invoked_for_local
+                                     ? last_local_end_time_millis
+                                     : last_shared_end_time_millis),
+            kCredentialLifeCycleDays * absl::Hours(24),
+            kExpectedValidLocalCredtialSize - valid_credentials_count);
+    // Now merge newly generated credentails to already existing valid ones.
+    for (auto& pair : newly_generated_credentials) {
+      local_credentials->push_back(std::move(pair.first));
+      shared_credentials->push_back(std::move(pair.second));
     }
-  } else {
-    absl::StatusOr<std::vector<nearby::internal::LocalCredential>>
-        get_local_result;
-    credential_storage_ptr_->GetLocalCredentials(
-        credential_selector,
-        GetLocalCredentialsResultCallback{
-            .credentials_fetched_cb =
-                [get_corresponding_credentials_latch, &get_local_result](
-                    absl::StatusOr<
-                        std::vector<nearby::internal::LocalCredential>>
-                        result) mutable {
-                  get_local_result = std::move(result);
-                  get_corresponding_credentials_latch.CountDown();
+    // Save merged local and shared credential lists to storage
+    CountDownLatch save_credentials_latch(1);
+    absl::Status save_credentials_status;
+    credential_storage_ptr_->SaveCredentials(
+        credential_selector.manager_app_id, credential_selector.account_name,
+        *local_credentials, *shared_credentials,
+        PublicCredentialType::kLocalPublicCredential,
+        SaveCredentialsResultCallback{
+            .credentials_saved_cb =
+                [save_credentials_latch,
+                 &save_credentials_status](absl::Status status) mutable {
+                  save_credentials_status = status;
+                  save_credentials_latch.CountDown();
                 },
         });
-    if (!WaitForLatch("CheckCredentialsAndRefillIfNeeded-GetCorrespondingLocal",
-                      &get_corresponding_credentials_latch)) {
-      callback_for_shared_credentials.value().credentials_fetched_cb(
-          absl::DeadlineExceededError(
-              "Failed in awaiting corresponding GetSharedCredentials"));
-      return;
+    if (!WaitForLatch("RefillCredentials-SaveCredentials",
+                      &save_credentials_latch)) {
+      save_credentials_status =
+          absl::DeadlineExceededError("Failed in awaiting SaveCredentials");
     }
-    if (!get_local_result.ok()) {
-      callback_for_local_credentials.value().credentials_fetched_cb(
-          get_local_result.status());
+    if (!save_credentials_status.ok()) {
+      NEARBY_LOGS(ERROR) << "Save credentials failed with: "
+                         << save_credentials_status;
+      report_error(save_credentials_status);
       return;
     }
-    for (const auto& credential : get_local_result.value()) {
-      if (credential.end_time_millis() >= current_time_millis) {
-        valid_local_credentials.push_back(credential);
-      }
-    }
-  }
-
-  // Now merge newly generated credentails to already existing valid ones.
-  valid_local_credentials.insert(valid_local_credentials.end(),
-                                 newly_generated_local_credentials.begin(),
-                                 newly_generated_local_credentials.end());
-  valid_shared_credentials.insert(valid_shared_credentials.end(),
-                                  newly_generated_shared_credentials.begin(),
-                                  newly_generated_shared_credentials.end());
-  // Save merged local and shared credential lists to storage
-  CountDownLatch save_credentials_latch(1);
-  absl::Status save_credentials_status;
-  credential_storage_ptr_->SaveCredentials(
-      credential_selector.manager_app_id, credential_selector.account_name,
-      valid_local_credentials, valid_shared_credentials,
-      PublicCredentialType::kLocalPublicCredential,
-      SaveCredentialsResultCallback{
-          .credentials_saved_cb =
-              [save_credentials_latch,
-               &save_credentials_status](absl::Status status) mutable {
-                save_credentials_status = status;
-                save_credentials_latch.CountDown();
-              },
-      });
-  if (!WaitForLatch("CheckCredentialsAndRefillIfNeeded-SaveCredentials",
-                    &save_credentials_latch)) {
-    save_credentials_status =
-        absl::DeadlineExceededError("Failed in awaiting SaveCredentials");
-  }
-  if (!save_credentials_status.ok()) {
-    NEARBY_LOGS(ERROR) << "Save credentials failed with: "
-                       << save_credentials_status;
-    if (invoked_for_local) {
-      callback_for_local_credentials.value().credentials_fetched_cb(
-          save_credentials_status);
-    } else {
-      callback_for_shared_credentials.value().credentials_fetched_cb(
-          save_credentials_status);
-    }
-    return;
   }
   if (invoked_for_local) {
     callback_for_local_credentials.value().credentials_fetched_cb(
-        valid_local_credentials);
+        std::move(*local_credentials));
   } else {
     callback_for_shared_credentials.value().credentials_fetched_cb(
-        valid_shared_credentials);
+        std::move(*shared_credentials));
   }
 }
 
+void CredentialManagerImpl::FlushCredentialRefillsForTest() {
+  CountDownLatch flush_latch(1);
+  refill_executor_.Execute("flush-refills",
+                           [flush_latch]() mutable { flush_latch.CountDown(); });
+  WaitForLatch("FlushCredentialRefillsForTest", &flush_latch);
+}
+
 bool CredentialManagerImpl::WaitForLatch(absl::string_view method_name,
                                          CountDownLatch* latch) {
   Exception await_exception = latch->Await();
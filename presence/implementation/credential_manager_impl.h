@@ -24,13 +24,16 @@
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
 #include "absl/log/die_if_null.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "absl/types/variant.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/credential_storage_impl.h"
 #include "internal/platform/implementation/credential_callbacks.h"
+#include "internal/platform/multi_thread_executor.h"
 #include "internal/platform/runnable.h"
 #include "internal/platform/single_thread_executor.h"
 #include "internal/proto/credential.pb.h"
@@ -44,6 +47,16 @@ class CredentialManagerImpl : public CredentialManager {
  public:
   using IdentityType = ::nearby::internal::IdentityType;
   using Metadata = ::nearby::internal::Metadata;
+  using CredentialPair = std::pair<::nearby::internal::LocalCredential,
+                                   ::nearby::internal::SharedCredential>;
+
+  // Metadata encrypted with a credential, as decrypted by
+  // `DecryptMetadataBatch`.
+  struct EncryptedMetadata {
+    std::string metadata_encryption_key;
+    std::string key_seed;
+    std::string encrypted_metadata;
+  };
 
   explicit CredentialManagerImpl(SingleThreadExecutor* executor)
       : executor_(ABSL_DIE_IF_NULL(executor)) {
@@ -66,6 +79,9 @@ class CredentialManagerImpl : public CredentialManager {
   // Modify this to 12 after use real AES.
   static constexpr int kAesGcmIVSize = 12;
 
+  // Maximum number of threads generating credentials and decrypting metadata.
+  static constexpr int kMaxCryptoThreads = 4;
+
   void GenerateCredentials(
       const Metadata& metadata, absl::string_view manager_app_id,
       const std::vector<nearby::internal::IdentityType>& identity_types,
@@ -115,10 +131,26 @@ class CredentialManagerImpl : public CredentialManager {
                               absl::string_view key_seed,
                               absl::string_view metadata_string) override;
 
-  std::pair<nearby::internal::LocalCredential,
-            nearby::internal::SharedCredential>
-  CreateLocalCredential(const Metadata& metadata, IdentityType identity_type,
-                        absl::Time start_time, absl::Time end_time);
+  // Decrypts every metadata of `batch` on the crypto threads. `callback` is
+  // called on one of them with the results in the order of `batch`; a
+  // metadata that fails to decrypt gives an empty string.
+  void DecryptMetadataBatch(
+      std::vector<EncryptedMetadata> batch,
+      absl::AnyInvocable<void(std::vector<std::string>) &&> callback);
+
+  CredentialPair CreateLocalCredential(const Metadata& metadata,
+                                       IdentityType identity_type,
+                                       absl::Time start_time,
+                                       absl::Time end_time);
+
+  // Creates `count` credentials on the crypto threads. The first one starts at
+  // `start_time`, and each one starts when the previous one ends, after
+  // `life_cycle`. `callback` is called on a crypto thread with the credentials
+  // in that order.
+  void CreateLocalCredentials(
+      const Metadata& metadata, IdentityType identity_type,
+      absl::Time start_time, absl::Duration life_cycle, int count,
+      absl::AnyInvocable<void(std::vector<CredentialPair>) &&> callback);
 
   nearby::internal::SharedCredential CreatePublicCredential(
       const nearby::internal::LocalCredential& private_credential,
@@ -150,6 +182,9 @@ class CredentialManagerImpl : public CredentialManager {
     return metadata_;
   }
 
+  // Waits for the refills started so far to complete.
+  void FlushCredentialRefillsForTest();
+
  private:
   struct SubscriberKey {
     CredentialSelector credential_selector;
@@ -187,16 +222,26 @@ class CredentialManagerImpl : public CredentialManager {
 
   bool WaitForLatch(absl::string_view method_name, CountDownLatch* latch);
 
+  // Blocking versions of the credential storage reads.
+  absl::StatusOr<std::vector<nearby::internal::LocalCredential>>
+  GetStoredLocalCredentials(const CredentialSelector& credential_selector);
+  absl::StatusOr<std::vector<nearby::internal::SharedCredential>>
+  GetStoredPublicCredentials(const CredentialSelector& credential_selector,
+                             PublicCredentialType public_credential_type);
+
+  // Blocking version of `CreateLocalCredentials`.
+  std::vector<CredentialPair> CreateLocalCredentialsSync(
+      const Metadata& metadata, IdentityType identity_type,
+      absl::Time start_time, absl::Duration life_cycle, int count);
+
   // The similar flow to check-expired-then-refill-if-needed is needed in both
   // GetLocalCredentials() and GetPublicCredentials(). The high level flow is:
   // check if there're expired creds from the result credentials list from
-  // GetLocal/GetPublic, if some creds expired, prune the expired, merge with
-  // newly generated ones. Then get the corresponding(local/shared) creds list
-  // from the storage, also prune expired, merge with newly
-  // generated. Then finally, save the newly merged two lists (local & shared)
-  // to storage. For re-use purpose, this private function is made to be able
-  // to take in different parameters from both GetLocalCredentials() and
-  // GetPublicCredentials().
+  // GetLocal/GetPublic. If there are enough valid ones, they are returned right
+  // away. Otherwise a refill is started with `RefillCredentials()` and the
+  // result is returned when it completes. For re-use purpose, this private
+  // function is made to be able to take in different parameters from both
+  // GetLocalCredentials() and GetPublicCredentials().
   void CheckCredentialsAndRefillIfNeeded(
       const CredentialSelector& credential_selector,
       absl::variant<std::vector<nearby::internal::LocalCredential>*,
@@ -207,6 +252,18 @@ class CredentialManagerImpl : public CredentialManager {
       std::optional<GetPublicCredentialsResultCallback>
           callback_for_shared_credentials);
 
+  // Runs on `refill_executor_`, one refill at a time. Reads both local and
+  // shared credentials from storage again, as an earlier refill may have
+  // topped them up already, prunes the expired ones, generates the missing
+  // ones on the crypto threads and saves the merged lists to storage. Then
+  // calls the callback that is set with the local or shared credentials.
+  void RefillCredentials(
+      const CredentialSelector& credential_selector, const Metadata& metadata,
+      std::optional<GetLocalCredentialsResultCallback>
+          callback_for_local_credentials,
+      std::optional<GetPublicCredentialsResultCallback>
+          callback_for_shared_credentials);
+
   void OnCredentialsChanged(absl::string_view manager_app_id,
                             absl::string_view account_name,
                             PublicCredentialType credential_type)
@@ -232,6 +289,11 @@ class CredentialManagerImpl : public CredentialManager {
   SingleThreadExecutor* executor_;
   std::unique_ptr<nearby::CredentialStorageImpl> credential_storage_ptr_;
   Metadata metadata_;
+  // Key pair generation and metadata encryption, off the callers' threads.
+  // Declared last, so that tasks still running can use the other members
+  // while the executors shut down.
+  MultiThreadExecutor crypto_executor_{kMaxCryptoThreads};
+  SingleThreadExecutor refill_executor_;
 };
 
 }  // namespace presence
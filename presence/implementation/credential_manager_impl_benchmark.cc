@@ -0,0 +1,158 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Cost of refilling the local credentials, and how long it holds up the
+// service controller thread, which also delivers the scan results.
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/status/statusor.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/implementation/credential_callbacks.h"
+#include "internal/platform/single_thread_executor.h"
+#include "internal/proto/credential.pb.h"
+#include "internal/proto/metadata.pb.h"
+#include "presence/implementation/credential_manager_impl.h"
+
+namespace nearby {
+namespace presence {
+namespace {
+
+using ::nearby::internal::IdentityType;
+using ::nearby::internal::LocalCredential;
+using ::nearby::internal::Metadata;
+using ::nearby::internal::SharedCredential;
+
+constexpr char kManagerAppId[] = "benchmark_app";
+constexpr char kAccountName[] = "benchmark account";
+constexpr int kCredentialCount = 6;
+
+Metadata CreateMetadata() {
+  Metadata metadata;
+  metadata.set_account_name(kAccountName);
+  metadata.set_device_name("benchmark device");
+  metadata.set_bluetooth_mac_address("FF:FF:FF:FF:FF:FF");
+  return metadata;
+}
+
+CredentialSelector CreateSelector() {
+  return CredentialSelector{
+      .manager_app_id = kManagerAppId,
+      .account_name = kAccountName,
+      .identity_type = IdentityType::IDENTITY_TYPE_PRIVATE};
+}
+
+// Stores a single credential, so that the next read refills the others.
+void StoreOneCredential(CredentialManagerImpl& credential_manager) {
+  CountDownLatch latch(1);
+  credential_manager.GenerateCredentials(
+      CreateMetadata(), kManagerAppId, {IdentityType::IDENTITY_TYPE_PRIVATE},
+      /*credential_life_cycle_days=*/5, /*contiguous_copy_of_credentials=*/1,
+      {.credentials_generated_cb =
+           [&latch](absl::StatusOr<std::vector<SharedCredential>>) {
+             latch.CountDown();
+           }});
+  latch.Await();
+}
+
+// Creates the credentials one after the other, as a refill used to.
+void BM_CreateLocalCredentialSequential(benchmark::State& state) {
+  SingleThreadExecutor executor;
+  CredentialManagerImpl credential_manager(&executor);
+  Metadata metadata = CreateMetadata();
+  absl::Time start_time = absl::Now();
+  for (auto _ : state) {
+    for (int i = 0; i < kCredentialCount; i++) {
+      benchmark::DoNotOptimize(credential_manager.CreateLocalCredential(
+          metadata, IdentityType::IDENTITY_TYPE_PRIVATE, start_time,
+          start_time + absl::Hours(24)));
+    }
+  }
+}
+BENCHMARK(BM_CreateLocalCredentialSequential)->Unit(benchmark::kMillisecond);
+
+void BM_CreateLocalCredentialsBatch(benchmark::State& state) {
+  SingleThreadExecutor executor;
+  CredentialManagerImpl credential_manager(&executor);
+  Metadata metadata = CreateMetadata();
+  absl::Time start_time = absl::Now();
+  for (auto _ : state) {
+    CountDownLatch latch(1);
+    credential_manager.CreateLocalCredentials(
+        metadata, IdentityType::IDENTITY_TYPE_PRIVATE, start_time,
+        absl::Hours(24), kCredentialCount,
+        [&latch](std::vector<CredentialManagerImpl::CredentialPair>) {
+          latch.CountDown();
+        });
+    latch.Await();
+  }
+}
+BENCHMARK(BM_CreateLocalCredentialsBatch)->Unit(benchmark::kMillisecond);
+
+// Reads the local credentials on the service controller thread, as the
+// broadcast manager does, and posts a scan callback right behind it. Reports
+// the time until the credentials arrive and until the scan callback runs.
+void BM_RefillLocalCredentials(benchmark::State& state) {
+  int64_t refill_micros = 0;
+  int64_t scan_callback_micros = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    SingleThreadExecutor executor;
+    CredentialManagerImpl credential_manager(&executor);
+    StoreOneCredential(credential_manager);
+    CountDownLatch refilled(1);
+    CountDownLatch scan_callback_run(1);
+    absl::Time refilled_time;
+    absl::Time scan_callback_time;
+    state.ResumeTiming();
+
+    absl::Time start = absl::Now();
+    executor.Execute([&]() {
+      credential_manager.GetLocalCredentials(
+          CreateSelector(),
+          {.credentials_fetched_cb =
+               [&](absl::StatusOr<std::vector<LocalCredential>>) {
+                 refilled_time = absl::Now();
+                 refilled.CountDown();
+               }});
+    });
+    executor.Execute([&]() {
+      scan_callback_time = absl::Now();
+      scan_callback_run.CountDown();
+    });
+    refilled.Await();
+    scan_callback_run.Await();
+
+    state.PauseTiming();
+    refill_micros += absl::ToInt64Microseconds(refilled_time - start);
+    scan_callback_micros +=
+        absl::ToInt64Microseconds(scan_callback_time - start);
+    state.ResumeTiming();
+  }
+  state.counters["refill_us"] =
+      benchmark::Counter(refill_micros, benchmark::Counter::kAvgIterations);
+  state.counters["scan_callback_us"] = benchmark::Counter(
+      scan_callback_micros, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_RefillLocalCredentials)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace presence
+}  // namespace nearby
@@ -114,6 +114,7 @@ class CredentialManagerImplTest : public ::testing::Test {
     // times to make sure that all tasks have finished.
     for (int i = 0; i < 3; i++) {
       MediumEnvironment::Instance().Sync();
+      credential_manager_.FlushCredentialRefillsForTest();
       CountDownLatch latch(1);
       executor_.Execute([&]() { latch.CountDown(); });
       latch.Await();
@@ -605,6 +606,7 @@ TEST_F(CredentialManagerImplTest, RefillCredentailInGetLocalCredentials) {
            [&](absl::StatusOr<std::vector<LocalCredential>> credentials) {
              private_credentials = std::move(credentials);
            }});
+  credential_manager_.FlushCredentialRefillsForTest();
 
   EXPECT_OK(private_credentials);
   EXPECT_EQ(private_credentials->size(), kExpectedPresenceCredentialListSize);
@@ -637,6 +639,7 @@ TEST_F(CredentialManagerImplTest, RefillCredentailInGetSharedCredentials) {
            [&](absl::StatusOr<std::vector<SharedCredential>> credentials) {
              refilled_public_credentials = std::move(credentials);
            }});
+  credential_manager_.FlushCredentialRefillsForTest();
 
   EXPECT_OK(refilled_public_credentials);
   EXPECT_EQ(refilled_public_credentials->size(),
@@ -700,6 +703,7 @@ TEST_F(CredentialManagerImplTest, RefillExpiredCredsInGetLocal) {
            [&](absl::StatusOr<std::vector<LocalCredential>> credentials) {
              refilled_private_credentials = std::move(credentials);
            }});
+  credential_manager_.FlushCredentialRefillsForTest();
 
   EXPECT_OK(refilled_private_credentials);
   EXPECT_EQ(refilled_private_credentials->size(),
@@ -716,6 +720,140 @@ TEST_F(CredentialManagerImplTest, RefillExpiredCredsInGetLocal) {
           .start_time_millis());
 }
 
+TEST_F(CredentialManagerImplTest, ConcurrentRefillsGenerateCredentialsOnce) {
+  // Only refills read the shared credentials here. Holding that read keeps the
+  // first refill from completing until both local reads have started one.
+  CountDownLatch release_refills(1);
+  auto credential_storage_ptr =
+      std::make_unique<CredentialManagerImplTest::MockCredentialStorage>();
+  CredentialManagerImplTest::MockCredentialStorage* credential_storage =
+      credential_storage_ptr.get();
+  EXPECT_CALL(*credential_storage, GetPublicCredentials)
+      .WillRepeatedly(::testing::Invoke(
+          [&](const CredentialSelector& credential_selector,
+              PublicCredentialType public_credential_type,
+              GetPublicCredentialsResultCallback callback) {
+            release_refills.Await();
+            credential_storage->nearby::CredentialStorageImpl::
+                GetPublicCredentials(credential_selector,
+                                     public_credential_type,
+                                     std::move(callback));
+          }));
+  int save_count = 0;
+  EXPECT_CALL(*credential_storage, SaveCredentials)
+      .WillRepeatedly(::testing::Invoke(
+          [&](absl::string_view manager_app_id, absl::string_view account_name,
+              const std::vector<LocalCredential>& private_credentials,
+              const std::vector<SharedCredential>& public_credentials,
+              PublicCredentialType public_credential_type,
+              SaveCredentialsResultCallback callback) {
+            save_count++;
+            credential_storage->nearby::CredentialStorageImpl::SaveCredentials(
+                manager_app_id, account_name, private_credentials,
+                public_credentials, public_credential_type,
+                std::move(callback));
+          }));
+  CredentialManagerImpl credential_manager(&executor_,
+                                           std::move(credential_storage_ptr));
+  std::vector<IdentityType> identity_types{IDENTITY_TYPE_PRIVATE};
+  CredentialSelector credential_selector = BuildDefaultCredentialSelector();
+  credential_manager.GenerateCredentials(
+      CreateTestMetadata(), kManagerAppId, identity_types,
+      kExpectedPresenceCredentialValidDays, 1,
+      {.credentials_generated_cb =
+           [](absl::StatusOr<std::vector<SharedCredential>> credentials) {
+             EXPECT_OK(credentials);
+           }});
+
+  // Both reads see a single credential and start a refill, but the second one
+  // finds the credentials already topped up.
+  absl::StatusOr<std::vector<LocalCredential>> private_credentials1;
+  absl::StatusOr<std::vector<LocalCredential>> private_credentials2;
+  credential_manager.GetLocalCredentials(
+      credential_selector,
+      {.credentials_fetched_cb =
+           [&](absl::StatusOr<std::vector<LocalCredential>> credentials) {
+             private_credentials1 = std::move(credentials);
+           }});
+  credential_manager.GetLocalCredentials(
+      credential_selector,
+      {.credentials_fetched_cb =
+           [&](absl::StatusOr<std::vector<LocalCredential>> credentials) {
+             private_credentials2 = std::move(credentials);
+           }});
+  release_refills.CountDown();
+  credential_manager.FlushCredentialRefillsForTest();
+
+  // Once by GenerateCredentials and once by the first refill.
+  EXPECT_EQ(save_count, 2);
+  ASSERT_OK(private_credentials1);
+  ASSERT_OK(private_credentials2);
+  EXPECT_EQ(private_credentials1->size(), kExpectedPresenceCredentialListSize);
+  EXPECT_THAT(*private_credentials2,
+              UnorderedPointwise(EqualsProto(), *private_credentials1));
+}
+
+TEST_F(CredentialManagerImplTest, CreateLocalCredentialsInOrder) {
+  Metadata metadata = CreateTestMetadata();
+  constexpr absl::Time kStartTime = absl::FromUnixSeconds(100000);
+  constexpr absl::Duration kLifeCycle = absl::Hours(24);
+  std::vector<CredentialManagerImpl::CredentialPair> credentials;
+  CountDownLatch latch(1);
+
+  credential_manager_.CreateLocalCredentials(
+      metadata, IDENTITY_TYPE_PRIVATE, kStartTime, kLifeCycle,
+      kExpectedPresenceCredentialListSize,
+      [&](std::vector<CredentialManagerImpl::CredentialPair> result) {
+        credentials = std::move(result);
+        latch.CountDown();
+      });
+
+  ASSERT_TRUE(latch.Await().Ok());
+  ASSERT_EQ(credentials.size(), kExpectedPresenceCredentialListSize);
+  for (int i = 0; i < kExpectedPresenceCredentialListSize; i++) {
+    const LocalCredential& private_credential = credentials[i].first;
+    EXPECT_EQ(private_credential.identity_type(), IDENTITY_TYPE_PRIVATE);
+    EXPECT_EQ(private_credential.start_time_millis(),
+              absl::ToUnixMillis(kStartTime + kLifeCycle * i));
+    EXPECT_EQ(private_credential.end_time_millis(),
+              absl::ToUnixMillis(kStartTime + kLifeCycle * (i + 1)));
+    EXPECT_EQ(private_credential.key_seed(), credentials[i].second.key_seed());
+  }
+}
+
+TEST_F(CredentialManagerImplTest, DecryptMetadataBatch) {
+  Metadata metadata = CreateTestMetadata();
+  std::vector<CredentialManagerImpl::EncryptedMetadata> batch;
+  for (int i = 0; i < kExpectedPresenceCredentialListSize; i++) {
+    auto credentials = credential_manager_.CreateLocalCredential(
+        metadata, IDENTITY_TYPE_PRIVATE, absl::FromUnixSeconds(100000),
+        absl::FromUnixSeconds(200000));
+    batch.push_back({
+        .metadata_encryption_key =
+            credentials.first.metadata_encryption_key_v0(),
+        .key_seed = credentials.second.key_seed(),
+        .encrypted_metadata = credentials.second.encrypted_metadata_bytes_v0(),
+    });
+  }
+  // A key that does not match the metadata.
+  batch.back().metadata_encryption_key = batch.front().metadata_encryption_key;
+  std::vector<std::string> decrypted_metadata;
+  CountDownLatch latch(1);
+
+  credential_manager_.DecryptMetadataBatch(
+      std::move(batch), [&](std::vector<std::string> result) {
+        decrypted_metadata = std::move(result);
+        latch.CountDown();
+      });
+
+  ASSERT_TRUE(latch.Await().Ok());
+  ASSERT_EQ(decrypted_metadata.size(), kExpectedPresenceCredentialListSize);
+  for (int i = 0; i < kExpectedPresenceCredentialListSize - 1; i++) {
+    EXPECT_EQ(decrypted_metadata[i], metadata.SerializeAsString());
+  }
+  EXPECT_TRUE(decrypted_metadata.back().empty());
+}
+
 }  // namespace
 
 }  // namespace presence
@@ -0,0 +1,97 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "presence/implementation/ldt_decryptor_index.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "internal/platform/logging.h"
+#include "internal/proto/credential.pb.h"
+#include "presence/implementation/ldt.h"
+
+namespace nearby {
+namespace presence {
+
+LdtDecryptorIndex::LdtDecryptorIndex(
+    const std::vector<internal::SharedCredential>& credentials) {
+  absl::flat_hash_set<std::pair<std::string, std::string>> seen;
+  decryptors_.reserve(credentials.size());
+  for (const internal::SharedCredential& credential : credentials) {
+    if (!seen.insert({credential.key_seed(),
+                      credential.metadata_encryption_key_tag_v0()})
+             .second) {
+      continue;
+    }
+    absl::StatusOr<LdtEncryptor> encryptor = LdtEncryptor::Create(
+        credential.key_seed(), credential.metadata_encryption_key_tag_v0());
+    if (!encryptor.ok()) {
+      NEARBY_LOGS(WARNING) << "Skipping credential: " << encryptor.status();
+      continue;
+    }
+    decryptors_.push_back(
+        {.credential = credential, .encryptor = *std::move(encryptor)});
+  }
+}
+
+absl::StatusOr<LdtDecryptorIndex::Result> LdtDecryptorIndex::DecryptAndVerify(
+    absl::string_view data, absl::string_view salt) {
+  if (decryptors_.empty()) {
+    return absl::UnavailableError("No credentials");
+  }
+  std::string key = absl::StrCat(salt, data);
+  auto it = remembered_.find(key);
+  if (it != remembered_.end()) {
+    if (it->second == kNoMatch) {
+      return absl::UnavailableError(
+          "Couldn't decrypt the message with any credentials");
+    }
+    Decryptor& decryptor = decryptors_[it->second];
+    absl::StatusOr<std::string> plaintext =
+        decryptor.encryptor.DecryptAndVerify(data, salt);
+    if (plaintext.ok()) {
+      return Result{.credential = &decryptor.credential,
+                    .plaintext = *std::move(plaintext)};
+    }
+  }
+  for (int i = 0; i < decryptors_.size(); ++i) {
+    absl::StatusOr<std::string> plaintext =
+        decryptors_[i].encryptor.DecryptAndVerify(data, salt);
+    if (plaintext.ok()) {
+      Remember(std::move(key), i);
+      return Result{.credential = &decryptors_[i].credential,
+                    .plaintext = *std::move(plaintext)};
+    }
+  }
+  Remember(std::move(key), kNoMatch);
+  return absl::UnavailableError(
+      "Couldn't decrypt the message with any credentials");
+}
+
+void LdtDecryptorIndex::Remember(std::string key, int index) {
+  if (remembered_.size() >= kMaxRememberedAdvertisements) {
+    // Salts rotate, so old advertisements are not worth keeping around.
+    remembered_.clear();
+  }
+  remembered_[std::move(key)] = index;
+}
+
+}  // namespace presence
+}  // namespace nearby
@@ -0,0 +1,87 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_NEARBY_PRESENCE_IMPLEMENTATION_LDT_DECRYPTOR_INDEX_H_
+#define THIRD_PARTY_NEARBY_PRESENCE_IMPLEMENTATION_LDT_DECRYPTOR_INDEX_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "internal/proto/credential.pb.h"
+#include "presence/implementation/ldt.h"
+
+namespace nearby {
+namespace presence {
+
+// Decrypts LDT encrypted advertisements with a set of credentials.
+//
+// The LDT keys of every credential are derived once, when the index is built,
+// instead of for every received advertisement. Credentials with the same key
+// seed and metadata key tag are only tried once.
+//
+// The metadata key tag can only be checked after decryption, so an unknown
+// advertisement has to be tried against every credential. Advertisements are
+// broadcast over and over with the same salt and ciphertext though, so the
+// outcome of a decryption is remembered and the next copy of the same
+// advertisement is resolved with at most one LDT operation.
+class LdtDecryptorIndex {
+ public:
+  // Bounds the number of remembered advertisements.
+  static constexpr size_t kMaxRememberedAdvertisements = 256;
+
+  struct Result {
+    // Points into the index, valid until the index is destroyed.
+    const internal::SharedCredential* credential;
+    std::string plaintext;
+  };
+
+  LdtDecryptorIndex() = default;
+  explicit LdtDecryptorIndex(
+      const std::vector<internal::SharedCredential>& credentials);
+  LdtDecryptorIndex(LdtDecryptorIndex&&) = default;
+  LdtDecryptorIndex& operator=(LdtDecryptorIndex&&) = default;
+
+  // Returns the plaintext of `data` and the credential that decrypted it.
+  absl::StatusOr<Result> DecryptAndVerify(absl::string_view data,
+                                          absl::string_view salt);
+
+  // Returns the number of distinct credentials in the index.
+  size_t size() const { return decryptors_.size(); }
+  bool empty() const { return decryptors_.empty(); }
+
+ private:
+  // Marks an advertisement that no credential could decrypt.
+  static constexpr int kNoMatch = -1;
+
+  struct Decryptor {
+    internal::SharedCredential credential;
+    LdtEncryptor encryptor;
+  };
+
+  void Remember(std::string key, int index);
+
+  std::vector<Decryptor> decryptors_;
+  // Index into `decryptors_` of the credential that decrypted an
+  // advertisement, keyed by its salt and ciphertext.
+  absl::flat_hash_map<std::string, int> remembered_;
+};
+
+}  // namespace presence
+}  // namespace nearby
+
+#endif  // THIRD_PARTY_NEARBY_PRESENCE_IMPLEMENTATION_LDT_DECRYPTOR_INDEX_H_
@@ -0,0 +1,136 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "presence/implementation/ldt_decryptor_index.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "protobuf-matchers/protocol-buffer-matchers.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/string_view.h"
+#include "internal/proto/credential.pb.h"
+
+namespace nearby {
+namespace presence {
+
+namespace {
+using ::nearby::internal::SharedCredential;
+using ::testing::status::StatusIs;
+
+// Test data from Android tests.
+constexpr absl::string_view kSharedCredentialBase16 =
+    "1220BAF3C12E1BBBB3E4367BBD40986D0D7CD158DF6D662AAE6312FE67634B5D45473220"
+    "CDDA7C6CF56882D74364F8BE9874A78D7C961BFF9800A40D83F6652E6CF5D1A7";
+constexpr absl::string_view kPlainTextBase16 =
+    "205BF1D88FF539EC740CCC2EC2DE19353EF30F01054C3E24";
+constexpr absl::string_view kCipherTextBase16 =
+    "FDABC09D6F8028D4E5E585C62E9A0DB5003F19FEBDF92524";
+constexpr absl::string_view kSaltBase16 = "874C";
+
+SharedCredential GetAndroidCredential() {
+  SharedCredential credential;
+  credential.ParseFromString(absl::HexStringToBytes(kSharedCredentialBase16));
+  return credential;
+}
+
+// A credential that decrypts nothing encrypted with the Android credential.
+SharedCredential GetOtherCredential(char fill) {
+  SharedCredential credential;
+  credential.set_key_seed(std::string(32, fill));
+  credential.set_metadata_encryption_key_tag_v0(std::string(32, fill));
+  return credential;
+}
+
+#ifdef USE_RUST_LDT
+
+TEST(LdtDecryptorIndex, DecryptsWithMatchingCredential) {
+  LdtDecryptorIndex index({GetOtherCredential('a'), GetOtherCredential('b'),
+                           GetAndroidCredential(), GetOtherCredential('c')});
+
+  absl::StatusOr<LdtDecryptorIndex::Result> result =
+      index.DecryptAndVerify(absl::HexStringToBytes(kCipherTextBase16),
+                             absl::HexStringToBytes(kSaltBase16));
+
+  ASSERT_OK(result);
+  EXPECT_EQ(result->plaintext, absl::HexStringToBytes(kPlainTextBase16));
+  EXPECT_EQ(result->credential->key_seed(), GetAndroidCredential().key_seed());
+}
+
+TEST(LdtDecryptorIndex, RepeatedAdvertisementDecryptsAgain) {
+  LdtDecryptorIndex index({GetOtherCredential('a'), GetAndroidCredential()});
+
+  for (int i = 0; i < 3; ++i) {
+    absl::StatusOr<LdtDecryptorIndex::Result> result =
+        index.DecryptAndVerify(absl::HexStringToBytes(kCipherTextBase16),
+                               absl::HexStringToBytes(kSaltBase16));
+
+    ASSERT_OK(result);
+    EXPECT_EQ(result->plaintext, absl::HexStringToBytes(kPlainTextBase16));
+  }
+}
+
+TEST(LdtDecryptorIndex, UnknownAdvertisementFailsEveryTime) {
+  LdtDecryptorIndex index({GetOtherCredential('a'), GetOtherCredential('b')});
+
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT(
+        index.DecryptAndVerify(absl::HexStringToBytes(kCipherTextBase16),
+                               absl::HexStringToBytes(kSaltBase16)),
+        StatusIs(absl::StatusCode::kUnavailable));
+  }
+}
+
+TEST(LdtDecryptorIndex, SkipsDuplicateCredentials) {
+  LdtDecryptorIndex index({GetAndroidCredential(), GetOtherCredential('a'),
+                           GetAndroidCredential(), GetOtherCredential('a')});
+
+  EXPECT_EQ(index.size(), 2);
+}
+
+TEST(LdtDecryptorIndex, ForgetsOldAdvertisements) {
+  LdtDecryptorIndex index({GetAndroidCredential()});
+  std::string ciphertext = absl::HexStringToBytes(kCipherTextBase16);
+
+  // Enough other advertisements to flush the one we care about.
+  for (int i = 0; i <= LdtDecryptorIndex::kMaxRememberedAdvertisements; ++i) {
+    std::string salt = {static_cast<char>(i >> 8), static_cast<char>(i)};
+    index.DecryptAndVerify(ciphertext, salt).IgnoreError();
+  }
+  absl::StatusOr<LdtDecryptorIndex::Result> result = index.DecryptAndVerify(
+      ciphertext, absl::HexStringToBytes(kSaltBase16));
+
+  ASSERT_OK(result);
+  EXPECT_EQ(result->plaintext, absl::HexStringToBytes(kPlainTextBase16));
+}
+
+#else
+
+TEST(LdtDecryptorIndex, LdtUnavailable) {
+  LdtDecryptorIndex index({GetAndroidCredential()});
+
+  EXPECT_TRUE(index.empty());
+  EXPECT_THAT(index.DecryptAndVerify(absl::HexStringToBytes(kCipherTextBase16),
+                                     absl::HexStringToBytes(kSaltBase16)),
+              StatusIs(absl::StatusCode::kUnavailable));
+}
+
+#endif /* USE_RUST_LDT */
+
+}  // namespace
+}  // namespace presence
+}  // namespace nearby
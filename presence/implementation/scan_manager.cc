@@ -174,9 +174,7 @@ void ScanManager::UpdateCredentials(ScanSessionId id,
   if (it == scan_sessions_.end()) {
     return;
   }
-  ScanSessionState& session = it->second;
-  session.credentials[identity_type] = std::move(credentials);
-  session.decoder = AdvertisementDecoder(session.request, &session.credentials);
+  it->second.decoder.UpdateCredentials(identity_type, credentials);
 }
 
 int ScanManager::ScanningCallbacksLengthForTest() {
@@ -63,8 +63,6 @@ class ScanManager {
   struct ScanSessionState {
     ScanRequest request;
     ScanCallback callback;
-    absl::flat_hash_map<IdentityType, std::vector<SharedCredential>>
-        credentials;
     AdvertisementDecoder decoder;
     std::unique_ptr<ScanningSession> scanning_session;
   };
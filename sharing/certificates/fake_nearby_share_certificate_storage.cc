@@ -74,6 +74,19 @@ FakeNearbyShareCertificateStorage::AddPublicCertificatesCall::
 FakeNearbyShareCertificateStorage::AddPublicCertificatesCall::
     ~AddPublicCertificatesCall() = default;
 
+FakeNearbyShareCertificateStorage::UpdatePublicCertificatesCall::
+    UpdatePublicCertificatesCall(
+        const std::vector<PublicCertificate>& public_certificates,
+        ResultCallback callback)
+    : public_certificates(public_certificates), callback(std::move(callback)) {}
+
+FakeNearbyShareCertificateStorage::UpdatePublicCertificatesCall::
+    UpdatePublicCertificatesCall(UpdatePublicCertificatesCall&& other) =
+        default;
+
+FakeNearbyShareCertificateStorage::UpdatePublicCertificatesCall::
+    ~UpdatePublicCertificatesCall() = default;
+
 FakeNearbyShareCertificateStorage::RemoveExpiredPublicCertificatesCall::
     RemoveExpiredPublicCertificatesCall(absl::Time now, ResultCallback callback)
     : now(now), callback(std::move(callback)) {}
@@ -138,6 +151,18 @@ void FakeNearbyShareCertificateStorage::AddPublicCertificates(
   }
 }
 
+void FakeNearbyShareCertificateStorage::UpdatePublicCertificates(
+    absl::Span<const PublicCertificate> public_certificates,
+    ResultCallback callback) {
+  update_public_certificates_calls_.emplace_back(
+      std::vector<PublicCertificate>(public_certificates.begin(),
+                                     public_certificates.end()),
+      callback);
+  if (is_sync_mode_) {
+    callback(update_public_certificates_result_);
+  }
+}
+
 void FakeNearbyShareCertificateStorage::RemoveExpiredPublicCertificates(
     absl::Time now, ResultCallback callback) {
   remove_expired_public_certificates_calls_.emplace_back(now, callback);
@@ -85,6 +85,18 @@ class FakeNearbyShareCertificateStorage : public NearbyShareCertificateStorage {
     ResultCallback callback;
   };
 
+  struct UpdatePublicCertificatesCall {
+    UpdatePublicCertificatesCall(
+        const std::vector<nearby::sharing::proto::PublicCertificate>&
+            public_certificates,
+        ResultCallback callback);
+    UpdatePublicCertificatesCall(UpdatePublicCertificatesCall&& other);
+    ~UpdatePublicCertificatesCall();
+
+    std::vector<nearby::sharing::proto::PublicCertificate> public_certificates;
+    ResultCallback callback;
+  };
+
   struct RemoveExpiredPublicCertificatesCall {
     RemoveExpiredPublicCertificatesCall(absl::Time now,
                                         ResultCallback callback);
@@ -117,6 +129,10 @@ class FakeNearbyShareCertificateStorage : public NearbyShareCertificateStorage {
       absl::Span<const nearby::sharing::proto::PublicCertificate>
           public_certificates,
       ResultCallback callback) override;
+  void UpdatePublicCertificates(
+      absl::Span<const nearby::sharing::proto::PublicCertificate>
+          public_certificates,
+      ResultCallback callback) override;
   void RemoveExpiredPublicCertificates(absl::Time now,
                                        ResultCallback callback) override;
   void ClearPublicCertificates(ResultCallback callback) override;
@@ -137,6 +153,11 @@ class FakeNearbyShareCertificateStorage : public NearbyShareCertificateStorage {
     return add_public_certificates_calls_;
   }
 
+  std::vector<UpdatePublicCertificatesCall>&
+  update_public_certificates_calls() {
+    return update_public_certificates_calls_;
+  }
+
   std::vector<RemoveExpiredPublicCertificatesCall>&
   remove_expired_public_certificates_calls() {
     return remove_expired_public_certificates_calls_;
@@ -152,6 +173,10 @@ class FakeNearbyShareCertificateStorage : public NearbyShareCertificateStorage {
     add_public_certificates_result_ = result;
   }
 
+  void SetUpdatePublicCertificatesResult(bool result) {
+    update_public_certificates_result_ = result;
+  }
+
   void SetRemoveExpiredPublicCertificatesResult(bool result) {
     remove_expired_public_certificates_result_ = result;
   }
@@ -164,11 +189,13 @@ class FakeNearbyShareCertificateStorage : public NearbyShareCertificateStorage {
   std::vector<PublicCertificateCallback> get_public_certificates_callbacks_;
   std::vector<ReplacePublicCertificatesCall> replace_public_certificates_calls_;
   std::vector<AddPublicCertificatesCall> add_public_certificates_calls_;
+  std::vector<UpdatePublicCertificatesCall> update_public_certificates_calls_;
   std::vector<RemoveExpiredPublicCertificatesCall>
       remove_expired_public_certificates_calls_;
   std::vector<ResultCallback> clear_public_certificates_callbacks_;
   bool is_sync_mode_ = false;
   bool add_public_certificates_result_ = false;
+  bool update_public_certificates_result_ = false;
   bool remove_expired_public_certificates_result_ = false;
 };
 
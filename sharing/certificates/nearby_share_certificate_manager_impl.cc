@@ -319,19 +319,21 @@ void NearbyShareCertificateManagerImpl::CertificateDownloadContext::
 
 void NearbyShareCertificateManagerImpl::OnPublicCertificatesDownloadSuccess(
     const std::vector<PublicCertificate>& certificates) {
-  // Save certificates to store.
+  // Save certificates to store. Only the certificates that changed since the
+  // last download are written.
   absl::Notification notification;
-  bool is_added_to_store = false;
-  certificate_storage_->AddPublicCertificates(
+  bool is_updated_in_store = false;
+  certificate_storage_->UpdatePublicCertificates(
       absl::MakeSpan(certificates.data(),
                      certificates.size()),
       [&](bool success) {
-        is_added_to_store = success;
+        is_updated_in_store = success;
         notification.Notify();
       });
   notification.WaitForNotification();
-  if (!is_added_to_store) {
-    NL_LOG(ERROR) << __func__ << ": Failed to add certificates to store.";
+  public_certificate_cache_->Invalidate();
+  if (!is_updated_in_store) {
+    NL_LOG(ERROR) << __func__ << ": Failed to update certificates in store.";
     OnPublicCertificatesDownloadFailure();
     return;
   }
@@ -437,11 +439,31 @@ NearbyShareCertificateManagerImpl::GetPrivateCertificatesAsPublicCertificates(
 void NearbyShareCertificateManagerImpl::GetDecryptedPublicCertificate(
     NearbyShareEncryptedMetadataKey encrypted_metadata_key,
     CertDecryptedCallback callback) {
+  std::optional<NearbyShareDecryptedPublicCertificate> decrypted;
+  if (public_certificate_cache_->TryDecryptPublicCertificate(
+          encrypted_metadata_key, &decrypted)) {
+    std::move(callback)(std::move(decrypted));
+    return;
+  }
+
+  // Nothing cached yet: read the certificates from storage, and keep them.
   certificate_storage_->GetPublicCertificates(
-      [encrypted_metadata_key = std::move(encrypted_metadata_key),
+      [cache = public_certificate_cache_,
+       generation = public_certificate_cache_->generation(),
+       encrypted_metadata_key = std::move(encrypted_metadata_key),
        callback = std::move(callback)](
           bool success,
-          std::unique_ptr<std::vector<PublicCertificate>> result) {
+          std::unique_ptr<std::vector<PublicCertificate>> result) mutable {
+        if (success && result) {
+          cache->Load(generation, *result);
+          std::optional<NearbyShareDecryptedPublicCertificate> decrypted;
+          if (cache->TryDecryptPublicCertificate(encrypted_metadata_key,
+                                                 &decrypted)) {
+            std::move(callback)(std::move(decrypted));
+            return;
+          }
+        }
+        // Storage changed while reading it, or could not be read.
         TryDecryptPublicCertificates(encrypted_metadata_key,
                                      std::move(callback), success,
                                      std::move(result));
@@ -450,7 +472,13 @@ void NearbyShareCertificateManagerImpl::GetDecryptedPublicCertificate(
 
 void NearbyShareCertificateManagerImpl::ClearPublicCertificates(
     std::function<void(bool)> callback) {
-  certificate_storage_->ClearPublicCertificates(std::move(callback));
+  public_certificate_cache_->Invalidate();
+  certificate_storage_->ClearPublicCertificates(
+      [cache = public_certificate_cache_,
+       callback = std::move(callback)](bool success) {
+        cache->Invalidate();
+        callback(success);
+      });
 }
 
 void NearbyShareCertificateManagerImpl::OnStart() {
@@ -694,6 +722,7 @@ void NearbyShareCertificateManagerImpl::OnPublicCertificateExpiration() {
           notification.Notify();
         });
     notification.WaitForNotification();
+    public_certificate_cache_->Invalidate();
     if (!result) {
       NL_LOG(ERROR) << __func__
                     << ": Failed to remove expired public certificates.";
@@ -33,6 +33,7 @@
 #include "sharing/certificates/nearby_share_certificate_storage.h"
 #include "sharing/certificates/nearby_share_encrypted_metadata_key.h"
 #include "sharing/certificates/nearby_share_private_certificate.h"
+#include "sharing/certificates/nearby_share_public_certificate_cache.h"
 #include "sharing/contacts/nearby_share_contact_manager.h"
 #include "sharing/internal/api/preference_manager.h"
 #include "sharing/internal/api/public_certificate_database.h"
@@ -202,6 +203,10 @@ class NearbyShareCertificateManagerImpl
   std::unique_ptr< nearby::sharing::api::SharingRpcClient> nearby_client_;
 
   std::shared_ptr<NearbyShareCertificateStorage> certificate_storage_;
+  // Public certificates of `certificate_storage_`, shared with storage
+  // callbacks that may outlive this object.
+  std::shared_ptr<NearbySharePublicCertificateCache> public_certificate_cache_ =
+      std::make_shared<NearbySharePublicCertificateCache>();
   std::unique_ptr<NearbyShareScheduler>
       private_certificate_expiration_scheduler_;
   std::unique_ptr<NearbyShareScheduler>
@@ -359,7 +359,7 @@ class NearbyShareCertificateManagerImplTest
 
     client_factory_.instances().back()->SetListPublicCertificatesResponses(
         responses);
-    cert_store_->SetAddPublicCertificatesResult(
+    cert_store_->SetUpdatePublicCertificatesResult(
         result != DownloadPublicCertificatesResult::kStorageError);
     download_scheduler_->InvokeRequestCallback();
     Sync();
@@ -395,13 +395,13 @@ class NearbyShareCertificateManagerImplTest
     return response;
   }
 
-  void CheckStorageAddCertificates(
-      const FakeNearbyShareCertificateStorage::AddPublicCertificatesCall&
-          add_cert_call) {
-    ASSERT_EQ(add_cert_call.public_certificates.size(),
+  void CheckStorageUpdateCertificates(
+      const FakeNearbyShareCertificateStorage::UpdatePublicCertificatesCall&
+          update_cert_call) {
+    ASSERT_EQ(update_cert_call.public_certificates.size(),
               public_certificates_.size());
     for (size_t i = 0; i < public_certificates_.size(); ++i) {
-      EXPECT_EQ(add_cert_call.public_certificates[i].secret_id(),
+      EXPECT_EQ(update_cert_call.public_certificates[i].secret_id(),
                 public_certificates_[i].secret_id());
     }
   }
@@ -602,6 +602,46 @@ TEST_F(NearbyShareCertificateManagerImplTest,
   EXPECT_FALSE(decrypted_pub_cert);
 }
 
+TEST_F(NearbyShareCertificateManagerImplTest,
+       GetDecryptedPublicCertificateReadsStorageOnce) {
+  cert_manager_->GetDecryptedPublicCertificate(
+      metadata_encryption_keys_[0],
+      [](std::optional<NearbyShareDecryptedPublicCertificate> cert) {});
+  GetPublicCertificatesCallback(true, public_certificates_);
+
+  std::optional<NearbyShareDecryptedPublicCertificate> decrypted_pub_cert;
+  cert_manager_->GetDecryptedPublicCertificate(
+      metadata_encryption_keys_[1],
+      [&](std::optional<NearbyShareDecryptedPublicCertificate> cert) {
+        CaptureDecryptedPublicCertificateCallback(&decrypted_pub_cert, cert);
+      });
+
+  EXPECT_TRUE(cert_store_->get_public_certificates_callbacks().empty());
+  ASSERT_TRUE(decrypted_pub_cert);
+  std::vector<uint8_t> id(public_certificates_[1].secret_id().begin(),
+                          public_certificates_[1].secret_id().end());
+  EXPECT_EQ(decrypted_pub_cert->id(), id);
+}
+
+TEST_F(NearbyShareCertificateManagerImplTest,
+       GetDecryptedPublicCertificateAfterClearReadsStorage) {
+  cert_manager_->GetDecryptedPublicCertificate(
+      metadata_encryption_keys_[0],
+      [](std::optional<NearbyShareDecryptedPublicCertificate> cert) {});
+  GetPublicCertificatesCallback(true, public_certificates_);
+
+  cert_manager_->ClearPublicCertificates([](bool result) {});
+  std::optional<NearbyShareDecryptedPublicCertificate> decrypted_pub_cert;
+  cert_manager_->GetDecryptedPublicCertificate(
+      metadata_encryption_keys_[0],
+      [&](std::optional<NearbyShareDecryptedPublicCertificate> cert) {
+        CaptureDecryptedPublicCertificateCallback(&decrypted_pub_cert, cert);
+      });
+  GetPublicCertificatesCallback(true, {});
+
+  EXPECT_FALSE(decrypted_pub_cert);
+}
+
 TEST_F(NearbyShareCertificateManagerImplTest,
        DownloadPublicCertificatesSuccess) {
   ASSERT_NO_FATAL_FAILURE(DownloadPublicCertificatesFlow(
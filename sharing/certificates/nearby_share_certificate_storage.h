@@ -89,6 +89,16 @@ class NearbyShareCertificateStorage {
           public_certificates,
       ResultCallback callback) = 0;
 
+  // Makes the stored public certificates match |public_certificates|, the
+  // complete set of certificates available to the device. Only certificates
+  // that are new or whose expiration changed are written, and stored
+  // certificates missing from |public_certificates| are removed. Certificates
+  // are identified by secret ID; their content is not compared.
+  virtual void UpdatePublicCertificates(
+      absl::Span<const nearby::sharing::proto::PublicCertificate>
+          public_certificates,
+      ResultCallback callback) = 0;
+
   // Removes all private certificates from storage with expiration date after
   // |now|.
   void RemoveExpiredPrivateCertificates(absl::Time now);
@@ -0,0 +1,187 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Cost of storing a periodic public certificate download, replacing the whole
+// stored set against updating only what changed. Certificates are served page
+// by page by a fake RPC client, as the certificate manager downloads them.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "sharing/certificates/nearby_share_certificate_storage.h"
+#include "sharing/certificates/nearby_share_certificate_storage_impl.h"
+#include "sharing/internal/api/fake_nearby_share_client.h"
+#include "sharing/internal/api/sharing_rpc_client.h"
+#include "sharing/internal/test/fake_preference_manager.h"
+#include "sharing/internal/test/fake_public_certificate_db.h"
+#include "sharing/proto/certificate_rpc.pb.h"
+#include "sharing/proto/rpc_resources.pb.h"
+
+namespace nearby {
+namespace sharing {
+namespace {
+
+using ::nearby::sharing::proto::ListPublicCertificatesRequest;
+using ::nearby::sharing::proto::ListPublicCertificatesResponse;
+using ::nearby::sharing::proto::PublicCertificate;
+
+constexpr int kPageSize = 100;
+// Share of the certificates replaced between two downloads.
+constexpr int kChurnPercent = 1;
+
+// Database that counts what is written to it.
+class CountingPublicCertificateDb : public FakePublicCertificateDb {
+ public:
+  void AddCertificates(absl::Span<const PublicCertificate> certificates,
+                       absl::AnyInvocable<void(bool) &&> callback) override {
+    for (const PublicCertificate& certificate : certificates) {
+      bytes_written_ += certificate.ByteSizeLong();
+    }
+    FakePublicCertificateDb::AddCertificates(certificates,
+                                             std::move(callback));
+  }
+
+  std::int64_t bytes_written() const { return bytes_written_; }
+  void reset_bytes_written() { bytes_written_ = 0; }
+
+ private:
+  std::int64_t bytes_written_ = 0;
+};
+
+PublicCertificate CreateCertificate(int id) {
+  PublicCertificate certificate;
+  certificate.set_secret_id(absl::StrCat("secret_id_", id));
+  certificate.set_secret_key(std::string(32, 'k'));
+  certificate.set_public_key(std::string(91, 'p'));
+  certificate.mutable_start_time()->set_seconds(1700000000);
+  certificate.mutable_end_time()->set_seconds(1700000000 + id % 1000 * 3600);
+  certificate.set_metadata_encryption_key(std::string(14, 'm'));
+  certificate.set_encrypted_metadata_bytes(std::string(200, 'e'));
+  certificate.set_metadata_encryption_key_tag(std::string(32, 't'));
+  return certificate;
+}
+
+// Returns the `count` certificates of download `generation`: the first
+// kChurnPercent of them are new in every generation.
+std::vector<PublicCertificate> CreateCertificates(int count, int generation) {
+  int churn = count * kChurnPercent / 100;
+  std::vector<PublicCertificate> certificates;
+  certificates.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    certificates.push_back(
+        CreateCertificate(i < churn ? i + count * generation : i));
+  }
+  return certificates;
+}
+
+// Serves `certificates` `kPageSize` at a time.
+std::unique_ptr<FakeNearbyShareClient> CreateClient(
+    absl::Span<const PublicCertificate> certificates) {
+  std::vector<absl::StatusOr<ListPublicCertificatesResponse>> responses;
+  for (size_t i = 0; i < certificates.size(); i += kPageSize) {
+    ListPublicCertificatesResponse response;
+    for (size_t j = i; j < i + kPageSize && j < certificates.size(); ++j) {
+      *response.add_public_certificates() = certificates[j];
+    }
+    if (i + kPageSize < certificates.size()) {
+      response.set_next_page_token(absl::StrCat(i + kPageSize));
+    }
+    responses.push_back(std::move(response));
+  }
+  auto client = std::make_unique<FakeNearbyShareClient>();
+  client->SetListPublicCertificatesResponses(std::move(responses));
+  return client;
+}
+
+// Downloads every page, as CertificateDownloadContext does.
+std::vector<PublicCertificate> Download(api::SharingRpcClient& client) {
+  std::vector<PublicCertificate> certificates;
+  bool done = false;
+  ListPublicCertificatesRequest request;
+  while (!done) {
+    client.ListPublicCertificates(
+        request,
+        [&](const absl::StatusOr<ListPublicCertificatesResponse>& response) {
+          if (!response.ok()) {
+            done = true;
+            return;
+          }
+          certificates.insert(certificates.end(),
+                              response->public_certificates().begin(),
+                              response->public_certificates().end());
+          done = response->next_page_token().empty();
+          request.set_page_token(response->next_page_token());
+        });
+  }
+  return certificates;
+}
+
+// Stores the download of state.range(0) certificates over a store holding
+// the previous download, by replacing everything if `incremental` is false.
+void StoreDownload(benchmark::State& state, bool incremental) {
+  const int count = state.range(0);
+  std::int64_t bytes_written = 0;
+  int generation = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    FakePreferenceManager preference_manager;
+    auto db = std::make_unique<CountingPublicCertificateDb>();
+    CountingPublicCertificateDb* counting_db = db.get();
+    std::shared_ptr<NearbyShareCertificateStorage> storage =
+        NearbyShareCertificateStorageImpl::Factory::Create(preference_manager,
+                                                           std::move(db));
+    storage->ReplacePublicCertificates(CreateCertificates(count, generation),
+                                       [](bool) {});
+    counting_db->reset_bytes_written();
+    std::unique_ptr<FakeNearbyShareClient> client =
+        CreateClient(CreateCertificates(count, ++generation));
+    state.ResumeTiming();
+
+    std::vector<PublicCertificate> certificates = Download(*client);
+    if (incremental) {
+      storage->UpdatePublicCertificates(certificates, [](bool) {});
+    } else {
+      storage->ReplacePublicCertificates(certificates, [](bool) {});
+    }
+
+    state.PauseTiming();
+    bytes_written += counting_db->bytes_written();
+    state.ResumeTiming();
+  }
+  state.counters["bytes_written"] = benchmark::Counter(
+      bytes_written, benchmark::Counter::kAvgIterations);
+}
+
+void BM_ReplacePublicCertificates(benchmark::State& state) {
+  StoreDownload(state, /*incremental=*/false);
+}
+BENCHMARK(BM_ReplacePublicCertificates)->Arg(100)->Arg(1000)->Arg(10000);
+
+void BM_UpdatePublicCertificates(benchmark::State& state) {
+  StoreDownload(state, /*incremental=*/true);
+}
+BENCHMARK(BM_UpdatePublicCertificates)->Arg(100)->Arg(1000)->Arg(10000);
+
+}  // namespace
+}  // namespace sharing
+}  // namespace nearby
@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/string_view.h"
@@ -325,6 +326,35 @@ void NearbyShareCertificateStorageImpl::AddPublicCertificatesCallback(
   std::move(callback)(true);
 }
 
+void NearbyShareCertificateStorageImpl::UpdatePublicCertificatesAddCallback(
+    std::vector<std::string> ids_to_remove,
+    std::unique_ptr<ExpirationList> expirations, ResultCallback callback,
+    bool proceed) {
+  if (!proceed) {
+    NL_LOG(ERROR) << __func__ << ": Failed to add public certificates.";
+    std::move(callback)(false);
+    return;
+  }
+
+  if (ids_to_remove.empty()) {
+    ReplacePublicCertificatesUpdateEntriesCallback(
+        std::move(expirations), std::move(callback), /*proceed=*/true);
+    return;
+  }
+
+  NL_VLOG(1) << __func__ << ": Removing " << ids_to_remove.size()
+             << " public certificates.";
+  public_certificate_database_->RemoveCertificatesById(
+      std::move(ids_to_remove),
+      [weak_this = weak_from_this(), expirations = std::move(expirations),
+       callback = std::move(callback)](bool success) mutable {
+        if (auto storage = weak_this.lock()) {
+          storage->ReplacePublicCertificatesUpdateEntriesCallback(
+              std::move(expirations), std::move(callback), success);
+        }
+      });
+}
+
 void NearbyShareCertificateStorageImpl::RemoveExpiredPublicCertificatesCallback(
     const absl::flat_hash_set<std::string>& ids_to_remove,
     ResultCallback callback, bool proceed) {
@@ -492,6 +522,77 @@ void NearbyShareCertificateStorageImpl::AddPublicCertificates(
       });
 }
 
+void NearbyShareCertificateStorageImpl::UpdatePublicCertificates(
+    absl::Span<const nearby::sharing::proto::PublicCertificate>
+        public_certificates,
+    ResultCallback callback) {
+  if (init_status_ == InitStatus::kFailed) {
+    std::move(callback)(false);
+    return;
+  }
+
+  if (init_status_ == InitStatus::kUninitialized) {
+    deferred_callbacks_.push(
+        [this,
+         public_certificates =
+             std::vector<nearby::sharing::proto::PublicCertificate>(
+                 public_certificates.begin(), public_certificates.end()),
+         callback = std::move(callback)]() {
+          UpdatePublicCertificates(public_certificates, std::move(callback));
+        });
+    return;
+  }
+
+  absl::flat_hash_map<std::string, absl::Time> stored_expirations(
+      public_certificate_expirations_.begin(),
+      public_certificate_expirations_.end());
+  std::vector<nearby::sharing::proto::PublicCertificate> certificates_to_add;
+  auto new_expirations = std::make_unique<ExpirationList>();
+  new_expirations->reserve(public_certificates.size());
+  for (const nearby::sharing::proto::PublicCertificate& cert :
+       public_certificates) {
+    absl::Time expiration = TimestampToTime(cert.end_time());
+    auto it = stored_expirations.find(cert.secret_id());
+    if (it == stored_expirations.end() || it->second != expiration) {
+      certificates_to_add.push_back(cert);
+    }
+    if (it != stored_expirations.end()) {
+      // Whatever is left in the map at the end is no longer available.
+      stored_expirations.erase(it);
+    }
+    new_expirations->emplace_back(cert.secret_id(), expiration);
+  }
+  std::sort(new_expirations->begin(), new_expirations->end(), SortBySecond);
+
+  std::vector<std::string> ids_to_remove;
+  ids_to_remove.reserve(stored_expirations.size());
+  for (const auto& [id, expiration] : stored_expirations) {
+    ids_to_remove.push_back(id);
+  }
+
+  NL_VLOG(1) << __func__ << ": Adding " << certificates_to_add.size()
+             << " and removing " << ids_to_remove.size() << " of "
+             << public_certificates.size() << " public certificates.";
+  if (certificates_to_add.empty()) {
+    UpdatePublicCertificatesAddCallback(std::move(ids_to_remove),
+                                        std::move(new_expirations),
+                                        std::move(callback), /*proceed=*/true);
+    return;
+  }
+
+  public_certificate_database_->AddCertificates(
+      absl::MakeConstSpan(certificates_to_add),
+      [weak_this = weak_from_this(), ids_to_remove = std::move(ids_to_remove),
+       new_expirations = std::move(new_expirations),
+       callback = std::move(callback)](bool success) mutable {
+        if (auto storage = weak_this.lock()) {
+          storage->UpdatePublicCertificatesAddCallback(
+              std::move(ids_to_remove), std::move(new_expirations),
+              std::move(callback), success);
+        }
+      });
+}
+
 void NearbyShareCertificateStorageImpl::RemoveExpiredPublicCertificates(
     absl::Time now, ResultCallback callback) {
   if (init_status_ == InitStatus::kFailed) {
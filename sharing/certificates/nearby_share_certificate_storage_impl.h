@@ -89,6 +89,10 @@ class NearbyShareCertificateStorageImpl : public NearbyShareCertificateStorage,
       absl::Span<const nearby::sharing::proto::PublicCertificate>
           public_certificates,
       ResultCallback callback) override;
+  void UpdatePublicCertificates(
+      absl::Span<const nearby::sharing::proto::PublicCertificate>
+          public_certificates,
+      ResultCallback callback) override;
   void RemoveExpiredPublicCertificates(absl::Time now,
                                        ResultCallback callback) override;
   void ClearPublicCertificates(ResultCallback callback) override;
@@ -123,6 +127,10 @@ class NearbyShareCertificateStorageImpl : public NearbyShareCertificateStorage,
   void AddPublicCertificatesCallback(
       std::unique_ptr<ExpirationList> new_expirations, ResultCallback callback,
       bool proceed);
+  void UpdatePublicCertificatesAddCallback(
+      std::vector<std::string> ids_to_remove,
+      std::unique_ptr<ExpirationList> expirations, ResultCallback callback,
+      bool proceed);
   void RemoveExpiredPublicCertificatesCallback(
       const absl::flat_hash_set<std::string>& ids_to_remove,
       ResultCallback callback, bool proceed);
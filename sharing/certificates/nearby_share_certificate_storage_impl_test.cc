@@ -57,6 +57,7 @@ using ::testing::_;
 using ::testing::Eq;
 using ::testing::Invoke;
 using ::testing::StrictMock;
+using ::testing::UnorderedElementsAre;
 
 // NOTE: Make sure secret ID alphabetical ordering does not match the 1,2,3,...
 // ordering to test sorting expiration times.
@@ -519,6 +520,55 @@ TEST_F(NearbyShareCertificateStorageImplTest, AddPublicCertificates) {
   EXPECT_THAT(cert_store.use_count(), Eq(1));
 }
 
+TEST_F(NearbyShareCertificateStorageImplTest, UpdatePublicCertificates) {
+  auto db = std::make_unique<nearby::FakePublicCertificateDb>();
+  nearby::FakePublicCertificateDb* fake_db = db.get();
+  PrepopulatePublicCertificates(fake_db);
+  std::vector<PublicCertificate> new_certs = {
+      // Same expiration as the stored certificate: not written again.
+      CreatePublicCertificate(kSecretId1, kSecretKey4, kPublicKey4,
+                              kStartSeconds1, kStartNanos1, kEndSeconds1,
+                              kEndNanos1, kForSelectedContacts1,
+                              kMetadataEncryptionKey1, kEncryptedMetadataBytes1,
+                              kMetadataEncryptionKeyTag1),
+      // Expiration changed.
+      CreatePublicCertificate(kSecretId2, kSecretKey4, kPublicKey4,
+                              kStartSeconds2, kStartNanos2, kEndSeconds4,
+                              kEndNanos4, kForSelectedContacts2,
+                              kMetadataEncryptionKey2, kEncryptedMetadataBytes2,
+                              kMetadataEncryptionKeyTag2),
+      CreatePublicCertificate(kSecretId4, kSecretKey4, kPublicKey4,
+                              kStartSeconds4, kStartNanos4, kEndSeconds4,
+                              kEndNanos4, kForSelectedContacts4,
+                              kMetadataEncryptionKey4, kEncryptedMetadataBytes4,
+                              kMetadataEncryptionKeyTag4),
+  };
+  auto cert_store = NearbyShareCertificateStorageImpl::Factory::Create(
+      preference_manager_, std::move(db));
+
+  bool succeeded = false;
+  cert_store->UpdatePublicCertificates(
+      new_certs, [this, &succeeded](bool success) {
+        CaptureBoolCallback(&succeeded, success);
+      });
+
+  ASSERT_TRUE(succeeded);
+  auto cert_map = fake_db->GetCertificatesMap();
+  ASSERT_EQ(cert_map.size(), 3u);
+  ASSERT_EQ(cert_map.count(kSecretId1), 1u);
+  ASSERT_EQ(cert_map.count(kSecretId2), 1u);
+  ASSERT_EQ(cert_map.count(kSecretId4), 1u);
+  EXPECT_EQ(cert_map.find(kSecretId1)->second.secret_key(), kSecretKey1);
+  EXPECT_EQ(cert_map.find(kSecretId2)->second.secret_key(), kSecretKey4);
+  EXPECT_EQ(cert_map.find(kSecretId4)->second.secret_key(), kSecretKey4);
+
+  std::vector<std::string> ids = cert_store->GetPublicCertificateIds();
+  EXPECT_THAT(ids, UnorderedElementsAre(kSecretId1, kSecretId2, kSecretId4));
+  EXPECT_EQ(cert_store->NextPublicCertificateExpirationTime(),
+            TimestampToTime(new_certs[0].end_time()));
+  EXPECT_THAT(cert_store.use_count(), Eq(1));
+}
+
 TEST_F(NearbyShareCertificateStorageImplTest, ClearPublicCertificates) {
   auto db = std::make_unique<nearby::FakePublicCertificateDb>();
   nearby::FakePublicCertificateDb* fake_db = db.get();
@@ -0,0 +1,105 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sharing/certificates/nearby_share_public_certificate_cache.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "sharing/certificates/nearby_share_decrypted_public_certificate.h"
+#include "sharing/certificates/nearby_share_encrypted_metadata_key.h"
+#include "sharing/proto/rpc_resources.pb.h"
+
+namespace nearby {
+namespace sharing {
+namespace {
+
+using ::nearby::sharing::proto::PublicCertificate;
+
+std::string GetKey(
+    const NearbyShareEncryptedMetadataKey& encrypted_metadata_key) {
+  std::string key(encrypted_metadata_key.salt().begin(),
+                  encrypted_metadata_key.salt().end());
+  key.append(encrypted_metadata_key.encrypted_key().begin(),
+             encrypted_metadata_key.encrypted_key().end());
+  return key;
+}
+
+}  // namespace
+
+uint64_t NearbySharePublicCertificateCache::generation() const {
+  absl::MutexLock lock(&mutex_);
+  return generation_;
+}
+
+void NearbySharePublicCertificateCache::Load(
+    uint64_t generation, std::vector<PublicCertificate> public_certificates) {
+  absl::MutexLock lock(&mutex_);
+  if (generation != generation_) return;
+  public_certificates_ =
+      std::make_shared<const std::vector<PublicCertificate>>(
+          std::move(public_certificates));
+  remembered_keys_.clear();
+}
+
+void NearbySharePublicCertificateCache::Invalidate() {
+  absl::MutexLock lock(&mutex_);
+  ++generation_;
+  public_certificates_ = nullptr;
+  remembered_keys_.clear();
+}
+
+bool NearbySharePublicCertificateCache::TryDecryptPublicCertificate(
+    const NearbyShareEncryptedMetadataKey& encrypted_metadata_key,
+    std::optional<NearbyShareDecryptedPublicCertificate>* decrypted) {
+  std::string key = GetKey(encrypted_metadata_key);
+  std::shared_ptr<const std::vector<PublicCertificate>> public_certificates;
+  uint64_t generation;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (public_certificates_ == nullptr) return false;
+    auto it = remembered_keys_.find(key);
+    if (it != remembered_keys_.end()) {
+      *decrypted = it->second;
+      return true;
+    }
+    public_certificates = public_certificates_;
+    generation = generation_;
+  }
+
+  *decrypted = std::nullopt;
+  for (const PublicCertificate& certificate : *public_certificates) {
+    *decrypted = NearbyShareDecryptedPublicCertificate::DecryptPublicCertificate(
+        certificate, encrypted_metadata_key);
+    if (decrypted->has_value()) break;
+  }
+
+  absl::MutexLock lock(&mutex_);
+  if (generation != generation_) return true;
+  if (remembered_keys_.size() >= kMaxRememberedKeys) {
+    // Advertised salts rotate, so old keys are not worth keeping around.
+    remembered_keys_.clear();
+  }
+  remembered_keys_.emplace(std::move(key), *decrypted);
+  return true;
+}
+
+}  // namespace sharing
+}  // namespace nearby
@@ -0,0 +1,88 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_NEARBY_SHARING_CERTIFICATES_NEARBY_SHARE_PUBLIC_CERTIFICATE_CACHE_H_
+#define THIRD_PARTY_NEARBY_SHARING_CERTIFICATES_NEARBY_SHARE_PUBLIC_CERTIFICATE_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "sharing/certificates/nearby_share_decrypted_public_certificate.h"
+#include "sharing/certificates/nearby_share_encrypted_metadata_key.h"
+#include "sharing/proto/rpc_resources.pb.h"
+
+namespace nearby {
+namespace sharing {
+
+// Keeps the public certificates of NearbyShareCertificateStorage in memory so
+// that resolving an advertised encrypted metadata key does not read the whole
+// database every time.
+//
+// An encrypted metadata key can only be matched to its certificate by trying
+// to decrypt it with every certificate. Remote devices keep advertising the
+// same salt and encrypted key though, so the outcome of a lookup is remembered
+// and the same advertisement is resolved again without any decryption.
+//
+// The cache must be invalidated whenever the stored public certificates
+// change. The class is thread-safe.
+class NearbySharePublicCertificateCache {
+ public:
+  // Bounds the number of remembered encrypted metadata keys.
+  static constexpr size_t kMaxRememberedKeys = 128;
+
+  // Returns the current generation, to be passed to Load() along with
+  // certificates read from storage.
+  uint64_t generation() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Caches `public_certificates` read from storage, unless the cache was
+  // invalidated since `generation` was obtained.
+  void Load(uint64_t generation,
+            std::vector<nearby::sharing::proto::PublicCertificate>
+                public_certificates) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Drops the cached certificates and everything learned from them.
+  void Invalidate() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns false if no certificates are loaded. Otherwise sets `decrypted` to
+  // the certificate that decrypts `encrypted_metadata_key`, or std::nullopt if
+  // there is none, and returns true.
+  bool TryDecryptPublicCertificate(
+      const NearbyShareEncryptedMetadataKey& encrypted_metadata_key,
+      std::optional<NearbyShareDecryptedPublicCertificate>* decrypted)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  mutable absl::Mutex mutex_;
+  uint64_t generation_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Shared with lookups in progress, which decrypt outside of the lock.
+  std::shared_ptr<const std::vector<nearby::sharing::proto::PublicCertificate>>
+      public_certificates_ ABSL_GUARDED_BY(mutex_);
+  // Lookup results keyed by salt and encrypted key.
+  absl::flat_hash_map<std::string,
+                      std::optional<NearbyShareDecryptedPublicCertificate>>
+      remembered_keys_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace sharing
+}  // namespace nearby
+
+#endif  // THIRD_PARTY_NEARBY_SHARING_CERTIFICATES_NEARBY_SHARE_PUBLIC_CERTIFICATE_CACHE_H_
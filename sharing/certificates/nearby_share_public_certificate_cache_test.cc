@@ -0,0 +1,137 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sharing/certificates/nearby_share_public_certificate_cache.h"
+
+#include <stdint.h>
+
+#include <optional>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sharing/certificates/nearby_share_decrypted_public_certificate.h"
+#include "sharing/certificates/nearby_share_encrypted_metadata_key.h"
+#include "sharing/certificates/nearby_share_private_certificate.h"
+#include "sharing/certificates/test_util.h"
+#include "sharing/proto/enums.pb.h"
+#include "sharing/proto/rpc_resources.pb.h"
+
+namespace nearby {
+namespace sharing {
+namespace {
+
+using ::nearby::sharing::proto::DeviceVisibility;
+using ::nearby::sharing::proto::PublicCertificate;
+
+constexpr DeviceVisibility kVisibility =
+    DeviceVisibility::DEVICE_VISIBILITY_ALL_CONTACTS;
+
+// Returns certificates of which only the last one decrypts
+// GetNearbyShareTestEncryptedMetadataKey().
+std::vector<PublicCertificate> GetPublicCertificates() {
+  std::vector<PublicCertificate> certificates;
+  for (int i = 0; i < 3; ++i) {
+    NearbySharePrivateCertificate other(kVisibility,
+                                        GetNearbyShareTestNotBefore(),
+                                        GetNearbyShareTestMetadata());
+    certificates.push_back(*other.ToPublicCertificate());
+  }
+  certificates.push_back(GetNearbyShareTestPublicCertificate(kVisibility));
+  return certificates;
+}
+
+TEST(NearbySharePublicCertificateCacheTest, NotLoaded) {
+  NearbySharePublicCertificateCache cache;
+  std::optional<NearbyShareDecryptedPublicCertificate> decrypted;
+
+  EXPECT_FALSE(cache.TryDecryptPublicCertificate(
+      GetNearbyShareTestEncryptedMetadataKey(), &decrypted));
+}
+
+TEST(NearbySharePublicCertificateCacheTest, DecryptsWithLoadedCertificates) {
+  NearbySharePublicCertificateCache cache;
+  cache.Load(cache.generation(), GetPublicCertificates());
+  std::optional<NearbyShareDecryptedPublicCertificate> decrypted;
+
+  ASSERT_TRUE(cache.TryDecryptPublicCertificate(
+      GetNearbyShareTestEncryptedMetadataKey(), &decrypted));
+
+  ASSERT_TRUE(decrypted.has_value());
+  EXPECT_EQ(decrypted->id(), GetNearbyShareTestCertificateId());
+}
+
+TEST(NearbySharePublicCertificateCacheTest, RepeatedKeyIsRemembered) {
+  NearbySharePublicCertificateCache cache;
+  cache.Load(cache.generation(), GetPublicCertificates());
+  std::optional<NearbyShareDecryptedPublicCertificate> first;
+  std::optional<NearbyShareDecryptedPublicCertificate> second;
+
+  ASSERT_TRUE(cache.TryDecryptPublicCertificate(
+      GetNearbyShareTestEncryptedMetadataKey(), &first));
+  ASSERT_TRUE(cache.TryDecryptPublicCertificate(
+      GetNearbyShareTestEncryptedMetadataKey(), &second));
+
+  ASSERT_TRUE(first.has_value());
+  ASSERT_TRUE(second.has_value());
+  EXPECT_EQ(first->id(), second->id());
+  EXPECT_EQ(first->unencrypted_metadata().SerializeAsString(),
+            second->unencrypted_metadata().SerializeAsString());
+}
+
+TEST(NearbySharePublicCertificateCacheTest, UnknownKey) {
+  NearbySharePublicCertificateCache cache;
+  cache.Load(cache.generation(), GetPublicCertificates());
+  NearbySharePrivateCertificate unknown(kVisibility,
+                                        GetNearbyShareTestNotBefore(),
+                                        GetNearbyShareTestMetadata());
+  std::optional<NearbyShareEncryptedMetadataKey> key =
+      unknown.EncryptMetadataKey();
+  ASSERT_TRUE(key.has_value());
+
+  for (int i = 0; i < 2; ++i) {
+    std::optional<NearbyShareDecryptedPublicCertificate> decrypted;
+    ASSERT_TRUE(cache.TryDecryptPublicCertificate(*key, &decrypted));
+    EXPECT_FALSE(decrypted.has_value());
+  }
+}
+
+TEST(NearbySharePublicCertificateCacheTest, InvalidateDropsCertificates) {
+  NearbySharePublicCertificateCache cache;
+  cache.Load(cache.generation(), GetPublicCertificates());
+  std::optional<NearbyShareDecryptedPublicCertificate> decrypted;
+  ASSERT_TRUE(cache.TryDecryptPublicCertificate(
+      GetNearbyShareTestEncryptedMetadataKey(), &decrypted));
+
+  cache.Invalidate();
+
+  EXPECT_FALSE(cache.TryDecryptPublicCertificate(
+      GetNearbyShareTestEncryptedMetadataKey(), &decrypted));
+}
+
+TEST(NearbySharePublicCertificateCacheTest, StaleLoadIsIgnored) {
+  NearbySharePublicCertificateCache cache;
+  uint64_t generation = cache.generation();
+
+  // The certificates changed while they were being read.
+  cache.Invalidate();
+  cache.Load(generation, GetPublicCertificates());
+
+  std::optional<NearbyShareDecryptedPublicCertificate> decrypted;
+  EXPECT_FALSE(cache.TryDecryptPublicCertificate(
+      GetNearbyShareTestEncryptedMetadataKey(), &decrypted));
+}
+
+}  // namespace
+}  // namespace sharing
+}  // namespace nearby